@@ -458,6 +458,22 @@ static cfg_opt_t *cfg_dupopts(cfg_opt_t *opts)
    return dupopts;
 }
 
+cfg_t *cfg_newsection(cfg_t *cfg, cfg_opt_t *opt, const char *title)
+{
+   cfg_t *sec = estructalloc(cfg_t, 1);
+   cfg_assert(sec);
+   sec->namealloc = estrdup(opt->name); // haleyjd 04/14/11
+   sec->name      = sec->namealloc;
+   sec->opts      = cfg_dupopts(opt->subopts);
+   sec->flags     = cfg->flags;
+   sec->flags    |= CFGF_ALLOCATED;
+   sec->filename  = cfg->filename;
+   sec->line      = cfg->line;
+   sec->errfunc   = cfg->errfunc;
+   sec->title     = title ? estrdup(title) : nullptr;
+   return sec;
+}
+
 int cfg_parse_boolean(const char *s)
 {
    if(strcasecmp(s, "true") == 0 || 
@@ -594,17 +610,7 @@ cfg_value_t *cfg_setopt(cfg_t *cfg, cfg_opt_t *opt, const char *value)
    case CFGT_SEC:
    case CFGT_MVPROP: // haleyjd
       oldsection = val->section;
-      val->section = estructalloc(cfg_t, 1);
-      cfg_assert(val->section);
-      val->section->namealloc = estrdup(opt->name); // haleyjd 04/14/11
-      val->section->name      = val->section->namealloc;
-      val->section->opts      = cfg_dupopts(opt->subopts);
-      val->section->flags     = cfg->flags;
-      val->section->flags    |= CFGF_ALLOCATED;
-      val->section->filename  = cfg->filename;
-      val->section->line      = cfg->line;
-      val->section->errfunc   = cfg->errfunc;
-      val->section->title     = value ? estrdup(value) : nullptr;
+      val->section = cfg_newsection(cfg, opt, value);
       // haleyjd 01/02/12: make the old section a displaced version of the
       // new one, so that it can remain accessible
       val->section->displaced = oldsection;
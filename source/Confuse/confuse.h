@@ -585,6 +585,15 @@ int           cfg_getnflag(cfg_t *cfg, const char *name, unsigned int index);
 
 cfg_value_t *cfg_setopt(cfg_t *cfg, cfg_opt_t *opt, const char *value);
 
+/** Create an empty section for a section or multi-valued property option
+ * of cfg, set up as the parser would set it up. The section is not added
+ * to the option's values.
+ * @param cfg The configuration file context the option belongs to.
+ * @param opt The section or multi-valued property option.
+ * @param title The section's title, or nullptr.
+ */
+cfg_t *cfg_newsection(cfg_t *cfg, cfg_opt_t *opt, const char *title);
+
 /** Return the number of values this option has. If the option does
  * not have the CFGF_LIST or CFGF_MULTI flag set, this function will
  * always return 1.
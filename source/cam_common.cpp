@@ -58,53 +58,48 @@ PathTraverser::PathTraverser(const PTDef &indef, void *incontext) :
 //
 // Handles intercepts in order
 //
-bool PathTraverser::traverseIntercepts() const
+bool PathTraverser::traverseIntercepts()
 {
-   size_t    count;
-   fixed_t   dist;
-   divline_t dl;
-   PODCollection<intercept_t>::iterator scan, end, in;
-
-   count = intercepts.getLength();
-   end = intercepts.end();
+   const size_t count = intercepts.getLength();
+   divline_t    dl;
 
    //
    // calculate intercept distance
    //
-   for(scan = intercepts.begin(); scan < end; scan++)
+   for(intercept_t &in : intercepts)
    {
-      if(!scan->isaline)
+      if(!in.isaline)
          continue;   // ioanch 20151230: only lines need this treatment
-      P_MakeDivline(scan->d.line, &dl);
-      if(scan->frac = P_InterceptVector(&trace, &dl); scan->frac < 0)
-         scan->frac = D_MAXINT;
+      P_MakeDivline(in.d.line, &dl);
+      if(in.frac = P_InterceptVector(&trace, &dl); in.frac < 0)
+         in.frac = D_MAXINT;
    }
 
    //
    // go through in order
-   //	
-   in = nullptr; // shut up compiler warning
+   //
+   if(order.getLength() < count)
+      order.resize(count);
+   const size_t numorder = P_SortIntercepts(intercepts.begin(), count, D_MAXINT - 1,
+                                            order.begin());
 
-   while(count--)
+   intercept_t *in = nullptr;
+   for(size_t i = 0; i < numorder; i++)
    {
-      dist = D_MAXINT;
+      in = intercepts.begin() + uint32_t(order[i]);
+      if(!def.trav(in, context, trace))
+         return false; // don't bother going farther
 
-      for(scan = intercepts.begin(); scan < end; scan++)
-      {
-         if(scan->frac < dist)
-         {
-            dist = scan->frac;
-            in = scan;
-         }
-      }
-
-      if(in)
-      {
-         if(!def.trav(in, context, trace))
-            return false; // don't bother going farther
+      in->frac = D_MAXINT;
+   }
 
-         in->frac = D_MAXINT;
-      }
+   // The closest-first rescan this replaces never picked an intercept left
+   // at D_MAXINT, and instead visited the last one it did pick again (by
+   // then itself at D_MAXINT). Keep doing so, since demos depend on it.
+   for(size_t i = numorder; in && i < count; i++)
+   {
+      if(!def.trav(in, context, trace))
+         return false;
    }
 
    return true; // everything was traversed
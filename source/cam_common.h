@@ -69,7 +69,7 @@ private:
    bool checkLine(size_t linenum);
    bool blockLinesIterator(int x, int y);
    bool blockThingsIterator(int x, int y);
-   bool traverseIntercepts() const;
+   bool traverseIntercepts();
 
    const PTDef def;
    void *const context;
@@ -81,6 +81,7 @@ private:
       bool addedportal;
    } portalguard;
    PODCollection<intercept_t> intercepts;
+   PODCollection<uint64_t>    order; // traversal order of intercepts
 };
 
 //
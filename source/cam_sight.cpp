@@ -37,6 +37,7 @@
 #include "p_chase.h"
 #include "p_inter.h"    // ioanch 20160101: for damage
 #include "p_portal.h"
+#include "p_pvs.h"
 #include "p_map.h"      // ioanch 20160131: for use
 #include "p_maputl.h"
 #include "p_setup.h"
@@ -451,7 +452,9 @@ bool CamContext::checkSight(const camsightparams_t &params,
 
    bool result = false;
 
-   if(link || !(rejectmatrix[pnum >> 3] & (1 << (pnum & 7))))
+   // the sector PVS only covers sight within a portal group
+   if(link || (!(rejectmatrix[pnum >> 3] & (1 << (pnum & 7))) &&
+               (params.cgroupid != params.tgroupid || P_CheckSectorPVS(int(s1), int(s2)))))
    {
       // killough 4/19/98: make fake floors and ceilings block monster view
       if((csec->heightsec != -1 &&
@@ -0,0 +1,392 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Headless benchmark mode. Plays back a demo as fast as possible
+//  and records per-frame and per-tic phase timings, which are written out as
+//  CSV or JSON together with percentile summaries.
+//
+// Authors: agent
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+#include "z_zone.h"
+
+#include "d_bench.h"
+#include "d_main.h"
+#include "doomstat.h"
+#include "m_argv.h"
+#include "m_collection.h"
+#include "m_compare.h"
+#include "r_context.h"
+#include "v_misc.h"
+
+bool d_benchmark;
+bool d_benchheadless;
+
+static const char *benchdemo;
+static const char *benchfile = "benchmark.csv";
+
+static const char *const benchphasenames[NUMBENCHPHASES] =
+{
+   "ticker",
+   "render",
+   "bsp",
+   "planes",
+   "masked",
+   "blit",
+   "display",
+   "frame",
+};
+
+struct benchframe_t
+{
+   int     gametic;
+   int64_t ns[NUMBENCHPHASES];
+};
+
+struct benchtic_t
+{
+   int     gametic;
+   int64_t ns;
+};
+
+static PODCollection<benchframe_t> benchframes;
+static PODCollection<benchtic_t>   benchtics;
+
+// Render phases are added from every context's worker thread
+static std::atomic<int64_t> benchaccum[NUMBENCHPHASES];
+
+static int64_t benchframestart;
+static int64_t benchlastframeend;
+
+//
+// Monotonic time in nanoseconds
+//
+int64_t D_BenchNow()
+{
+   using namespace std::chrono;
+   return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//
+// Adds time to a phase of the current frame. Ticker time is also recorded
+// per tic, since a frame may run any number of them.
+//
+void D_BenchAddTime(benchphase_e phase, int64_t ns)
+{
+   benchaccum[phase].fetch_add(ns, std::memory_order_relaxed);
+
+   if(phase == BENCH_TICKER)
+      benchtics.add({ gametic, ns });
+}
+
+//
+// Checks for -benchmark <demo> [-benchfile <path>] [-benchwindow]. Must run
+// after the -nosound family has been parsed, since it overrides them.
+//
+void D_BenchInit()
+{
+   int p;
+
+   if(!(p = M_CheckParm("-benchmark")) || p >= myargc - 1)
+      return;
+
+   d_benchmark     = true;
+   d_benchheadless = !M_CheckParm("-benchwindow");
+   benchdemo       = myargv[p + 1];
+
+   // sound mixing would only add noise to the timings
+   nosfxparm   = true;
+   nomusicparm = true;
+
+   if((p = M_CheckParm("-benchfile")) && p < myargc - 1)
+      benchfile = myargv[p + 1];
+}
+
+//
+// Called at the start of D_Display
+//
+void D_BenchBeginFrame()
+{
+   if(d_benchmark)
+      benchframestart = D_BenchNow();
+}
+
+//
+// Called at the end of D_Display. Takes everything accumulated since the
+// previous frame and records it as this frame.
+//
+void D_BenchEndFrame()
+{
+   if(!d_benchmark)
+      return;
+
+   const int64_t now = D_BenchNow();
+   benchframe_t  frame;
+
+   frame.gametic = gametic;
+   for(int i = 0; i < NUMBENCHPHASES; i++)
+      frame.ns[i] = benchaccum[i].exchange(0, std::memory_order_relaxed);
+
+   frame.ns[BENCH_DISPLAY] = now - benchframestart;
+   frame.ns[BENCH_FRAME]   = benchlastframeend ? now - benchlastframeend
+                                               : frame.ns[BENCH_DISPLAY];
+   benchlastframeend = now;
+
+   benchframes.add(frame);
+}
+
+//=============================================================================
+//
+// Report
+//
+
+struct benchstats_t
+{
+   double mean, p50, p90, p95, p99, max;
+};
+
+static double D_nsToMS(int64_t ns)
+{
+   return ns / 1000000.0;
+}
+
+//
+// Nearest-rank percentile of an already sorted set of samples
+//
+static double D_benchPercentile(const PODCollection<int64_t> &sorted, double pct)
+{
+   const size_t n = sorted.getLength();
+   size_t rank = size_t(pct / 100.0 * n + 0.999999);
+
+   rank = emax<size_t>(rank, 1);
+   rank = emin(rank, n);
+   return D_nsToMS(sorted[rank - 1]);
+}
+
+static benchstats_t D_benchStats(PODCollection<int64_t> &samples)
+{
+   benchstats_t stats = {};
+   const size_t n     = samples.getLength();
+
+   if(!n)
+      return stats;
+
+   std::sort(samples.begin(), samples.end());
+
+   int64_t total = 0;
+   for(int64_t sample : samples)
+      total += sample;
+
+   stats.mean = D_nsToMS(total) / n;
+   stats.p50  = D_benchPercentile(samples, 50.0);
+   stats.p90  = D_benchPercentile(samples, 90.0);
+   stats.p95  = D_benchPercentile(samples, 95.0);
+   stats.p99  = D_benchPercentile(samples, 99.0);
+   stats.max  = D_nsToMS(samples[n - 1]);
+   return stats;
+}
+
+//
+// Stats for one phase over all frames
+//
+static benchstats_t D_benchPhaseStats(int phase)
+{
+   PODCollection<int64_t> samples;
+
+   for(const benchframe_t &frame : benchframes)
+      samples.add(frame.ns[phase]);
+
+   return D_benchStats(samples);
+}
+
+static benchstats_t D_benchTicStats()
+{
+   PODCollection<int64_t> samples;
+
+   for(const benchtic_t &tic : benchtics)
+      samples.add(tic.ns);
+
+   return D_benchStats(samples);
+}
+
+static double D_benchSeconds()
+{
+   int64_t total = 0;
+   for(const benchframe_t &frame : benchframes)
+      total += frame.ns[BENCH_FRAME];
+   return total / 1000000000.0;
+}
+
+//
+// Writes one row per frame, one per tic and one per summary statistic. Tic
+// rows only fill in the ticker column.
+//
+static void D_benchWriteCSV(FILE *f)
+{
+   fputs("type,index,gametic", f);
+   for(const char *name : benchphasenames)
+      fprintf(f, ",%s_ms", name);
+   fputc('\n', f);
+
+   for(size_t i = 0; i < benchframes.getLength(); i++)
+   {
+      const benchframe_t &frame = benchframes[i];
+
+      fprintf(f, "frame,%u,%d", unsigned(i), frame.gametic);
+      for(int64_t ns : frame.ns)
+         fprintf(f, ",%.4f", D_nsToMS(ns));
+      fputc('\n', f);
+   }
+
+   for(size_t i = 0; i < benchtics.getLength(); i++)
+   {
+      fprintf(f, "tic,%u,%d,%.4f", unsigned(i), benchtics[i].gametic,
+              D_nsToMS(benchtics[i].ns));
+      for(int phase = BENCH_TICKER + 1; phase < NUMBENCHPHASES; phase++)
+         fputc(',', f);
+      fputc('\n', f);
+   }
+
+   benchstats_t stats[NUMBENCHPHASES];
+   for(int phase = 0; phase < NUMBENCHPHASES; phase++)
+      stats[phase] = D_benchPhaseStats(phase);
+
+   static const char *const statnames[] = { "mean", "p50", "p90", "p95", "p99", "max" };
+   static double benchstats_t::*const statfields[] =
+   {
+      &benchstats_t::mean, &benchstats_t::p50, &benchstats_t::p90,
+      &benchstats_t::p95,  &benchstats_t::p99, &benchstats_t::max
+   };
+
+   for(size_t s = 0; s < earrlen(statnames); s++)
+   {
+      fprintf(f, "summary,%s,", statnames[s]);
+      for(const benchstats_t &phasestats : stats)
+         fprintf(f, ",%.4f", phasestats.*statfields[s]);
+      fputc('\n', f);
+   }
+}
+
+static void D_benchWriteJSONStats(FILE *f, const benchstats_t &stats)
+{
+   fprintf(f, "{ \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, "
+              "\"p99\": %.4f, \"max\": %.4f }",
+           stats.mean, stats.p50, stats.p90, stats.p95, stats.p99, stats.max);
+}
+
+//
+// Writes str as a quoted JSON string
+//
+static void D_benchWriteJSONString(FILE *f, const char *str)
+{
+   fputc('"', f);
+   for(const unsigned char *c = reinterpret_cast<const unsigned char *>(str); *c; c++)
+   {
+      if(*c == '"' || *c == '\\')
+         fprintf(f, "\\%c", *c);
+      else if(*c < 0x20)
+         fprintf(f, "\\u%04x", *c);
+      else
+         fputc(*c, f);
+   }
+   fputc('"', f);
+}
+
+static void D_benchWriteJSON(FILE *f)
+{
+   const double seconds = D_benchSeconds();
+
+   fputs("{\n", f);
+   fputs("  \"demo\": ", f);
+   D_benchWriteJSONString(f, benchdemo);
+   fputs(",\n", f);
+   fprintf(f, "  \"width\": %d,\n  \"height\": %d,\n", video.width, video.height);
+   fprintf(f, "  \"contexts\": %d,\n", r_numcontexts);
+   fprintf(f, "  \"gametics\": %d,\n", gametic);
+   fprintf(f, "  \"frames\": %u,\n", unsigned(benchframes.getLength()));
+   fprintf(f, "  \"seconds\": %.4f,\n", seconds);
+   fprintf(f, "  \"fps\": %.2f,\n", seconds > 0 ? benchframes.getLength() / seconds : 0.0);
+
+   fputs("  \"summary\": {\n", f);
+   for(int phase = 0; phase < NUMBENCHPHASES; phase++)
+   {
+      fprintf(f, "    \"%s\": ", benchphasenames[phase]);
+      D_benchWriteJSONStats(f, D_benchPhaseStats(phase));
+      fputs(",\n", f);
+   }
+   fputs("    \"tic\": ", f);
+   D_benchWriteJSONStats(f, D_benchTicStats());
+   fputs("\n  },\n", f);
+
+   fputs("  \"frame_ms\": [\n", f);
+   for(size_t i = 0; i < benchframes.getLength(); i++)
+   {
+      const benchframe_t &frame = benchframes[i];
+
+      fprintf(f, "    { \"gametic\": %d", frame.gametic);
+      for(int phase = 0; phase < NUMBENCHPHASES; phase++)
+         fprintf(f, ", \"%s\": %.4f", benchphasenames[phase], D_nsToMS(frame.ns[phase]));
+      fprintf(f, " }%s\n", i + 1 < benchframes.getLength() ? "," : "");
+   }
+   fputs("  ],\n", f);
+
+   fputs("  \"tic_ms\": [\n", f);
+   for(size_t i = 0; i < benchtics.getLength(); i++)
+   {
+      fprintf(f, "    { \"gametic\": %d, \"ticker\": %.4f }%s\n", benchtics[i].gametic,
+              D_nsToMS(benchtics[i].ns), i + 1 < benchtics.getLength() ? "," : "");
+   }
+   fputs("  ]\n}\n", f);
+}
+
+//
+// Writes the -benchfile report. JSON if the file name ends in .json, CSV
+// otherwise. Called from G_CheckDemoStatus when the demo ends.
+//
+void D_BenchWriteReport()
+{
+   if(!d_benchmark)
+      return;
+
+   FILE *f;
+   if(!(f = fopen(benchfile, "w")))
+   {
+      usermsg("D_BenchWriteReport: failed opening '%s'\n", benchfile);
+      return;
+   }
+
+   const size_t len = strlen(benchfile);
+   if(len >= 5 && !strcasecmp(benchfile + len - 5, ".json"))
+      D_benchWriteJSON(f);
+   else
+      D_benchWriteCSV(f);
+
+   fclose(f);
+
+   const benchstats_t frame = D_benchPhaseStats(BENCH_FRAME);
+   usermsg("Benchmark: %u frames, mean %.2f ms, p99 %.2f ms, written to '%s'\n",
+           unsigned(benchframes.getLength()), frame.mean, frame.p99, benchfile);
+}
+
+// EOF
+
@@ -0,0 +1,89 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Headless benchmark mode. Plays back a demo as fast as possible
+//  and records per-frame and per-tic phase timings, which are written out as
+//  CSV or JSON together with percentile summaries.
+//
+// Authors: agent
+//
+
+#ifndef D_BENCH_H__
+#define D_BENCH_H__
+
+#include <stdint.h>
+
+//
+// Timed phases. BSP covers the main BSP walk and all portal views. BSP,
+// planes and masked are summed over all render contexts, so with several
+// contexts they are CPU time rather than wall time; render is wall time.
+//
+enum benchphase_e
+{
+   BENCH_TICKER,  // P_Ticker (the last frame's tics)
+   BENCH_RENDER,  // R_RenderPlayerView
+   BENCH_BSP,     // R_RenderBSPNode and R_RenderPortals
+   BENCH_PLANES,  // R_DrawPlanes
+   BENCH_MASKED,  // R_DrawPostBSP
+   BENCH_BLIT,    // I_FinishUpdate
+   BENCH_DISPLAY, // all of D_Display
+   BENCH_FRAME,   // wall time since the end of the previous frame
+   NUMBENCHPHASES
+};
+
+extern bool d_benchmark;     // -benchmark is running
+extern bool d_benchheadless; // no window; render into system memory
+
+int64_t D_BenchNow();
+void    D_BenchAddTime(benchphase_e phase, int64_t ns);
+
+void D_BenchInit();
+void D_BenchBeginFrame();
+void D_BenchEndFrame();
+void D_BenchWriteReport();
+
+//
+// Times the enclosing scope into a phase. Costs a single flag test when no
+// benchmark is running.
+//
+class BenchScope
+{
+public:
+   explicit BenchScope(benchphase_e inPhase)
+      : phase(inPhase), start(d_benchmark ? D_BenchNow() : 0)
+   {
+   }
+   ~BenchScope()
+   {
+      if(d_benchmark)
+         D_BenchAddTime(phase, D_BenchNow() - start);
+   }
+
+   BenchScope(const BenchScope &) = delete;
+   BenchScope &operator = (const BenchScope &) = delete;
+
+private:
+   benchphase_e phase;
+   int64_t      start;
+};
+
+#endif
+
+// EOF
+
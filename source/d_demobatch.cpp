@@ -0,0 +1,486 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Batch demo verification. Plays every demo listed in a manifest
+//  headless, spread over worker processes, checks each against reference
+//  checksums and writes a summary of desyncs and timings.
+//
+// Authors: agent
+//
+
+#include <chrono>
+#include <thread>
+
+#include "z_zone.h"
+#include "hal/i_directory.h"
+#include "hal/i_process.h"
+
+#include "d_bench.h"
+#include "d_demobatch.h"
+#include "d_main.h"
+#include "m_argv.h"
+#include "m_collection.h"
+#include "m_ctype.h"
+#include "m_qstr.h"
+#include "m_utils.h"
+
+bool d_batchworker;
+
+enum batchstatus_e
+{
+   BATCH_OK,         // matched the reference, or exited its last level
+   BATCH_DESYNC,     // checksums differ from the reference
+   BATCH_UNFINISHED, // no reference, and the last level was not exited
+   BATCH_NOEND,      // never got to the end of the demo
+   BATCH_NOSTART,    // the worker could not be started
+   NUMBATCHSTATUS
+};
+
+static const char *const batchStatusNames[NUMBATCHSTATUS] =
+{
+   "ok", "desync", "unfinished", "noend", "nostart"
+};
+
+//
+// One demo of the batch, and the worker playing it.
+//
+struct batchdemo_t
+{
+   char         *demo;      // demo file
+   size_t        firstarg;  // -iwad, -file and extra arguments in batchArgs
+   size_t        numargs;
+   hal_process_t proc;      // worker playing it
+   int64_t       starttime; // when the worker was started
+   double        seconds;   // wall-clock time the worker took
+   int           exitcode;
+   int           tics;      // tics played, from the checksum file
+   int           desynctic; // first tic unlike the reference, or -1
+   batchstatus_e status;
+};
+
+static PODCollection<batchdemo_t>  batchDemos;
+static PODCollection<char *>       batchArgs;
+static PODCollection<const char *> batchPassArgs; // our own, for every worker
+
+static const char *batchOut = "demobatch";
+static const char *batchRef;
+
+//=============================================================================
+//
+// Manifest
+//
+// One demo per line: the demo, the IWAD it's for, and any PWADs, optionally
+// followed by -- and more arguments for the worker playing it. # starts a
+// comment, and double quotes group a name with spaces in it.
+//
+
+//
+// Gets the next token of a manifest line, leaving p after it. Returns false
+// at the end of the line.
+//
+static bool D_batchToken(const char *&p, qstring &token)
+{
+   while(*p != '\n' && ectype::isSpace(*p))
+      ++p;
+
+   if(!*p || *p == '\n')
+      return false;
+
+   token.clear();
+
+   if(*p == '"')
+   {
+      ++p;
+      while(*p && *p != '"' && *p != '\n')
+         token += *p++;
+      if(*p == '"')
+         ++p;
+   }
+   else
+   {
+      while(*p && !ectype::isSpace(*p))
+         token += *p++;
+   }
+
+   return true;
+}
+
+static void D_readBatchManifest(const char *filename)
+{
+   char *text = M_LoadStringFromFile(filename);
+   qstring token;
+   int linenum = 0;
+
+   if(!text)
+      I_Error("D_DemoBatchInit: cannot read manifest %s\n", filename);
+
+   for(const char *p = text; *p; )
+   {
+      batchdemo_t bd = {};
+      int  field      = 0;
+      bool havefile   = false;
+      bool extra      = false;
+
+      ++linenum;
+      bd.firstarg  = batchArgs.getLength();
+      bd.desynctic = -1;
+
+      while(D_batchToken(p, token))
+      {
+         if(!field && token[0] == '#')
+            break;
+
+         if(field == 0)
+            bd.demo = token.duplicate();
+         else if(field == 1)
+         {
+            batchArgs.add(estrdup("-iwad"));
+            batchArgs.add(token.duplicate());
+         }
+         else if(!extra && token == "--")
+            extra = true;
+         else
+         {
+            if(!extra && !havefile)
+            {
+               batchArgs.add(estrdup("-file"));
+               havefile = true;
+            }
+            batchArgs.add(token.duplicate());
+         }
+         ++field;
+      }
+
+      // skip comments and to the next line
+      while(*p && *p++ != '\n');
+
+      if(field == 1)
+         I_Error("D_DemoBatchInit: %s line %d: no IWAD given\n", filename, linenum);
+      if(field)
+      {
+         bd.numargs = batchArgs.getLength() - bd.firstarg;
+         batchDemos.add(bd);
+      }
+   }
+
+   efree(text);
+}
+
+//=============================================================================
+//
+// Workers
+//
+
+//
+// Gets the name a demo's output files go by. The index keeps demos with the
+// same file name apart.
+//
+static void D_batchFileName(size_t index, const char *ext, qstring &path)
+{
+   qstring demo(batchDemos[index].demo), base, fn;
+   size_t  dot;
+
+   demo.normalizeSlashes();
+   demo.extractFileBase(base);
+   if((dot = base.findLastOf('.')) != qstring::npos)
+      base.truncate(dot);
+
+   fn.Printf(0, "%03d_%s.%s", int(index), base.constPtr(), ext);
+   path = batchOut;
+   path.pathConcatenate(fn.constPtr());
+}
+
+//
+// Starts a worker playing one demo, with its output going to a file.
+//
+static bool D_startBatchWorker(size_t index)
+{
+   batchdemo_t &bd = batchDemos[index];
+   PODCollection<const char *> argv;
+   qstring logfile, sumfile, outfile;
+
+   D_batchFileName(index, "log", logfile);
+   D_batchFileName(index, "sum", sumfile);
+   D_batchFileName(index, "out", outfile);
+   remove(sumfile.constPtr()); // so a stale one can't pass for this run
+
+   argv.add(myargv[0]);
+   for(size_t i = 0; i < bd.numargs; i++)
+      argv.add(batchArgs[bd.firstarg + i]);
+   for(const char *arg : batchPassArgs)
+      argv.add(arg);
+
+   argv.add("-fastdemo");
+   argv.add(bd.demo);
+   argv.add("-nodraw");
+   argv.add("-nosound");
+   argv.add("-noedfcache");
+   argv.add("-notexcache");
+   argv.add("-demolog");
+   argv.add(logfile.constPtr());
+   argv.add("-demochecksums");
+   argv.add(sumfile.constPtr());
+   argv.add("-batchworker");
+   argv.add(nullptr);
+
+   bd.starttime = D_BenchNow();
+   return I_StartProcess(&argv[0], outfile.constPtr(), bd.proc);
+}
+
+//
+// Gets the tic a line of a checksum file is for.
+//
+static int D_sumLineTic(const char *line)
+{
+   if(!strncmp(line, "end\t", 4))
+      line += 4;
+   return atoi(line);
+}
+
+//
+// Works out how a demo went from the checksum file its worker wrote, and
+// the reference one if there is one. -fastdemo exits with an error at the
+// end of a demo, so the exit code is no help in telling.
+//
+static void D_checkBatchDemo(size_t index)
+{
+   batchdemo_t &bd = batchDemos[index];
+   qstring sumfile;
+
+   D_batchFileName(index, "sum", sumfile);
+
+   char *text = M_LoadStringFromFile(sumfile.constPtr());
+   const char *end = text ? strstr(text, "end\t") : nullptr;
+
+   if(!end)
+   {
+      bd.status = BATCH_NOEND;
+      if(text)
+         efree(text);
+      return;
+   }
+
+   char result[16] = "";
+   sscanf(end, "end\t%d\t%15s", &bd.tics, result);
+
+   char *ref = nullptr;
+   if(batchRef)
+   {
+      qstring fn, refpath;
+
+      sumfile.extractFileBase(fn);
+      refpath = batchRef;
+      refpath.pathConcatenate(fn.constPtr());
+      ref = M_LoadStringFromFile(refpath.constPtr());
+   }
+
+   if(ref)
+   {
+      const char *a = text, *b = ref;
+
+      bd.status = BATCH_OK;
+      while(*a || *b)
+      {
+         const size_t alen = strcspn(a, "\n"), blen = strcspn(b, "\n");
+
+         if(alen != blen || strncmp(a, b, alen))
+         {
+            bd.status    = BATCH_DESYNC;
+            bd.desynctic = D_sumLineTic(*a ? a : b);
+            break;
+         }
+         a += alen + (a[alen] == '\n');
+         b += blen + (b[blen] == '\n');
+      }
+      efree(ref);
+   }
+   else
+      bd.status = strcmp(result, "exited") ? BATCH_UNFINISHED : BATCH_OK;
+
+   efree(text);
+}
+
+//
+// Runs every demo of the batch, keeping up to numjobs workers going at once.
+//
+static void D_runBatch(int numjobs)
+{
+   PODCollection<size_t> running;
+   size_t next = 0, done = 0;
+   const size_t total = batchDemos.getLength();
+
+   while(done < total)
+   {
+      while(next < total && running.getLength() < size_t(numjobs))
+      {
+         if(D_startBatchWorker(next))
+            running.add(next);
+         else
+         {
+            batchDemos[next].status   = BATCH_NOSTART;
+            batchDemos[next].exitcode = -1;
+            usermsg("[%u/%u] %s: could not start a worker\n",
+                    unsigned(++done), unsigned(total), batchDemos[next].demo);
+         }
+         ++next;
+      }
+
+      bool finished = false;
+      for(size_t i = 0; i < running.getLength(); )
+      {
+         batchdemo_t &bd = batchDemos[running[i]];
+
+         if(!I_PollProcess(bd.proc, bd.exitcode))
+         {
+            ++i;
+            continue;
+         }
+
+         bd.seconds = double(D_BenchNow() - bd.starttime) / 1e9;
+         D_checkBatchDemo(running[i]);
+
+         if(bd.status == BATCH_DESYNC)
+         {
+            usermsg("[%u/%u] %s: desync at tic %d (%.1fs)\n", unsigned(++done),
+                    unsigned(total), bd.demo, bd.desynctic, bd.seconds);
+         }
+         else
+         {
+            usermsg("[%u/%u] %s: %s, %d tics (%.1fs)\n", unsigned(++done),
+                    unsigned(total), bd.demo, batchStatusNames[bd.status],
+                    bd.tics, bd.seconds);
+         }
+
+         running[i] = running.back();
+         running.pop();
+         finished = true;
+      }
+
+      if(!finished)
+         std::this_thread::sleep_for(std::chrono::milliseconds(5));
+   }
+}
+
+//
+// Writes out a line per demo for whatever looks at the results next.
+//
+static void D_writeBatchSummary()
+{
+   qstring path(batchOut);
+   FILE *f;
+
+   path.pathConcatenate("summary.csv");
+   if(!(f = fopen(path.constPtr(), "wt")))
+   {
+      usermsg("Could not write %s\n", path.constPtr());
+      return;
+   }
+
+   fputs("index,demo,status,tics,desync_tic,seconds,exit_code\n", f);
+   for(size_t i = 0; i < batchDemos.getLength(); i++)
+   {
+      const batchdemo_t &bd = batchDemos[i];
+
+      fprintf(f, "%u,\"%s\",%s,%d,%d,%.3f,%d\n", unsigned(i), bd.demo,
+              batchStatusNames[bd.status], bd.tics, bd.desynctic, bd.seconds,
+              bd.exitcode);
+   }
+
+   fclose(f);
+}
+
+//
+// Checks for -demobatch, and if it's given, plays the whole batch and exits
+// before anything else is started up. Arguments besides those for the batch
+// itself are passed on to every worker.
+//
+void D_DemoBatchInit()
+{
+   int p;
+
+   d_batchworker = !!M_CheckParm("-batchworker");
+
+   if(!(p = M_CheckParm("-demobatch")) || p >= myargc - 1)
+      return;
+
+   const char *manifest = myargv[p + 1];
+   int numjobs = int(std::thread::hardware_concurrency());
+   PODCollection<int> ownargs;
+
+   ownargs.add(p);
+   if((p = M_CheckParm("-batchjobs")) && p < myargc - 1)
+   {
+      numjobs = atoi(myargv[p + 1]);
+      ownargs.add(p);
+   }
+   if((p = M_CheckParm("-batchout")) && p < myargc - 1)
+   {
+      batchOut = myargv[p + 1];
+      ownargs.add(p);
+   }
+   if((p = M_CheckParm("-batchref")) && p < myargc - 1)
+   {
+      batchRef = myargv[p + 1];
+      ownargs.add(p);
+   }
+   if(numjobs < 1)
+      numjobs = 1;
+
+   for(int i = 1; i < myargc; i++)
+   {
+      bool own = false;
+
+      for(int arg : ownargs)
+      {
+         if(i == arg || i == arg + 1)
+            own = true;
+      }
+      if(!own)
+         batchPassArgs.add(myargv[i]);
+   }
+
+   D_readBatchManifest(manifest);
+   if(batchDemos.isEmpty())
+      I_Error("D_DemoBatchInit: no demos in %s\n", manifest);
+
+   I_CreateDirectory(qstring(batchOut));
+
+   usermsg("Playing %u demos with %d workers\n", unsigned(batchDemos.getLength()),
+           numjobs);
+
+   const int64_t starttime = D_BenchNow();
+   D_runBatch(numjobs);
+   const double seconds = double(D_BenchNow() - starttime) / 1e9;
+
+   D_writeBatchSummary();
+
+   int counts[NUMBATCHSTATUS] = {};
+   for(const batchdemo_t &bd : batchDemos)
+      ++counts[bd.status];
+
+   usermsg("%d ok, %d desynced, %d unfinished, %d did not end, %d did not start "
+           "in %.1fs\n", counts[BATCH_OK], counts[BATCH_DESYNC],
+           counts[BATCH_UNFINISHED], counts[BATCH_NOEND], counts[BATCH_NOSTART],
+           seconds);
+
+   exit(counts[BATCH_OK] == int(batchDemos.getLength()) ? 0 : 1);
+}
+
+// EOF
+
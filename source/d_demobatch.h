@@ -0,0 +1,37 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Batch demo verification. Plays every demo listed in a manifest
+//  headless, spread over worker processes, checks each against reference
+//  checksums and writes a summary of desyncs and timings.
+//
+// Authors: agent
+//
+
+#ifndef D_DEMOBATCH_H__
+#define D_DEMOBATCH_H__
+
+extern bool d_batchworker; // this process is playing one demo of a batch
+
+void D_DemoBatchInit();
+
+#endif
+
+// EOF
+
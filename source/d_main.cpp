@@ -39,8 +39,10 @@
 #include "c_io.h"
 #include "c_net.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_deh.h"      // Ty 04/08/98 - Externalizations
 #include "d_dehtbl.h"
+#include "d_demobatch.h"
 #include "d_event.h"
 #include "d_files.h"
 #include "d_gi.h"
@@ -75,6 +77,7 @@
 #include "p_chase.h"
 #include "p_setup.h"
 #include "r_draw.h"
+#include "r_dynres.h"
 #include "r_main.h"
 #include "r_patch.h"
 #include "s_sound.h"
@@ -576,6 +579,8 @@ static void D_Display()
       return;
 
    i_haltimer.StartDisplay();
+   D_BenchBeginFrame();
+   R_DynResBeginFrame();
 
    if(setsizeneeded)            // change the view size if needed
    {
@@ -717,9 +722,15 @@ static void D_Display()
    if(printstats)
       D_showMemStats();
 #endif
+
+   R_DynResEndFrame();
    
-   I_FinishUpdate();              // page flip or blit buffer
+   {
+      BenchScope bench(BENCH_BLIT);
+      I_FinishUpdate();           // page flip or blit buffer
+   }
 
+   D_BenchEndFrame();
    i_haltimer.EndDisplay();
 }
 
@@ -1270,6 +1281,9 @@ static void D_DoomInit()
 
    FindResponseFile(); // Append response file arguments to command-line
 
+   // play a batch of demos and exit, if asked to
+   D_DemoBatchInit();
+
    // haleyjd 08/18/07: set base path and user path
    D_SetBasePath();
    D_SetUserPath();
@@ -1420,6 +1434,8 @@ static void D_DoomInit()
    // ioanch 20160313: demo testing
    if((p = M_CheckParm("-demolog")) && p < myargc - 1)
       G_DemoLogInit(myargv[p + 1]);
+   if((p = M_CheckParm("-demochecksums")) && p < myargc - 1)
+      G_DemoLogChecksumInit(myargv[p + 1]);
 
    // haleyjd 01/17/11: allow -play also
    const char *playdemoparms[] = { "-playdemo", "-play", nullptr };
@@ -1428,6 +1444,8 @@ static void D_DoomInit()
    {
       if((p = M_CheckParm("-fastdemo")) && p < myargc-1)  // killough
          fastdemo = true;            // run at fastest speed possible
+      else if((p = M_CheckParm("-benchmark")) && p < myargc-1)
+         fastdemo = true;
       else
          p = M_CheckParm("-timedemo");
    }
@@ -1532,6 +1550,9 @@ static void D_DoomInit()
    }
    //jff end of sound/music command line parms
 
+   // -benchmark overrides the sound parms, so check it after them
+   D_BenchInit();
+
    // killough 3/2/98: allow -nodraw -noblit generally
    nodrawers = !!M_CheckParm("-nodraw");
    noblit    = !!M_CheckParm("-noblit");
@@ -1851,7 +1872,15 @@ static void D_DoomInit()
       }
    }
 
-   if((p = M_CheckParm("-fastdemo")) && ++p < myargc)
+   if((p = M_CheckParm("-benchmark")) && ++p < myargc)
+   {
+      // a -fastdemo that records its timings with d_bench
+      fastdemo = true;
+      timingdemo = true;
+      G_DeferedPlayDemo(myargv[p]);
+      singledemo = true;
+   }
+   else if((p = M_CheckParm("-fastdemo")) && ++p < myargc)
    {                                 // killough
       fastdemo = true;                // run at fastest speed possible
       timingdemo = true;              // show stats after quit
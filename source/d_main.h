@@ -47,10 +47,11 @@ extern bool clfastparm;    // checkparm of -fast
 extern bool nodrawers;
 extern bool nosfxparm;
 extern bool nomusicparm;
+extern bool d_benchheadless;
 
 inline static bool D_noWindow()
 {
-   return nodrawers && nosfxparm && nomusicparm;
+   return (nodrawers || d_benchheadless) && nosfxparm && nomusicparm;
 }
 
 extern int use_startmap;
@@ -98,6 +98,7 @@
 
 #include "e_lib.h"
 #include "e_edf.h"
+#include "e_edfcache.h"
 
 #include "e_anim.h"
 #include "e_args.h"
@@ -572,6 +573,7 @@ static int bex_include(cfg_t *cfg, cfg_opt_t *opt, int argc,
 
    // queue the file for later processing
    D_QueueDEH(filename, 0);
+   E_EDFCacheAddDEH(filename);
 
    return 0;
 }
@@ -845,6 +847,7 @@ static int edf_enable(cfg_t *cfg, cfg_opt_t *opt, int argc,
    }
 
    edf_enables[idx].enabled = 1;
+   E_EDFCacheSetEnable(edf_enables[idx].name, 1);
    return 0;
 }
 
@@ -875,6 +878,7 @@ static int edf_disable(cfg_t *cfg, cfg_opt_t *opt, int argc,
         (GameModeInfo->type == Game_Heretic && idx == ENABLE_HERETIC)))
    {
       edf_enables[idx].enabled = 0;
+      E_EDFCacheSetEnable(edf_enables[idx].name, 0);
    }
 
    return 0;
@@ -1078,6 +1082,11 @@ static void E_ParseLumpRecursive(cfg_t *cfg, const char *name, int ln)
       {
          int err;
 
+         // empty lumps are skipped without being opened, but the EDF cache
+         // must still notice if they gain any content
+         if(!lumpinfo[ln]->size)
+            E_EDFCacheAddEmptyLump(name, ln);
+
          // try to parse it
          if((err = cfg_parselump(cfg, name, ln)))
          {
@@ -1772,7 +1781,14 @@ void E_ProcessEDF(const char *filename)
    // haleyjd 03/21/10: All parsing is now streamlined into a single process,
    // using the unified cfg_t object created above.
    //
-   E_ParseEDF(cfg, filename);
+   // The parse is skipped when the EDF cache holds its result for the very
+   // same sources, and the cache is rewritten whenever it doesn't.
+   //
+   if(!E_LoadEDFCache(cfg, filename, edf_enables))
+   {
+      E_ParseEDF(cfg, filename);
+      E_SaveEDFCache(cfg);
+   }
 
    //
    // Processing
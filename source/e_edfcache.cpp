@@ -0,0 +1,891 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: On-disk cache of the parsed EDF definition tree, so that the
+//  text of every EDF source needn't be parsed again on the next launch.
+//
+//  What is cached is the libConfuse tree as it stands after the parsing
+//  phase, together with what the parse did besides filling it in: the
+//  DeHackEd files it queued, the enable values it changed and the sources
+//  it recorded for include tracking. Processing then runs on the tree as
+//  usual.
+//
+//  The cache is keyed by a SHA1 over the build, the option tables, the
+//  game type, the starting enable values, the root file name and the names
+//  of all global lumps, which between them decide what the parse would
+//  read. The file then lists every source the parse read, with its size
+//  and CRC32, and every userinclude file that was absent; the cache is used
+//  only if all of them are still the same.
+//
+// Authors: agent
+//
+
+#include "z_zone.h"
+#include "i_system.h"
+
+#include "Confuse/confuse.h"
+
+#include "d_dehtbl.h"
+#include "d_gi.h"
+#include "d_io.h"
+#include "doomstat.h"
+#include "e_edf.h"
+#include "e_edfcache.h"
+#include "e_lib.h"
+#include "hal/i_filemap.h"
+#include "m_argv.h"
+#include "m_buffer.h"
+#include "m_collection.h"
+#include "m_hash.h"
+#include "m_qstr.h"
+#include "m_utils.h"
+#include "version.h"
+#include "w_wad.h"
+
+#define EDFCACHE_FILENAME "edfcache.bin"
+#define EDFCACHE_MAGIC    "EEDF"
+#define EDFCACHE_VERSION  1
+
+// deepest nesting of sections accepted from the cache file
+#define EDFCACHE_MAXDEPTH 64
+
+// length written for a null string
+#define EDFCACHE_NULLSTR 0xFFFFFFFFu
+
+enum edfsourcetype_e
+{
+   EDFSOURCE_DATA,        // a file or lump that was read
+   EDFSOURCE_EMPTYLUMP,   // an empty root lump, which is never read
+   EDFSOURCE_MISSINGFILE, // a userinclude file that wasn't there
+};
+
+struct edfsource_t
+{
+   qstring  name;
+   int      type;
+   int      lumpnum; // -1 for files
+   uint32_t size;
+   uint32_t crc;     // CRC32 of the data
+   qstring  sha1;    // digest string, for include tracking
+};
+
+struct edfenableset_t
+{
+   qstring name;
+   int     value;
+};
+
+static uint32_t edfcachekey[5];
+static bool     edfcacherecording;
+
+static Collection<edfsource_t>    edfsources;
+static Collection<qstring>        edfdehfiles;
+static Collection<edfenableset_t> edfenablesets;
+
+//
+// Path of the cache file in the user game directory
+//
+static qstring E_edfCachePath()
+{
+   qstring path(usergamepath);
+   path.pathConcatenate(EDFCACHE_FILENAME);
+   return path;
+}
+
+static void E_clearEDFCacheRecord()
+{
+   edfsources.clear();
+   edfdehfiles.clear();
+   edfenablesets.clear();
+}
+
+//=============================================================================
+//
+// Key
+//
+
+static void E_hashInt(HashData &hash, int32_t value)
+{
+   uint8_t bytes[4] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16),
+                        uint8_t(value >> 24) };
+   hash.addData(bytes, 4);
+}
+
+static void E_hashString(HashData &hash, const char *str)
+{
+   const size_t len = strlen(str);
+   E_hashInt(hash, int32_t(len));
+   hash.addData(reinterpret_cast<const uint8_t *>(str), uint32_t(len));
+}
+
+//
+// Hashes the layout of an option table and of every table below it, since
+// that is the layout of the tree written to the cache. Tables reached again
+// are hashed by the order they were first reached in.
+//
+static void E_hashOptions(HashData &hash, const cfg_opt_t *opts,
+                          PODCollection<const cfg_opt_t *> &visited)
+{
+   for(size_t i = 0; i < visited.getLength(); i++)
+   {
+      if(visited[i] == opts)
+      {
+         E_hashInt(hash, -1 - int32_t(i));
+         return;
+      }
+   }
+   visited.add(opts);
+
+   for(const cfg_opt_t *opt = opts; opt->name; opt++)
+   {
+      E_hashString(hash, opt->name);
+      E_hashInt(hash, opt->type);
+      E_hashInt(hash, opt->flags);
+      E_hashInt(hash, opt->simple_value != nullptr);
+
+      if((opt->type == CFGT_SEC || opt->type == CFGT_MVPROP) && opt->subopts)
+         E_hashOptions(hash, opt->subopts, visited);
+   }
+   E_hashInt(hash, 0);
+}
+
+//
+// Hashes everything that decides which sources the parse reads
+//
+static void E_computeEDFCacheKey(const cfg_t *cfg, const char *filename,
+                                 const E_Enable_t *enables)
+{
+   HashData hash(HashData::SHA1);
+
+   E_hashInt(hash, EDFCACHE_VERSION);
+   E_hashInt(hash, version);
+   E_hashInt(hash, subversion);
+   E_hashString(hash, version_date);
+   E_hashString(hash, version_time);
+
+   PODCollection<const cfg_opt_t *> visited;
+   E_hashOptions(hash, cfg->opts, visited);
+
+   E_hashInt(hash, GameModeInfo->type);
+   for(const E_Enable_t *enable = enables; enable->name; enable++)
+   {
+      E_hashString(hash, enable->name);
+      E_hashInt(hash, enable->enabled);
+   }
+
+   E_hashString(hash, filename ? filename : "");
+   E_hashString(hash, basepath ? basepath : "");
+
+   // includes are found by name, so a lump added or removed anywhere can
+   // change which one the parse would read
+   lumpinfo_t **lumpinfo = wGlobalDir.getLumpInfo();
+   const int    numlumps = wGlobalDir.getNumLumps();
+
+   E_hashInt(hash, numlumps);
+   for(int i = 0; i < numlumps; i++)
+   {
+      const lumpinfo_t *lump = lumpinfo[i];
+
+      if(lump->li_namespace != lumpinfo_t::ns_global)
+         continue;
+
+      E_hashInt(hash, i);
+      E_hashString(hash, lump->name);
+      E_hashString(hash, lump->lfn ? lump->lfn : "");
+      E_hashInt(hash, lump->source);
+   }
+
+   hash.wrapUp();
+
+   for(int i = 0; i < 5; i++)
+      edfcachekey[i] = hash.getDigestPart(i);
+}
+
+//=============================================================================
+//
+// Recording
+//
+
+//
+// E_EDFCacheAddSource
+//
+// Notes a file or lump the parse has read, whether or not include tracking
+// then let it be parsed.
+//
+void E_EDFCacheAddSource(const char *name, int lumpnum, const char *data, size_t size,
+                         const HashData &sha1)
+{
+   if(!edfcacherecording)
+      return;
+
+   edfsource_t source;
+   char       *digest = sha1.digestToString();
+
+   source.name    = name ? name : "";
+   source.type    = EDFSOURCE_DATA;
+   source.lumpnum = lumpnum;
+   source.size    = uint32_t(size);
+   source.crc     = HashData(HashData::CRC32, reinterpret_cast<const uint8_t *>(data),
+                             uint32_t(size)).getDigestPart(0);
+   source.sha1    = digest;
+   edfsources.add(source);
+
+   efree(digest);
+}
+
+//
+// E_EDFCacheAddEmptyLump
+//
+// Notes an empty lump the parse skipped over.
+//
+void E_EDFCacheAddEmptyLump(const char *name, int lumpnum)
+{
+   if(!edfcacherecording)
+      return;
+
+   edfsource_t source;
+
+   source.name    = name;
+   source.type    = EDFSOURCE_EMPTYLUMP;
+   source.lumpnum = lumpnum;
+   source.size    = 0;
+   source.crc     = 0;
+   edfsources.add(source);
+}
+
+//
+// E_EDFCacheAddMissingFile
+//
+// Notes an optional file the parse found absent.
+//
+void E_EDFCacheAddMissingFile(const char *name)
+{
+   if(!edfcacherecording)
+      return;
+
+   edfsource_t source;
+
+   source.name    = name;
+   source.type    = EDFSOURCE_MISSINGFILE;
+   source.lumpnum = -1;
+   source.size    = 0;
+   source.crc     = 0;
+   edfsources.add(source);
+}
+
+//
+// E_EDFCacheAddDEH
+//
+// Notes a DeHackEd file queued by the parse.
+//
+void E_EDFCacheAddDEH(const char *filename)
+{
+   if(edfcacherecording)
+      edfdehfiles.add(qstring(filename));
+}
+
+//
+// E_EDFCacheSetEnable
+//
+// Notes an enable value set by the parse.
+//
+void E_EDFCacheSetEnable(const char *name, int value)
+{
+   if(!edfcacherecording)
+      return;
+
+   edfenableset_t set;
+   set.name  = name;
+   set.value = value;
+   edfenablesets.add(set);
+}
+
+//=============================================================================
+//
+// Loading
+//
+
+//
+// Bounds-checked little-endian reader over the mapped cache file
+//
+class EDFCacheReader
+{
+   const byte *data;
+   size_t      size;
+   size_t      pos;
+
+public:
+   EDFCacheReader(const byte *inData, size_t inSize) : data(inData), size(inSize), pos(0) {}
+
+   bool has(size_t len) const { return len <= size - pos; }
+
+   const byte *bytes(size_t len)
+   {
+      if(!has(len))
+         return nullptr;
+      const byte *ret = data + pos;
+      pos += len;
+      return ret;
+   }
+
+   bool readUint32(uint32_t &num)
+   {
+      const byte *b = bytes(4);
+      if(!b)
+         return false;
+      num = uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+      return true;
+   }
+
+   bool readInt32(int &num)
+   {
+      uint32_t unum;
+      if(!readUint32(unum))
+         return false;
+      num = int32_t(unum);
+      return true;
+   }
+
+   bool readUint8(uint8_t &num)
+   {
+      const byte *b = bytes(1);
+      if(!b)
+         return false;
+      num = *b;
+      return true;
+   }
+
+   bool readDouble(double &num)
+   {
+      uint32_t lo, hi;
+      if(!readUint32(lo) || !readUint32(hi))
+         return false;
+      const uint64_t bits = uint64_t(hi) << 32 | lo;
+      memcpy(&num, &bits, sizeof(num));
+      return true;
+   }
+
+   // strings are stored with their terminator, so they can be used in place
+   bool readString(const char *&str)
+   {
+      uint32_t len;
+      if(!readUint32(len))
+         return false;
+      if(len == EDFCACHE_NULLSTR)
+      {
+         str = nullptr;
+         return true;
+      }
+
+      const byte *b;
+      if(!has(size_t(len) + 1) || !(b = bytes(size_t(len) + 1)) || b[len])
+         return false;
+      str = reinterpret_cast<const char *>(b);
+      return true;
+   }
+};
+
+//
+// Checks that a source the cached tree was parsed from is still the same
+//
+static bool E_checkCachedSource(int type, const char *name, int lumpnum, uint32_t size,
+                                uint32_t crc)
+{
+   const int numlumps = wGlobalDir.getNumLumps();
+
+   switch(type)
+   {
+   case EDFSOURCE_MISSINGFILE:
+      return access(name, R_OK) != 0;
+
+   case EDFSOURCE_EMPTYLUMP:
+      return lumpnum >= 0 && lumpnum < numlumps && !wGlobalDir.lumpLength(lumpnum);
+
+   case EDFSOURCE_DATA:
+      if(lumpnum >= 0)
+      {
+         return lumpnum < numlumps && uint32_t(wGlobalDir.lumpLength(lumpnum)) == size &&
+                W_LumpCheckSum(lumpnum) == crc;
+      }
+      else
+      {
+         FILE *f;
+         if(!(f = fopen(name, "rb")))
+            return false;
+
+         bool          same = false;
+         hal_filemap_t map;
+         if(I_MapFile(f, map))
+         {
+            same = map.size == size &&
+                   HashData(HashData::CRC32, map.data, uint32_t(map.size)).getDigestPart(0) == crc;
+            I_UnmapFile(map);
+         }
+         else if(M_FileLength(f) == long(size))
+         {
+            byte *buffer = emalloc(byte *, size ? size : 1);
+            same = fread(buffer, 1, size, f) == size &&
+                   HashData(HashData::CRC32, buffer, size).getDigestPart(0) == crc;
+            efree(buffer);
+         }
+
+         fclose(f);
+         return same;
+      }
+
+   default:
+      return false;
+   }
+}
+
+static bool E_loadCachedSection(EDFCacheReader &reader, cfg_t *sec, int depth);
+
+//
+// Reads the values of one option of a section
+//
+static bool E_loadCachedValues(EDFCacheReader &reader, cfg_t *sec, cfg_opt_t *opt, int depth)
+{
+   uint32_t nvalues;
+
+   // every value takes at least one byte, which bounds the count
+   if(!reader.readUint32(nvalues) || !reader.has(nvalues))
+      return false;
+   if(!nvalues)
+      return true;
+
+   // simple options keep their values elsewhere, and function calls leave
+   // none behind
+   if(opt->simple_value || opt->type == CFGT_FUNC || opt->type == CFGT_NONE)
+      return false;
+
+   opt->values = ecalloc(cfg_value_t **, nvalues, sizeof(cfg_value_t *));
+
+   for(uint32_t i = 0; i < nvalues; i++)
+   {
+      cfg_value_t *val = opt->values[i] = estructalloc(cfg_value_t, 1);
+      opt->nvalues = i + 1;
+
+      switch(opt->type)
+      {
+      case CFGT_INT:
+      case CFGT_FLAG:
+         if(!reader.readInt32(val->number))
+            return false;
+         break;
+      case CFGT_FLOAT:
+         if(!reader.readDouble(val->fpnumber))
+            return false;
+         break;
+      case CFGT_BOOL:
+         {
+            uint8_t b;
+            if(!reader.readUint8(b))
+               return false;
+            val->boolean = !!b;
+         }
+         break;
+      case CFGT_STR:
+      case CFGT_STRFUNC:
+         {
+            const char *str;
+            if(!reader.readString(str))
+               return false;
+            val->string = str ? estrdup(str) : nullptr;
+         }
+         break;
+      case CFGT_SEC:
+      case CFGT_MVPROP:
+         {
+            // the section, then the ones it displaced, newest first
+            uint32_t count;
+            if(!reader.readUint32(count) || !count || !reader.has(count))
+               return false;
+
+            cfg_t **link = &val->section;
+            for(uint32_t c = 0; c < count; c++)
+            {
+               const char *title;
+               if(!reader.readString(title))
+                  return false;
+
+               cfg_t *newsec = *link = cfg_newsection(sec, opt, title);
+               if(!E_loadCachedSection(reader, newsec, depth + 1))
+                  return false;
+               link = &newsec->displaced;
+            }
+         }
+         break;
+      default:
+         return false;
+      }
+   }
+
+   return true;
+}
+
+//
+// Reads the values of every option of a section. Whatever has been read
+// when it fails is linked into the section, for cfg_free to clean up.
+//
+static bool E_loadCachedSection(EDFCacheReader &reader, cfg_t *sec, int depth)
+{
+   uint32_t numopts, count = 0;
+
+   if(depth > EDFCACHE_MAXDEPTH)
+      return false;
+
+   while(sec->opts[count].name)
+      ++count;
+
+   if(!reader.readInt32(sec->line) || !reader.readUint32(numopts) || numopts != count)
+      return false;
+
+   for(cfg_opt_t *opt = sec->opts; opt->name; opt++)
+   {
+      if(!E_loadCachedValues(reader, sec, opt, depth))
+         return false;
+   }
+
+   return true;
+}
+
+//
+// Reads and checks everything that comes before the tree, keeping what is
+// to be done once the tree has been read as well
+//
+static bool E_loadCachedRecord(EDFCacheReader &reader, Collection<qstring> &digests)
+{
+   uint32_t count;
+
+   if(!reader.readUint32(count))
+      return false;
+
+   for(uint32_t i = 0; i < count; i++)
+   {
+      const char *name, *sha1;
+      uint32_t    type, size, crc;
+      int         lumpnum;
+
+      if(!reader.readUint32(type) || !reader.readString(name) || !name ||
+         !reader.readInt32(lumpnum) || !reader.readUint32(size) || !reader.readUint32(crc) ||
+         !reader.readString(sha1))
+         return false;
+
+      if(!E_checkCachedSource(int(type), name, lumpnum, size, crc))
+      {
+         E_EDFLogPrintf("\t* EDF cache is out of date: %s has changed\n", name);
+         return false;
+      }
+
+      if(type == EDFSOURCE_DATA)
+      {
+         if(!sha1)
+            return false;
+         digests.add(qstring(sha1));
+      }
+   }
+
+   if(!reader.readUint32(count))
+      return false;
+
+   for(uint32_t i = 0; i < count; i++)
+   {
+      const char *filename;
+      if(!reader.readString(filename) || !filename)
+         return false;
+      edfdehfiles.add(qstring(filename));
+   }
+
+   if(!reader.readUint32(count))
+      return false;
+
+   for(uint32_t i = 0; i < count; i++)
+   {
+      edfenableset_t set;
+      const char    *name;
+
+      if(!reader.readString(name) || !name || !reader.readInt32(set.value))
+         return false;
+      set.name = name;
+      edfenablesets.add(set);
+   }
+
+   return true;
+}
+
+//
+// E_LoadEDFCache
+//
+// Fills in the freshly created cfg from the cache file, if there is one and
+// it was made from the same sources the parse would read now, and does what
+// that parse did besides. Returns true if so; otherwise cfg is left alone,
+// and what the parse does is noted down for E_SaveEDFCache.
+//
+bool E_LoadEDFCache(cfg_t *cfg, const char *filename, const E_Enable_t *enables)
+{
+   edfcacherecording = false;
+   E_clearEDFCacheRecord();
+
+   if(M_CheckParm("-noedfcache"))
+      return false;
+
+   E_computeEDFCacheKey(cfg, filename, enables);
+   edfcacherecording = true;
+
+   const qstring path = E_edfCachePath();
+   FILE *f;
+   if(!(f = fopen(path.constPtr(), "rb")))
+      return false;
+
+   hal_filemap_t map;
+   if(!I_MapFile(f, map))
+   {
+      fclose(f);
+      return false;
+   }
+
+   EDFCacheReader      reader(map.data, map.size);
+   Collection<qstring> digests;
+   const byte         *magic   = reader.bytes(4);
+   uint32_t            version = 0;
+   bool                valid   = magic && !memcmp(magic, EDFCACHE_MAGIC, 4) &&
+                                 reader.readUint32(version) && version == EDFCACHE_VERSION;
+
+   for(int i = 0; valid && i < 5; i++)
+   {
+      uint32_t part;
+      valid = reader.readUint32(part) && part == edfcachekey[i];
+   }
+
+   valid = valid && E_loadCachedRecord(reader, digests);
+
+   if(valid && !E_loadCachedSection(reader, cfg, 0))
+   {
+      // drop whatever was read of the tree
+      for(cfg_opt_t *opt = cfg->opts; opt->name; opt++)
+         cfg_free_value(opt);
+      cfg->line = 0;
+      valid = false;
+   }
+
+   I_UnmapFile(map);
+   fclose(f);
+
+   if(!valid)
+   {
+      E_clearEDFCacheRecord();
+      return false;
+   }
+
+   printf("E_ProcessEDF: Loaded parsed definitions from %s\n", EDFCACHE_FILENAME);
+   E_EDFLogPrintf("\t* Loaded parsed definitions from %s\n", path.constPtr());
+
+   // everything the parse did besides building the tree, in the same order
+   for(const qstring &digest : digests)
+   {
+      HashData sha1(HashData::SHA1);
+      sha1.stringToDigest(digest.constPtr());
+      E_CheckIncludeHash(sha1);
+   }
+   for(const qstring &dehfile : edfdehfiles)
+      D_QueueDEH(dehfile.constPtr(), 0);
+   for(const edfenableset_t &set : edfenablesets)
+      E_EDFSetEnableValue(set.name.constPtr(), set.value);
+
+   edfcacherecording = false;
+   E_clearEDFCacheRecord();
+   return true;
+}
+
+//=============================================================================
+//
+// Saving
+//
+
+static bool E_writeString(OutBuffer &out, const char *str)
+{
+   if(!str)
+      return out.writeUint32(EDFCACHE_NULLSTR);
+
+   const uint32_t len = uint32_t(strlen(str));
+   return out.writeUint32(len) && out.write(str, len + 1);
+}
+
+static bool E_saveCachedSection(OutBuffer &out, const cfg_t *sec);
+
+static bool E_saveCachedValues(OutBuffer &out, const cfg_opt_t *opt)
+{
+   if(!out.writeUint32(opt->nvalues))
+      return false;
+
+   for(unsigned int i = 0; i < opt->nvalues; i++)
+   {
+      const cfg_value_t *val = opt->values[i];
+      bool               ok;
+
+      switch(opt->type)
+      {
+      case CFGT_INT:
+      case CFGT_FLAG:
+         ok = out.writeSint32(val->number);
+         break;
+      case CFGT_FLOAT:
+         {
+            uint64_t bits;
+            memcpy(&bits, &val->fpnumber, sizeof(bits));
+            ok = out.writeUint32(uint32_t(bits)) && out.writeUint32(uint32_t(bits >> 32));
+         }
+         break;
+      case CFGT_BOOL:
+         ok = out.writeUint8(val->boolean ? 1 : 0);
+         break;
+      case CFGT_STR:
+      case CFGT_STRFUNC:
+         ok = E_writeString(out, val->string);
+         break;
+      case CFGT_SEC:
+      case CFGT_MVPROP:
+         {
+            uint32_t count = 0;
+            for(const cfg_t *sec = val->section; sec; sec = sec->displaced)
+               ++count;
+
+            ok = out.writeUint32(count);
+            for(const cfg_t *sec = val->section; ok && sec; sec = sec->displaced)
+               ok = E_writeString(out, sec->title) && E_saveCachedSection(out, sec);
+         }
+         break;
+      default:
+         ok = false;
+         break;
+      }
+
+      if(!ok)
+         return false;
+   }
+
+   return true;
+}
+
+static bool E_saveCachedSection(OutBuffer &out, const cfg_t *sec)
+{
+   uint32_t count = 0;
+
+   while(sec->opts[count].name)
+      ++count;
+
+   if(!out.writeSint32(sec->line) || !out.writeUint32(count))
+      return false;
+
+   for(const cfg_opt_t *opt = sec->opts; opt->name; opt++)
+   {
+      if(!E_saveCachedValues(out, opt))
+         return false;
+   }
+
+   return true;
+}
+
+static bool E_saveCachedRecord(OutBuffer &out)
+{
+   if(!out.writeUint32(uint32_t(edfsources.getLength())))
+      return false;
+
+   for(const edfsource_t &source : edfsources)
+   {
+      if(!out.writeUint32(uint32_t(source.type)) || !E_writeString(out, source.name.constPtr()) ||
+         !out.writeSint32(source.lumpnum) || !out.writeUint32(source.size) ||
+         !out.writeUint32(source.crc) ||
+         !E_writeString(out, source.type == EDFSOURCE_DATA ? source.sha1.constPtr() : nullptr))
+         return false;
+   }
+
+   if(!out.writeUint32(uint32_t(edfdehfiles.getLength())))
+      return false;
+
+   for(const qstring &dehfile : edfdehfiles)
+   {
+      if(!E_writeString(out, dehfile.constPtr()))
+         return false;
+   }
+
+   if(!out.writeUint32(uint32_t(edfenablesets.getLength())))
+      return false;
+
+   for(const edfenableset_t &set : edfenablesets)
+   {
+      if(!E_writeString(out, set.name.constPtr()) || !out.writeSint32(set.value))
+         return false;
+   }
+
+   return true;
+}
+
+//
+// E_SaveEDFCache
+//
+// Writes the tree just parsed into cfg out to the cache file, along with
+// what E_LoadEDFCache noted down during the parse. Must be called before
+// processing, which may change the tree. The file is written under a
+// temporary name and renamed into place, as in r_texcache.cpp.
+//
+void E_SaveEDFCache(cfg_t *cfg)
+{
+   if(!edfcacherecording)
+      return;
+
+   edfcacherecording = false;
+
+   const qstring path = E_edfCachePath();
+   qstring       temppath(path);
+   temppath += ".tmp";
+
+   OutBuffer out;
+   if(!out.createFile(temppath.constPtr(), 512 * 1024, OutBuffer::LENDIAN))
+   {
+      E_clearEDFCacheRecord();
+      return;
+   }
+
+   bool ok = out.write(EDFCACHE_MAGIC, 4) && out.writeUint32(EDFCACHE_VERSION);
+   for(int i = 0; ok && i < 5; i++)
+      ok = out.writeUint32(edfcachekey[i]);
+
+   ok = ok && E_saveCachedRecord(out) && E_saveCachedSection(out, cfg);
+   ok = out.flush() && ok;
+   out.close();
+
+   if(ok)
+   {
+      // rename won't replace an existing file everywhere
+      remove(path.constPtr());
+      ok = !rename(temppath.constPtr(), path.constPtr());
+   }
+
+   if(!ok)
+   {
+      remove(temppath.constPtr());
+      E_EDFLogPrintf("\t* Could not write %s\n", path.constPtr());
+   }
+
+   E_clearEDFCacheRecord();
+}
+
+// EOF
+
@@ -0,0 +1,49 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: On-disk cache of the parsed EDF definition tree, so that the
+//  text of every EDF source needn't be parsed again on the next launch.
+//
+// Authors: agent
+//
+
+#ifndef E_EDFCACHE_H__
+#define E_EDFCACHE_H__
+
+struct cfg_t;
+struct E_Enable_t;
+class  HashData;
+
+bool E_LoadEDFCache(cfg_t *cfg, const char *filename, const E_Enable_t *enables);
+void E_SaveEDFCache(cfg_t *cfg);
+
+// Called while parsing, to note everything the parse depended on or did
+// besides filling in the tree. They do nothing unless E_LoadEDFCache has
+// just missed.
+void E_EDFCacheAddSource(const char *name, int lumpnum, const char *data, size_t size,
+                         const HashData &sha1);
+void E_EDFCacheAddEmptyLump(const char *name, int lumpnum);
+void E_EDFCacheAddMissingFile(const char *name);
+void E_EDFCacheAddDEH(const char *filename);
+void E_EDFCacheSetEnable(const char *name, int value);
+
+#endif
+
+// EOF
+
@@ -34,6 +34,7 @@
 
 #include "e_lib.h"
 #include "e_edf.h"
+#include "e_edfcache.h"
 
 #include "autopalette.h"
 #include "d_dehtbl.h"
@@ -89,12 +90,22 @@ static Collection<HashData> eincludes;
 //
 bool E_CheckInclude(const char *data, size_t size)
 {
-   size_t numincludes;
-   char *digest;
-   
    // calculate the SHA-1 hash of the data   
    HashData newHash(HashData::SHA1, (const uint8_t *)data, (uint32_t)size);
 
+   return E_CheckIncludeHash(newHash);
+}
+
+//
+// E_CheckIncludeHash
+//
+// As above, for a data source whose SHA-1 hash is already known.
+//
+bool E_CheckIncludeHash(const HashData &newHash)
+{
+   size_t numincludes;
+   char *digest;
+
    // output digest string
    digest = newHash.digestToString();
 
@@ -121,6 +132,21 @@ bool E_CheckInclude(const char *data, size_t size)
    return true;
 }
 
+//
+// E_checkEDFSource
+//
+// Calls E_CheckIncludeHash for an EDF data source, after noting it down for
+// the EDF cache.
+//
+static bool E_checkEDFSource(const char *name, int lumpnum, const char *data, size_t size)
+{
+   HashData newHash(HashData::SHA1, (const uint8_t *)data, (uint32_t)size);
+
+   E_EDFCacheAddSource(name, lumpnum, data, size, newHash);
+
+   return E_CheckIncludeHash(newHash);
+}
+
 //
 // E_OpenAndCheckInclude
 //
@@ -147,7 +173,7 @@ static int E_OpenAndCheckInclude(cfg_t *cfg, const char *fn, int lumpnum)
    if((data = cfg_lexer_mustopen(cfg, fn, lumpnum, &len)))
    {
       // see if we already parsed this data source
-      if(E_CheckInclude(data, len))
+      if(E_checkEDFSource(fn, lumpnum, data, len))
          code = cfg_lexer_include(cfg, data, fn, lumpnum);
       else
       {
@@ -257,7 +283,7 @@ static int E_findFileInclude(cfg_t *src, const char *name)
 //
 int E_CheckRoot(cfg_t *cfg, const char *data, int size)
 {
-   return !E_CheckInclude(data, (size_t)size);
+   return !E_checkEDFSource(cfg->filename, cfg->lumpnum, data, (size_t)size);
 }
 
 //=============================================================================
@@ -494,7 +520,14 @@ int E_UserInclude(cfg_t *cfg, cfg_opt_t *opt, int argc, const char **argv)
 
    filename = E_BuildDefaultFn(argv[0]);
 
-   return !access(filename, R_OK) ? E_OpenAndCheckInclude(cfg, filename, -1) : 0;
+   if(access(filename, R_OK))
+   {
+      // the EDF cache must notice if it turns up later
+      E_EDFCacheAddMissingFile(filename);
+      return 0;
+   }
+
+   return E_OpenAndCheckInclude(cfg, filename, -1);
 }
 
 //=============================================================================
@@ -81,7 +81,9 @@ void E_CfgListToCommaString(cfg_t *sec, const char *optname, qstring &output);
 
 #endif
 
+class HashData;
 bool E_CheckInclude(const char *data, size_t size);
+bool E_CheckIncludeHash(const HashData &newHash);
 
 const char *E_BuildDefaultFn(const char *filename);
 
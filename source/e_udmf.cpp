@@ -29,7 +29,6 @@
 
 #include "doomstat.h"
 #include "e_exdata.h"
-#include "e_hash.h"
 #include "e_lib.h"
 #include "e_mod.h"
 #include "e_sound.h"
@@ -403,7 +402,7 @@ bool UDMFParser::loadLinedefs(UDMFSetupSettings &setupSettings)
          uld.sideback < -1 || uld.sideback >= numsides)
       {
          mLine = uld.errorline;
-         mColumn = 1;
+         mLineStart = mPos;   // column 1
          mError = "Vertex or sidedef overflow";
          return false;
       }
@@ -461,7 +460,7 @@ bool UDMFParser::loadSidedefs2()
       if(usd.sector < 0 || usd.sector >= numsectors)
       {
          mLine = usd.errorline;
-         mColumn = 1;
+         mLineStart = mPos;   // column 1
          mError = "Sector overflow";
          return false;
       }
@@ -714,178 +713,191 @@ enum token_e
    t_zoneboundary,
 };
 
-struct keytoken_t
-{
-   const char *string;
-   DLListItem<keytoken_t> link;
-   token_e token;
-};
-
-#define TOKEN(a) { #a, DLListItem<keytoken_t>(), t_##a }
-
-static keytoken_t gTokenList[] =
+//
+// Case-insensitive FNV-1a hash of a key. It is constexpr so that looking up a
+// key is a switch over the hashes of the known keys; two keys with the same
+// hash would be duplicate case labels and fail to compile, so the hash is
+// perfect over the key set.
+//
+static constexpr uint32_t keyHash(const char *key, size_t length)
 {
-   TOKEN(alpha),
-   TOKEN(alphaceiling),
-   TOKEN(alphafloor),
-   TOKEN(ambush),
-   TOKEN(angle),
-   TOKEN(arg0),
-   TOKEN(arg1),
-   TOKEN(arg2),
-   TOKEN(arg3),
-   TOKEN(arg4),
-   TOKEN(attachceiling),
-   TOKEN(attachfloor),
-   TOKEN(blockeverything),
-   TOKEN(blockfloaters),
-   TOKEN(blocking),
-   TOKEN(blockmonsters),
-   TOKEN(blocksound),
-   TOKEN(ceilingid),
-   TOKEN(ceilingterrain),
-   TOKEN(class1),
-   TOKEN(class2),
-   TOKEN(class3),
-   TOKEN(clipmidtex),
-   TOKEN(colormapbottom),
-   TOKEN(colormapmid),
-   TOKEN(colormaptop),
-   TOKEN(coop),
-   TOKEN(damage_endgodmode),
-   TOKEN(damage_exitlevel),
-   TOKEN(damageamount),
-   TOKEN(damageinterval),
-   TOKEN(damageterraineffect),
-   TOKEN(damagetype),
-   TOKEN(dm),
-   TOKEN(dontdraw),
-   TOKEN(dontpegbottom),
-   TOKEN(dontpegtop),
-   TOKEN(dormant),
-   TOKEN(firstsideonly),
-   TOKEN(floorid),
-   TOKEN(floorterrain),
-   TOKEN(friction),
-   TOKEN(friend),
-   TOKEN(health),
-   TOKEN(height),
-   TOKEN(heightceiling),
-   TOKEN(heightfloor),
-   TOKEN(id),
-   TOKEN(impact),
-   TOKEN(invisible),
-   TOKEN(jumpover),
-   TOKEN(leakiness),
-   TOKEN(lightceiling),
-   TOKEN(lightceilingabsolute),
-   TOKEN(lightfloor),
-   TOKEN(lightfloorabsolute),
-   TOKEN(lightlevel),
-   TOKEN(lightseqalt),
-   TOKEN(lightsequence),
-   TOKEN(lowerportal),
-   TOKEN(mapped),
-   TOKEN(midtex3d),
-   TOKEN(midtex3dimpassible),
-   TOKEN(missilecross),
-   TOKEN(monstercross),
-   TOKEN(monsterpush),
-   TOKEN(monstershoot),
-   TOKEN(monsteruse),
-   TOKEN(offsetx),
-   TOKEN(offsety),
-   TOKEN(polycross),
-   TOKEN(portal),
-   TOKEN(portalceiling),
-   TOKEN(portal_ceil_attached),
-   TOKEN(portal_ceil_blocksound),
-   TOKEN(portal_ceil_disabled),
-   TOKEN(portal_ceil_nopass),
-   TOKEN(portal_ceil_norender),
-   TOKEN(portal_ceil_overlaytype),
-   TOKEN(portal_ceil_useglobaltex),
-   TOKEN(portalfloor),
-   TOKEN(portal_floor_attached),
-   TOKEN(portal_floor_blocksound),
-   TOKEN(portal_floor_disabled),
-   TOKEN(portal_floor_nopass),
-   TOKEN(portal_floor_norender),
-   TOKEN(portal_floor_overlaytype),
-   TOKEN(portal_floor_useglobaltex),
-   TOKEN(passuse),
-   TOKEN(phasedlight),
-   TOKEN(playercross),
-   TOKEN(playerpush),
-   TOKEN(playeruse),
-   TOKEN(renderstyle),
-   TOKEN(repeatspecial),
-   TOKEN(rotationceiling),
-   TOKEN(rotationfloor),
-   TOKEN(scroll_ceil_x),
-   TOKEN(scroll_ceil_y),
-   TOKEN(scroll_ceil_type),
-   TOKEN(scroll_floor_x),
-   TOKEN(scroll_floor_y),
-   TOKEN(scroll_floor_type),
-   TOKEN(secret),
-   TOKEN(sector),
-   TOKEN(sideback),
-   TOKEN(sidefront),
-   TOKEN(single),
-   TOKEN(skill1),
-   TOKEN(skill2),
-   TOKEN(skill3),
-   TOKEN(skill4),
-   TOKEN(skill5),
-   TOKEN(soundsequence),
-   TOKEN(special),
-   TOKEN(standing),
-   TOKEN(strifeally),
-   TOKEN(texturebottom),
-   TOKEN(textureceiling),
-   TOKEN(texturefloor),
-   TOKEN(texturemiddle),
-   TOKEN(texturetop),
-   TOKEN(tranmap),
-   TOKEN(translucent),
-   TOKEN(twosided),
-   TOKEN(type),
-   TOKEN(upperportal),
-   TOKEN(v1),
-   TOKEN(v2),
-   TOKEN(x),
-   TOKEN(xpanningceiling),
-   TOKEN(xpanningfloor),
-   TOKEN(xscaleceiling),
-   TOKEN(xscalefloor),
-   TOKEN(y),
-   TOKEN(ypanningceiling),
-   TOKEN(ypanningfloor),
-   TOKEN(yscaleceiling),
-   TOKEN(yscalefloor),
-   TOKEN(zoneboundary),
-};
+   uint32_t hash = 2166136261u;
+   for(size_t i = 0; i < length; i++)
+   {
+      unsigned char c = static_cast<unsigned char>(key[i]);
+      if(c >= 'A' && c <= 'Z')
+         c += 'a' - 'A';
+      hash = (hash ^ c) * 16777619u;
+   }
+   return hash;
+}
 
-static EHashTable<keytoken_t, ENCStringHashKey, &keytoken_t::string, &keytoken_t::link> gTokenTable;
+#define TOKEN(a)                                                  \
+   case keyHash(#a, sizeof(#a) - 1):                              \
+      token = t_##a;                                              \
+      return length == sizeof(#a) - 1 && !strncasecmp(key, #a, length);
 
-static void registerAllKeys()
+//
+// Finds the token for a key. Returns false if the key isn't known.
+//
+static bool tokenForKey(const char *key, size_t length, token_e &token)
 {
-   static bool called = false;
-   if(called)
-      return;
-   for(size_t i = 0; i < earrlen(gTokenList); ++i)
-      gTokenTable.addObject(gTokenList[i]);
-   called = true;
+   switch(keyHash(key, length))
+   {
+   TOKEN(alpha)
+   TOKEN(alphaceiling)
+   TOKEN(alphafloor)
+   TOKEN(ambush)
+   TOKEN(angle)
+   TOKEN(arg0)
+   TOKEN(arg1)
+   TOKEN(arg2)
+   TOKEN(arg3)
+   TOKEN(arg4)
+   TOKEN(attachceiling)
+   TOKEN(attachfloor)
+   TOKEN(blockeverything)
+   TOKEN(blockfloaters)
+   TOKEN(blocking)
+   TOKEN(blockmonsters)
+   TOKEN(blocksound)
+   TOKEN(ceilingid)
+   TOKEN(ceilingterrain)
+   TOKEN(class1)
+   TOKEN(class2)
+   TOKEN(class3)
+   TOKEN(clipmidtex)
+   TOKEN(colormapbottom)
+   TOKEN(colormapmid)
+   TOKEN(colormaptop)
+   TOKEN(coop)
+   TOKEN(damage_endgodmode)
+   TOKEN(damage_exitlevel)
+   TOKEN(damageamount)
+   TOKEN(damageinterval)
+   TOKEN(damageterraineffect)
+   TOKEN(damagetype)
+   TOKEN(dm)
+   TOKEN(dontdraw)
+   TOKEN(dontpegbottom)
+   TOKEN(dontpegtop)
+   TOKEN(dormant)
+   TOKEN(firstsideonly)
+   TOKEN(floorid)
+   TOKEN(floorterrain)
+   TOKEN(friction)
+   TOKEN(friend)
+   TOKEN(health)
+   TOKEN(height)
+   TOKEN(heightceiling)
+   TOKEN(heightfloor)
+   TOKEN(id)
+   TOKEN(impact)
+   TOKEN(invisible)
+   TOKEN(jumpover)
+   TOKEN(leakiness)
+   TOKEN(lightceiling)
+   TOKEN(lightceilingabsolute)
+   TOKEN(lightfloor)
+   TOKEN(lightfloorabsolute)
+   TOKEN(lightlevel)
+   TOKEN(lightseqalt)
+   TOKEN(lightsequence)
+   TOKEN(lowerportal)
+   TOKEN(mapped)
+   TOKEN(midtex3d)
+   TOKEN(midtex3dimpassible)
+   TOKEN(missilecross)
+   TOKEN(monstercross)
+   TOKEN(monsterpush)
+   TOKEN(monstershoot)
+   TOKEN(monsteruse)
+   TOKEN(offsetx)
+   TOKEN(offsety)
+   TOKEN(polycross)
+   TOKEN(portal)
+   TOKEN(portalceiling)
+   TOKEN(portal_ceil_attached)
+   TOKEN(portal_ceil_blocksound)
+   TOKEN(portal_ceil_disabled)
+   TOKEN(portal_ceil_nopass)
+   TOKEN(portal_ceil_norender)
+   TOKEN(portal_ceil_overlaytype)
+   TOKEN(portal_ceil_useglobaltex)
+   TOKEN(portalfloor)
+   TOKEN(portal_floor_attached)
+   TOKEN(portal_floor_blocksound)
+   TOKEN(portal_floor_disabled)
+   TOKEN(portal_floor_nopass)
+   TOKEN(portal_floor_norender)
+   TOKEN(portal_floor_overlaytype)
+   TOKEN(portal_floor_useglobaltex)
+   TOKEN(passuse)
+   TOKEN(phasedlight)
+   TOKEN(playercross)
+   TOKEN(playerpush)
+   TOKEN(playeruse)
+   TOKEN(renderstyle)
+   TOKEN(repeatspecial)
+   TOKEN(rotationceiling)
+   TOKEN(rotationfloor)
+   TOKEN(scroll_ceil_x)
+   TOKEN(scroll_ceil_y)
+   TOKEN(scroll_ceil_type)
+   TOKEN(scroll_floor_x)
+   TOKEN(scroll_floor_y)
+   TOKEN(scroll_floor_type)
+   TOKEN(secret)
+   TOKEN(sector)
+   TOKEN(sideback)
+   TOKEN(sidefront)
+   TOKEN(single)
+   TOKEN(skill1)
+   TOKEN(skill2)
+   TOKEN(skill3)
+   TOKEN(skill4)
+   TOKEN(skill5)
+   TOKEN(soundsequence)
+   TOKEN(special)
+   TOKEN(standing)
+   TOKEN(strifeally)
+   TOKEN(texturebottom)
+   TOKEN(textureceiling)
+   TOKEN(texturefloor)
+   TOKEN(texturemiddle)
+   TOKEN(texturetop)
+   TOKEN(tranmap)
+   TOKEN(translucent)
+   TOKEN(twosided)
+   TOKEN(type)
+   TOKEN(upperportal)
+   TOKEN(v1)
+   TOKEN(v2)
+   TOKEN(x)
+   TOKEN(xpanningceiling)
+   TOKEN(xpanningfloor)
+   TOKEN(xscaleceiling)
+   TOKEN(xscalefloor)
+   TOKEN(y)
+   TOKEN(ypanningceiling)
+   TOKEN(ypanningfloor)
+   TOKEN(yscaleceiling)
+   TOKEN(yscalefloor)
+   TOKEN(zoneboundary)
+   default:
+      return false;
+   }
 }
 
+#undef TOKEN
+
 //
 // Looks for "ee_compat = true;" in the TEXTMAP in order to accept unknown name-
 // spaces as Eternity-compatible. Useful to support arbitrary namespaces which
 // look like Eternity but weren't made only for it. The resulting behaviour
 // is like Eternity. Thanks to anotak for this feature.
 //
-bool UDMFParser::checkForCompatibilityFlag(qstring nstext)
+bool UDMFParser::checkForCompatibilityFlag(const qstring &nstext)
 {
    // ano - read over the file looking for `ee_compat="true"`
    readresult_e result;
@@ -905,7 +917,7 @@ bool UDMFParser::checkForCompatibilityFlag(qstring nstext)
 
       if(result == result_Assignment &&
          !mInBlock &&
-         mKey.strCaseCmp("ee_compat") == 0 &&
+         mKey.is("ee_compat") &&
          mValue.type == Token::type_Keyword &&
          ectype::toUpper(mValue.text[0]) == 'T')
       {
@@ -934,20 +946,14 @@ bool UDMFParser::checkForCompatibilityFlag(qstring nstext)
 //
 bool UDMFParser::parse(WadDirectory &setupwad, int lump)
 {
-   {
-      ZAutoBuffer buf;
-
-      setupwad.cacheLumpAuto(lump, buf);
-      auto data = buf.getAs<const char *>();
-
-      // store it conveniently
-      setData(data, setupwad.lumpLength(lump));
-   }
+   // tokens point into the lump, so it is kept for as long as the parser
+   setupwad.cacheLumpAuto(lump, mBuffer);
+   setData(mBuffer.getAs<const char *>(), mBuffer.getSize());
 
    readresult_e result = readItem();
    if(result == result_Error)
       return false;
-   if(result != result_Assignment || mKey.strCaseCmp("namespace") ||
+   if(result != result_Assignment || !mKey.is("namespace") ||
       mValue.type != Token::type_String)
    {
       mError = "TEXTMAP must begin with a namespace assignment";
@@ -955,18 +961,25 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
    }
 
    // Set namespace
-   if(!mValue.text.strCaseCmp("eternity"))
+   if(mValue.is("eternity"))
       mNamespace = namespace_Eternity;
-   else if(!mValue.text.strCaseCmp("heretic"))
+   else if(mValue.is("heretic"))
       mNamespace = namespace_Heretic;
-   else if(!mValue.text.strCaseCmp("hexen"))
+   else if(mValue.is("hexen"))
       mNamespace = namespace_Hexen;
-   else if(!mValue.text.strCaseCmp("strife"))
+   else if(mValue.is("strife"))
       mNamespace = namespace_Strife;
-   else if(!mValue.text.strCaseCmp("doom"))
+   else if(mValue.is("doom"))
       mNamespace = namespace_Doom;
-   else if(!checkForCompatibilityFlag(mValue.text))
-      return false;
+   else
+   {
+      qstring nstext;
+      nstext.copy(mValue.text, mValue.length);
+      if(!checkForCompatibilityFlag(nstext))
+         return false;
+   }
+
+   reserveItems();
 
    // Gamestuff. Must be null when out of block and only one be set when in
    // block
@@ -976,8 +989,6 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
    USector *sector = nullptr;
    uthing_t *thing = nullptr;
 
-   registerAllKeys();   // now it's the time
-
    while((result = readItem()) != result_Eof)
    {
       if(result == result_Error)
@@ -985,13 +996,13 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
       if(result == result_BlockEntry)
       {
          // we're now in some block. Alloc stuff
-         if(!mBlockName.strCaseCmp("linedef"))
+         if(mBlockName.is("linedef"))
          {
             linedef = &mLinedefs.addNew();
             linedef->errorline = mLine;
             linedef->renderstyle = RENDERSTYLE_translucent;
          }
-         else if(!mBlockName.strCaseCmp("sidedef"))
+         else if(mBlockName.is("sidedef"))
          {
             sidedef = &mSidedefs.addNew();
             sidedef->texturetop = "-";
@@ -999,11 +1010,11 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
             sidedef->texturemiddle = "-";
             sidedef->errorline = mLine;
          }
-         else if(!mBlockName.strCaseCmp("vertex"))
+         else if(mBlockName.is("vertex"))
             vertex = &mVertices.addNew();
-         else if(!mBlockName.strCaseCmp("sector"))
+         else if(mBlockName.is("sector"))
             sector = &mSectors.addNew();
-         else if(!mBlockName.strCaseCmp("thing"))
+         else if(mBlockName.is("thing"))
          {
             thing = &mThings.addNew();
             thing->health = 1.0;
@@ -1020,12 +1031,12 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
 #define READ_FIXED(obj, field) case t_##field: readFixed(obj->field); break
 #define REQUIRE_FIXED(obj, field, flag) case t_##field: requireFixed(obj->field, obj->flag); break
 
-         const keytoken_t *kt = gTokenTable.objectForKey(mKey.constPtr());
-         if(kt)
+         token_e kt;
+         if(tokenForKey(mKey.text, mKey.length, kt))
          {
             if(linedef)
             {
-               switch(kt->token)
+               switch(kt)
                {
                   case t_id: readNumber(linedef->identifier); break;
                   REQUIRE_INT(linedef, v1, v1set);
@@ -1090,7 +1101,7 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
             }
             else if(sidedef)
             {
-               switch(kt->token)
+               switch(kt)
                {
                   case t_offsetx:
                      if(mNamespace == namespace_Eternity)
@@ -1114,14 +1125,14 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
             }
             else if(vertex)
             {
-               if(kt->token == t_x)
+               if(kt == t_x)
                   requireFixed(vertex->x, vertex->xset);
-               else if(kt->token == t_y)
+               else if(kt == t_y)
                   requireFixed(vertex->y, vertex->yset);
             }
             else if(sector)
             {
-               switch(kt->token)
+               switch(kt)
                {
                   case t_texturefloor:
                      requireString(sector->texturefloor, sector->tfloorset);
@@ -1150,7 +1161,7 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
                }
                if(mNamespace == namespace_Eternity)
                {
-                  switch(kt->token)
+                  switch(kt)
                   {
                      READ_FIXED(sector, xpanningfloor);
                      READ_FIXED(sector, ypanningfloor);
@@ -1231,7 +1242,7 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
             }
             else if(thing)
             {
-               switch(kt->token)
+               switch(kt)
                {
                   case t_id: readNumber(thing->identifier); break;
                   REQUIRE_FIXED(thing, x, xset);
@@ -1282,7 +1293,7 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
                }
                if(mNamespace == namespace_Eternity)
                {
-                  switch(kt->token)
+                  switch(kt)
                   {
                      READ_NUMBER(thing, health);
                      default:
@@ -1352,7 +1363,7 @@ bool UDMFParser::parse(WadDirectory &setupwad, int lump)
 qstring UDMFParser::error() const
 {
    qstring message("TEXTMAP error at ");
-   message << (int)mLine << ':' << (int)mColumn << " - " << mError;
+   message << mLine << ':' << column() << " - " << mError;
    return message;
 }
 
@@ -1379,11 +1390,13 @@ int UDMFParser::getMapFormat() const
 }
 
 //
-// Loads a new TEXTMAP and clears all variables
+// Points the parser at a new TEXTMAP and clears all variables. The data is
+// not copied.
 //
 void UDMFParser::setData(const char *data, size_t size)
 {
-   mData.copy(data, size);
+   mData = data;
+   mSize = size;
    reset();
 }
 
@@ -1394,7 +1407,7 @@ void UDMFParser::reset()
 {
    mPos = 0;
    mLine = 1;
-   mColumn = 1;
+   mLineStart = 0;
    mError.clear();
 
    mKey.clear();
@@ -1451,7 +1464,7 @@ void UDMFParser::requireInt(int &target, bool &flagtarget) const
 void UDMFParser::readString(qstring &target) const
 {
    if(mValue.type == Token::type_String)
-      target = mValue.text;
+      target.copy(mValue.text, mValue.length);
 }
 
 //
@@ -1461,7 +1474,7 @@ void UDMFParser::requireString(qstring &target, bool &flagtarget) const
 {
    if(mValue.type == Token::type_String)
    {
-      target = mValue.text;
+      target.copy(mValue.text, mValue.length);
       flagtarget = true;
    }
 }
@@ -1518,7 +1531,7 @@ UDMFParser::readresult_e UDMFParser::readItem()
       mError = "Expected a keyword";
       return result_Error;
    }
-   mKey = token.text;
+   mKey = token;
 
    if(!next(token) || token.type != Token::type_Symbol ||
       (token.symbol != '=' && token.symbol != '{'))
@@ -1537,8 +1550,7 @@ UDMFParser::readresult_e UDMFParser::readItem()
          return result_Error;
       }
 
-      if(token.type == Token::type_Keyword && token.text.strCaseCmp("true") &&
-         token.text.strCaseCmp("false"))
+      if(token.type == Token::type_Keyword && !token.is("true") && !token.is("false"))
       {
          mError = "Identifier can only be true or false";
          return result_Error;
@@ -1577,145 +1589,276 @@ UDMFParser::readresult_e UDMFParser::readItem()
 //
 bool UDMFParser::next(Token &token)
 {
-   // Skip all leading whitespace
-   bool checkWhite = true;
-   size_t size = mData.length();
+   const char *const data = mData;
+   const size_t size = mSize;
+   size_t pos = mPos;
 
-   while(checkWhite)
+   // Skip all leading whitespace and comments. Newlines can only appear here
+   // and in strings, so these are the only places that count lines.
+   while(true)
    {
-      checkWhite = false;  // reset it unless someone else restores it
-
-      while(mPos != size && ectype::isSpace(mData[mPos]))
-         addPos(1);
-      if(mPos == size)
-         return false;
-
-      // Skip comments
-      if(mData[mPos] == '/' && mPos + 1 < size && mData[mPos + 1] == '/')
+      while(pos != size && ectype::isSpace(data[pos]))
       {
-         addPos(2);
-         // one line comment
-         while(mPos != size && mData[mPos] != '\n')
-            addPos(1);
-         if(mPos == size)
-            return false;
+         if(data[pos] == '\n')
+         {
+            mLine++;
+            mLineStart = pos + 1;
+         }
+         pos++;
+      }
+      if(pos == size)
+      {
+         mPos = pos;
+         return false;
+      }
 
-         // If here, we hit an "enter"
-         addPos(1);
-         if(mPos == size)
-            return false;
+      if(data[pos] != '/' || pos + 1 == size)
+         break;
 
-         checkWhite = true;   // look again for whitespaces if reached here
+      if(data[pos + 1] == '/')
+      {
+         // one line comment; the newline is counted as whitespace
+         const void *nl = memchr(data + pos, '\n', size - pos);
+         pos = nl ? static_cast<const char *>(nl) - data : size;
       }
-
-      if(mData[mPos] == '/' && mPos + 1 < size && mData[mPos + 1] == '*')
+      else if(data[pos + 1] == '*')
       {
-         addPos(2);
-         while(mPos + 1 < size && (mData[mPos] != '*' || mData[mPos + 1] != '/'))
-            addPos(1);
-         if(mPos + 1 >= size)
+         pos += 2;
+         while(pos + 1 < size && (data[pos] != '*' || data[pos + 1] != '/'))
          {
-            addPos(1);
-            return false;
+            if(data[pos] == '\n')
+            {
+               mLine++;
+               mLineStart = pos + 1;
+            }
+            pos++;
          }
-         if(mData[mPos] == '*' && mData[mPos + 1] == '/')
-            addPos(2);
-         if(mPos == size)
+         if(pos + 1 >= size)
+         {
+            if(pos < size && data[pos] == '\n')
+            {
+               mLine++;
+               mLineStart = pos + 1;
+            }
+            mPos = size;
             return false;
-         checkWhite = true;
+         }
+         pos += 2;
       }
+      else
+         break;
    }
 
+   mPos = pos;
+
    // now we're clear from whitespaces and comments
 
    // Check for number
-   char *result = nullptr;
-   double number = strtod(&mData[mPos], &result);
-   if(result > &mData[mPos])  // we have something
-   {
-      // copy it
-      token.type = Token::type_Number;
-      token.number = number;
-      addPos(result - mData.constPtr() - mPos);
+   if(nextNumber(token))
       return true;
-   }
 
    // Check for string
-   if(mData[mPos] == '"')
+   if(data[pos] == '"')
    {
-      addPos(1);
+      pos++;
 
       // we entered a string
       // find the next string
       token.type = Token::type_String;
+      token.text = data + pos;
 
-      // we must escape things here
-      token.text.clear();
-      bool escape = false;
-      while(mPos != size)
+      // Without escapes the string can be used where it is. Otherwise it has
+      // to be unescaped into mScratch.
+      size_t start = pos;
+      bool escaped = false;
+      while(pos != size && data[pos] != '"')
       {
-         if(!escape)
+         if(data[pos] == '\\')
          {
-            if(mData[mPos] == '\\')
-               escape = true;
-            else if(mData[mPos] == '"')
-            {
-               addPos(1);     // skip the quote
-               return true;   // we're done
-            }
-            else
-               token.text.Putc(mData[mPos]);
+            escaped = true;
+            if(++pos == size)
+               break;
+         }
+         if(data[pos] == '\n')
+         {
+            mLine++;
+            mLineStart = pos + 1;
          }
-         else
+         pos++;
+      }
+      token.length = pos - start;
+
+      if(escaped)
+      {
+         mScratch.clear();
+         for(size_t i = start; i < pos; i++)
          {
-            token.text.Putc(mData[mPos]);
-            escape = false;
+            if(data[i] == '\\' && ++i == pos)
+               break;
+            mScratch.Putc(data[i]);
          }
-         addPos(1);
+         token.text = mScratch.constPtr();
+         token.length = mScratch.length();
       }
+
+      if(pos != size)
+         pos++;     // skip the quote
+      mPos = pos;
       return true;
    }
 
    // keyword: start with a letter or _
-   if(ectype::isAlpha(mData[mPos]) || mData[mPos] == '_')
+   if(ectype::isAlpha(data[pos]) || data[pos] == '_')
    {
       token.type = Token::type_Keyword;
-      token.text.clear();
-      while(mPos != size &&
-            (ectype::isAlnum(mData[mPos]) || mData[mPos] == '_'))
-      {
-         token.text.Putc(mData[mPos]);
-         addPos(1);
-      }
+      token.text = data + pos;
+      while(pos != size && (ectype::isAlnum(data[pos]) || data[pos] == '_'))
+         pos++;
+      token.length = pos - mPos;
+      mPos = pos;
       return true;
    }
 
    // symbol. Just put one character
    token.type = Token::type_Symbol;
-   token.symbol = mData[mPos];
-   addPos(1);
+   token.symbol = data[pos];
+   mPos = pos + 1;
+
+   return true;
+}
+
+//
+// Reads a number at the current position, if there is one. Plain decimal
+// integers, which are nearly all of them, are converted here; anything else
+// goes through strtod. Also, the lump isn't terminated, so strtod only ever
+// sees a terminated copy.
+//
+bool UDMFParser::nextNumber(Token &token)
+{
+   const char *const data = mData;
+   size_t pos = mPos;
+   char c = data[pos];
+
+   // UDMF numbers start with a digit, a sign or a decimal point
+   if(!ectype::isDigit(c) && c != '+' && c != '-' && c != '.')
+      return false;
+
+   bool negative = (c == '-');
+   if(c == '+' || c == '-')
+      pos++;
+
+   size_t digitstart = pos;
+   double value = 0;
+   while(pos != mSize && ectype::isDigit(data[pos]))
+   {
+      value = value * 10 + (data[pos] - '0');
+      pos++;
+   }
+
+   // digits stay exact in a double up to 15 of them
+   size_t numdigits = pos - digitstart;
+   bool simple = numdigits && numdigits <= 15;
+   if(simple && pos != mSize)
+   {
+      // fraction, exponent or hex
+      c = ectype::toUpper(data[pos]);
+      simple = (c != '.' && c != 'E' && c != 'X');
+   }
+   if(simple)
+   {
+      token.type = Token::type_Number;
+      token.number = negative ? -value : value;
+      mPos = pos;
+      return true;
+   }
+
+   char buffer[64];
+   size_t length = 0;
+   for(pos = mPos; pos != mSize && length < sizeof(buffer) - 1; pos++)
+   {
+      c = data[pos];
+      if(!ectype::isAlnum(c) && c != '.' && c != '+' && c != '-')
+         break;
+      buffer[length++] = c;
+   }
+   buffer[length] = '\0';
 
+   char *end = nullptr;
+   double number = strtod(buffer, &end);
+   if(end == buffer)
+      return false;
+
+   token.type = Token::type_Number;
+   token.number = number;
+   mPos += end - buffer;
    return true;
 }
 
 //
-// Increases position by given amount. Updates line and column accordingly.
+// Counts the blocks of each kind in the TEXTMAP and reserves room for them,
+// so the collections don't keep growing and moving their items while the
+// real pass fills them. This only looks for "name {" outside of strings and
+// comments, which is far cheaper than tokenizing.
 //
-void UDMFParser::addPos(size_t amount)
+void UDMFParser::reserveItems()
 {
-   for(size_t i = 0; i < amount; i++)
+   const char *const data = mData;
+   const size_t size = mSize;
+   size_t counts[5] = { 0, 0, 0, 0, 0 };
+   static const char *const names[5] = { "linedef", "sidedef", "vertex", "sector", "thing" };
+
+   size_t wordstart = 0, wordend = 0;   // last keyword seen
+   for(size_t pos = mPos; pos < size; pos++)
    {
-      if(mPos == mData.length())
-         return;
-      if(mData[mPos] == '\n')
+      char c = data[pos];
+      if(c == '"')
       {
-         mColumn = 1;
-         mLine++;
+         for(++pos; pos < size && data[pos] != '"'; pos++)
+         {
+            if(data[pos] == '\\')
+               pos++;
+         }
       }
-      else
-         mColumn++;
-      mPos++;
+      else if(c == '/' && pos + 1 < size && data[pos + 1] == '/')
+      {
+         const void *nl = memchr(data + pos, '\n', size - pos);
+         pos = nl ? static_cast<const char *>(nl) - data : size;
+      }
+      else if(c == '/' && pos + 1 < size && data[pos + 1] == '*')
+      {
+         for(pos += 2; pos + 1 < size && (data[pos] != '*' || data[pos + 1] != '/'); pos++)
+            ;
+         pos++;
+      }
+      else if(ectype::isAlpha(c) || c == '_')
+      {
+         wordstart = pos;
+         while(pos + 1 < size && (ectype::isAlnum(data[pos + 1]) || data[pos + 1] == '_'))
+            pos++;
+         wordend = pos + 1;
+      }
+      else if(c == '{')
+      {
+         size_t length = wordend - wordstart;
+         for(int i = 0; i < 5; i++)
+         {
+            if(!strncasecmp(data + wordstart, names[i], length) && !names[i][length])
+            {
+               counts[i]++;
+               break;
+            }
+         }
+         wordstart = wordend = 0;
+      }
+      else if(c == '=' || c == ';' || c == '}')
+         wordstart = wordend = 0;
    }
+
+   mLinedefs.reserve(counts[0]);
+   mSidedefs.reserve(counts[1]);
+   mVertices.reserve(counts[2]);
+   mSectors.reserve(counts[3]);
+   mThings.reserve(counts[4]);
 }
 
 // EOF
@@ -31,6 +31,7 @@
 #include "m_collection.h"
 #include "m_fixed.h"
 #include "m_qstr.h"
+#include "z_auto.h"
 
 class WadDirectory;
 
@@ -167,7 +168,7 @@ class UDMFParser : public ZoneObject
 {
 public:
    
-   UDMFParser() : mLine(1), mColumn(1)
+   UDMFParser() : mData(nullptr), mSize(0), mPos(0), mLine(1), mLineStart(0)
    {
       static ULinedef linedef;
       mLinedefs.setPrototype(&linedef);
@@ -193,7 +194,7 @@ public:
    bool loadSidedefs2();
    bool loadThings();
 
-   bool checkForCompatibilityFlag(qstring nstext);
+   bool checkForCompatibilityFlag(const qstring &nstext);
    bool parse(WadDirectory &setupwad, int lump);
 
    qstring error() const;
@@ -201,10 +202,14 @@ public:
    int getMapFormat() const;
 
    int line() const { return mLine; }
-   int column() const { return mColumn; }
+   int column() const { return static_cast<int>(mPos - mLineStart) + 1; }
 
 private:
 
+   //
+   // A token. Keywords and strings point straight into the TEXTMAP, except
+   // for strings with escapes, which are unescaped into mScratch.
+   //
    class Token
    {
    public:
@@ -218,7 +223,8 @@ private:
 
       type_e type;
       double number;
-      qstring text;
+      const char *text;
+      size_t length;
       char symbol;
 
       Token()
@@ -230,9 +236,17 @@ private:
       {
          type = type_Keyword;
          number = 0;
-         text.clear();
+         text = "";
+         length = 0;
          symbol = 0;
       }
+
+      // case-insensitive comparison of the text. The lengths are compared
+      // first, as the text may have a NUL in it.
+      bool is(const char *str) const
+      {
+         return strlen(str) == length && !strncasecmp(text, str, length);
+      }
    };
 
    enum readresult_e
@@ -437,6 +451,7 @@ private:
 
    void setData(const char *data, size_t size);
    void reset();
+   void reserveItems();
 
    void readFixed(fixed_t &target) const;
    void requireFixed(fixed_t &target, bool &flagtarget) const;
@@ -450,20 +465,23 @@ private:
    readresult_e readItem();
 
    bool next(Token &token);
-   void addPos(size_t amount);
+   bool nextNumber(Token &token);
 
-   bool eof() const { return mPos == mData.length(); }
+   bool eof() const { return mPos == mSize; }
 
-   qstring mData;
+   ZAutoBuffer mBuffer;  // the TEXTMAP lump, tokenized in place
+   const char *mData;
+   size_t mSize;
    size_t mPos;
    int mLine; // for locating errors. 1-based
-   int mColumn;
+   size_t mLineStart;  // offset of the current line, for the column
    qstring mError;
+   qstring mScratch;   // unescaped string value
 
-   qstring mKey;
+   Token mKey;
    Token mValue;
    bool mInBlock;
-   qstring mBlockName;
+   Token mBlockName;
 
    // Game stuff
    namespace_e mNamespace;
@@ -0,0 +1,399 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Keyframe index of the demo being played back, for seeking to any
+//  tic of it by restoring the nearest snapshot and playing on from there.
+//
+// Authors: agent
+//
+
+#include "z_zone.h"
+#include "hal/i_timer.h"
+
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "d_demobatch.h"
+#include "d_event.h"
+#include "d_main.h"
+#include "doomstat.h"
+#include "g_demokey.h"
+#include "g_game.h"
+#include "hu_stuff.h"
+#include "m_collection.h"
+#include "m_misc.h"
+#include "m_qstr.h"
+#include "m_utils.h"
+#include "p_chase.h"
+#include "p_saveg.h"
+#include "s_sound.h"
+#include "st_stuff.h"
+#include "v_misc.h"
+
+extern gamestate_t wipegamestate;
+
+//
+// A snapshot of the game, taken at the start of a tic of the demo before the
+// tic was read. Everything the savegame format leaves out that playback
+// depends on is kept alongside it.
+//
+struct demokey_t
+{
+   int     tic;       // demo tic the keyframe is for
+   size_t  offset;    // offset of that tic in the demo
+   int     ticdelta;  // gametic - basetic, which the RNG may depend on
+   int     paused;    // pause state set by the demo itself
+   byte   *data;      // snapshot on the system heap, or null if on disk
+   size_t  size;      // size of the snapshot
+};
+
+static PODCollection<demokey_t> demoKeys;
+static size_t demoKeyMemory; // bytes of snapshots held in memory
+static int    demoKeyShift;  // keyframe interval is doubled this many times
+static int    demoSeekTic = -1;
+
+int   demo_keyinterval = 0;              // tics between keyframes; 0 is off
+int   demo_keymemory   = 256;          // MiB of snapshots held before thinning
+char *demo_keydir;                     // if set, snapshots are kept here
+
+//
+// Gets the file a keyframe is kept in, when they are kept on disk.
+//
+static void G_demoKeyFileName(const demokey_t &key, qstring &path)
+{
+   qstring fn;
+
+   fn.Printf(0, "demokey%06d.ekf", key.tic);
+   path = demo_keydir;
+   path.pathConcatenate(fn.constPtr());
+}
+
+//
+// Throws away a keyframe's snapshot.
+//
+static void G_freeDemoKey(demokey_t &key)
+{
+   if(key.data)
+   {
+      demoKeyMemory -= key.size;
+      Z_SysFree(key.data);
+      key.data = nullptr;
+   }
+   else
+   {
+      qstring path;
+
+      G_demoKeyFileName(key, path);
+      remove(path.constPtr());
+   }
+}
+
+//
+// Drops every other keyframe, and doubles the interval new ones are taken at,
+// once the snapshots have grown past demo_keymemory.
+//
+static void G_thinDemoKeys()
+{
+   size_t numkept = 0;
+
+   for(size_t i = 0; i < demoKeys.getLength(); i++)
+   {
+      if(i & 1)
+         G_freeDemoKey(demoKeys[i]);
+      else
+         demoKeys[numkept++] = demoKeys[i];
+   }
+   demoKeys.resize(numkept);
+
+   ++demoKeyShift;
+}
+
+//
+// Frees the whole index, for a new demo or when playback stops.
+//
+void G_ClearDemoKeys()
+{
+   for(demokey_t &key : demoKeys)
+      G_freeDemoKey(key);
+
+   demoKeys.makeEmpty();
+   demoKeyMemory = 0;
+   demoKeyShift  = 0;
+   demoSeekTic   = -1;
+}
+
+//
+// A keyframe can only be taken while a level is running with nothing else
+// pending, so that restoring one and running the tic gives the same result.
+//
+static bool G_canTakeDemoKey()
+{
+   // indexing is asked for, and never skews timing or batch runs
+   if(!demo_keyinterval || timingdemo || fastdemo || d_batchworker)
+      return false;
+
+   if(gamestate != GS_LEVEL || gameaction != ga_nothing || hub_changelevel)
+      return false;
+
+   for(int i = 0; i < MAXPLAYERS; i++)
+   {
+      if(playeringame[i] && players[i].playerstate != PST_LIVE)
+         return false;
+   }
+
+   if(demoKeys.isEmpty())
+      return true;
+
+   return G_DemoTic() >= demoKeys.back().tic + (demo_keyinterval << demoKeyShift);
+}
+
+//
+// Adds a keyframe for the current tic to the end of the index.
+//
+static void G_takeDemoKey()
+{
+   demokey_t key;
+
+   key.tic      = G_DemoTic();
+   key.offset   = G_DemoOffset();
+   key.ticdelta = gametic - basetic;
+   key.paused   = paused & 1;
+   key.data     = P_SaveGameState(nullptr, key.size);
+
+   if(demo_keydir && *demo_keydir)
+   {
+      qstring path;
+
+      G_demoKeyFileName(key, path);
+      const bool written = M_WriteFile(path.constPtr(), key.data, key.size);
+      Z_SysFree(key.data);
+      key.data = nullptr;
+
+      if(!written)
+      {
+         C_Printf(FC_ERROR "Could not write demo keyframe %s\n", path.constPtr());
+         return;
+      }
+   }
+   else
+      demoKeyMemory += key.size;
+
+   demoKeys.add(key);
+
+   if(demoKeyMemory > size_t(demo_keymemory) << 20 && demoKeys.getLength() > 1)
+      G_thinDemoKeys();
+}
+
+//
+// Puts the game back to the way it was when a keyframe was taken. Loading
+// the level stops demo playback and resets the view, so those are put back
+// as they are now.
+//
+static bool G_restoreDemoKey(const demokey_t &key)
+{
+   byte  *data = key.data;
+   size_t size = key.size;
+
+   if(!data)
+   {
+      qstring path;
+
+      G_demoKeyFileName(key, path);
+      const int len = M_ReadFile(path.constPtr(), &data);
+      if(len < 0)
+      {
+         C_Printf(FC_ERROR "Could not read demo keyframe %s\n", path.constPtr());
+         return false;
+      }
+      size = size_t(len);
+   }
+
+   const bool tmp_netgame   = netgame;
+   const bool tmp_precache  = precache;
+   const int  tmp_console   = consoleplayer;
+   const int  tmp_display   = displayplayer;
+   const int  tmp_userpause = paused & 2;
+
+   precache = false; // don't spend a lot of time in loadlevel
+
+   const bool loaded = P_LoadGameState(data, size);
+
+   precache = tmp_precache;
+
+   if(!key.data)
+      efree(data);
+
+   if(!loaded)
+      return false;
+
+   demoplayback  = true;
+   usergame      = false;
+   netgame       = tmp_netgame;
+   consoleplayer = tmp_console;
+   displayplayer = tmp_display;
+   basetic       = gametic - key.ticdelta;
+   paused        = key.paused | tmp_userpause;
+
+   if(paused)
+      S_PauseSound();
+
+   ST_Start();
+   HU_Start();
+   P_ResetChasecam();
+
+   wipegamestate = gamestate; // no wipe, it's the same level
+
+   G_SetDemoPosition(key.tic, key.offset);
+
+   return true;
+}
+
+//
+// Gets the demo to a tic, restoring the closest keyframe before it if that
+// is nearer than where playback is now, and running every tic from there
+// with no sound.
+//
+static void G_doDemoSeek(int target)
+{
+   const int       current = G_DemoTic();
+   const demokey_t *key    = nullptr;
+
+   for(const demokey_t &k : demoKeys)
+   {
+      if(k.tic > target)
+         break;
+      key = &k;
+   }
+
+   if(target < current || (key && key->tic > current))
+   {
+      if(!key)
+      {
+         C_Printf(FC_ERROR "No demo keyframe before tic %d%s\n", target,
+                  demo_keyinterval ? "" : " (demo_keyinterval is 0)");
+         return;
+      }
+      if(!G_restoreDemoKey(*key))
+         return;
+   }
+
+   const bool tmp_nosfx     = nosfxparm;
+   const int  tmp_userpause = paused & 2;
+
+   nosfxparm = true;
+   paused   &= ~2;
+
+   while(demoplayback && G_DemoTic() < target)
+   {
+      G_Ticker();
+      --basetic; // as if gametic had moved on
+   }
+
+   nosfxparm = tmp_nosfx;
+   paused   |= tmp_userpause;
+}
+
+//
+// Called at the start of every tic of demo playback. Runs a seek asked for
+// by demo_seek, and adds to the index when the next keyframe is due.
+//
+void G_DemoKeyTicker()
+{
+   if(demoSeekTic >= 0)
+   {
+      const int target = demoSeekTic;
+      const unsigned int starttime = i_haltimer.GetTicks();
+
+      demoSeekTic = -1;
+      G_doDemoSeek(target);
+
+      if(demoplayback)
+      {
+         C_Printf("Demo at tic %d (%u ms)\n", G_DemoTic(),
+                  i_haltimer.GetTicks() - starttime);
+      }
+   }
+
+   if(demoplayback && G_canTakeDemoKey())
+      G_takeDemoKey();
+}
+
+//=============================================================================
+//
+// Console Commands
+//
+
+VARIABLE_INT(demo_keyinterval, nullptr, 0, UL, nullptr);
+CONSOLE_VARIABLE(demo_keyinterval, demo_keyinterval, 0)
+{
+   if(!demo_keyinterval)
+      G_ClearDemoKeys();
+   else if(demo_keyinterval < TICRATE)
+      demo_keyinterval = TICRATE;
+}
+
+VARIABLE_INT(demo_keymemory, nullptr, 16, UL, nullptr);
+CONSOLE_VARIABLE(demo_keymemory, demo_keymemory, 0) {}
+
+VARIABLE_STRING(demo_keydir, nullptr, 1024);
+CONSOLE_VARIABLE(demo_keydir, demo_keydir, cf_allowblank)
+{
+   // keyframes already on disk would be lost track of
+   G_ClearDemoKeys();
+   M_NormalizeSlashes(demo_keydir);
+}
+
+CONSOLE_COMMAND(demo_seek, cf_notnet)
+{
+   if(!demoplayback)
+   {
+      C_Printf(FC_ERROR "No demo is playing\n");
+      return;
+   }
+   if(Console.argc < 1)
+   {
+      C_Printf("usage: demo_seek tic\n"
+               "  or demo_seek +tics / -tics to move relative to now\n");
+      return;
+   }
+
+   const char *arg = Console.argv[0]->constPtr();
+   int target = Console.argv[0]->toInt();
+
+   if(*arg == '+' || *arg == '-')
+      target += G_DemoTic();
+
+   demoSeekTic = target < 0 ? 0 : target;
+}
+
+CONSOLE_COMMAND(demo_keyframes, 0)
+{
+   if(demoKeys.isEmpty())
+   {
+      C_Printf("No demo keyframes\n");
+      return;
+   }
+
+   C_Printf("%u keyframes, tics %d to %d, every %d tics\n"
+            "%u KiB in memory\n",
+            unsigned(demoKeys.getLength()), demoKeys[0].tic, demoKeys.back().tic,
+            demo_keyinterval << demoKeyShift, unsigned(demoKeyMemory >> 10));
+}
+
+// EOF
+
@@ -0,0 +1,35 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Keyframe index of the demo being played back, for seeking to any
+//  tic of it by restoring the nearest snapshot and playing on from there.
+//
+// Authors: agent
+//
+
+#ifndef G_DEMOKEY_H__
+#define G_DEMOKEY_H__
+
+void G_DemoKeyTicker();
+void G_ClearDemoKeys();
+
+#endif
+
+// EOF
+
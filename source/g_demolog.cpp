@@ -26,13 +26,20 @@
 #include "d_main.h"
 #include "doomstat.h"
 #include "g_demolog.h"
+#include "g_game.h"
 #include "m_argv.h"
 #include "m_qstr.h"
+#include "m_random.h"
+#include "p_mobj.h"
 
 FILE *demoLogFile;
 
 static bool demoLogLevelExited;
 
+// -demochecksums file
+static FILE *demoSumFile;
+static bool  demoSumEnded;
+
 static void G_demoLogAtExit()
 {
    if(demoLogFile && !demoLogLevelExited)
@@ -78,10 +85,9 @@ void G_DemoLog(E_FORMAT_STRING(const char *format), ...)
 }
 
 //
-// Logs the current stats (useful to tell if a death was deliberate because
-// the user considered the level finished anyway)
+// Gets the kill, item and secret percentages of all players together
 //
-void G_DemoLogStats()
+static void G_demoLogGetStats(int &kills, int &items, int &secrets)
 {
    int allKills = 0, allItems = 0, allSecret = 0;
    for(int i = 0; i < MAXPLAYERS; ++i)
@@ -90,10 +96,20 @@ void G_DemoLogStats()
       allItems += players[i].itemcount;
       allSecret += players[i].secretcount;
    }
-   G_DemoLog("(k: %d%%, i: %d%%, s: %d%%)",
-             totalkills ? 100 * allKills / totalkills : 0,
-             totalitems ? 100 * allItems / totalitems : 0,
-             totalsecret ? 100 * allSecret / totalsecret : 0);
+   kills   = totalkills ? 100 * allKills / totalkills : 0;
+   items   = totalitems ? 100 * allItems / totalitems : 0;
+   secrets = totalsecret ? 100 * allSecret / totalsecret : 0;
+}
+
+//
+// Logs the current stats (useful to tell if a death was deliberate because
+// the user considered the level finished anyway)
+//
+void G_DemoLogStats()
+{
+   int kills, items, secrets;
+   G_demoLogGetStats(kills, items, secrets);
+   G_DemoLog("(k: %d%%, i: %d%%, s: %d%%)", kills, items, secrets);
 }
 
 //
@@ -112,5 +128,101 @@ bool G_DemoLogEnabled()
    return demoLogFile != nullptr;
 }
 
+//=============================================================================
+//
+// Per-tic consistency checksums
+//
+// One line per tic of playback in a level, with the tic of the demo and a
+// checksum of the RNG and every Mobj's position, momentum and health. Two
+// runs of a demo that stay in sync write the same file, so the first line
+// that differs from a known good run is where the demo desynced. A last
+// line starting with "end" is only written if the demo played to its end.
+//
+
+static void G_demoSumAtExit()
+{
+   fclose(demoSumFile);
+}
+
+//
+// Opens the -demochecksums file
+//
+void G_DemoLogChecksumInit(const char *path)
+{
+   if(!(demoSumFile = fopen(path, "wt")))
+   {
+      usermsg("G_DemoLogChecksumInit: failed opening '%s'\n", path);
+      return;
+   }
+   atexit(G_demoSumAtExit);
+}
+
+//
+// FNV-1a over one value
+//
+static void G_demoSumAdd(uint32_t &sum, int32_t value)
+{
+   for(int i = 0; i < 4; i++)
+   {
+      sum ^= (uint32_t(value) >> (i * 8)) & 0xff;
+      sum *= 16777619u;
+   }
+}
+
+//
+// Writes the checksum for the tic just run. Called after P_Ticker during
+// demo playback.
+//
+void G_DemoLogChecksum()
+{
+   if(!demoSumFile)
+      return;
+
+   uint32_t sum = 2166136261u;
+
+   G_demoSumAdd(sum, leveltime);
+   G_demoSumAdd(sum, rng.rndindex);
+   G_demoSumAdd(sum, rng.prndindex);
+   for(unsigned int seed : rng.seed)
+      G_demoSumAdd(sum, int32_t(seed));
+
+   for(Thinker *th = thinkercap.next; th != &thinkercap; th = th->next)
+   {
+      const Mobj *mo = thinker_cast<Mobj *>(th);
+      if(!mo)
+         continue;
+
+      G_demoSumAdd(sum, mo->type);
+      G_demoSumAdd(sum, mo->x);
+      G_demoSumAdd(sum, mo->y);
+      G_demoSumAdd(sum, mo->z);
+      G_demoSumAdd(sum, mo->momx);
+      G_demoSumAdd(sum, mo->momy);
+      G_demoSumAdd(sum, mo->momz);
+      G_demoSumAdd(sum, int32_t(mo->angle));
+      G_demoSumAdd(sum, mo->health);
+   }
+
+   fprintf(demoSumFile, "%d\t%08x\n", G_DemoTic(), sum);
+}
+
+//
+// Writes the closing line of the checksum file once the demo has played to
+// its end, noting whether the last level was exited and the stats then.
+//
+void G_DemoLogEnd()
+{
+   if(!demoSumFile || demoSumEnded)
+      return;
+
+   int kills, items, secrets;
+   G_demoLogGetStats(kills, items, secrets);
+
+   fprintf(demoSumFile, "end\t%d\t%s\t%d\t%d\t%d\n", G_DemoTic(),
+           demoLogLevelExited ? "exited" : "unfinished", kills, items, secrets);
+   fflush(demoSumFile);
+   demoSumEnded = true;
+}
+
 // EOF
 
@@ -33,6 +33,10 @@ void G_DemoLogStats();
 bool G_DemoLogEnabled();
 void G_DemoLogSetExited(bool value);
 
+void G_DemoLogChecksumInit(const char *path);
+void G_DemoLogChecksum();
+void G_DemoLogEnd();
+
 #endif
 
 // EOF
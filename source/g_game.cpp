@@ -39,6 +39,7 @@
 #include "c_io.h"
 #include "c_net.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_deh.h"              // Ty 3/27/98 deh declarations
 #include "d_event.h"
 #include "d_gi.h"
@@ -55,6 +56,7 @@
 #include "f_finale.h"
 #include "f_wipe.h"
 #include "g_bind.h"
+#include "g_demokey.h"
 #include "g_demolog.h"
 #include "g_dmflag.h"
 #include "g_game.h"
@@ -107,6 +109,7 @@ static OutBuffer demofp;         // only for recording
 static byte    *demo_p;          // used for both playing and recording
 static byte    *demo_continue_p; // only for rerecording
 static size_t   demolength;
+static int      demotic;         // tics read so far during playback
 static int16_t  consistency[MAXPLAYERS][BACKUPTICS];
 static int      g_destmap;
 
@@ -1356,6 +1359,10 @@ void G_DoPlayDemo(void)
    if(gameaction != ga_loadgame)      // killough 12/98: support -loadgame
       basetic = gametic;  // killough 9/29/98
 
+   // keyframes of the last demo are no use for this one
+   G_ClearDemoKeys();
+   demotic = 0;
+
    M_ExtractFileBase(defdemoname, basename);         // killough
 
    // haleyjd 11/09/09: check ns_demos namespace first, then ns_global
@@ -1555,6 +1562,32 @@ static void G_ReadDemoTiccmd(ticcmd_t *cmd)
    }
 }
 
+//
+// Number of tics read so far from the demo being played back.
+//
+int G_DemoTic()
+{
+   return demotic;
+}
+
+//
+// Offset into the demo being played back of the next tic to be read.
+//
+size_t G_DemoOffset()
+{
+   return demo_p - demobuffer;
+}
+
+//
+// Moves playback to another tic of the demo, for a demo keyframe that has
+// just been restored.
+//
+void G_SetDemoPosition(int tic, size_t offset)
+{
+   demotic = tic;
+   demo_p  = demobuffer + offset;
+}
+
 //
 // G_ReadDemoContinueTiccmd
 //
@@ -2194,6 +2227,13 @@ void G_Ticker()
 {
    int i;
 
+   // report on a savegame written in the background
+   P_PollSaveGame();
+
+   // run a pending demo seek, and index the demo as it plays
+   if(demoplayback)
+      G_DemoKeyTicker();
+
    // do player reborns if needed
    for(i = 0; i < MAXPLAYERS; i++)
    {
@@ -2356,6 +2396,9 @@ void G_Ticker()
             }
          }
       }
+
+      if(demoplayback)
+         ++demotic;
    }
 
    if(InventoryCanClose())
@@ -2379,6 +2422,8 @@ void G_Ticker()
    if(gamestate == GS_LEVEL)
    {
       P_Ticker();
+      if(demoplayback)
+         G_DemoLogChecksum();
       G_CameraTicker(); // haleyjd: move cameras
       ST_Ticker(); 
       AM_Ticker(); 
@@ -3796,12 +3841,17 @@ bool G_CheckDemoStatus()
       return false;  // killough
    }
 
+   // the demo has played to its end
+   if(demoplayback)
+      G_DemoLogEnd();
+
    if(timingdemo)
    {
       int endtime = i_haltimer.GetRealTime();
 
       // killough -- added fps information and made it work for longer demos:
       unsigned int realtics = endtime - starttime;
+      D_BenchWriteReport();
       I_Error("Timed %u gametics in %u realtics = %-.1f frames per second\n",
               (unsigned int)(gametic), realtics,
               (unsigned int)(gametic) * (double) TICRATE / realtics);
@@ -3814,6 +3864,7 @@ bool G_CheckDemoStatus()
       // haleyjd 01/08/11: refactored so that stopping netdemos doesn't cause
       // access violations by leaving the game in "netgame" mode.
       Z_ChangeTag(demobuffer, PU_CACHE);
+      G_ClearDemoKeys();
       G_ReloadDefaults();    // killough 3/1/98
       netgame = false;       // killough 3/29/98
 
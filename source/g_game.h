@@ -55,6 +55,9 @@ void G_RecordDemoContinue(const char *in, const char *name);
 void G_SetOldDemoOptions();
 void G_BeginRecording();
 void G_StopDemo();
+int    G_DemoTic();
+size_t G_DemoOffset();
+void   G_SetDemoPosition(int tic, size_t offset);
 void G_ScrambleRand();
 void G_ExitLevel(int destmap = 0);
 void G_SecretExitLevel(int destmap = 0);
@@ -0,0 +1,129 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Read-only memory mapping of open files
+//
+// Authors: agent
+//
+
+#include "../z_zone.h"
+
+#include "i_filemap.h"
+#include "i_platform.h"
+#include "../m_argv.h"
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+#include <windows.h>
+#include <io.h>
+#elif EE_CURRENT_PLATFORM == EE_PLATFORM_LINUX \
+   || EE_CURRENT_PLATFORM == EE_PLATFORM_MACOSX \
+   || EE_CURRENT_PLATFORM == EE_PLATFORM_FREEBSD
+#define EE_HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+//
+// -nommap turns mapping off, so that everything is read through stdio.
+//
+static bool I_mappingAllowed()
+{
+   static int allowed = -1;
+
+   if(allowed < 0)
+      allowed = !M_CheckParm("-nommap");
+
+   return !!allowed;
+}
+
+//
+// I_MapFile
+//
+// Maps the whole of an open file read-only. The FILE stays open and usable.
+// Returns false, leaving map empty, if the file can't be mapped; that
+// includes files too big for the address space on 32-bit builds.
+//
+bool I_MapFile(FILE *f, hal_filemap_t &map)
+{
+   map = {};
+
+   if(!f || !I_mappingAllowed())
+      return false;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(f)));
+   LARGE_INTEGER size;
+
+   if(file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || !size.QuadPart ||
+      uint64_t(size.QuadPart) > SIZE_MAX)
+      return false;
+
+   HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+   if(!mapping)
+      return false;
+
+   void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+   if(!data)
+   {
+      CloseHandle(mapping);
+      return false;
+   }
+
+   map.data   = static_cast<const byte *>(data);
+   map.size   = size_t(size.QuadPart);
+   map.handle = mapping;
+   return true;
+#elif defined(EE_HAVE_MMAP)
+   struct stat st;
+
+   if(fstat(fileno(f), &st) || st.st_size <= 0 || uint64_t(st.st_size) > SIZE_MAX)
+      return false;
+
+   void *data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fileno(f), 0);
+   if(data == MAP_FAILED)
+      return false;
+
+   map.data = static_cast<const byte *>(data);
+   map.size = size_t(st.st_size);
+   return true;
+#else
+   return false;
+#endif
+}
+
+//
+// I_UnmapFile
+//
+void I_UnmapFile(hal_filemap_t &map)
+{
+   if(!map.data)
+      return;
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   UnmapViewOfFile(map.data);
+   CloseHandle(static_cast<HANDLE>(map.handle));
+#elif defined(EE_HAVE_MMAP)
+   munmap(const_cast<byte *>(map.data), map.size);
+#endif
+
+   map = {};
+}
+
+// EOF
+
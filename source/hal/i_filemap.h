@@ -0,0 +1,49 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Read-only memory mapping of open files
+//
+// Authors: agent
+//
+
+#ifndef I_FILEMAP_H__
+#define I_FILEMAP_H__
+
+#include <stdio.h>
+
+#include "../doomtype.h"
+
+//
+// A read-only view of an entire file. data is nullptr if the file isn't
+// mapped, in which case callers should fall back to stdio.
+//
+struct hal_filemap_t
+{
+   const byte *data;
+   size_t      size;
+   void       *handle; // platform mapping object, where there is one
+};
+
+bool I_MapFile(FILE *f, hal_filemap_t &map);
+void I_UnmapFile(hal_filemap_t &map);
+
+#endif
+
+// EOF
+
@@ -0,0 +1,263 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Expansion of the 8-bit screen to 32-bit pixels for presentation.
+//  Rows are expanded with AVX2 gathers where the CPU has them and a plain
+//  table lookup otherwise, and large frames are split between a few helper
+//  threads.
+//
+// Authors: agent
+//
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "../z_zone.h"
+
+#include "i_palexpand.h"
+#include "../r_simd.h"
+
+#if defined(R_SIMD_SSE2) && defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define I_PALEXPAND_AVX2
+#include <immintrin.h>
+#endif
+
+// Frames smaller than this are expanded on the calling thread alone; below
+// it, waking the helpers costs about as much as they save.
+static constexpr int64_t PALEXPAND_THREADPIXELS = 2560 * 1440;
+
+static constexpr unsigned PALEXPAND_MAXHELPERS = 3;
+
+using expandrow_t = void (*)(const byte *, uint32_t *, int, const uint32_t *);
+
+static expandrow_t expandrow;
+
+//=============================================================================
+//
+// Row Kernels
+//
+
+static void I_expandRowScalar(const byte *src, uint32_t *dest, int width,
+                              const uint32_t *palette)
+{
+   for(int x = 0; x < width; x++)
+      dest[x] = palette[src[x]];
+}
+
+#ifdef I_PALEXPAND_AVX2
+__attribute__((target("avx2")))
+static void I_expandRowAVX2(const byte *src, uint32_t *dest, int width,
+                            const uint32_t *palette)
+{
+   const int *table = reinterpret_cast<const int *>(palette);
+   int x = 0;
+
+   for(; x + 8 <= width; x += 8)
+   {
+      const __m128i bytes   = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + x));
+      const __m256i indices = _mm256_cvtepu8_epi32(bytes);
+
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest + x),
+                          _mm256_i32gather_epi32(table, indices, 4));
+   }
+   for(; x < width; x++)
+      dest[x] = palette[src[x]];
+}
+#endif
+
+//
+// Picks the AVX2 kernel if this CPU can run it. Without a gather, a vector
+// kernel would still do one lookup per pixel, so it's no better than the
+// scalar loop.
+//
+static expandrow_t I_pickExpandRow()
+{
+#ifdef I_PALEXPAND_AVX2
+   if(__builtin_cpu_supports("avx2"))
+      return I_expandRowAVX2;
+#endif
+   return I_expandRowScalar;
+}
+
+//=============================================================================
+//
+// Helper Threads
+//
+
+struct palexpandjob_t
+{
+   const byte     *source;
+   int             srcpitch;
+   uint32_t       *dest;
+   int             destpitch;
+   int             width;
+   int             rows;
+   const uint32_t *palette;
+   int             numbands;
+};
+
+static std::mutex              palexpandmutex;
+static std::condition_variable palexpandwork; // helpers wait for a new job
+static std::condition_variable palexpanddone; // the caller waits for the helpers
+
+static palexpandjob_t palexpandjob;
+static unsigned       palexpandjobnum;
+static unsigned       palexpandpending;
+static bool           palexpandquit;
+
+static std::thread *palexpandthreads;
+static unsigned     palexpandnumthreads;
+static bool         palexpandstarted;
+
+//
+// Expands one horizontal band of the job's rows
+//
+static void I_expandBand(const palexpandjob_t &job, int band)
+{
+   const int first = job.rows * band / job.numbands;
+   const int last  = job.rows * (band + 1) / job.numbands;
+
+   for(int y = first; y < last; y++)
+   {
+      expandrow(job.source + size_t(y) * job.srcpitch, job.dest + size_t(y) * job.destpitch,
+                job.width, job.palette);
+   }
+}
+
+//
+// Helper thread loop. Helper n always takes band n + 1; the caller takes
+// band 0.
+//
+static void I_palExpandThread(int band, unsigned jobnum)
+{
+   std::unique_lock<std::mutex> lock(palexpandmutex);
+
+   while(true)
+   {
+      palexpandwork.wait(lock, [jobnum] { return palexpandquit || palexpandjobnum != jobnum; });
+      if(palexpandquit)
+         return;
+
+      jobnum = palexpandjobnum;
+      const palexpandjob_t job = palexpandjob;
+
+      lock.unlock();
+      I_expandBand(job, band);
+      lock.lock();
+
+      if(!--palexpandpending)
+         palexpanddone.notify_one();
+   }
+}
+
+//
+// Starts the helpers the first time a frame is big enough to want them.
+// Returns false if the machine has no cores to spare.
+//
+static bool I_startPalExpandThreads()
+{
+   if(palexpandstarted)
+      return palexpandnumthreads > 0;
+
+   palexpandstarted = true;
+
+   unsigned numthreads = std::thread::hardware_concurrency();
+   numthreads = numthreads > 1 ? numthreads - 1 : 0;
+   if(numthreads > PALEXPAND_MAXHELPERS)
+      numthreads = PALEXPAND_MAXHELPERS;
+
+   if(!numthreads)
+      return false;
+
+   palexpandthreads    = new std::thread[numthreads];
+   palexpandnumthreads = numthreads;
+   for(unsigned i = 0; i < numthreads; i++)
+      palexpandthreads[i] = std::thread(I_palExpandThread, int(i + 1), palexpandjobnum);
+
+   return true;
+}
+
+//
+// Stops the helper threads. Called from I_ShutdownGraphics.
+//
+void I_ShutdownPaletteExpansion()
+{
+   if(!palexpandthreads)
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock(palexpandmutex);
+      palexpandquit = true;
+   }
+   palexpandwork.notify_all();
+
+   for(unsigned i = 0; i < palexpandnumthreads; i++)
+      palexpandthreads[i].join();
+
+   delete[] palexpandthreads;
+   palexpandthreads    = nullptr;
+   palexpandnumthreads = 0;
+   palexpandstarted    = false;
+   palexpandquit       = false;
+}
+
+//=============================================================================
+//
+// Interface
+//
+
+void I_ExpandPalette(const byte *source, int srcpitch, uint32_t *dest, int destpitch,
+                     int width, int rows, const uint32_t *palette)
+{
+   if(!expandrow)
+      expandrow = I_pickExpandRow();
+
+   if(int64_t(width) * rows < PALEXPAND_THREADPIXELS || !I_startPalExpandThreads())
+   {
+      for(int y = 0; y < rows; y++)
+      {
+         expandrow(source + size_t(y) * srcpitch, dest + size_t(y) * destpitch,
+                   width, palette);
+      }
+      return;
+   }
+
+   const palexpandjob_t job =
+   {
+      source, srcpitch, dest, destpitch, width, rows, palette,
+      int(palexpandnumthreads) + 1
+   };
+
+   {
+      std::lock_guard<std::mutex> lock(palexpandmutex);
+      palexpandjob     = job;
+      palexpandpending = palexpandnumthreads;
+      ++palexpandjobnum;
+   }
+   palexpandwork.notify_all();
+
+   I_expandBand(job, 0);
+
+   std::unique_lock<std::mutex> lock(palexpandmutex);
+   palexpanddone.wait(lock, [] { return palexpandpending == 0; });
+}
+
+// EOF
+
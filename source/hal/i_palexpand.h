@@ -0,0 +1,45 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Expansion of the 8-bit screen to 32-bit pixels for presentation
+//
+// Authors: agent
+//
+
+#ifndef I_PALEXPAND_H__
+#define I_PALEXPAND_H__
+
+#include <stdint.h>
+
+#include "../doomtype.h"
+
+//
+// Looks each of width x rows source pixels up in palette and writes the
+// results to dest. Pitches are in pixels of their own buffer. Large frames
+// are split across helper threads; the call returns once all rows are done.
+//
+void I_ExpandPalette(const byte *source, int srcpitch, uint32_t *dest, int destpitch,
+                     int width, int rows, const uint32_t *palette);
+
+void I_ShutdownPaletteExpansion();
+
+#endif
+
+// EOF
+
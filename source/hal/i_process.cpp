@@ -0,0 +1,196 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Starting child processes and waiting for them to finish
+//
+// Authors: agent
+//
+
+#include "../z_zone.h"
+
+#include "i_platform.h"
+#include "i_process.h"
+#include "../m_qstr.h"
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+#include <windows.h>
+#elif EE_CURRENT_PLATFORM == EE_PLATFORM_LINUX \
+   || EE_CURRENT_PLATFORM == EE_PLATFORM_MACOSX \
+   || EE_CURRENT_PLATFORM == EE_PLATFORM_FREEBSD
+#define EE_HAVE_POSIX_SPAWN
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+//
+// Quotes one argument for a Windows command line, the way the C runtime
+// splits it up again.
+//
+static void I_quoteArgument(const char *arg, qstring &cmdline)
+{
+   if(*arg && !strpbrk(arg, " \t\""))
+   {
+      cmdline += arg;
+      return;
+   }
+
+   cmdline += '"';
+   for(const char *p = arg; ; p++)
+   {
+      size_t numslashes = 0;
+
+      while(*p == '\\')
+      {
+         ++numslashes;
+         ++p;
+      }
+
+      // backslashes are only special before a quote
+      if(!*p)
+         numslashes *= 2;
+      else if(*p == '"')
+         numslashes = numslashes * 2 + 1;
+
+      while(numslashes--)
+         cmdline += '\\';
+
+      if(!*p)
+         break;
+      cmdline += *p;
+   }
+   cmdline += '"';
+}
+#endif
+
+//
+// I_StartProcess
+//
+// Starts argv[0] with the given arguments, which end with a null. The
+// child's standard output and error go to outfile.
+//
+bool I_StartProcess(const char *const *argv, const char *outfile, hal_process_t &proc)
+{
+   proc = {};
+
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   qstring cmdline;
+
+   for(const char *const *arg = argv; *arg; arg++)
+   {
+      if(arg != argv)
+         cmdline += ' ';
+      I_quoteArgument(*arg, cmdline);
+   }
+
+   SECURITY_ATTRIBUTES sa = { sizeof(sa), nullptr, TRUE };
+   HANDLE out = CreateFileA(outfile, GENERIC_WRITE, FILE_SHARE_READ, &sa, CREATE_ALWAYS,
+                            FILE_ATTRIBUTE_NORMAL, nullptr);
+   if(out == INVALID_HANDLE_VALUE)
+      return false;
+
+   STARTUPINFOA        si = {};
+   PROCESS_INFORMATION pi = {};
+
+   si.cb         = sizeof(si);
+   si.dwFlags    = STARTF_USESTDHANDLES;
+   si.hStdInput  = GetStdHandle(STD_INPUT_HANDLE);
+   si.hStdOutput = out;
+   si.hStdError  = out;
+
+   // CreateProcess may write to the command line
+   char *buf = cmdline.duplicate();
+   const BOOL started = CreateProcessA(nullptr, buf, nullptr, nullptr, TRUE,
+                                       CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
+   efree(buf);
+   CloseHandle(out);
+
+   if(!started)
+      return false;
+
+   CloseHandle(pi.hThread);
+   proc.handle = pi.hProcess;
+   return true;
+#elif defined(EE_HAVE_POSIX_SPAWN)
+   posix_spawn_file_actions_t actions;
+   pid_t pid;
+
+   if(posix_spawn_file_actions_init(&actions))
+      return false;
+
+   posix_spawn_file_actions_addopen(&actions, 1, outfile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   posix_spawn_file_actions_adddup2(&actions, 1, 2);
+
+   const int res = posix_spawnp(&pid, argv[0], &actions, nullptr,
+                                const_cast<char *const *>(argv), environ);
+   posix_spawn_file_actions_destroy(&actions);
+
+   if(res)
+      return false;
+
+   proc.pid = pid;
+   return true;
+#else
+   return false;
+#endif
+}
+
+//
+// I_PollProcess
+//
+// Returns true, with its exit code, once a process started by
+// I_StartProcess has finished. A process killed by a signal gives the
+// negated signal number. Doesn't wait.
+//
+bool I_PollProcess(hal_process_t &proc, int &exitcode)
+{
+#if EE_CURRENT_PLATFORM == EE_PLATFORM_WINDOWS
+   if(WaitForSingleObject(proc.handle, 0) != WAIT_OBJECT_0)
+      return false;
+
+   DWORD code = 0;
+   GetExitCodeProcess(proc.handle, &code);
+   CloseHandle(proc.handle);
+   proc.handle = nullptr;
+
+   exitcode = int(code);
+   return true;
+#elif defined(EE_HAVE_POSIX_SPAWN)
+   int status;
+   const pid_t res = waitpid(proc.pid, &status, WNOHANG);
+
+   if(!res)
+      return false;
+
+   if(res < 0)
+      exitcode = -1; // lost track of it
+   else
+      exitcode = WIFEXITED(status) ? WEXITSTATUS(status) : -WTERMSIG(status);
+   proc.pid = 0;
+   return true;
+#else
+   exitcode = -1;
+   return true;
+#endif
+}
+
+// EOF
+
@@ -0,0 +1,43 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Starting child processes and waiting for them to finish
+//
+// Authors: agent
+//
+
+#ifndef I_PROCESS_H__
+#define I_PROCESS_H__
+
+//
+// A running child process.
+//
+struct hal_process_t
+{
+   void *handle; // process handle, where the platform has one
+   int   pid;    // process id, elsewhere
+};
+
+bool I_StartProcess(const char *const *argv, const char *outfile, hal_process_t &proc);
+bool I_PollProcess(hal_process_t &proc, int &exitcode);
+
+#endif
+
+// EOF
+
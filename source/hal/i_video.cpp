@@ -25,6 +25,10 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "../z_zone.h"   /* memory allocation wrappers -- killough */
 
 // Need platform defines
@@ -32,6 +36,7 @@
 
 #include "../am_map.h"
 #include "../c_runcmd.h"
+#include "../d_bench.h"
 #include "../d_gi.h"
 #include "../d_main.h"
 #include "../doomstat.h"
@@ -45,8 +50,10 @@
 #include "../r_context.h"
 #include "../r_main.h"
 #include "../st_stuff.h"
+#include "../v_buffer.h"
 #include "../v_misc.h"
 #include "../v_video.h"
+#include "i_palexpand.h"
 
 // Platform-Specific Video Drivers:
 #ifdef _SDL_VER
@@ -115,6 +122,103 @@ static haldriveritem_t halVideoDriverTable[VDR_MAXDRIVERS] =
    }
 };
 
+//=============================================================================
+//
+// Headless Video Driver
+//
+// Used by -benchmark when no window is wanted. Frames are rendered into a
+// system memory buffer laid out like the SDL drivers' primary surface, and
+// never presented.
+//
+
+class HeadlessVideoDriver : public HALVideoDriver
+{
+protected:
+   byte *buffer = nullptr;
+
+   virtual void SetPrimaryBuffer() override;
+   virtual void UnsetPrimaryBuffer() override;
+
+public:
+   virtual void FinishUpdate() override {}
+   virtual void ReadScreen(byte *scr) override;
+   virtual void SetPalette(byte *pal) override {}
+   virtual void ShutdownGraphics() override { ShutdownGraphicsPartway(); }
+   virtual void ShutdownGraphicsPartway() override { UnsetPrimaryBuffer(); }
+   virtual bool InitGraphicsMode() override;
+};
+
+//
+// HeadlessVideoDriver::SetPrimaryBuffer
+//
+// Same transposed shape as the SDL surface, with the pitch rounded up to
+// four bytes the way SDL does it.
+//
+void HeadlessVideoDriver::SetPrimaryBuffer()
+{
+   int bump = (video.width == 512 || video.width == 1024) ? 4 : 0;
+
+   video.pitch = (video.height + 3) & ~3;
+   buffer = ecalloc(byte *, video.pitch, video.width + bump);
+   video.screens[0] = buffer;
+}
+
+//
+// HeadlessVideoDriver::UnsetPrimaryBuffer
+//
+void HeadlessVideoDriver::UnsetPrimaryBuffer()
+{
+   if(buffer)
+   {
+      efree(buffer);
+      buffer = nullptr;
+   }
+   video.screens[0] = nullptr;
+}
+
+//
+// HeadlessVideoDriver::ReadScreen
+//
+void HeadlessVideoDriver::ReadScreen(byte *scr)
+{
+   VBuffer temp;
+
+   V_InitVBufferFrom(&temp, vbscreen.width, vbscreen.height,
+                     vbscreen.height, video.bitdepth, scr);
+   V_BlitVBuffer(&temp, 0, 0, &vbscreen, 0, 0, vbscreen.width, vbscreen.height);
+   V_FreeVBuffer(&temp);
+}
+
+//
+// HeadlessVideoDriver::InitGraphicsMode
+//
+// Takes the resolution from the usual settings and command line overrides,
+// but never opens a window.
+//
+bool HeadlessVideoDriver::InitGraphicsMode()
+{
+   Geom geom;
+   int  resolutionWidth  = 640;
+   int  resolutionHeight = 480;
+
+   geom.parse(i_videomode);
+   I_CheckVideoCmdsOnce(geom);
+   I_ParseResolution(i_resolution, resolutionWidth, resolutionHeight,
+                     geom.width, geom.height);
+
+   video.width     = resolutionWidth;
+   video.height    = resolutionHeight;
+   video.bitdepth  = 8;
+   video.pixelsize = 1;
+
+   UnsetPrimaryBuffer();
+   SetPrimaryBuffer();
+
+   return false;
+}
+
+static HeadlessVideoDriver i_headlessvideodriver;
+
 //
 // Find the currently selected video driver by ID
 //
@@ -195,13 +299,122 @@ char *i_videomode;
 // haleyjd 03/30/14: support for letterboxing narrow resolutions
 bool i_letterbox;
 
+// Convert and present each frame while the next one is being made
+bool i_pipeline;
+
+//=============================================================================
+//
+// Pipelined Presentation
+//
+// With i_pipeline on, I_FinishUpdate only stages the frame. Its palette
+// conversion then runs on the present thread while the game carries on with
+// the next tics, and the upload and buffer swap happen while the render
+// contexts draw the next frame (see R_RunContexts), or at the latest when the
+// next frame is finished. This costs up to a frame of extra latency.
+//
+
+static std::thread             presentthread;
+static std::mutex              presentmutex;
+static std::condition_variable presentcv;
+static bool                    presentconverting; // guarded by presentmutex
+static bool                    presentquit;       // guarded by presentmutex
+static bool                    presentpending;    // main thread only
+
+//
+// Sleeps until there's a staged frame to convert
+//
+static void I_presentThreadFunc()
+{
+   std::unique_lock<std::mutex> lock(presentmutex);
+
+   while(true)
+   {
+      presentcv.wait(lock, [] { return presentquit || presentconverting; });
+
+      if(presentquit)
+         break;
+
+      lock.unlock();
+      i_video_driver->ConvertFrame();
+      lock.lock();
+
+      presentconverting = false;
+      presentcv.notify_all();
+   }
+}
+
+//
+// Waits until the present thread is done with the staged frame
+//
+static void I_waitForConversion()
+{
+   std::unique_lock<std::mutex> lock(presentmutex);
+   presentcv.wait(lock, [] { return !presentconverting; });
+}
+
+//
+// Tells the present thread to quit and waits for it to do so
+//
+static void I_stopPresentThread()
+{
+   if(!presentthread.joinable())
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock(presentmutex);
+      presentquit = true;
+   }
+   presentcv.notify_all();
+
+   presentthread.join();
+   presentquit = false;
+}
+
+//
+// I_PresentPendingFrame
+//
+// Shows the frame staged by the last I_FinishUpdate, if it hasn't been shown
+// yet. Must be called from the main thread.
+//
+void I_PresentPendingFrame()
+{
+   if(!presentpending)
+      return;
+
+   I_waitForConversion();
+   presentpending = false;
+   i_video_driver->PresentFrame();
+}
+
 //
 // I_FinishUpdate
 //
 void I_FinishUpdate()
 {
-   if(!noblit && in_graphics_mode)
+   if(noblit || !in_graphics_mode)
+      return;
+
+   // anything still waiting goes out first, so frames are never dropped
+   I_PresentPendingFrame();
+
+   if(!i_pipeline || !i_video_driver->CanPipeline())
+   {
       i_video_driver->FinishUpdate();
+      return;
+   }
+
+   if(!i_video_driver->StageFrame())
+      return;
+
+   if(!presentthread.joinable())
+      presentthread = std::thread(&I_presentThreadFunc);
+
+   {
+      std::lock_guard<std::mutex> lock(presentmutex);
+      presentconverting = true;
+   }
+   presentcv.notify_all();
+   presentpending = true;
 }
 
 //
@@ -218,11 +431,21 @@ void I_ReadScreen(byte *scr)
 void I_SetPalette(byte *palette)
 {
    if(in_graphics_mode)             // killough 8/11/98
+   {
+      // the staged frame is converted with the palette it was drawn with
+      if(presentpending)
+         I_waitForConversion();
       i_video_driver->SetPalette(palette);
+   }
 }
 
 void I_ShutdownGraphics()
 {
+   if(in_graphics_mode)
+      I_PresentPendingFrame();
+   I_stopPresentThread();
+   I_ShutdownPaletteExpansion();
+
    if(in_graphics_mode)
    {
       R_FreeContexts();
@@ -516,7 +739,8 @@ static bool I_InitGraphicsMode()
    if(!i_videomode)
       i_videomode = estrdup(i_default_videomode);
 
-   if(D_noWindow())
+   // Headless benchmarks still render, just not to a window
+   if(D_noWindow() && !d_benchheadless)
       return false;
 
    // A false return value from HALVideoDriver::InitGraphicsMode means that no
@@ -554,6 +778,7 @@ static void I_ResetScreen()
    // Switch out of old graphics mode
    if(in_graphics_mode)
    {
+      I_PresentPendingFrame();
       R_FreeContexts();
       i_video_driver->ShutdownGraphicsPartway();
       in_graphics_mode = false;
@@ -593,7 +818,12 @@ void I_InitGraphics()
    
    // Select video driver based on configuration (out of those available in 
    // the current compile), or get the default driver if unspecified
-   if(!(driveritem = I_DefaultVideoDriver()))
+   if(d_benchheadless)
+   {
+      i_video_driver = &i_headlessvideodriver;
+      usermsg(" (using headless video driver)");
+   }
+   else if(!(driveritem = I_DefaultVideoDriver()))
    {
       I_Error("I_InitGraphics: invalid video driver %d\n", i_videodriverid);
    }
@@ -770,6 +1000,9 @@ static const char *i_videodrivernames[] =
 VARIABLE_INT(i_videodriverid, nullptr, -1, VDR_MAXDRIVERS-1, i_videodrivernames);
 CONSOLE_VARIABLE(i_videodriverid, i_videodriverid, 0) {}
 
+VARIABLE_TOGGLE(i_pipeline, nullptr, onoff);
+CONSOLE_VARIABLE(i_pipeline, i_pipeline, 0) {}
+
 VARIABLE_TOGGLE(i_letterbox, nullptr, yesno);
 CONSOLE_VARIABLE(i_letterbox, i_letterbox, cf_buffered)
 {
@@ -1895,7 +1895,7 @@ static cell AMX_NATIVE_CALL sm_gethudmode(AMX *amx, cell *params)
 {
    if(hud_enabled && hud_overlaylayout > 0) // Boom HUD enabled, return style
       return (cell)hud_overlaylayout + 1;
-   else if(viewwindow.height == video.height)         // Fullscreen (no HUD)
+   else if(scaledwindow.height == SCREENHEIGHT)         // Fullscreen (no HUD)
       return 0;			
    else                                    // Vanilla style status bar
       return 1;
@@ -57,6 +57,18 @@ public:
    virtual void ShutdownGraphicsPartway() = 0;
    virtual bool InitGraphicsMode()        = 0;
 
+   //
+   // Pipelined presentation (i_pipeline). StageFrame copies the finished
+   // screen aside on the main thread, ConvertFrame turns that copy into the
+   // driver's true-colour buffer on the present thread, and PresentFrame
+   // uploads and shows the result, again on the main thread. Drivers that
+   // can't split their update this way leave CanPipeline false.
+   //
+   virtual bool CanPipeline() const { return false; }
+   virtual bool StageFrame()        { return false; }
+   virtual void ConvertFrame()      {}
+   virtual void PresentFrame()      {}
+
    SDL_Window *window = nullptr;
 };
 
@@ -115,6 +127,7 @@ void I_ShutdownGraphics();
 void I_SetPalette(byte *palette);
 
 void I_FinishUpdate();
+void I_PresentPendingFrame();
 
 void I_ReadScreen(byte *scr);
 
@@ -140,6 +153,7 @@ extern char *i_videomode;
 extern char *i_default_videomode;
 extern int   i_videodriverid;
 extern bool  i_letterbox;
+extern bool  i_pipeline;
 extern int   displaynum;
 
 // Driver enumeration
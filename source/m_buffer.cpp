@@ -27,6 +27,8 @@
 #include "m_buffer.h"
 #include "m_swap.h"
 
+#include "../zlib/zlib.h"
+
 //=============================================================================
 //
 // BufferedFileBase
@@ -46,12 +48,33 @@ void BufferedFileBase::initBuffer(size_t pLen, int pEndian)
    endian = pEndian;
 }
 
+//
+// Frees the buffer from whichever heap it came from.
+//
+void BufferedFileBase::freeBuffer()
+{
+   if(buffer)
+   {
+      if(inMemory)
+         Z_SysFree(buffer);
+      else
+         efree(buffer);
+      buffer = nullptr;
+   }
+
+   inMemory = false;
+}
+
 //
 // Gives the current file offset; this does not account for any data that might
-// be currently pending in an output buffer.
+// be currently pending in an output buffer. For a memory buffer, it is the
+// amount written so far.
 //
 long BufferedFileBase::tell()
 {
+   if(inMemory)
+      return static_cast<long>(idx);
+
    return ftell(f);
 }
 
@@ -69,11 +92,7 @@ void BufferedFileBase::close()
    idx = 0;
    len = 0;
 
-   if(buffer)
-   {
-      efree(buffer);
-      buffer = nullptr;
-   }
+   freeBuffer();
 
    ownFile = false;
 }
@@ -173,13 +192,55 @@ bool OutBuffer::createFile(const char *filename, size_t pLen, int pEndian)
    return true;
 }
 
+//
+// Sets up buffered binary output to memory instead of a file. The buffer starts
+// pLen bytes long and doubles whenever it fills. It is allocated from the
+// system heap, so that once released it may be handed to another thread.
+//
+bool OutBuffer::createMemory(size_t pLen, int pEndian)
+{
+   buffer   = static_cast<byte *>(Z_SysMalloc(pLen));
+   len      = pLen;
+   idx      = 0;
+   endian   = pEndian;
+   inMemory = true;
+
+   return true;
+}
+
+//
+// Takes everything written to a memory buffer, leaving the buffer closed. The
+// caller owns the result and must free it with Z_SysFree.
+//
+byte *OutBuffer::releaseMemory(size_t &size)
+{
+   byte *data = buffer;
+
+   size   = idx;
+   buffer = nullptr;
+   close();
+
+   return data;
+}
+
 //
 // Call to flush the contents of the buffer to the output file. This will be
 // called automatically before the file is closed, but must be called explicitly
 // if a current file offset is needed. Returns false if an IO error occurs.
+// A memory buffer is grown instead.
 //
 bool OutBuffer::flush()
 {
+   if(inMemory)
+   {
+      if(idx == len)
+      {
+         len   *= 2;
+         buffer = static_cast<byte *>(Z_SysRealloc(buffer, len));
+      }
+      return true;
+   }
+
    if(idx)
    {
       if(fwrite(buffer, sizeof(byte), idx, f) < idx)
@@ -230,7 +291,7 @@ bool OutBuffer::write(const void *data, size_t size)
       {
          if(!flush())
             return false;
-         lWriteAmt = len;
+         lWriteAmt = len - idx;
       }
 
       if(lBytesToWrite < lWriteAmt)
@@ -363,20 +424,156 @@ bool InBuffer::openExisting(FILE *pf, int pEndian)
 }
 
 //
-// Seeks inside the file via fseek, and then clears the internal buffer.
+// Reads from a block of memory rather than a file. The memory is not copied,
+// so it must outlive the buffer, and is never freed by it.
+//
+bool InBuffer::openMemory(const byte *data, size_t size, int pEndian)
+{
+   if(!data)
+      return false;
+
+   source    = data;
+   sourcelen = size;
+   sourcepos = 0;
+   endian    = pEndian;
+   ownFile   = false;
+
+   return true;
+}
+
+//
+// Copies up to 'size' bytes out of the memory being read.
+//
+size_t InBuffer::readSource(void *dest, size_t size)
+{
+   const size_t amt = size < sourcelen - sourcepos ? size : sourcelen - sourcepos;
+
+   memcpy(dest, source + sourcepos, amt);
+   sourcepos += amt;
+
+   return amt;
+}
+
+// size of the compressed input chunks read while inflating
+#define INFLATE_CHUNK 65536
+
+//
+// Switches to reading a zlib stream that starts at the current position in
+// the file. Reads then return the inflated data, streamed from the file a
+// chunk at a time. Seeking is not possible until the file is closed.
+//
+bool InBuffer::beginInflate()
+{
+   initBuffer(INFLATE_CHUNK, endian);
+
+   zstream = estructalloc(z_stream, 1);
+   if(inflateInit(zstream) != Z_OK)
+   {
+      efree(zstream);
+      zstream = nullptr;
+      return false;
+   }
+
+   return true;
+}
+
+//
+// Stops inflating, if a zlib stream was being read.
+//
+void InBuffer::endInflate()
+{
+   if(zstream)
+   {
+      inflateEnd(zstream);
+      efree(zstream);
+      zstream = nullptr;
+   }
+}
+
+//
+// Overrides BufferedFileBase::close()
+//
+void InBuffer::close()
+{
+   endInflate();
+
+   source    = nullptr;
+   sourcelen = sourcepos = 0;
+
+   BufferedFileBase::close();
+}
+
+//
+// Seeks inside the file via fseek, or within the memory being read.
 //
 int InBuffer::seek(long offset, int origin)
 {
+   if(zstream)
+      return -1;
+
+   if(source)
+   {
+      long base = 0;
+
+      switch(origin)
+      {
+      case SEEK_CUR:
+         base = static_cast<long>(sourcepos);
+         break;
+      case SEEK_END:
+         base = static_cast<long>(sourcelen);
+         break;
+      default:
+         break;
+      }
+      if(base + offset < 0 || static_cast<size_t>(base + offset) > sourcelen)
+         return -1;
+
+      sourcepos = static_cast<size_t>(base + offset);
+      return 0;
+   }
+
    return fseek(f, offset, origin);
 }
 
 //
 // Read 'size' amount of bytes from the file. Reads are done from the physical
-// medium in chunks of the buffer's length.
+// medium in chunks of the buffer's length. When inflating, a short count is
+// returned at the end of the stream, or on corrupt data, which throws instead
+// if exceptions are enabled.
 //
 size_t InBuffer::read(void *dest, size_t size)
 {
-   return fread(dest, 1, size, f);
+   if(!zstream)
+      return source ? readSource(dest, size) : fread(dest, 1, size, f);
+
+   zstream->next_out  = static_cast<Bytef *>(dest);
+   zstream->avail_out = static_cast<uInt>(size);
+
+   while(zstream->avail_out)
+   {
+      if(!zstream->avail_in)
+      {
+         const size_t amt = source ? readSource(buffer, len) : fread(buffer, 1, len, f);
+         if(!amt)
+            break;
+
+         zstream->next_in  = buffer;
+         zstream->avail_in = static_cast<uInt>(amt);
+      }
+
+      const int ret = inflate(zstream, Z_NO_FLUSH);
+      if(ret == Z_STREAM_END)
+         break;
+      if(ret != Z_OK)
+      {
+         if(throwing)
+            throw BufferedIOException("inflate failed on corrupt data");
+         break;
+      }
+   }
+
+   return size - zstream->avail_out;
 }
 
 //
@@ -384,7 +581,21 @@ size_t InBuffer::read(void *dest, size_t size)
 //
 int InBuffer::skip(size_t skipAmt)
 {
-   return fseek(f, static_cast<long>(skipAmt), SEEK_CUR);
+   if(zstream)
+   {
+      byte scratch[512];
+
+      while(skipAmt)
+      {
+         const size_t amt = skipAmt < sizeof(scratch) ? skipAmt : sizeof(scratch);
+         if(read(scratch, amt) != amt)
+            return -1;
+         skipAmt -= amt;
+      }
+      return 0;
+   }
+
+   return seek(static_cast<long>(skipAmt), SEEK_CUR);
 }
 
 //
@@ -32,6 +32,8 @@
 // Required for: byte
 #include "doomtype.h"
 
+struct z_stream_s;
+
 //
 // An exception class for buffered IO errors
 //
@@ -62,13 +64,15 @@ protected:
    int endian;    // endianness indicator
    bool throwing; // throws exceptions on IO errors
    bool ownFile;  // buffer owns the file
+   bool inMemory; // buffer is on the system heap and grows instead of flushing
    
    void initBuffer(size_t pLen, int pEndian);
+   void freeBuffer();
 
 public:
    BufferedFileBase() 
       : f(nullptr), buffer(nullptr), len(0), idx(0), endian(0), throwing(false),
-        ownFile(false)
+        ownFile(false), inMemory(false)
    {
    }
 
@@ -77,11 +81,7 @@ public:
       if(ownFile && f)
          fclose(f);
 
-      if(buffer)
-      {
-         efree(buffer);
-         buffer = nullptr;
-      }
+      freeBuffer();
    }
 
    long tell();
@@ -113,6 +113,8 @@ class OutBuffer : public BufferedFileBase
 {
 public:
    bool createFile(const char *filename, size_t pLen, int pEndian);
+   bool createMemory(size_t pLen, int pEndian);
+   byte *releaseMemory(size_t &size);
    bool flush();
    void close();
 
@@ -134,13 +136,29 @@ public:
 //
 class InBuffer : public BufferedFileBase
 {
+protected:
+   z_stream_s *zstream;   // set while reading a zlib stream
+   const byte *source;    // memory read instead of a file, if not null
+   size_t      sourcelen; // size of the memory
+   size_t      sourcepos; // current position in the memory
+
+   void   endInflate();
+   size_t readSource(void *dest, size_t size);
+
 public:
-   InBuffer() : BufferedFileBase()
+   InBuffer()
+      : BufferedFileBase(), zstream(nullptr), source(nullptr), sourcelen(0),
+        sourcepos(0)
    {
    }
 
+   ~InBuffer() { endInflate(); }
+
    bool openFile(const char *filename, int pEndian);
    bool openExisting(FILE *f, int pEndian);
+   bool openMemory(const byte *data, size_t size, int pEndian);
+   bool beginInflate();
+   void close();
 
    int    seek(long offset, int origin);
    size_t read(void *dest, size_t size);
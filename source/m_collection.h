@@ -288,6 +288,15 @@ public:
       ++this->length;
    }
 
+   //
+   // Makes room for at least n items without changing the length.
+   //
+   void reserve(size_t n)
+   {
+      if(n > this->numalloc)
+         this->baseResize(n - this->numalloc);
+   }
+
    //
    // Adds a new zero-initialized item to the end of the collection.
    //
@@ -460,27 +469,32 @@ public:
    }
 
    //
-   // Adds a new item to the end of the collection.
+   // Makes room for at least n items without changing the length. Items are
+   // moved, not reallocated in place, as they may point into themselves.
    //
-   void add(const T &newItem)
+   void reserve(size_t n)
    {
-      if(this->length >= this->numalloc)
+      if(n > this->numalloc)
       {
-         size_t newnumalloc = this->numalloc + (this->length ? this->length : 32);
-
-         if(newnumalloc > this->numalloc)
+         T *newItems = ecalloc(T *, n, sizeof(T));
+         for(size_t i = 0; i < this->length; i++)
          {
-            T *newItems = ecalloc(T *, newnumalloc, sizeof(T));
-            for(size_t i = 0; i < this->length; i++)
-            {
-               ::new (&newItems[i]) T(std::move(this->ptrArray[i]));
-               this->ptrArray[i].~T();
-            }
-            efree(this->ptrArray);
-            this->ptrArray = newItems;
-            this->numalloc = newnumalloc;
+            ::new (&newItems[i]) T(std::move(this->ptrArray[i]));
+            this->ptrArray[i].~T();
          }
+         efree(this->ptrArray);
+         this->ptrArray = newItems;
+         this->numalloc = n;
       }
+   }
+
+   //
+   // Adds a new item to the end of the collection.
+   //
+   void add(const T &newItem)
+   {
+      if(this->length >= this->numalloc)
+         reserve(this->numalloc + (this->length ? this->length : 32));
       
       // placement copy construct new item
       ::new (&this->ptrArray[this->length]) T(newItem);
@@ -101,6 +101,7 @@ extern bool secret_notification_enabled;
 #ifdef _SDL_VER
 extern int  showendoom;
 extern int  endoomdelay;
+extern int  snd_musicbuffers;
 #endif
 
 #ifdef HAVE_SPCLIB
@@ -807,6 +808,9 @@ default_t defaults[] =
 
    DEFAULT_INT("endoomdelay", &endoomdelay, nullptr, 350, 35, 3500, default_t::wad_no,
                "Amount of time to display ENDOOM when shown"),
+
+   DEFAULT_INT("snd_musicbuffers", &snd_musicbuffers, nullptr, 4, 2, 32, default_t::wad_no,
+               "audio buffers of SPC and OPL music rendered ahead of playback"),
 #endif
 
    DEFAULT_INT("autoaim", &default_autoaim, &autoaim, 1, 0, 1, default_t::wad_yes,
@@ -837,12 +841,12 @@ default_t defaults[] =
                "user's default wad directory"),
    
    DEFAULT_INT("r_columnengine",&r_column_engine_num, nullptr, 
-               0, 0, NUMCOLUMNENGINES - 1, default_t::wad_no, 
-               "0 = normal"),
+               COLUMNENGINE_NORMAL, 0, NUMCOLUMNENGINES - 1, default_t::wad_no, 
+               "0 = normal, 1 = SIMD (normal if unsupported by the CPU)"),
    
    DEFAULT_INT("r_spanengine",&r_span_engine_num, nullptr,
-               0, 0, NUMSPANENGINES - 1, default_t::wad_no, 
-               "0 = high precision"),
+               SPANENGINE_NORMAL, 0, NUMSPANENGINES - 1, default_t::wad_no, 
+               "0 = high precision, 1 = SIMD (high precision if unsupported by the CPU)"),
 
    DEFAULT_INT("r_tlstyle", &r_tlstyle, nullptr, 1, 0, R_TLSTYLE_NUM - 1, default_t::wad_yes,
                "Doom object translucency style (0 = none, 1 = Boom, 2 = new)"),
@@ -875,7 +879,7 @@ default_t defaults[] =
    DEFAULT_INT("snd_oplemulator", &adlmidi_emulator, nullptr, ADLMIDI_EMU_DOSBOX, 0, ADLMIDI_EMU_end - 1, default_t::wad_no,
                "TODO: adlmidi_bank description"),
 
-   DEFAULT_INT("snd_numchips", &adlmidi_numchips, nullptr, 2, 1, 8, default_t::wad_yes,
+   DEFAULT_INT("snd_numchips", &adlmidi_numchips, nullptr, 2, 1, 16, default_t::wad_yes,
                "TODO: adlmidi_numcards description"),
 
    DEFAULT_INT("snd_bank", &adlmidi_bank, nullptr, 72, 0, BANKS_MAX, default_t::wad_yes,
@@ -42,6 +42,8 @@
 #include "m_shots.h"
 #include "mn_menus.h"
 #include "r_context.h"
+#include "r_dynres.h"
+#include "s_mixer.h"
 #include "s_sound.h"
 #include "s_sndseq.h"
 #include "w_wad.h"
@@ -165,9 +167,13 @@ static default_t sysdefaults[] =
                "Percentage of normal speed (35 fps) realtic clock runs at"),
 
    // killough
-   DEFAULT_INT("snd_channels", &default_numChannels, nullptr, 32, 1, 32, default_t::wad_no,
+   DEFAULT_INT("snd_channels", &default_numChannels, nullptr, 32, 1, MIXER_MAXVOICES, default_t::wad_no,
                "number of sound effects handled simultaneously"),
 
+   DEFAULT_INT("snd_interpolation", &s_interpolation, nullptr, MIXER_INTERP_LINEAR, MIXER_INTERP_NONE,
+               MIXER_NUMINTERP - 1, default_t::wad_no,
+               "Resampling of pitched sounds: 0 = none, 1 = linear, 2 = cubic"),
+
    // haleyjd 12/08/01
    DEFAULT_INT("force_flip_pan", &forceFlipPan, nullptr, 0, 0, 1, default_t::wad_no,
                "Force reversal of stereo audio channels: 0 = normal, 1 = reverse"),
@@ -217,6 +223,9 @@ static default_t sysdefaults[] =
    DEFAULT_BOOL("i_letterbox", &i_letterbox, nullptr, false, default_t::wad_no, 
                 "Letterbox video modes with aspect ratios narrower than 4:3"),
 
+   DEFAULT_BOOL("i_pipeline", &i_pipeline, nullptr, false, default_t::wad_no,
+                "Present each frame while the next one is simulated and drawn"),
+
    DEFAULT_INT("use_vsync", &use_vsync, nullptr, 1, 0, 1, default_t::wad_no,
                "1 to enable wait for vsync to avoid display tearing"),
 
@@ -248,10 +257,23 @@ static default_t sysdefaults[] =
    DEFAULT_BOOL("i_forcefeedback", &i_forcefeedback, nullptr, true, default_t::wad_no,
                 "1 to enable force feedback through gamepads where supported"),
 
-#if 0
-   DEFAULT_INT("r_numcontexts", &r_numcontexts, nullptr, 1, 1, UL, default_t::wad_no,
-               "Amount of renderer threads to run"),
-#endif
+   DEFAULT_INT("r_numcontexts", &r_numcontexts, nullptr, 1, 1, 1, default_t::wad_no,
+               "Amount of renderer threads to run (only 1 is supported for now)"),
+
+   DEFAULT_BOOL("r_balancecontexts", &r_balancecontexts, nullptr, true, default_t::wad_no,
+                "1 to resize renderer threads' screen slices based on their workload"),
+
+   DEFAULT_BOOL("r_dynres", &r_dynres, nullptr, false, default_t::wad_no,
+                "1 to scale the 3D view's resolution to hold r_dynresfps"),
+
+   DEFAULT_INT("r_dynresfps", &r_dynresfps, nullptr, 60, 10, 500, default_t::wad_no,
+               "Frame rate that dynamic resolution aims for"),
+
+   DEFAULT_INT("r_dynresmin", &r_dynresmin, nullptr, 50, 25, 100, default_t::wad_no,
+               "Smallest dynamic resolution scale, in percent"),
+
+   DEFAULT_INT("r_dynresmax", &r_dynresmax, nullptr, 100, 25, 100, default_t::wad_no,
+               "Largest dynamic resolution scale, in percent"),
 
 #ifdef _SDL_VER
    DEFAULT_INT("displaynum", &displaynum, nullptr, 0, 0, UL, default_t::wad_no,
@@ -0,0 +1,209 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Runs a fixed graph of dependent tasks, spreading the ones that
+//  allow it over a few helper threads, and times each of them.
+//
+//  Helper threads only live for the duration of run(). The graph itself
+//  holds no zone memory, so helpers never touch the zone heap unless a task
+//  does, which TASK_ANY tasks must not.
+//
+// Authors: agent
+//
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "z_zone.h"
+
+#include "m_taskgraph.h"
+
+// most helper threads started by run()
+#define TASKGRAPH_MAXHELPERS 3
+
+static int64_t M_taskNow()
+{
+   using namespace std::chrono;
+   return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//
+// Adds a task that runs after every task in deps has finished. Tasks may only
+// depend on tasks added before them. Returns the task's id.
+//
+int TaskGraph::addTask(const char *name, taskthread_e where, std::function<void()> fn,
+                       std::initializer_list<int> deps)
+{
+   const int id = static_cast<int>(tasks.size());
+
+   for(int dep : deps)
+      tasks[dep].dependents.push_back(id);
+
+   tasks.push_back({ name, where, std::move(fn), {}, static_cast<int>(deps.size()), false,
+                     { name, 0, 0, 0 } });
+   return id;
+}
+
+//
+// Runs every task in dependency order and returns true once all have
+// finished. failed is checked on the main thread after each task it runs;
+// once it returns true no more tasks are started, run() waits for the ones
+// already going and returns false.
+//
+bool TaskGraph::run(const std::function<bool()> &failed)
+{
+   std::mutex              mutex;
+   std::condition_variable changed;
+   std::deque<int>         mainready, anyready;
+
+   int  remaining = static_cast<int>(tasks.size());
+   int  running   = 0;
+   bool stopping  = false;
+   bool quit      = false;
+
+   const int64_t base = M_taskNow();
+
+   auto makeReady = [&](int id) {
+      (tasks[id].where == TASK_MAIN ? mainready : anyready).push_back(id);
+   };
+
+   // runs a task; the lock is held on entry and on return
+   auto execute = [&](std::unique_lock<std::mutex> &lock, int id, int thread) {
+      task_t &task = tasks[id];
+
+      ++running;
+      lock.unlock();
+
+      task.timing.start  = M_taskNow() - base;
+      task.fn();
+      task.timing.end    = M_taskNow() - base;
+      task.timing.thread = thread;
+
+      lock.lock();
+      --running;
+      --remaining;
+      task.ran = true;
+      for(int dependent : task.dependents)
+      {
+         if(!--tasks[dependent].waiting)
+            makeReady(dependent);
+      }
+      changed.notify_all();
+   };
+
+   int numany = 0;
+   for(size_t i = 0; i < tasks.size(); i++)
+   {
+      tasks[i].ran = false;
+      if(tasks[i].where == TASK_ANY)
+         ++numany;
+      if(!tasks[i].waiting)
+         makeReady(static_cast<int>(i));
+   }
+
+   int numhelpers = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+   numhelpers = std::min({ numhelpers, numany, TASKGRAPH_MAXHELPERS });
+
+   std::vector<std::thread> helpers;
+   for(int i = 0; i < numhelpers; i++)
+   {
+      helpers.emplace_back([&, i] {
+         std::unique_lock<std::mutex> lock(mutex);
+
+         while(true)
+         {
+            changed.wait(lock, [&] { return quit || (!stopping && !anyready.empty()); });
+            if(quit)
+               return;
+
+            const int id = anyready.front();
+            anyready.pop_front();
+            execute(lock, id, i + 1);
+         }
+      });
+   }
+
+   {
+      std::unique_lock<std::mutex> lock(mutex);
+
+      while(remaining)
+      {
+         // main-only tasks first, since nothing else can run them
+         std::deque<int> *queue = nullptr;
+         if(!stopping)
+         {
+            if(!mainready.empty())
+               queue = &mainready;
+            else if(!anyready.empty())
+               queue = &anyready;
+         }
+
+         if(queue)
+         {
+            const int id = queue->front();
+            queue->pop_front();
+            execute(lock, id, 0);
+
+            if(failed())
+               stopping = true;
+            continue;
+         }
+
+         // stopped, or waiting on nothing
+         if(!running)
+            break;
+
+         changed.wait(lock);
+      }
+
+      quit = true;
+      changed.notify_all();
+   }
+
+   for(std::thread &helper : helpers)
+      helper.join();
+
+   return !remaining;
+}
+
+//
+// Timings of the tasks that ran in the last run(), by start time
+//
+std::vector<TaskGraph::timing_t> TaskGraph::getTimings() const
+{
+   std::vector<timing_t> timings;
+
+   for(const task_t &task : tasks)
+   {
+      if(task.ran)
+         timings.push_back(task.timing);
+   }
+
+   std::sort(timings.begin(), timings.end(), [](const timing_t &a, const timing_t &b) {
+      return a.start < b.start;
+   });
+   return timings;
+}
+
+// EOF
+
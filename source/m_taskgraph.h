@@ -0,0 +1,80 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Runs a fixed graph of dependent tasks, spreading the ones that
+//  allow it over a few helper threads, and times each of them.
+//
+// Authors: agent
+//
+
+#ifndef M_TASKGRAPH_H__
+#define M_TASKGRAPH_H__
+
+#include <functional>
+#include <initializer_list>
+#include <stdint.h>
+#include <vector>
+
+//
+// Where a task may run. Anything that touches the zone heap, the WAD system
+// or the console must stay on the main thread.
+//
+enum taskthread_e
+{
+   TASK_MAIN, // only the thread calling run()
+   TASK_ANY,  // any thread, including the main one when it has nothing else
+};
+
+class TaskGraph
+{
+public:
+   struct timing_t
+   {
+      const char *name;
+      int64_t     start;  // nanoseconds since run() began
+      int64_t     end;
+      int         thread; // 0 is the main thread
+   };
+
+   int addTask(const char *name, taskthread_e where, std::function<void()> fn,
+               std::initializer_list<int> deps = {});
+
+   bool run(const std::function<bool()> &failed);
+
+   std::vector<timing_t> getTimings() const;
+
+private:
+   struct task_t
+   {
+      const char           *name;
+      taskthread_e          where;
+      std::function<void()> fn;
+      std::vector<int>      dependents;
+      int                   waiting;  // dependencies not yet finished
+      bool                  ran;
+      timing_t              timing;
+   };
+
+   std::vector<task_t> tasks;
+};
+
+#endif
+
+// EOF
+
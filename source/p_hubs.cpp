@@ -85,6 +85,9 @@ char *temp_hubfile(void)
 void P_ClearHubs(void)
 {
    int i;
+
+   // don't let a hub level still being written outlive its removal
+   P_WaitSaveGame();
    
    for(i=0; i<num_hub_levels; i++)
    {
@@ -26,6 +26,8 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
+
 #include "z_zone.h"
 
 #include "doomstat.h"
@@ -279,6 +281,47 @@ fixed_t P_InterceptVector(const divline_t *v2, const divline_t *v1)
                           FixedMul((v2->y-v1->y)>>8, v1->dx)), den) : 0;
 }
 
+//
+// P_SortIntercepts
+//
+// Writes into order the traversal order of the intercepts with frac no
+// greater than maxfrac, and returns how many that is. The order is the one
+// produced by repeatedly scanning for the first intercept with the smallest
+// frac: ascending frac, with ties going to whichever was added first. Each
+// key holds the biased frac in its high half and the intercept index in its
+// low half, so one unstable sort of plain integers reproduces it exactly.
+//
+size_t P_SortIntercepts(const intercept_t *intercepts, size_t count,
+                        fixed_t maxfrac, uint64_t *order)
+{
+   size_t numorder = 0;
+
+   for(size_t i = 0; i < count; i++)
+   {
+      if(intercepts[i].frac > maxfrac)
+         continue;
+      const uint32_t key = uint32_t(intercepts[i].frac) ^ 0x80000000u;
+      order[numorder++] = (uint64_t(key) << 32) | uint32_t(i);
+   }
+
+   // most traces only cross a handful of lines
+   if(numorder <= 16)
+   {
+      for(size_t i = 1; i < numorder; i++)
+      {
+         const uint64_t key = order[i];
+         size_t j = i;
+         for(; j > 0 && order[j - 1] > key; j--)
+            order[j] = order[j - 1];
+         order[j] = key;
+      }
+   }
+   else
+      std::sort(order, order + numorder);
+
+   return numorder;
+}
+
 //
 // P_LineOpening
 //
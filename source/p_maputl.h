@@ -114,6 +114,8 @@ extern int (*P_PointOnDivlineSide)(fixed_t x, fixed_t y, const divline_t *line);
 
 void    P_MakeDivline(const line_t *li, divline_t *dl);
 fixed_t P_InterceptVector(const divline_t *v2, const divline_t *v1);
+size_t  P_SortIntercepts(const intercept_t *intercepts, size_t count,
+                         fixed_t maxfrac, uint64_t *order);
 int     P_BoxOnLineSide(const fixed_t *tmbox, const line_t *ld);
 // ioanch 20160123: for linedef portal clipping.
 v2fixed_t P_BoxLinePoint(const fixed_t bbox[4], const line_t *ld);
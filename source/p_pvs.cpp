@@ -0,0 +1,648 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Sector-to-sector potentially visible set, used to reject sight
+//  checks that can't succeed without tracing them.
+//
+//  Built at level load by portal flow in 2D: the two-sided lines between
+//  sectors are the portals, and a sector can see another only if some
+//  straight line passes through a chain of portals from one to the other.
+//  Each step clips the next portal to the region visible through the first
+//  portal and the last one, which only ever overestimates what's visible, so
+//  the set is conservative: anything not in it really can't be seen. Heights
+//  are ignored since they change at runtime.
+//
+//  Sectors where the lines don't tell the whole story are "open" and see and
+//  are seen by everything: those touching linked portals, sectors that aren't
+//  closed, sectors whose subsectors disagree with their lines, and sectors of
+//  polyobject lines. Sectors whose flow runs over budget are open as well.
+//
+// Authors: agent
+//
+
+#include <algorithm>
+#include <math.h>
+
+#include "z_zone.h"
+
+#include "m_collection.h"
+#include "m_compare.h"
+#include "m_fixed.h"
+#include "p_pvs.h"
+#include "polyobj.h"
+#include "r_defs.h"
+#include "r_portal.h"
+#include "r_state.h"
+
+byte *sectorpvs;
+
+// no PVS for maps with more sectors than this, to bound its memory use
+#define PVS_MAXSECTORS 16384
+
+// portal flow limits, past which a sector just sees everything
+#define PVS_MAXSTEPS    16384    // per sector
+#define PVS_MAXDEPTH    256      // length of a portal chain
+#define PVS_TOTALSTEPS  (1 << 25) // for the whole map
+
+// slack for clipping, in map units; keeps grazing and corner lines visible
+#define PVS_EPSILON (1.0 / 16.0)
+
+//
+// A portal is a line between two sectors, or a vertex where two sectors
+// touch without sharing a line there.
+//
+struct pvsportal_t
+{
+   double x1, y1, x2, y2;
+   int    sectors[2];
+   bool   ispoint;
+};
+
+//
+// A portal as seen from one of its sectors
+//
+struct pvsedge_t
+{
+   int portal;
+   int other; // sector on the far side
+
+   // half-plane of the far sector: nx * x + ny * y + d >= 0 (not for points)
+   double nx, ny, d;
+};
+
+struct pvsseg_t
+{
+   double x1, y1, x2, y2;
+};
+
+//
+// Clip a segment to the half-plane nx * x + ny * y + d >= 0, where (nx, ny)
+// is a unit vector. Returns false if nothing is left.
+//
+static bool P_pvsClip(pvsseg_t &seg, double nx, double ny, double d)
+{
+   const double d1 = nx * seg.x1 + ny * seg.y1 + d;
+   const double d2 = nx * seg.x2 + ny * seg.y2 + d;
+
+   if(d1 >= -PVS_EPSILON && d2 >= -PVS_EPSILON)
+      return true;
+   if(d1 < -PVS_EPSILON && d2 < -PVS_EPSILON)
+      return false;
+
+   const double t  = (d1 + PVS_EPSILON) / (d1 - d2);
+   const double ix = seg.x1 + (seg.x2 - seg.x1) * t;
+   const double iy = seg.y1 + (seg.y2 - seg.y1) * t;
+
+   if(d1 < -PVS_EPSILON)
+      seg.x1 = ix, seg.y1 = iy;
+   else
+      seg.x2 = ix, seg.y2 = iy;
+   return true;
+}
+
+//
+// Clip a segment to one side of the line through (x1, y1) and (x2, y2): the
+// side that (sx, sy) is on, or the other side if away is set. Returns false
+// if nothing is left.
+//
+static bool P_pvsClipLine(pvsseg_t &seg, double x1, double y1, double x2, double y2,
+                          double sx, double sy, bool away)
+{
+   double nx = -(y2 - y1);
+   double ny =   x2 - x1;
+   const double len = sqrt(nx * nx + ny * ny);
+
+   if(len < PVS_EPSILON)
+      return true;
+   nx /= len;
+   ny /= len;
+
+   double d = -(nx * x1 + ny * y1);
+   const double side = nx * sx + ny * sy + d;
+
+   if(side > -PVS_EPSILON && side < PVS_EPSILON)
+      return true;
+   if((side < 0) != away)
+      nx = -nx, ny = -ny, d = -d;
+
+   return P_pvsClip(seg, nx, ny, d);
+}
+
+static bool P_pvsIsPoint(const pvsseg_t &seg)
+{
+   return fabs(seg.x2 - seg.x1) < PVS_EPSILON && fabs(seg.y2 - seg.y1) < PVS_EPSILON;
+}
+
+//
+// Clip a segment to what can be seen from source through pass: lines through
+// a point on each of them can only reach the region between the two lines
+// that cross from an end of one to the opposite end of the other. Where one
+// of them is a point, the region is the cone from or through that point.
+//
+static bool P_pvsClipSeparators(pvsseg_t &seg, const pvsseg_t &source, const pvsseg_t &pass)
+{
+   const double sx[2] = { source.x1, source.x2 }, sy[2] = { source.y1, source.y2 };
+   const double px[2] = { pass.x1,   pass.x2   }, py[2] = { pass.y1,   pass.y2   };
+   const bool   spoint = P_pvsIsPoint(source);
+   const bool   ppoint = P_pvsIsPoint(pass);
+
+   if(spoint && ppoint)
+   {
+      // just the line through both, either way along it
+      const double dx = px[0] - sx[0], dy = py[0] - sy[0];
+      return P_pvsClipLine(seg, sx[0], sy[0], px[0], py[0], sx[0] - dy, sy[0] + dx, false) &&
+             P_pvsClipLine(seg, sx[0], sy[0], px[0], py[0], sx[0] + dy, sy[0] - dx, false);
+   }
+
+   if(ppoint)
+   {
+      // beyond the pass, the cone from the source's ends is mirrored
+      return P_pvsClipLine(seg, sx[0], sy[0], px[0], py[0], sx[1], sy[1], true) &&
+             P_pvsClipLine(seg, sx[1], sy[1], px[0], py[0], sx[0], sy[0], true);
+   }
+
+   if(spoint)
+   {
+      return P_pvsClipLine(seg, sx[0], sy[0], px[0], py[0], px[1], py[1], false) &&
+             P_pvsClipLine(seg, sx[0], sy[0], px[1], py[1], px[0], py[0], false);
+   }
+
+   for(int i = 0; i < 2; i++)
+   {
+      for(int j = 0; j < 2; j++)
+      {
+         double nx = -(py[j] - sy[i]);
+         double ny =   px[j] - sx[i];
+         const double len = sqrt(nx * nx + ny * ny);
+
+         if(len < PVS_EPSILON)
+            continue;
+         nx /= len;
+         ny /= len;
+
+         const double d   = -(nx * sx[i] + ny * sy[i]);
+         const double dso = nx * sx[i ^ 1] + ny * sy[i ^ 1] + d;
+         const double dpo = nx * px[j ^ 1] + ny * py[j ^ 1] + d;
+
+         // only a separator if it has the portals on opposite sides
+         if(dso > PVS_EPSILON && dpo < -PVS_EPSILON)
+         {
+            if(!P_pvsClip(seg, -nx, -ny, -d))
+               return false;
+         }
+         else if(dso < -PVS_EPSILON && dpo > PVS_EPSILON)
+         {
+            if(!P_pvsClip(seg, nx, ny, d))
+               return false;
+         }
+      }
+   }
+
+   return true;
+}
+
+//
+// Portal flow state for the map
+//
+class PVSBuilder
+{
+public:
+   PODCollection<pvsportal_t> portals;
+   PODCollection<pvsedge_t>   edges;     // grouped by sector
+   int  *firstedge;                      // numsectors + 1 entries
+   bool *open;                           // see and are seen by everything
+   byte *matrix;
+
+   PVSBuilder() : firstedge(nullptr), open(nullptr), matrix(nullptr) {}
+   ~PVSBuilder()
+   {
+      efree(firstedge);
+      efree(open);
+      efree(onstack);
+      efree(row);
+   }
+
+   void findPortals();
+   void findOpenSectors();
+   void flowSector(int source);
+   void finish();
+
+private:
+   bool *onstack  = nullptr;
+   byte *row      = nullptr; // scratch row for the source sector
+   int   steps    = 0;
+   int   total    = 0;
+   bool  overflow = false;
+
+   // portals crossed so far; the first is in the source sector
+   pvsseg_t         chain[PVS_MAXDEPTH + 1];
+   const pvsedge_t *chainedges[PVS_MAXDEPTH + 1];
+
+   void mark(int sector) { row[sector >> 3] |= 1 << (sector & 7); }
+   void flow(int sector, int depth);
+
+   friend void P_BuildSectorPVS();
+};
+
+//
+// Collect the portals, then give each sector its list of edges.
+//
+void PVSBuilder::findPortals()
+{
+   // lines between two sectors
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t *line = &lines[i];
+
+      if(!line->backsector || line->frontsector == line->backsector)
+         continue;
+
+      portals.add({ M_FixedToDouble(line->v1->x), M_FixedToDouble(line->v1->y),
+                    M_FixedToDouble(line->v2->x), M_FixedToDouble(line->v2->y),
+                    { eindex(line->frontsector - sectors), eindex(line->backsector - sectors) },
+                    false });
+   }
+
+   // Vertices where two sectors touch without a line between them there. Sight
+   // traces in fixed point can slip through these.
+   struct vertexsector_t
+   {
+      int vertex, sector;
+      bool operator < (const vertexsector_t &other) const
+      {
+         return vertex != other.vertex ? vertex < other.vertex : sector < other.sector;
+      }
+      bool operator == (const vertexsector_t &other) const
+      {
+         return vertex == other.vertex && sector == other.sector;
+      }
+   };
+   struct vertexpair_t
+   {
+      int vertex, a, b;
+      bool operator < (const vertexpair_t &other) const
+      {
+         if(vertex != other.vertex)
+            return vertex < other.vertex;
+         return a != other.a ? a < other.a : b < other.b;
+      }
+   };
+
+   PODCollection<vertexsector_t> touching;
+   PODCollection<vertexpair_t>   linked;
+
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t *line = &lines[i];
+      const int v[2] = { eindex(line->v1 - vertexes), eindex(line->v2 - vertexes) };
+      const int front = eindex(line->frontsector - sectors);
+      const int back  = line->backsector ? eindex(line->backsector - sectors) : -1;
+
+      for(int vertex : v)
+      {
+         touching.add({ vertex, front });
+         if(back >= 0 && back != front)
+         {
+            touching.add({ vertex, back });
+            linked.add({ vertex, emin(front, back), emax(front, back) });
+         }
+      }
+   }
+
+   std::sort(touching.begin(), touching.end());
+   std::sort(linked.begin(), linked.end());
+
+   const vertexsector_t *tend = std::unique(touching.begin(), touching.end());
+   for(const vertexsector_t *group = touching.begin(); group != tend; )
+   {
+      const vertexsector_t *next = group;
+      while(next != tend && next->vertex == group->vertex)
+         ++next;
+
+      const vertex_t &vx = vertexes[group->vertex];
+      for(const vertexsector_t *a = group; a != next; ++a)
+      {
+         for(const vertexsector_t *b = a + 1; b != next; ++b)
+         {
+            const vertexpair_t key = { group->vertex, a->sector, b->sector };
+            if(std::binary_search(linked.begin(), linked.end(), key))
+               continue;
+
+            const double x = M_FixedToDouble(vx.x), y = M_FixedToDouble(vx.y);
+            portals.add({ x, y, x, y, { a->sector, b->sector }, true });
+         }
+      }
+      group = next;
+   }
+
+   // edges, grouped by sector
+   firstedge = ecalloc(int *, numsectors + 1, sizeof(int));
+   for(const pvsportal_t &portal : portals)
+   {
+      ++firstedge[portal.sectors[0] + 1];
+      ++firstedge[portal.sectors[1] + 1];
+   }
+   for(int i = 0; i < numsectors; i++)
+      firstedge[i + 1] += firstedge[i];
+
+   int *fill = ecalloc(int *, numsectors, sizeof(int));
+   for(int i = 0; i < numsectors; i++)
+      fill[i] = firstedge[i];
+
+   for(size_t i = 0; i < 2 * portals.getLength(); i++)
+      edges.add(pvsedge_t());
+
+   for(size_t i = 0; i < portals.getLength(); i++)
+   {
+      const pvsportal_t &portal = portals[i];
+
+      // the line's front is on its right
+      double nx = portal.y2 - portal.y1, ny = -(portal.x2 - portal.x1);
+      const double len = sqrt(nx * nx + ny * ny);
+      if(len > 0)
+         nx /= len, ny /= len;
+      const double d = -(nx * portal.x1 + ny * portal.y1);
+
+      // from the front sector, the far side is the back
+      edges[fill[portal.sectors[0]]++] = { int(i), portal.sectors[1], -nx, -ny, -d };
+      edges[fill[portal.sectors[1]]++] = { int(i), portal.sectors[0],  nx,  ny,  d };
+   }
+
+   efree(fill);
+}
+
+//
+// Mark the sectors that the lines alone can't account for.
+//
+void PVSBuilder::findOpenSectors()
+{
+   open = ecalloc(bool *, numsectors, sizeof(bool));
+
+   // linked portals take sight somewhere else entirely
+   for(int i = 0; i < numsectors; i++)
+   {
+      const sector_t &sector = sectors[i];
+      const portal_t *floor   = sector.srf.floor.portal;
+      const portal_t *ceiling = sector.srf.ceiling.portal;
+
+      if((floor && floor->type == R_LINKED) || (ceiling && ceiling->type == R_LINKED))
+         open[i] = true;
+   }
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t &line = lines[i];
+      if(line.portal && line.portal->type == R_LINKED)
+      {
+         open[line.frontsector - sectors] = true;
+         if(line.backsector)
+            open[line.backsector - sectors] = true;
+      }
+   }
+
+   // polyobject lines move away from where they were drawn
+   for(int i = 0; i < numPolyObjects; i++)
+   {
+      const polyobj_t &po = PolyObjects[i];
+      for(int j = 0; j < po.numLines; j++)
+      {
+         open[po.lines[j]->frontsector - sectors] = true;
+         if(po.lines[j]->backsector)
+            open[po.lines[j]->backsector - sectors] = true;
+      }
+   }
+
+   // subsectors whose segs face a different sector (self-referencing sector
+   // tricks and the like)
+   for(int i = 0; i < numsubsectors; i++)
+   {
+      const subsector_t &ss = subsectors[i];
+      for(int j = 0; j < ss.numlines; j++)
+      {
+         const seg_t &seg = segs[ss.firstline + j];
+         if(seg.linedef && seg.frontsector != ss.sector)
+         {
+            open[ss.sector - sectors] = true;
+            open[seg.frontsector - sectors] = true;
+         }
+      }
+   }
+
+   // sectors that aren't closed, where some vertex has an odd number of the
+   // sector's boundary lines
+   struct sectorvertex_t
+   {
+      int sector, vertex;
+      bool operator < (const sectorvertex_t &other) const
+      {
+         return sector != other.sector ? sector < other.sector : vertex < other.vertex;
+      }
+      bool operator != (const sectorvertex_t &other) const
+      {
+         return sector != other.sector || vertex != other.vertex;
+      }
+   };
+
+   PODCollection<sectorvertex_t> ends;
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t &line = lines[i];
+      if(line.frontsector == line.backsector)
+         continue;
+
+      const int v1 = eindex(line.v1 - vertexes), v2 = eindex(line.v2 - vertexes);
+      for(const sector_t *sector : { line.frontsector, line.backsector })
+      {
+         if(!sector)
+            continue;
+         ends.add({ eindex(sector - sectors), v1 });
+         ends.add({ eindex(sector - sectors), v2 });
+      }
+   }
+
+   std::sort(ends.begin(), ends.end());
+   for(size_t i = 0; i < ends.getLength(); )
+   {
+      size_t j = i + 1;
+      while(j < ends.getLength() && !(ends[j] != ends[i]))
+         ++j;
+      if((j - i) & 1)
+         open[ends[i].sector] = true;
+      i = j;
+   }
+}
+
+//
+// Visit a sector entered through the last portal of the chain, then follow
+// every portal out of it that a line through the whole chain could reach.
+//
+void PVSBuilder::flow(int sector, int depth)
+{
+   if(++steps > PVS_MAXSTEPS || ++total > PVS_TOTALSTEPS || depth > PVS_MAXDEPTH ||
+      open[sector])
+   {
+      overflow = true;
+      return;
+   }
+
+   mark(sector);
+   onstack[sector] = true;
+
+   for(int e = firstedge[sector]; e < firstedge[sector + 1] && !overflow; e++)
+   {
+      const pvsedge_t   &edge   = edges[e];
+      const pvsportal_t &portal = portals[edge.portal];
+
+      if(edge.portal == chainedges[depth - 1]->portal || onstack[edge.other])
+         continue;
+
+      pvsseg_t next = { portal.x1, portal.y1, portal.x2, portal.y2 };
+      bool     seen = true;
+
+      // a straight line stays on the far side of every portal it crosses
+      for(int i = 0; i < depth && seen; i++)
+      {
+         const pvsedge_t &crossed = *chainedges[i];
+         if(!portals[crossed.portal].ispoint)
+            seen = P_pvsClip(next, crossed.nx, crossed.ny, crossed.d);
+      }
+
+      // and passes through the source and each portal after it
+      for(int i = 1; i < depth && seen; i++)
+         seen = P_pvsClipSeparators(next, chain[0], chain[i]);
+
+      if(!seen)
+         continue;
+
+      chain[depth]      = next;
+      chainedges[depth] = &edge;
+      flow(edge.other, depth + 1);
+   }
+
+   onstack[sector] = false;
+}
+
+//
+// Work out everything one sector can see
+//
+void PVSBuilder::flowSector(int sector)
+{
+   const size_t base = size_t(sector) * numsectors;
+
+   steps    = 0;
+   overflow = open[sector];
+
+   // rows don't start on byte boundaries, so gather into a scratch row
+   if(!overflow)
+   {
+      memset(row, 0, (numsectors + 7) / 8);
+      mark(sector);
+      onstack[sector] = true;
+
+      for(int e = firstedge[sector]; e < firstedge[sector + 1] && !overflow; e++)
+      {
+         const pvsedge_t   &edge   = edges[e];
+         const pvsportal_t &portal = portals[edge.portal];
+
+         chain[0]      = { portal.x1, portal.y1, portal.x2, portal.y2 };
+         chainedges[0] = &edge;
+
+         // any line through one portal can go on through any other
+         if(open[edge.other])
+            overflow = true;
+         else
+            flow(edge.other, 1);
+      }
+
+      onstack[sector] = false;
+   }
+
+   for(int i = 0; i < numsectors; i++)
+   {
+      if(overflow || (row[i >> 3] & (1 << (i & 7))))
+         matrix[(base + i) >> 3] |= 1 << ((base + i) & 7);
+   }
+}
+
+//
+// Sight is symmetric, so whatever either side of a pair sees of the other
+// both do. The set may only ever overestimate what is visible, so the pair
+// gets the union of the two rows: open and overflowed sectors see everything,
+// and everything has to see them back.
+//
+void PVSBuilder::finish()
+{
+   auto test = [this](size_t bit) { return (matrix[bit >> 3] & (1 << (bit & 7))) != 0; };
+   auto set  = [this](size_t bit) { matrix[bit >> 3] |= 1 << (bit & 7); };
+
+   for(int a = 0; a < numsectors; a++)
+   {
+      for(int b = a + 1; b < numsectors; b++)
+      {
+         const size_t ab = size_t(a) * numsectors + b;
+         const size_t ba = size_t(b) * numsectors + a;
+         if(test(ab) != test(ba))
+         {
+            set(ab);
+            set(ba);
+         }
+      }
+   }
+}
+
+//
+// P_BuildSectorPVS
+//
+// Called once the level's portals are all spawned.
+//
+void P_BuildSectorPVS()
+{
+   sectorpvs = nullptr;
+
+   if(!numsectors || numsectors > PVS_MAXSECTORS)
+      return;
+
+   PVSBuilder builder;
+
+   builder.matrix  = ecalloctag(byte *, (size_t(numsectors) * numsectors + 7) / 8, 1,
+                                PU_LEVEL, nullptr);
+   builder.onstack = ecalloc(bool *, numsectors, sizeof(bool));
+   builder.row     = ecalloc(byte *, (numsectors + 7) / 8, 1);
+
+   builder.findPortals();
+   builder.findOpenSectors();
+
+   for(int i = 0; i < numsectors; i++)
+      builder.flowSector(i);
+
+   builder.finish();
+   sectorpvs = builder.matrix;
+}
+
+//
+// P_ClearSectorPVS
+//
+// The matrix is PU_LEVEL; drop it before the level is freed.
+//
+void P_ClearSectorPVS()
+{
+   sectorpvs = nullptr;
+}
+
+// EOF
+
@@ -0,0 +1,54 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Sector-to-sector potentially visible set, used to reject sight
+//  checks that can't succeed without tracing them.
+//
+// Authors: agent
+//
+
+#ifndef P_PVS_H__
+#define P_PVS_H__
+
+#include "r_state.h"
+
+// numsectors * numsectors bit matrix, or nullptr if there's none for this map
+extern byte *sectorpvs;
+
+void P_BuildSectorPVS();
+void P_ClearSectorPVS();
+
+//
+// Returns false only if nothing in sector s1 can possibly see anything in
+// sector s2, in the same linked portal group. Heights are not taken into
+// account, so true means the sight check has to be traced.
+//
+inline bool P_CheckSectorPVS(int s1, int s2)
+{
+   if(!sectorpvs)
+      return true;
+
+   const size_t bit = size_t(s1) * numsectors + s2;
+   return (sectorpvs[bit >> 3] & (1 << (bit & 7))) != 0;
+}
+
+#endif
+
+// EOF
+
@@ -23,6 +23,10 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <atomic>
+#include <string>
+#include <thread>
+
 #include "z_zone.h"
 #include "i_system.h"
 
@@ -51,6 +55,7 @@
 #include "p_spec.h"
 #include "p_tick.h"
 #include "p_saveg.h"
+#include "p_sector.h"
 #include "p_enemy.h"
 #include "p_xenemy.h"
 #include "p_portal.h"
@@ -69,6 +74,8 @@
 #include "w_levels.h"
 #include "w_wad.h"
 
+#include "../zlib/zlib.h"
+
 // Pads save_p to a 4-byte boundary
 //  so that the load/save works on SGI&Gecko.
 // #define PADSAVEP()    do { save_p += (4 - ((int) save_p & 3)) & 3; } while (0)
@@ -754,6 +761,7 @@ static void P_ArchiveWorld(SaveArchive &arc)
          // SoM: update the heights
          P_SetFloorHeight(sec, sec->srf.floor.height);
          P_SetCeilingHeight(sec, sec->srf.ceiling.height);
+         P_AddMovedSector(sec);
       }
    }
 
@@ -1328,149 +1336,303 @@ static void P_ArchiveACS(SaveArchive &arc)
 
 #define SAVESTRINGSIZE 24
 
-void P_SaveCurrentLevel(char *filename, char *description)
+//
+// Savegames are compressed. The description stays uncompressed at the start of
+// the file, where the menus read it, and is followed by this marker and then a
+// zlib stream of the rest. Saves without the marker are read as they are.
+//
+static const char saveZlibMarker[4] = { 'Z', 'S', 'A', 'V' };
+
+// size of the chunks the compressed save is written in
+#define SAVE_DEFLATE_CHUNK 65536
+
+//
+// The save being written in the background, if any. Its thread sets
+// saveWriteError and then saveWriteDone, and touches nothing else shared.
+//
+static std::thread       saveWriter;
+static std::atomic<bool> saveWriteDone;
+static int               saveWriteError; // errno value, or -1 if unknown
+static bool              saveWriteQuiet; // no message on success
+
+//
+// Writes the description and compressed body of a serialized save to f.
+//
+static bool P_deflateSave(FILE *f, const byte *data, size_t size)
 {
-   int i;
-   char name2[VERSIONSIZE];
-   const char *fn;
-   OutBuffer savefile;
-   SaveArchive arc(&savefile);
+   if(fwrite(data, 1, SAVESTRINGSIZE, f) < SAVESTRINGSIZE ||
+      fwrite(saveZlibMarker, 1, sizeof(saveZlibMarker), f) < sizeof(saveZlibMarker))
+      return false;
 
-   if(!savefile.createFile(filename, 512*1024, OutBuffer::NENDIAN))
-   {
-      const char *str =
-         errno ? strerror(errno) : FC_ERROR "Could not save game: Error unknown";
-      doom_printf("%s", str);
-      return;
-   }
+   z_stream zs = {};
+   if(deflateInit(&zs, Z_DEFAULT_COMPRESSION) != Z_OK)
+      return false;
 
-   // Enable buffered IO exceptions
-   savefile.setThrowing(true);
+   zs.next_in  = const_cast<Bytef *>(data + SAVESTRINGSIZE);
+   zs.avail_in = static_cast<uInt>(size - SAVESTRINGSIZE);
 
-   try
+   byte out[SAVE_DEFLATE_CHUNK];
+   int  ret;
+   do
    {
-      arc.archiveCString(description, SAVESTRINGSIZE);
-      
-      // killough 2/22/98: "proprietary" version string :-)
-      memset(name2, 0, sizeof(name2));
-      sprintf(name2, VERSIONID);
-   
-      arc.archiveCString(name2, VERSIONSIZE);
+      zs.next_out  = out;
+      zs.avail_out = sizeof(out);
 
-      arc.writeSaveVersion();
-   
-      // killough 2/14/98: save old compatibility flag:
-      // haleyjd 06/16/10: save "inmasterlevels" state
-      int tempskill = (int)gameskill;
-      
-      arc << compatibility << tempskill << inmanageddir;
-      arc << vanilla_mode;
-   
-      // sf: use string rather than episode, map
-      for(i = 0; i < 8; i++)
+      ret = deflate(&zs, Z_FINISH);
+
+      const size_t amt = sizeof(out) - zs.avail_out;
+      if(ret == Z_STREAM_ERROR || fwrite(out, 1, amt, f) < amt)
       {
-         int8_t lvc = levelmapname[i];
-         arc << lvc;
+         deflateEnd(&zs);
+         return false;
       }
+   }
+   while(ret != Z_STREAM_END);
+
+   deflateEnd(&zs);
+   return true;
+}
+
+//
+// Body of the save writer thread. Compresses the save into a temporary file,
+// which is renamed over the real one only once it is complete, then frees
+// the data. Uses only the C library and the system heap.
+//
+static void P_saveWriterThread(std::string filename, byte *data, size_t size)
+{
+   const std::string temppath = filename + ".tmp";
+   int error = 0;
 
-      // haleyjd 06/16/10: support for saving/loading levels in managed wad
-      // directories.
+   errno = 0;
+   if(FILE *f = fopen(temppath.c_str(), "wb"))
+   {
+      bool ok = P_deflateSave(f, data, size);
+      ok = !fclose(f) && ok;
 
-      if((fn = W_GetManagedDirFN(g_dir))) // returns null if g_dir == &w_GlobalDir
+      if(ok)
       {
-         // save length of managed directory filename string and
-         // managed directory filename string
-         arc.writeLString(fn);
+         // rename won't replace an existing file everywhere
+         remove(filename.c_str());
+         errno = 0;
+         ok = !rename(temppath.c_str(), filename.c_str());
       }
-      else
+      if(!ok)
       {
-         // just save 0; there is no name to save
-         size_t len = 0;
-         arc.archiveSize(len);
+         error = errno ? errno : -1;
+         remove(temppath.c_str());
       }
+   }
+   else
+      error = errno ? errno : -1;
 
-      // killough 3/16/98, 12/98: store lump name checksum
-      uint64_t checksum    = G_Signature(g_dir);
-      int      numwadfiles = D_GetNumWadFiles();
+   Z_SysFree(data);
 
-      arc << checksum;
-      arc << numwadfiles;
-      // killough 3/16/98: store pwad filenames in savegame
-      for(wfileadd_t *file = wadfiles; file->filename; ++file)
-      {
-         const char *fn = file->filename;
-         arc.writeLString(fn, 0);
-      }
+   saveWriteError = error;
+   saveWriteDone  = true;
+}
 
-      for(i = 0; i < MAXPLAYERS; i++)
-         arc << playeringame[i];
+//
+// Joins the save writer and reports how the write went.
+//
+static void P_finishSaveWrite()
+{
+   saveWriter.join();
 
-      for(; i < MIN_MAXPLAYERS; i++)         // killough 2/28/98
-      {
-         bool dummy = 0;
-         arc << dummy;
-      }
+   if(saveWriteError)
+   {
+      const char *str = saveWriteError > 0 ? strerror(saveWriteError) :
+                        FC_ERROR "Could not save game: Error unknown";
+      doom_printf("%s", str);
+   }
+   else if(!saveWriteQuiet) // sf: no 'game saved' message for hubs
+      doom_printf("%s", DEH_String("GGSAVED"));  // Ty 03/27/98 - externalized
+}
 
-      // jff 3/17/98 save idmus state
-      int tempGameType = (int)GameType;
-      arc << idmusnum << tempGameType;
+//
+// Reports on the last save once its write has finished. Called every tic.
+//
+void P_PollSaveGame()
+{
+   if(saveWriter.joinable() && saveWriteDone)
+      P_finishSaveWrite();
+}
 
-      byte options[GAME_OPTION_SIZE];
-      G_WriteOptions(options);    // killough 3/1/98: save game options
-      savefile.write(options, sizeof(options));
-   
-      //killough 11/98: save entire word
-      arc << leveltime;
-   
-      // killough 11/98: save revenant tracer state
-      uint8_t tracerState = (uint8_t)((gametic-basetic) & 255);
-      arc << tracerState;
+//
+// Waits for the last save to be written, if it is still going. Must be done
+// before a savegame is read or another is written.
+//
+void P_WaitSaveGame()
+{
+   if(saveWriter.joinable())
+      P_finishSaveWrite();
+}
 
-      arc << dmflags;
+//
+// Lets a save still being written finish when the program exits. Nothing is
+// reported, as the console may already be gone.
+//
+static void P_saveWriterAtExit()
+{
+   if(saveWriter.joinable())
+      saveWriter.join();
+}
+
+//
+// Hands a serialized save to a new writer thread.
+//
+static void P_startSaveWrite(const char *filename, byte *data, size_t size)
+{
+   static bool atexit_set = false;
+
+   if(!atexit_set)
+   {
+      atexit(P_saveWriterAtExit);
+      atexit_set = true;
+   }
+
+   saveWriteDone  = false;
+   saveWriteError = 0;
+   saveWriteQuiet = hub_changelevel;
+   saveWriter     = std::thread(P_saveWriterThread, std::string(filename), data, size);
+}
+
+//
+// Serializes the whole game state, in the uncompressed savegame format, into
+// memory on the system heap. The caller frees it with Z_SysFree. The
+// description may be null.
+//
+byte *P_SaveGameState(char *description, size_t &size)
+{
+   int i;
+   char name2[VERSIONSIZE];
+   char nodescription[SAVESTRINGSIZE] = {};
+   const char *fn;
+   OutBuffer savefile;
+   SaveArchive arc(&savefile);
+
+   savefile.createMemory(512*1024, OutBuffer::NENDIAN);
+
+   arc.archiveCString(description ? description : nodescription, SAVESTRINGSIZE);
    
-      // killough 3/22/98: add Z_CheckHeap after each call to ensure consistency
-      // haleyjd 07/06/09: just Z_CheckHeap after the end. This stuff works by now.
+   // killough 2/22/98: "proprietary" version string :-)
+   memset(name2, 0, sizeof(name2));
+   sprintf(name2, VERSIONID);
+
+   arc.archiveCString(name2, VERSIONSIZE);
+
+   arc.writeSaveVersion();
+
+   // killough 2/14/98: save old compatibility flag:
+   // haleyjd 06/16/10: save "inmasterlevels" state
+   int tempskill = (int)gameskill;
    
-      P_NumberThinkers();    // turn ptrs to numbers
+   arc << compatibility << tempskill << inmanageddir;
+   arc << vanilla_mode;
 
-      P_ArchivePlayers(arc);
-      P_ArchiveWorld(arc);
-      P_ArchiveLevelInfo(arc);
-      P_ArchivePolyObjects(arc); // haleyjd 03/27/06
-      P_ArchiveThinkers(arc);
-      P_ArchiveRNG(arc);    // killough 1/18/98: save RNG information
-      P_ArchiveMap(arc);    // killough 1/22/98: save automap information
-      P_ArchiveSoundSequences(arc);
-      P_ArchiveButtons(arc);
-      P_ArchiveACS(arc);            // davidph 05/30/12
+   // sf: use string rather than episode, map
+   for(i = 0; i < 8; i++)
+   {
+      int8_t lvc = levelmapname[i];
+      arc << lvc;
+   }
 
-      P_DeNumberThinkers();
+   // haleyjd 06/16/10: support for saving/loading levels in managed wad
+   // directories.
 
-      uint8_t cmarker = 0xE6; // consistency marker
-      arc << cmarker; 
+   if((fn = W_GetManagedDirFN(g_dir))) // returns null if g_dir == &w_GlobalDir
+   {
+      // save length of managed directory filename string and
+      // managed directory filename string
+      arc.writeLString(fn);
    }
-   catch(BufferedIOException)
+   else
    {
-      // An IO error occurred while trying to save.
-      const char *str =
-         errno ? strerror(errno) : FC_ERROR "Could not save game: Error unknown";
-      doom_printf("%s", str);
+      // just save 0; there is no name to save
+      size_t len = 0;
+      arc.archiveSize(len);
+   }
 
-      // Close the file and remove it
-      savefile.setThrowing(false);
-      savefile.close();
-      remove(filename);
-      return;
+   // killough 3/16/98, 12/98: store lump name checksum
+   uint64_t checksum    = G_Signature(g_dir);
+   int      numwadfiles = D_GetNumWadFiles();
+
+   arc << checksum;
+   arc << numwadfiles;
+   // killough 3/16/98: store pwad filenames in savegame
+   for(wfileadd_t *file = wadfiles; file->filename; ++file)
+   {
+      const char *fn = file->filename;
+      arc.writeLString(fn, 0);
+   }
+
+   for(i = 0; i < MAXPLAYERS; i++)
+      arc << playeringame[i];
+
+   for(; i < MIN_MAXPLAYERS; i++)         // killough 2/28/98
+   {
+      bool dummy = 0;
+      arc << dummy;
    }
 
-   // Close the save file
-   savefile.close();
+   // jff 3/17/98 save idmus state
+   int tempGameType = (int)GameType;
+   arc << idmusnum << tempGameType;
+
+   byte options[GAME_OPTION_SIZE];
+   G_WriteOptions(options);    // killough 3/1/98: save game options
+   savefile.write(options, sizeof(options));
+
+   //killough 11/98: save entire word
+   arc << leveltime;
+
+   // killough 11/98: save revenant tracer state
+   uint8_t tracerState = (uint8_t)((gametic-basetic) & 255);
+   arc << tracerState;
+
+   arc << dmflags;
+
+   // killough 3/22/98: add Z_CheckHeap after each call to ensure consistency
+   // haleyjd 07/06/09: just Z_CheckHeap after the end. This stuff works by now.
+
+   P_NumberThinkers();    // turn ptrs to numbers
+
+   P_ArchivePlayers(arc);
+   P_ArchiveWorld(arc);
+   P_ArchiveLevelInfo(arc);
+   P_ArchivePolyObjects(arc); // haleyjd 03/27/06
+   P_ArchiveThinkers(arc);
+   P_ArchiveRNG(arc);    // killough 1/18/98: save RNG information
+   P_ArchiveMap(arc);    // killough 1/22/98: save automap information
+   P_ArchiveSoundSequences(arc);
+   P_ArchiveButtons(arc);
+   P_ArchiveACS(arc);            // davidph 05/30/12
+
+   P_DeNumberThinkers();
+
+   uint8_t cmarker = 0xE6; // consistency marker
+   arc << cmarker; 
+
+   byte *data = savefile.releaseMemory(size);
 
    // Check the heap.
    Z_CheckHeap();
 
-   if(!hub_changelevel) // sf: no 'game saved' message for hubs
-      doom_printf("%s", DEH_String("GGSAVED"));  // Ty 03/27/98 - externalized
+   return data;
+}
+
+//
+// Serializes the level into memory on the game thread, and leaves compressing
+// and writing it to a background thread. The result is reported by
+// P_PollSaveGame.
+//
+void P_SaveCurrentLevel(char *filename, char *description)
+{
+   P_WaitSaveGame();
+
+   size_t size;
+   byte  *data = P_SaveGameState(description, size);
+
+   P_startSaveWrite(filename, data, size);
 }
 
 //============================================================================
@@ -1478,19 +1640,16 @@ void P_SaveCurrentLevel(char *filename, char *description)
 // Loading -- Main Routine
 //
 
-void P_LoadGame(const char *filename)
+//
+// Reads a savegame from an open buffer and sets up the level from it. A
+// snapshot taken during demo playback keeps the demo's version, and always
+// loads the level afresh. Returns false if the save was not loaded.
+//
+static bool P_loadGameState(InBuffer &loadfile, bool snapshot)
 {
    int i;
-   InBuffer loadfile;
    SaveArchive arc(&loadfile);
 
-   if(!loadfile.openFile(filename, InBuffer::NENDIAN))
-   {
-      C_Printf(FC_ERROR "Failed to load savegame %s\n", filename);
-      C_SetConsole();
-      return;
-   }
-
    // Enable buffered IO exceptions
    loadfile.setThrowing(true);
 
@@ -1510,8 +1669,19 @@ void P_LoadGame(const char *filename)
 
       arc.archiveCString(throwaway, SAVESTRINGSIZE);
 
+      // the rest is compressed, unless this is an older save
+      char marker[sizeof(saveZlibMarker)];
+      if(loadfile.read(marker, sizeof(marker)) == sizeof(marker) &&
+         !memcmp(marker, saveZlibMarker, sizeof(marker)))
+      {
+         if(!loadfile.beginInflate())
+            I_Error("P_LoadGame: could not start decompressing savegame\n");
+      }
+      else
+         loadfile.seek(SAVESTRINGSIZE, SEEK_SET);
+
       if(!arc.readSaveVersion())
-         return;
+         return false;
 
       // killough 2/14/98: load compatibility mode
       // haleyjd 06/16/10: reload "inmasterlevels" state
@@ -1520,7 +1690,11 @@ void P_LoadGame(const char *filename)
       gameskill = (skill_t)tempskill;
 
       arc << vanilla_mode;  // -vanilla setting
-      if(vanilla_mode)      // use UDoom version (no point for longtics now).
+      if(snapshot)
+      {
+         // the demo being played back stays in its own version
+      }
+      else if(vanilla_mode) // use UDoom version (no point for longtics now).
       {
          // All the other settings (save longtics) are stored in the save
          demo_version    = 109;
@@ -1619,7 +1793,7 @@ void P_LoadGame(const char *filename)
             G_LoadGameErr(msg.constPtr());
             loadfile.close();
 
-            return;
+            return false;
          }
       }
 
@@ -1650,7 +1824,7 @@ void P_LoadGame(const char *filename)
  
       // load a base level
       // sf: in hubs, use g_doloadlevel instead of g_initnew
-      if(hub_changelevel)
+      if(hub_changelevel && !snapshot)
          G_DoLoadLevel();
       else
          G_InitNew(gameskill, gamemapname);
@@ -1713,6 +1887,26 @@ void P_LoadGame(const char *filename)
    // haleyjd 02/09/10: wake up status bar again
    ST_Start();
 
+   return true;
+}
+
+void P_LoadGame(const char *filename)
+{
+   InBuffer loadfile;
+
+   // it may be the save that is still being written
+   P_WaitSaveGame();
+
+   if(!loadfile.openFile(filename, InBuffer::NENDIAN))
+   {
+      C_Printf(FC_ERROR "Failed to load savegame %s\n", filename);
+      C_SetConsole();
+      return;
+   }
+
+   if(!P_loadGameState(loadfile, false))
+      return;
+
    // killough 12/98: support -recordfrom and -loadgame -playdemo
    if(!command_loadgame)
       singledemo = false;         // Clear singledemo flag if loading from menu
@@ -1731,6 +1925,21 @@ void P_LoadGame(const char *filename)
       P_RestorePlayerPosition();
 }
 
+//
+// Restores game state taken by P_SaveGameState during demo playback. None of
+// the demo handling of a savegame load is done; the caller must put back any
+// playback state that loading the level resets.
+//
+bool P_LoadGameState(const byte *data, size_t size)
+{
+   InBuffer loadbuf;
+
+   if(!loadbuf.openMemory(data, size, InBuffer::NENDIAN))
+      return false;
+
+   return P_loadGameState(loadbuf, true);
+}
+
 //----------------------------------------------------------------------------
 //
 // $Log: p_saveg.c,v $
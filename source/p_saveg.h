@@ -134,8 +134,12 @@ unsigned int P_NumForThinker(Thinker *th);
 Thinker *P_ThinkerForNum(unsigned int n);
 void P_SetNewTarget(Mobj **mop, Mobj *targ);
 
-void P_SaveCurrentLevel(char *filename, char *description);
-void P_LoadGame(const char *filename);
+byte *P_SaveGameState(char *description, size_t &size);
+void  P_SaveCurrentLevel(char *filename, char *description);
+void  P_PollSaveGame();
+void  P_WaitSaveGame();
+bool  P_LoadGameState(const byte *data, size_t size);
+void  P_LoadGame(const char *filename);
 
 #endif
 
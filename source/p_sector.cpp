@@ -31,6 +31,7 @@
 #include "e_exdata.h"
 #include "e_reverbs.h"
 #include "e_things.h"
+#include "m_collection.h"
 #include "m_fixed.h"
 #include "p_mobj.h"
 #include "p_saveg.h"
@@ -229,24 +230,67 @@ int EV_SectorSoundChange(int tag, int sndSeqID)
 // Sector Interpolation
 //
 
+//
+// Sectors whose floor or ceiling may have moved since their heights were last
+// backed up. Every other sector still matches its backup, so only these need
+// backing up again or interpolating.
+//
+static PODCollection<sector_t *> pMovedSectors;
+
+//
+// Adds a sector to the moved sectors list, unless it is on it already. Call
+// whenever its floor or ceiling height is changed.
+//
+void P_AddMovedSector(sector_t *sector)
+{
+   auto &si = sectorinterps[sector - sectors];
+
+   if(!si.moved)
+   {
+      si.moved = true;
+      pMovedSectors.add(sector);
+   }
+}
+
+//
+// Iterates the moved sectors list
+//
+void P_ForEachMovedSector(void (*func)(sector_t *sector))
+{
+   for(sector_t *sector : pMovedSectors)
+      func(sector);
+}
+
+//
+// Empties the moved sectors list. Called when a level's sectors are created.
+//
+void P_ClearMovedSectors()
+{
+   pMovedSectors.makeEmpty();
+}
+
 //
 // P_SaveSectorPositions
 //
 // Backup current sector floor and ceiling heights to the sector interpolation
-// structures at the beginning of a frame.
+// structures at the beginning of a frame. Only sectors moved since the last
+// backup can differ from it; their list starts over for the new tic.
 //
 void P_SaveSectorPositions()
 {
-   for(int i = 0; i < numsectors; i++)
+   for(sector_t *sector : pMovedSectors)
    {
-      auto &si  = sectorinterps[i];
-      auto &sec = sectors[i];
+      auto &si  = sectorinterps[sector - sectors];
+      auto &sec = *sector;
 
       si.prevfloorheight    = sec.srf.floor.height;
       si.prevfloorheightf   = sec.srf.floor.heightf;
       si.prevceilingheight  = sec.srf.ceiling.height;
       si.prevceilingheightf = sec.srf.ceiling.heightf;
+      si.moved              = false;
    }
+
+   pMovedSectors.makeEmpty();
 }
 
 //
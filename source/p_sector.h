@@ -35,6 +35,9 @@ enum ssurftype_e
    ssurf_ceiling,
 };
 
+void P_AddMovedSector(sector_t *sector);
+void P_ForEachMovedSector(void (*func)(sector_t *sector));
+void P_ClearMovedSectors();
 void P_SaveSectorPositions();
 void P_SaveSectorPosition(const sector_t &sec);
 void P_SaveSectorPosition(const sector_t &sec, ssurftype_e surf);
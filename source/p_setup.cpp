@@ -25,6 +25,7 @@
 //-----------------------------------------------------------------------------
 
 #include <memory>
+#include <vector>
 #include "z_zone.h"
 
 #include "a_small.h"
@@ -52,6 +53,7 @@
 #include "m_bbox.h"
 #include "m_binary.h"
 #include "m_hash.h"
+#include "m_taskgraph.h"
 #include "p_anim.h"  // haleyjd: lightning
 #include "p_chase.h"
 #include "p_enemy.h"
@@ -62,7 +64,9 @@
 #include "p_mobjcol.h"
 #include "p_partcl.h"
 #include "p_portal.h"
+#include "p_pvs.h"
 #include "p_scroll.h"
+#include "p_sector.h"
 #include "p_setup.h"
 #include "p_skin.h"
 #include "p_slopes.h"
@@ -208,6 +212,9 @@ static WadDirectory *setupwad;
 // Current level's hash digest, for showing on console
 static qstring p_currentLevelHashDigest;
 
+// Stage timings of the last level setup, for p_setuptimes
+static std::vector<TaskGraph::timing_t> p_setuptimings;
+
 //
 // ShortToLong
 //
@@ -382,31 +389,34 @@ static void P_CalcSegLength(seg_t *lseg)
 static void P_LoadSegs(int lump)
 {
    int  i;
-   byte *data;
+   const byte *data;
    
    numsegs = setupwad->lumpLength(lump) / sizeof(mapseg_t);
    segs = estructalloctag(seg_t, numsegs, PU_LEVEL);
-   data = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
+   data = static_cast<const byte *>(setupwad->mapLumpNum(lump));
    
    for(i = 0; i < numsegs; ++i)
    {
       seg_t *li = segs + i;
-      mapseg_t *ml = (mapseg_t *)data + i;
+      mapseg_t ml;
       
       int side, linedef;
       line_t *ldef;
 
+      // the lump may be mapped in place at any alignment
+      memcpy(&ml, data + i * sizeof(mapseg_t), sizeof(ml));
+
       // haleyjd 06/19/06: convert indices to unsigned
-      li->v1 = &vertexes[SafeUintIndex(ml->v1, numvertexes, "seg", i, "vertex")];
-      li->v2 = &vertexes[SafeUintIndex(ml->v2, numvertexes, "seg", i, "vertex")];
+      li->v1 = &vertexes[SafeUintIndex(ml.v1, numvertexes, "seg", i, "vertex")];
+      li->v2 = &vertexes[SafeUintIndex(ml.v2, numvertexes, "seg", i, "vertex")];
 
-      li->offset = (float)(SwapShort(ml->offset));
+      li->offset = (float)(SwapShort(ml.offset));
 
       // haleyjd 06/19/06: convert indices to unsigned
-      linedef = SafeUintIndex(ml->linedef, numlines, "seg", i, "line");
+      linedef = SafeUintIndex(ml.linedef, numlines, "seg", i, "line");
       ldef = &lines[linedef];
       li->linedef = ldef;
-      side = SwapShort(ml->side);
+      side = SwapShort(ml.side);
 
       if(side < 0 || side > 1)
       {
@@ -425,8 +435,6 @@ static void P_LoadSegs(int lump)
 
       P_CalcSegLength(li);
    }
-   
-   Z_Free(data);
 }
 
 //
@@ -507,24 +515,23 @@ static void P_LoadSegs_V4(int lump)
 //
 static void P_LoadSubsectors(int lump)
 {
-   mapsubsector_t *mss;
-   byte *data;
+   mapsubsector_t mss;
+   const byte *data;
    int  i;
    
    numsubsectors = setupwad->lumpLength(lump) / sizeof(mapsubsector_t);
    subsectors = estructalloctag(subsector_t, numsubsectors, PU_LEVEL);
-   data = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
+   data = static_cast<const byte *>(setupwad->mapLumpNum(lump));
    
    for(i = 0; i < numsubsectors; ++i)
    {
-      mss = &(((mapsubsector_t *)data)[i]);
+      // the lump may be mapped in place at any alignment
+      memcpy(&mss, data + i * sizeof(mapsubsector_t), sizeof(mss));
 
       // haleyjd 06/19/06: convert indices to unsigned
-      subsectors[i].numlines  = (int)SwapShort(mss->numsegs ) & 0xffff;
-      subsectors[i].firstline = (int)SwapShort(mss->firstseg) & 0xffff;
+      subsectors[i].numlines  = (int)SwapShort(mss.numsegs ) & 0xffff;
+      subsectors[i].firstline = (int)SwapShort(mss.firstseg) & 0xffff;
    }
-   
-   Z_Free(data);
 }
 
 //
@@ -722,6 +729,7 @@ static void P_LoadSectors(int lumpnum)
 static void P_CreateSectorInterps()
 {
    sectorinterps = estructalloctag(sectorinterp_t, numsectors, PU_LEVEL);
+   P_ClearMovedSectors();
 
    for(int i = 0; i < numsectors; i++)
    {
@@ -737,8 +745,6 @@ static void P_CreateSectorInterps()
 //
 static void P_createSectorBoundingBoxes()
 {
-   pSectorBoxes = estructalloctag(sectorbox_t, numsectors, PU_LEVEL);
-
    for(int i = 0; i < numsectors; ++i)
    {
       const sector_t &sector = sectors[i];
@@ -760,33 +766,40 @@ static void P_createSectorBoundingBoxes()
 //
 // P_propagateSoundZone
 //
-// haleyjd 01/12/14: Recursive routine to propagate a sound zone from a
-// sector to all its neighboring sectors which border it by a 2S line which
-// is not marked as a sound boundary.
+// haleyjd 01/12/14: Routine to propagate a sound zone from a sector to all
+// its neighboring sectors which border it by a 2S line which is not marked
+// as a sound boundary. Uses an explicit stack, since a recursion as deep as
+// the sector count can overflow a helper thread's stack on huge maps.
 //
-static void P_propagateSoundZone(sector_t *sector, int zoneid)
+static void P_propagateSoundZone(sector_t *sector, int zoneid,
+                                 std::vector<sector_t *> &stack)
 {
-   // if we already touched this sector somehow, return immediately
-   if(sector->soundzone == zoneid)
-      return;
-
-   // set the zone to the sector
    sector->soundzone = zoneid;
+   stack.push_back(sector);
 
-   // iterate on the sector linedef list to find neighboring sectors
-   for(int ln = 0; ln < sector->linecount; ln++)
+   while(!stack.empty())
    {
-      auto line = sector->lines[ln];
+      sector = stack.back();
+      stack.pop_back();
 
-      // must be 2S and not a zone boundary line
-      if(!line->backsector || (line->extflags & EX_ML_ZONEBOUNDARY))
-         continue;
+      // iterate on the sector linedef list to find neighboring sectors
+      for(int ln = 0; ln < sector->linecount; ln++)
+      {
+         auto line = sector->lines[ln];
 
-      auto next = ((line->backsector != sector) ? line->backsector : line->frontsector);
+         // must be 2S and not a zone boundary line
+         if(!line->backsector || (line->extflags & EX_ML_ZONEBOUNDARY))
+            continue;
 
-      // if not already in the same sound zone, propagate recursively.
-      if(next->soundzone != zoneid)
-         P_propagateSoundZone(next, zoneid);
+         auto next = ((line->backsector != sector) ? line->backsector : line->frontsector);
+
+         // if not already in the same sound zone, propagate to it.
+         if(next->soundzone != zoneid)
+         {
+            next->soundzone = zoneid;
+            stack.push_back(next);
+         }
+      }
    }
 }
 
@@ -794,10 +807,13 @@ static void P_propagateSoundZone(sector_t *sector, int zoneid)
 // P_CreateSoundZones
 //
 // haleyjd 01/12/14: create sound environment zones for the map by using an
-// alert-like propagation method.
+// alert-like propagation method. Only touches the sectors, so it may run on
+// a helper thread; P_setSoundZoneReverbs allocates the zones afterwards.
 //
 static void P_CreateSoundZones()
 {
+   std::vector<sector_t *> stack;
+
    numsoundzones = 0;
 
    for(int secnum = 0; secnum < numsectors; secnum++)
@@ -806,9 +822,17 @@ static void P_CreateSoundZones()
       
       // if the sector hasn't become part of a zone yet, do propagation for it
       if(sec->soundzone == -1)
-         P_propagateSoundZone(sec, numsoundzones++);
+         P_propagateSoundZone(sec, numsoundzones++, stack);
    }
+}
 
+//
+// P_setSoundZoneReverbs
+//
+// Allocates the zones found by P_CreateSoundZones.
+//
+static void P_setSoundZoneReverbs()
+{
    // allocate soundzones
    soundzones = estructalloctag(soundzone_t, numsoundzones, PU_LEVEL);
    
@@ -871,7 +895,7 @@ static void P_CalcNodeCoefficients2(const node_t &node, fnode_t &fnode)
 //
 static void P_LoadNodes(int lump)
 {
-   byte *data;
+   const byte *data;
    int  i;
    
    numnodes = setupwad->lumpLength(lump) / sizeof(mapnode_t);
@@ -893,18 +917,21 @@ static void P_LoadNodes(int lump)
 
    nodes  = estructalloctag(node_t,  numnodes, PU_LEVEL);
    fnodes = estructalloctag(fnode_t, numnodes, PU_LEVEL);
-   data   = (byte *)(setupwad->cacheLumpNum(lump, PU_STATIC));
+   data   = static_cast<const byte *>(setupwad->mapLumpNum(lump));
 
    for(i = 0; i < numnodes; i++)
    {
       node_t *no = nodes + i;
-      mapnode_t *mn = (mapnode_t *)data + i;
+      mapnode_t mn;
       int j;
 
-      no->x  = SwapShort(mn->x);
-      no->y  = SwapShort(mn->y);
-      no->dx = SwapShort(mn->dx);
-      no->dy = SwapShort(mn->dy);
+      // the lump may be mapped in place at any alignment
+      memcpy(&mn, data + i * sizeof(mapnode_t), sizeof(mn));
+
+      no->x  = SwapShort(mn.x);
+      no->y  = SwapShort(mn.y);
+      no->dx = SwapShort(mn.dx);
+      no->dy = SwapShort(mn.dy);
 
       // haleyjd: calculate floating-point data
       P_CalcNodeCoefficients(no, &fnodes[i]);
@@ -917,14 +944,12 @@ static void P_LoadNodes(int lump)
       for(j = 0; j < 2; ++j)
       {
          int k;
-         ShortToNodeChild(&(no->children[j]), SwapUShort(mn->children[j]));
+         ShortToNodeChild(&(no->children[j]), SwapUShort(mn.children[j]));
 
          for(k = 0; k < 4; ++k)
-            no->bbox[j][k] = SwapShort(mn->bbox[j][k]) << FRACBITS;
+            no->bbox[j][k] = SwapShort(mn.bbox[j][k]) << FRACBITS;
       }
    }
-   
-   Z_Free(data);
 }
 
 //
@@ -1001,7 +1026,7 @@ static bool P_CheckForDeePBSPv4Nodes(int lumpnum)
    // Check size to avoid crashes
    if(setupwad->lumpLength(lumpnum + ML_NODES) < 8)
       return false;
-   const void *data = setupwad->cacheLumpNum(lumpnum + ML_NODES, PU_CACHE);
+   const void *data = setupwad->mapLumpNum(lumpnum + ML_NODES);
    if(!memcmp(data, "xNd4\0\0\0\0", 8))
    {
       C_Printf("DeePBSP v4 Extended nodes detected\n");
@@ -2113,8 +2138,26 @@ static void P_LoadSideDefs2(int lumpnum)
    Z_Free(lump);
 }
 
-// haleyjd 10/10/11: externalized structure due to pre-C++11 template limitations
-struct bmap_t { int n, nalloc, *list; }; // blocklist structure
+//
+// Input and output of a blockmap rebuild. The map geometry is copied in on
+// the main thread, so that the build itself can run on a helper thread while
+// the nodes are loaded; loading ZDoom nodes may move the vertex array.
+//
+struct bmapbuild_t
+{
+   struct line_t { fixed_t x1, y1, x2, y2, dx, dy; };
+
+   bool needed;   // no usable BLOCKMAP lump, so one is being built
+   bool boom;     // use the Boom algorithm instead of killough's
+
+   std::vector<fixed_t> vx, vy;   // vertex coordinates
+   std::vector<line_t>  lines;    // linedef endpoints and deltas
+
+   // result, only valid once built
+   std::vector<int> lump;
+   fixed_t orgx, orgy;
+   int     width, height;
+};
 
 //
 // Boom variant of blockmap creation, which will fix PrBoom+ demos recorded with -complevel 9. Not
@@ -2122,7 +2165,7 @@ struct bmap_t { int n, nalloc, *list; }; // blocklist structure
 //
 // Code copied from PrBoom+, possibly inherited itself from older ports. Specific stuff kept here.
 //
-static void P_createBlockMapBoom()
+static void P_createBlockMapBoom(bmapbuild_t &build)
 {
    //
    // jff 10/6/98
@@ -2136,23 +2179,13 @@ static void P_createBlockMapBoom()
    // jff 10/8/98 use guardband>0
    // jff 10/12/98 0 ok with + 1 in rows,cols
 
-   struct linelist_t        // type used to list lines in each block
-   {
-      int num;
-      struct linelist_t *next;
-   };
+   const int numverts = static_cast<int>(build.vx.size());
+   const int nlines   = static_cast<int>(build.lines.size());
 
-   //
-   // Subroutine to add a line number to a block list
-   // It simply returns if the line is already in the block
-   //
    int NBlocks;                   // number of cells = nrows*ncols
 
    int xorg, yorg;                 // blockmap origin (lower left)
    int nrows, ncols;               // blockmap dimensions
-   linelist_t **blocklists = nullptr;  // array of pointers to lists of lines
-   int *blockcount = nullptr;          // array of counters of line lists
-   int *blockdone = nullptr;           // array keeping track of blocks/line
    int linetotal = 0;              // total length of all blocklists
    int map_minx = INT_MAX;          // init for map limits search
    int map_miny = INT_MAX;
@@ -2161,15 +2194,15 @@ static void P_createBlockMapBoom()
 
    // scan for map limits, which the blockmap must enclose
 
-   for(int i = 0; i < numvertexes; i++)
+   for(int i = 0; i < numverts; i++)
    {
       fixed_t t;
 
-      if((t = vertexes[i].x) < map_minx)
+      if((t = build.vx[i]) < map_minx)
          map_minx = t;
       else if(t > map_maxx)
          map_maxx = t;
-      if((t = vertexes[i].y) < map_miny)
+      if((t = build.vy[i]) < map_miny)
          map_miny = t;
       else if(t > map_maxy)
          map_maxy = t;
@@ -2187,50 +2220,36 @@ static void P_createBlockMapBoom()
    nrows = (map_maxy - yorg + 1 + blkmask) >> blkshift;  //+1 needed for
    NBlocks = ncols * nrows;                                  //map exactly 1 cell
 
-   // create the array of pointers on NBlocks to blocklists
-   // also create an array of linelist counts on NBlocks
-   // finally make an array in which we can mark blocks done per line
+   // Each block's list of lines, in the order they were added. The lists
+   // are written out backwards, as PrBoom+ builds them as linked lists that
+   // grow at the head. Every list starts with the trailing -1.
+   std::vector<std::vector<int>> blocklists(NBlocks, std::vector<int>(1, -1));
+   std::vector<byte> blockdone(NBlocks);   // blocks done for the current line
 
-   // CPhipps - calloc's
-   blocklists = ecalloc(linelist_t **, NBlocks, sizeof(linelist_t *));
-   blockcount = ecalloc(int *, NBlocks, sizeof(int));
-   blockdone = emalloc(int *, NBlocks * sizeof(int));
-
-   auto AddBlockLine = [blocklists, blockcount, blockdone](int blockno, int lineno)
+   //
+   // Subroutine to add a line number to a block list
+   // It simply returns if the line is already in the block
+   //
+   auto AddBlockLine = [&blocklists, &blockdone](int blockno, int lineno)
    {
-      linelist_t *l;
-
       if(blockdone[blockno])
          return;
 
-      l = emalloc(linelist_t *, sizeof(linelist_t));
-      l->num = lineno;
-      l->next = blocklists[blockno];
-      blocklists[blockno] = l;
-      blockcount[blockno]++;
+      blocklists[blockno].push_back(lineno);
       blockdone[blockno] = 1;
    };
 
-   // initialize each blocklist, and enter the trailing -1 in all blocklists
-   // note the linked list of lines grows backwards
-
-   for(int i = 0; i < NBlocks; i++)
-   {
-      blocklists[i] = emalloc(linelist_t *, sizeof(linelist_t));
-      blocklists[i]->num = -1;
-      blocklists[i]->next = nullptr;
-      blockcount[i]++;
-   }
-
    // For each linedef in the wad, determine all blockmap blocks it touches,
    // and add the linedef number to the blocklists for those blocks
 
-   for(int i = 0; i < numlines; i++)
+   for(int i = 0; i < nlines; i++)
    {
-      int x1 = lines[i].v1->x >> FRACBITS;         // lines[i] map coords
-      int y1 = lines[i].v1->y >> FRACBITS;
-      int x2 = lines[i].v2->x >> FRACBITS;
-      int y2 = lines[i].v2->y >> FRACBITS;
+      const bmapbuild_t::line_t &line = build.lines[i];
+
+      int x1 = line.x1 >> FRACBITS;         // lines[i] map coords
+      int y1 = line.y1 >> FRACBITS;
+      int x2 = line.x2 >> FRACBITS;
+      int y2 = line.y2 >> FRACBITS;
       int dx = x2 - x1;
       int dy = y2 - y1;
       int vert = !dx;                            // lines[i] slopetype
@@ -2245,7 +2264,7 @@ static void P_createBlockMapBoom()
 
       // no blocks done for this linedef yet
 
-      memset(blockdone, 0, NBlocks * sizeof(int));
+      std::fill(blockdone.begin(), blockdone.end(), 0);
 
       // The line always belongs to the blocks containing its endpoints
 
@@ -2372,52 +2391,39 @@ static void P_createBlockMapBoom()
    // Add initial 0 to all blocklists
    // count the total number of lines (and 0's and -1's)
 
-   memset(blockdone, 0, NBlocks * sizeof(int));
+   std::fill(blockdone.begin(), blockdone.end(), 0);
    linetotal = 0;
    for(int i = 0; i < NBlocks; i++)
    {
       AddBlockLine(i, 0);
-      linetotal += blockcount[i];
+      linetotal += static_cast<int>(blocklists[i].size());
    }
 
    // Create the blockmap lump
 
-   blockmaplump = emalloctag(int *, sizeof(*blockmaplump) * (4 + NBlocks + linetotal), PU_LEVEL,
-                             nullptr);
+   std::vector<int> &lump = build.lump;
+   lump.assign(4 + NBlocks + linetotal, 0);
+
    // blockmap header
 
-   blockmaplump[0] = bmaporgx = xorg << FRACBITS;
-   blockmaplump[1] = bmaporgy = yorg << FRACBITS;
-   blockmaplump[2] = bmapwidth  = ncols;
-   blockmaplump[3] = bmapheight = nrows;
+   lump[0] = build.orgx = xorg << FRACBITS;
+   lump[1] = build.orgy = yorg << FRACBITS;
+   lump[2] = build.width  = ncols;
+   lump[3] = build.height = nrows;
 
    // offsets to lists and block lists
 
    for(int i = 0; i < NBlocks; i++)
    {
-      linelist_t *bl = blocklists[i];
-
-      int offs = blockmaplump[4 + i] =   // set offset to block's list
-      (i ? blockmaplump[4 + i - 1] : 4 + NBlocks) + (i ? blockcount[i - 1] : 0);
-
-      // add the lines in each block's list to the blockmaplump
-      // delete each list node as we go
+      const std::vector<int> &bl = blocklists[i];
 
-      while(bl)
-      {
-         linelist_t *tmp = bl->next;
-         blockmaplump[offs++] = bl->num;
+      int offs = lump[4 + i] =   // set offset to block's list
+      (i ? lump[4 + i - 1] : 4 + NBlocks) + (i ? static_cast<int>(blocklists[i - 1].size()) : 0);
 
-         efree(bl);
-         bl = tmp;
-      }
+      // add the lines in each block's list to the blockmaplump, newest first
+      for(auto itr = bl.rbegin(); itr != bl.rend(); ++itr)
+         lump[offs++] = *itr;
    }
-   skipblstart = true;
-
-   // free all temporary storage
-   efree(blocklists);
-   efree(blockcount);
-   efree(blockdone);
 }
 
 //
@@ -2433,48 +2439,52 @@ static void P_createBlockMapBoom()
 // Please note: This section of code is not interchangable with TeamTNT's
 // code which attempts to fix the same problem.
 //
-static void P_CreateBlockMap()
+// Works only on the copy of the geometry in build and touches no globals,
+// so it is safe to run on a helper thread.
+//
+static void P_CreateBlockMap(bmapbuild_t &build)
 {
    unsigned int i;
    fixed_t minx = INT_MAX, miny = INT_MAX,
            maxx = INT_MIN, maxy = INT_MIN;
 
-   C_Printf("P_CreateBlockMap: rebuilding blockmap for level\n");
+   if(build.boom)
+      return P_createBlockMapBoom(build);   // use Boom mode (which is also in PrBoom+)
 
-   if(demo_version >= 200 && demo_version < 203)
-      return P_createBlockMapBoom();   // use Boom mode (which is also in PrBoom+)
+   const unsigned int numverts = static_cast<unsigned int>(build.vx.size());
+   const unsigned int nlines   = static_cast<unsigned int>(build.lines.size());
 
    // First find limits of map
 
    // This fixes MBF's code, which has a bug where maxx/maxy
    // are wrong if the 0th node has the largest x or y
-   if(demo_version > 401 && numvertexes)
+   if(demo_version > 401 && numverts)
    {
-      minx = maxx = vertexes->x >> FRACBITS;
-      miny = maxy = vertexes->y >> FRACBITS;
+      minx = maxx = build.vx[0] >> FRACBITS;
+      miny = maxy = build.vy[0] >> FRACBITS;
    }
 
-   for(i = 0; i < (unsigned int)numvertexes; i++)
+   for(i = 0; i < numverts; i++)
    {
-      if((vertexes[i].x >> FRACBITS) < minx)
-         minx = vertexes[i].x >> FRACBITS;
-      else if((vertexes[i].x >> FRACBITS) > maxx)
-         maxx = vertexes[i].x >> FRACBITS;
-
-      if((vertexes[i].y >> FRACBITS) < miny)
-         miny = vertexes[i].y >> FRACBITS;
-      else if((vertexes[i].y >> FRACBITS) > maxy)
-         maxy = vertexes[i].y >> FRACBITS;
+      if((build.vx[i] >> FRACBITS) < minx)
+         minx = build.vx[i] >> FRACBITS;
+      else if((build.vx[i] >> FRACBITS) > maxx)
+         maxx = build.vx[i] >> FRACBITS;
+
+      if((build.vy[i] >> FRACBITS) < miny)
+         miny = build.vy[i] >> FRACBITS;
+      else if((build.vy[i] >> FRACBITS) > maxy)
+         maxy = build.vy[i] >> FRACBITS;
    }
 
    // Save blockmap parameters
-   
-   bmaporgx   = minx << FRACBITS;
-   bmaporgy   = miny << FRACBITS;
-   bmapwidth  = ((maxx - minx) >> MAPBTOFRAC) + 1;
-   bmapheight = ((maxy - miny) >> MAPBTOFRAC) + 1;
 
-   // Compute blockmap, which is stored as a 2d array of variable-sized 
+   build.orgx   = minx << FRACBITS;
+   build.orgy   = miny << FRACBITS;
+   build.width  = ((maxx - minx) >> MAPBTOFRAC) + 1;
+   build.height = ((maxy - miny) >> MAPBTOFRAC) + 1;
+
+   // Compute blockmap, which is stored as a 2d array of variable-sized
    // lists.
    //
    // Pseudocode:
@@ -2491,37 +2501,40 @@ static void P_CreateBlockMap()
    //     exit loop.
    //
    //     Move to an adjacent block by moving towards the ending block
-   //     in either the x or y direction, to the block which contains 
+   //     in either the x or y direction, to the block which contains
    //     the linedef.
 
    {
-      unsigned tot = bmapwidth * bmapheight;                  // size of blockmap
-      bmap_t *bmap = ecalloc(bmap_t *, sizeof *bmap, tot);    // array of blocklists
+      const int bmapwidth = build.width;
+      unsigned tot = build.width * build.height;              // size of blockmap
+      std::vector<std::vector<int>> bmap(tot);                // array of blocklists
 
-      for(i = 0; i < (unsigned int)numlines; i++)
+      for(i = 0; i < nlines; i++)
       {
+         const bmapbuild_t::line_t &line = build.lines[i];
+
          // starting coordinates
-         int x = (lines[i].v1->x >> FRACBITS) - minx;
-         int y = (lines[i].v1->y >> FRACBITS) - miny;
-         
+         int x = (line.x1 >> FRACBITS) - minx;
+         int y = (line.y1 >> FRACBITS) - miny;
+
          // x-y deltas
-         int adx = lines[i].dx >> FRACBITS, dx = adx < 0 ? -1 : 1;
-         int ady = lines[i].dy >> FRACBITS, dy = ady < 0 ? -1 : 1; 
+         int adx = line.dx >> FRACBITS, dx = adx < 0 ? -1 : 1;
+         int ady = line.dy >> FRACBITS, dy = ady < 0 ? -1 : 1;
 
-         // difference in preferring to move across y (>0) 
+         // difference in preferring to move across y (>0)
          // instead of x (<0)
          int diff = !adx ? 1 : !ady ? -1 :
-          (((x >> MAPBTOFRAC) << MAPBTOFRAC) + 
+          (((x >> MAPBTOFRAC) << MAPBTOFRAC) +
            (dx > 0 ? MAPBLOCKUNITS-1 : 0) - x) * (ady = D_abs(ady)) * dx -
-          (((y >> MAPBTOFRAC) << MAPBTOFRAC) + 
+          (((y >> MAPBTOFRAC) << MAPBTOFRAC) +
            (dy > 0 ? MAPBLOCKUNITS-1 : 0) - y) * (adx = D_abs(adx)) * dy;
 
          // starting block, and pointer to its blocklist structure
          int b = (y >> MAPBTOFRAC) * bmapwidth + (x >> MAPBTOFRAC);
 
          // ending block
-         int bend = (((lines[i].v2->y >> FRACBITS) - miny) >> MAPBTOFRAC) *
-            bmapwidth + (((lines[i].v2->x >> FRACBITS) - minx) >> MAPBTOFRAC);
+         int bend = (((line.y2 >> FRACBITS) - miny) >> MAPBTOFRAC) *
+            bmapwidth + (((line.x2 >> FRACBITS) - minx) >> MAPBTOFRAC);
 
          // delta for pointer when moving across y
          dy *= bmapwidth;
@@ -2533,16 +2546,8 @@ static void P_CreateBlockMap()
          // Now we simply iterate block-by-block until we reach the end block.
          while((unsigned int) b < tot)    // failsafe -- should ALWAYS be true
          {
-            // Increase size of allocated list if necessary
-            if(bmap[b].n >= bmap[b].nalloc)
-            {
-               bmap[b].nalloc = bmap[b].nalloc ? bmap[b].nalloc * 2 : 8;
-               bmap[b].list = erealloc(int *, bmap[b].list,
-                                       bmap[b].nalloc*sizeof*bmap->list);
-            }
-
             // Add linedef to end of list
-            bmap[b].list[bmap[b].n++] = i;
+            bmap[b].push_back(i);
 
             // If we have reached the last block, exit
             if(b == bend)
@@ -2564,10 +2569,10 @@ static void P_CreateBlockMap()
 
       // Compute the total size of the blockmap.
       //
-      // Compression of empty blocks is performed by reserving two 
+      // Compression of empty blocks is performed by reserving two
       // offset words at tot and tot+1.
       //
-      // 4 words, unused if this routine is called, are reserved at 
+      // 4 words, unused if this routine is called, are reserved at
       // the start.
 
       {
@@ -2577,42 +2582,63 @@ static void P_CreateBlockMap()
          for(i = 0; i < tot; i++)
          {
             // 1 header word + 1 trailer word + blocklist
-            if(bmap[i].n)
-               count += bmap[i].n + 2; 
+            if(!bmap[i].empty())
+               count += static_cast<int>(bmap[i].size()) + 2;
          }
 
          // Allocate blockmap lump with computed count
-         blockmaplump = emalloctag(int *, sizeof(*blockmaplump) * count,  PU_LEVEL, nullptr);
+         build.lump.assign(count, 0);
       }
 
       // Now compress the blockmap.
       {
+         std::vector<int> &lump = build.lump;
          int ndx = tot += 4;      // Advance index to start of linedef lists
-         bmap_t *bp = bmap;       // Start of uncompressed blockmap
+         auto bp = bmap.cbegin(); // Start of uncompressed blockmap
 
-         blockmaplump[ndx++] = 0;  // Store an empty blockmap list at start
-         blockmaplump[ndx++] = -1; // (Used for compression)
+         lump[ndx++] = 0;  // Store an empty blockmap list at start
+         lump[ndx++] = -1; // (Used for compression)
 
-         for(i = 4; i < tot; i++, bp++)
+         for(i = 4; i < tot; i++, ++bp)
          {
-            if(bp->n)                          // Non-empty blocklist
+            if(!bp->empty())                   // Non-empty blocklist
             {
-               blockmaplump[blockmaplump[i] = ndx++] = 0;  // Store index & header
-               do
-                  blockmaplump[ndx++] = bp->list[--bp->n]; // Copy linedef list
-               while (bp->n);
-               blockmaplump[ndx++] = -1;                   // Store trailer
-               efree(bp->list);                             // Free linedef list
+               lump[lump[i] = ndx++] = 0;      // Store index & header
+               for(auto itr = bp->rbegin(); itr != bp->rend(); ++itr)
+                  lump[ndx++] = *itr;          // Copy linedef list
+               lump[ndx++] = -1;               // Store trailer
             }
             else     // Empty blocklist: point to reserved empty blocklist
-               blockmaplump[i] = tot;
+               lump[i] = tot;
          }
-         
-         efree(bmap);    // Free uncompressed blockmap
       }
    }
+}
 
-   skipblstart = true;
+//
+// Copies the current geometry into build ahead of a blockmap rebuild.
+//
+static void P_prepareBlockMapBuild(bmapbuild_t &build)
+{
+   C_Printf("P_CreateBlockMap: rebuilding blockmap for level\n");
+
+   build.needed = true;
+   build.boom   = (demo_version >= 200 && demo_version < 203);
+
+   build.vx.resize(numvertexes);
+   build.vy.resize(numvertexes);
+   for(int i = 0; i < numvertexes; i++)
+   {
+      build.vx[i] = vertexes[i].x;
+      build.vy[i] = vertexes[i].y;
+   }
+
+   build.lines.resize(numlines);
+   for(int i = 0; i < numlines; i++)
+   {
+      const line_t &line = lines[i];
+      build.lines[i] = { line.v1->x, line.v1->y, line.v2->x, line.v2->y, line.dx, line.dy };
+   }
 }
 
 static const char *bmaperrormsg;
@@ -2703,18 +2729,23 @@ static bool P_VerifyBlockMap(int count)
 //
 // killough 3/30/98: Rewritten to remove blockmap limit
 //
-static void P_LoadBlockMap(int lump)
+// If the lump is missing or unusable, build is filled in for a rebuild by
+// P_CreateBlockMap, and P_SetupBlockMap installs the result.
+//
+static void P_LoadBlockMap(int lump, bmapbuild_t &build)
 {
    // IOANCH 20151215: no lump means no data. So that Eternity will generate.
    int len   = lump >= 0 ? setupwad->lumpLength(lump) : 0;
    int count = len / 2;
-   
+
+   build.needed = false;
+
    // sf: -blockmap checkparm made into variable
    // also checking for levels without blockmaps (0 length)
    // haleyjd 03/04/10: blockmaps of less than 8 bytes cannot be valid
    if(r_blockmap || len < 8 || count >= 0x10000)
    {
-      P_CreateBlockMap();
+      P_prepareBlockMapBuild(build);
    }
    else
    {
@@ -2751,9 +2782,33 @@ static void P_LoadBlockMap(int lump)
          C_Printf(FC_ERROR "Blockmap error: %s\a\n", bmaperrormsg);
          Z_Free(blockmaplump);
          blockmaplump = nullptr;
-         P_CreateBlockMap();
+         P_prepareBlockMapBuild(build);
       }
    }
+}
+
+//
+// P_SetupBlockMap
+//
+// Installs a rebuilt blockmap, if there is one, and creates the per-block
+// link arrays.
+//
+static void P_SetupBlockMap(bmapbuild_t &build)
+{
+   int count;
+
+   if(build.needed)
+   {
+      count = static_cast<int>(build.lump.size());
+      blockmaplump = emalloctag(int *, sizeof(*blockmaplump) * count, PU_LEVEL, nullptr);
+      memcpy(blockmaplump, build.lump.data(), sizeof(*blockmaplump) * count);
+
+      bmaporgx    = build.orgx;
+      bmaporgy    = build.orgy;
+      bmapwidth   = build.width;
+      bmapheight  = build.height;
+      skipblstart = true;
+   }
 
    // clear out mobj chains
    count      = sizeof(*blocklinks) * bmapwidth * bmapheight;
@@ -2824,6 +2879,9 @@ static void P_GroupLines()
    // build line tables for each sector
    linebuffer = emalloctag(line_t **, total * sizeof(*linebuffer), PU_LEVEL, nullptr);
 
+   // filled in by P_createSectorBoundingBoxes
+   pSectorBoxes = estructalloctag(sectorbox_t, numsectors, PU_LEVEL);
+
    for(i = 0; i < numsectors; i++)
    {
       sectors[i].lines = linebuffer;
@@ -2843,7 +2901,6 @@ static void P_GroupLines()
    for(i = 0; i < numsectors; i++)
    {
       sector_t *sector = sectors+i;
-      int block;
 
       // adjust pointers to point back to the beginning of each list
       sector->lines -= sector->linecount;
@@ -2865,6 +2922,21 @@ static void P_GroupLines()
 
       // haleyjd 10/16/06: copy all properties to ceiling origin
       sector->csoundorg = sector->soundorg;
+   }
+}
+
+//
+// P_setSectorBlockBoxes
+//
+// Converts the sector bounding boxes found by P_GroupLines to map blocks.
+// Split off so P_GroupLines doesn't have to wait for the blockmap.
+//
+static void P_setSectorBlockBoxes()
+{
+   for(int i = 0; i < numsectors; i++)
+   {
+      sector_t *sector = sectors+i;
+      int block;
 
       // adjust bounding box to map blocks
       block = (sector->blockbox[BOXTOP]-bmaporgy+MAXRADIUS)>>MAPBLOCKSHIFT;
@@ -2932,16 +3004,17 @@ static void P_GroupLines()
 //
 // ioanch 20190222: rewritten to lighten up the tabs and use floating-point.
 //
+// Uses no zone memory, so it may run on a helper thread.
+//
 static void P_RemoveSlimeTrails()             // killough 10/98
 {
-   byte *hit; 
    int i;
    
    // haleyjd: don't mess with vertices in old demos, for safety.
    if(demo_version < 203)
       return;
 
-   hit = ecalloc(byte *, 1, numvertexes); // Hitlist for vertices
+   std::vector<byte> hit(numvertexes); // Hitlist for vertices
 
    for(i = 0; i < numsegs; i++)            // Go through each seg
    {
@@ -2989,9 +3062,6 @@ static void P_RemoveSlimeTrails()             // killough 10/98
       } // Obfuscated C contest entry:   :)
       while((v != segs[i].v2) && (v = segs[i].v2));
    }
-
-   // free hit list
-   efree(hit);
 }
 
 //
@@ -3383,6 +3453,9 @@ static void P_PreZoneFreeLevel()
 
    // Clear all global reference-counted mobj references
    P_ClearGlobalMobjReferences();
+
+   // the sector PVS goes with the level
+   P_ClearSectorPVS();
 }
 
 //
@@ -3548,6 +3621,31 @@ CONSOLE_COMMAND(mapchecksum, 0)
       C_Printf("Current map MD5: %s\n", p_currentLevelHashDigest.constPtr());
 }
 
+//
+// Lists how long each geometry stage of the last level setup took, when it
+// started and on which thread it ran (0 is the main thread).
+//
+CONSOLE_COMMAND(p_setuptimes, 0)
+{
+   if(p_setuptimings.empty())
+   {
+      C_Puts("No level has been set up.");
+      return;
+   }
+
+   int64_t total = 0;
+
+   C_Printf(FC_HI "stage                 ms   start  thread\n");
+   for(const TaskGraph::timing_t &timing : p_setuptimings)
+   {
+      C_Printf("%-18s %7.2f %7.2f  %d\n", timing.name,
+               (timing.end - timing.start) / 1e6, timing.start / 1e6, timing.thread);
+      if(timing.end > total)
+         total = timing.end;
+   }
+   C_Printf(FC_HI "total %.2f ms\n", total / 1e6);
+}
+
 //
 // CHECK_ERROR
 //
@@ -3662,14 +3760,25 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
          P_SetupLevelError("Unsupported UDMF namespace", mapname);
          return;
       }
-
-      // start UDMF loading
-      udmf.loadVertices();
-      udmf.loadSectors(setupSettings);
    }
-   else
-   {
-      switch(LevelInfo.mapFormat)
+
+   // Load the geometry as a graph of stages. Stages that use the zone heap,
+   // the WAD directory or the console run on this thread in the order they
+   // were added; the rest may overlap them on helper threads. A stage that
+   // fails sets level_error, and no further stages start after that.
+   TaskGraph   graph;
+   bmapbuild_t bmapbuild;
+   qstring     udmferror;  // keeps a UDMF error message alive for level_error
+
+   int sectorTask = graph.addTask("sectors", TASK_MAIN, [&] {
+      // IOANCH 20151212: UDMF
+      if(isUdmf)
+      {
+         // start UDMF loading
+         udmf.loadVertices();
+         udmf.loadSectors(setupSettings);
+      }
+      else switch(LevelInfo.mapFormat)
       {
       case LEVEL_FORMAT_PSX:
          P_LoadConsoleVertexes(lumpnum + ML_VERTEXES);
@@ -3680,119 +3789,144 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
          P_LoadSectors (lumpnum + ML_SECTORS);
          break;
       }
-   }
-   
-   // possible error: missing flats
-   CHECK_ERROR();
+   });
 
    // haleyjd 01/05/14: create sector interpolation data
-   P_CreateSectorInterps();
+   graph.addTask("sector interps", TASK_MAIN, P_CreateSectorInterps, { sectorTask });
 
-   // IOANCH 20151212: UDMF
-   if(isUdmf)
-      udmf.loadSidedefs();
-   else
-      P_LoadSideDefs(lumpnum + ML_SIDEDEFS); // killough 4/4/98
+   int sideTask = graph.addTask("sidedefs", TASK_MAIN, [&] {
+      // IOANCH 20151212: UDMF
+      if(isUdmf)
+         udmf.loadSidedefs();
+      else
+         P_LoadSideDefs(lumpnum + ML_SIDEDEFS); // killough 4/4/98
+   }, { sectorTask });
 
    // haleyjd 10/03/05: handle multiple map formats
-   // IOANCH 20151212: UDMF
-   if(isUdmf)
-   {
-      if(!udmf.loadLinedefs(setupSettings))
+   int lineTask = graph.addTask("linedefs", TASK_MAIN, [&] {
+      // IOANCH 20151212: UDMF
+      if(isUdmf)
       {
-         P_SetupLevelError(udmf.error().constPtr(), mapname);
-         return;
+         if(!udmf.loadLinedefs(setupSettings))
+            level_error = (udmferror = udmf.error()).constPtr();
       }
-   }
-   else switch(LevelInfo.mapFormat)
-   {
-   case LEVEL_FORMAT_DOOM:
-   case LEVEL_FORMAT_PSX:
-      P_LoadLineDefs(lumpnum + ML_LINEDEFS, setupSettings);
-      break;
-   case LEVEL_FORMAT_HEXEN:
-      P_LoadHexenLineDefs(lumpnum + ML_LINEDEFS);
-      break;
-   }
+      else switch(LevelInfo.mapFormat)
+      {
+      case LEVEL_FORMAT_DOOM:
+      case LEVEL_FORMAT_PSX:
+         P_LoadLineDefs(lumpnum + ML_LINEDEFS, setupSettings);
+         break;
+      case LEVEL_FORMAT_HEXEN:
+         P_LoadHexenLineDefs(lumpnum + ML_LINEDEFS);
+         break;
+      }
+   }, { sideTask });
 
-   // IOANCH 20151213: udmf
-   if(isUdmf)
-   {
-      if(!udmf.loadSidedefs2())
+   int side2Task = graph.addTask("sidedefs2", TASK_MAIN, [&] {
+      // IOANCH 20151213: udmf
+      if(isUdmf)
       {
-         P_SetupLevelError(udmf.error().constPtr(), mapname);
-         return;
+         if(!udmf.loadSidedefs2())
+            level_error = (udmferror = udmf.error()).constPtr();
       }
-   }
-   else
-      P_LoadSideDefs2(lumpnum + ML_SIDEDEFS);
-   
-   P_LoadLineDefs2();                      // killough 4/4/98
-   
+      else
+         P_LoadSideDefs2(lumpnum + ML_SIDEDEFS);
+   }, { lineTask });
+
+   int line2Task = graph.addTask("linedefs2", TASK_MAIN, P_LoadLineDefs2,  // killough 4/4/98
+                                 { side2Task });
+
    // IOANCH 20151213: use mgla here and elsewhere
-   
-   P_LoadBlockMap (mgla.blockmap); // killough 3/1/98
-   
-   // If it's UDMF, vertices can have extra precision, requiring better geometry calculations.
-   R_PointOnSide = R_PointOnSideClassic;  // set classic function unless otherwise set later
-
-   // IOANCH: at this point, mgla.nodes is valid. Check ZDoom node signature too
-   ZNodeType znodeSignature;
-   int actualNodeLump = -1;
-   if((znodeSignature = P_CheckForZDoomUncompressedNodes(mgla.nodes, 
-      &actualNodeLump, isUdmf)) != ZNodeType_Invalid && actualNodeLump >= 0)
-   {
-      P_LoadZNodes(actualNodeLump, znodeSignature);
-      if(znodeSignature == ZNodeType_GL3)
-         R_PointOnSide = R_PointOnSidePrecise;
 
-      CHECK_ERROR();
-   }
-   else if(P_CheckForDeePBSPv4Nodes(lumpnum))   // ioanch 20160204: also DeePBSP
-   {
-      P_LoadSubsectors_V4(lumpnum + ML_SSECTORS);
-      CHECK_ERROR();
-      P_LoadNodes_V4(lumpnum + ML_NODES);
-      CHECK_ERROR();
-      P_LoadSegs_V4(lumpnum + ML_SEGS);
-      CHECK_ERROR();
-   }
-   else
-   {
-      // IOANCH 20151215: make sure everything is valid. Can happen if UDMF has
-      // invalid ZNODES entry
-      if(mgla.ssectors < 0 || mgla.segs < 0)
+   // killough 3/1/98: P_LoadBlockMap call moved down to below
+   // The lump is read here, but a rebuild runs alongside the nodes.
+   int bmapLumpTask = graph.addTask("blockmap lump", TASK_MAIN, [&] {
+      P_LoadBlockMap(mgla.blockmap, bmapbuild);
+   }, { line2Task });
+
+   int bmapBuildTask = graph.addTask("blockmap build", TASK_ANY, [&] {
+      if(bmapbuild.needed)
+         P_CreateBlockMap(bmapbuild);
+   }, { bmapLumpTask });
+
+   int bmapTask = graph.addTask("blockmap links", TASK_MAIN, [&] {
+      P_SetupBlockMap(bmapbuild);
+   }, { bmapBuildTask });
+
+   // ZDoom nodes may reallocate the vertices, so the blockmap lump stage has to
+   // have copied them first.
+   int nodeTask = graph.addTask("nodes", TASK_MAIN, [&] {
+      // If it's UDMF, vertices can have extra precision, requiring better geometry calculations.
+      R_PointOnSide = R_PointOnSideClassic;  // set classic function unless otherwise set later
+
+      // IOANCH: at this point, mgla.nodes is valid. Check ZDoom node signature too
+      ZNodeType znodeSignature;
+      int actualNodeLump = -1;
+      if((znodeSignature = P_CheckForZDoomUncompressedNodes(mgla.nodes, 
+         &actualNodeLump, isUdmf)) != ZNodeType_Invalid && actualNodeLump >= 0)
       {
-         P_SetupLevelError("UDMF levels don't support vanilla BSP", mapname);
-         return;
+         P_LoadZNodes(actualNodeLump, znodeSignature);
+         if(znodeSignature == ZNodeType_GL3)
+            R_PointOnSide = R_PointOnSidePrecise;
       }
+      else if(P_CheckForDeePBSPv4Nodes(lumpnum))   // ioanch 20160204: also DeePBSP
+      {
+         P_LoadSubsectors_V4(lumpnum + ML_SSECTORS);
+         if(level_error)
+            return;
+         P_LoadNodes_V4(lumpnum + ML_NODES);
+         if(level_error)
+            return;
+         P_LoadSegs_V4(lumpnum + ML_SEGS);
+      }
+      else
+      {
+         // IOANCH 20151215: make sure everything is valid. Can happen if UDMF has
+         // invalid ZNODES entry
+         if(mgla.ssectors < 0 || mgla.segs < 0)
+         {
+            level_error = "UDMF levels don't support vanilla BSP";
+            return;
+         }
 
-      // IOANCH: at this point, it's not a UDMF map so mgla will be valid
-      P_LoadSubsectors(mgla.ssectors);
-      P_LoadNodes     (mgla.nodes);
-
-      // possible error: missing nodes or subsectors
-      CHECK_ERROR();
+         // IOANCH: at this point, it's not a UDMF map so mgla will be valid
+         P_LoadSubsectors(mgla.ssectors);
+         P_LoadNodes     (mgla.nodes);
 
-      P_LoadSegs(mgla.segs); 
+         // possible error: missing nodes or subsectors
+         if(level_error)
+            return;
 
-      // possible error: malformed segs
-      CHECK_ERROR();
-   }
+         // possible error: malformed segs
+         P_LoadSegs(mgla.segs); 
+      }
+   }, { bmapLumpTask });
 
    // ioanch 20160309: reversed P_GroupLines with P_LoadReject to fix the
    // overrun
-   P_GroupLines();
-   P_LoadReject(mgla.reject); // haleyjd 01/26/04
+   int groupTask = graph.addTask("group lines", TASK_MAIN, P_GroupLines, { nodeTask });
+   graph.addTask("reject", TASK_MAIN, [&] {
+      P_LoadReject(mgla.reject); // haleyjd 01/26/04
+   }, { groupTask });
+   graph.addTask("sector blocks", TASK_MAIN, P_setSectorBlockBoxes, { groupTask, bmapTask });
 
    // Create bounding boxes now
-   P_createSectorBoundingBoxes();
+   int boxTask = graph.addTask("bounding boxes", TASK_ANY, P_createSectorBoundingBoxes,
+                               { groupTask });
 
    // haleyjd 01/12/14: build sound environment zones
-   P_CreateSoundZones();
+   int zoneTask = graph.addTask("sound zones", TASK_ANY, P_CreateSoundZones, { groupTask });
+   graph.addTask("sound zone reverbs", TASK_MAIN, P_setSoundZoneReverbs, { zoneTask });
 
    // killough 10/98: remove slime trails from wad
-   P_RemoveSlimeTrails(); 
+   // Moves vertices, so it must wait until the bounding boxes are done.
+   graph.addTask("slime trails", TASK_ANY, P_RemoveSlimeTrails, { boxTask });
+
+   graph.run([] { return level_error != nullptr; });
+   p_setuptimings = graph.getTimings();
+
+   // possible error: missing flats, nodes, subsectors or malformed segs
+   CHECK_ERROR();
 
    // haleyjd 08/19/13: call new function to handle bodyque
    G_ClearPlayerCorpseQueue();
@@ -3837,6 +3971,9 @@ void P_SetupLevel(WadDirectory *dir, const char *mapname, int playermask,
    // SoM: Deferred specials that need to be spawned after P_SpawnSpecials
    P_SpawnDeferredSpecials(setupSettings);
 
+   // needs all linked portals to be in place
+   P_BuildSectorPVS();
+
    // haleyjd
    P_InitLightning();
 
@@ -2399,6 +2399,8 @@ bool P_MoveAttached(const sector_t *sector, bool ceiling, fixed_t delta,
 
    for(i = 0; i < count; i++)
    {
+      P_AddMovedSector(list[i].sector);
+
       if(list[i].type & AS_CEILING)
       {
          P_SetCeilingHeight(list[i].sector, list[i].sector->srf.ceiling.height + delta);
@@ -28,6 +28,7 @@
 #include "acs_intr.h"
 #include "c_io.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_dehtbl.h"
 #include "d_gi.h"
 #include "d_main.h"
@@ -40,6 +41,7 @@
 #include "p_sector.h"
 #include "p_spec.h"
 #include "p_tick.h"
+#include "p_tickprof.h"
 #include "p_user.h"
 #include "p_partcl.h"
 #include "polyobj.h"
@@ -234,6 +236,14 @@ void Thinker::RunThinkers(void)
    {
       if(currentthinker->removed)
          currentthinker->removeDelayed();
+      else if(p_tickprofiling)
+      {
+         // the thinker can only be removed here, not freed
+         Thinker *const thinker = currentthinker;
+         const int64_t  start   = D_BenchNow();
+         thinker->Think();
+         P_TickProfAddThinker(thinker, D_BenchNow() - start);
+      }
       else
          currentthinker->Think();
    }
@@ -274,6 +284,8 @@ void P_Ticker()
                  players[consoleplayer].viewz != 1))
       return;
 
+   BenchScope bench(BENCH_TICKER);
+
    // spawn unknowns at start of map if requested and possible
    if(!leveltime)
       P_SpawnUnknownThings();
@@ -285,16 +297,23 @@ void P_Ticker()
    // Reset any interpolated scrolled sidedefs
    P_TicResetLerpScrolledSides();
    
-   P_ParticleThinker(); // haleyjd: think for particles
+   {
+      TickProfScope prof(TICKPROF_PARTICLES);
+      P_ParticleThinker(); // haleyjd: think for particles
+   }
 
    // VANILLA_HERETIC: it's critical to postpone S_RunSequences below
    if(!vanilla_heretic)
+   {
+      TickProfScope prof(TICKPROF_SOUNDSEQ);
       S_RunSequences(); // haleyjd 06/06/06
+   }
 
    // not if this is an intermission screen
    // haleyjd: players don't think during cinematic pauses
    if(gamestate == GS_LEVEL && !cinema_pause)
    {
+      TickProfScope prof(TICKPROF_PLAYERS);
       for(int i = 0; i < MAXPLAYERS; i++)
       {
          if(playeringame[i])
@@ -303,17 +322,34 @@ void P_Ticker()
    }
 
    Thinker::RunThinkers();
-   ACS_Exec();
-   P_UpdateSpecials();
+   {
+      TickProfScope prof(TICKPROF_ACS);
+      ACS_Exec();
+   }
+   {
+      TickProfScope prof(TICKPROF_SPECIALS);
+      P_UpdateSpecials();
+   }
    if(vanilla_heretic)
+   {
+      TickProfScope prof(TICKPROF_SOUNDSEQ);
       S_RunSequences();
-   P_RespawnSpecials();
-   if(demo_version >= 329)
-      P_AnimateSurfaces(); // haleyjd 04/14/99
+   }
+   {
+      TickProfScope prof(TICKPROF_SPECIALS);
+      P_RespawnSpecials();
+      if(demo_version >= 329)
+         P_AnimateSurfaces(); // haleyjd 04/14/99
+   }
    
    leveltime++;                       // for par times
 
-   P_RunEffects(); // haleyjd: run particle effects
+   {
+      TickProfScope prof(TICKPROF_PARTICLES);
+      P_RunEffects(); // haleyjd: run particle effects
+   }
+
+   P_TickProfEndTic();
 }
 
 //----------------------------------------------------------------------------
@@ -0,0 +1,311 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Tic-time profiler. Times every thinker and the other parts of
+//  P_Ticker, aggregated by thinker class and by thing type.
+//
+//  Controlled by the thinkprof console command. While it's off, the thinker
+//  loop and P_Ticker pay a single flag test.
+//
+// Authors: agent
+//
+
+#include <algorithm>
+
+#include "z_zone.h"
+
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "doomstat.h"
+#include "g_game.h"
+#include "info.h"
+#include "m_collection.h"
+#include "m_qstr.h"
+#include "p_mobj.h"
+#include "p_tick.h"
+#include "p_tickprof.h"
+#include "v_misc.h"
+
+bool p_tickprofiling;
+
+struct tickprofentry_t
+{
+   const char *name;
+   uint64_t    calls;
+   int64_t     ns;
+   int64_t     maxns;
+};
+
+static const char *const tickprofsectionnames[NUMTICKPROFSECTIONS] =
+{
+   "[players]",
+   "[particles]",
+   "[acs]",
+   "[specials]",
+   "[soundseq]",
+};
+
+// per thinker class, keyed by RTTI type; there are only a few dozen classes
+struct tickprofclass_t
+{
+   const RTTIObject::Type *type;
+   tickprofentry_t         entry;
+};
+
+static PODCollection<tickprofclass_t> tickprofclasses;
+static tickprofentry_t                tickprofsections[NUMTICKPROFSECTIONS];
+static tickprofentry_t               *tickproftypes;    // per mobjtype
+static int                            tickprofnumtypes;
+static int                            tickproftics;
+
+static void P_tickProfAdd(tickprofentry_t &entry, int64_t ns)
+{
+   ++entry.calls;
+   entry.ns += ns;
+   if(ns > entry.maxns)
+      entry.maxns = ns;
+}
+
+static tickprofentry_t &P_tickProfClass(const Thinker *thinker)
+{
+   const RTTIObject::Type *type = thinker->getDynamicType();
+
+   // thinkers of one class tend to come in runs, so try the last one first
+   static size_t last;
+   if(last < tickprofclasses.getLength() && tickprofclasses[last].type == type)
+      return tickprofclasses[last].entry;
+
+   for(size_t i = 0; i < tickprofclasses.getLength(); i++)
+   {
+      if(tickprofclasses[i].type == type)
+      {
+         last = i;
+         return tickprofclasses[i].entry;
+      }
+   }
+
+   last = tickprofclasses.getLength();
+   tickprofclasses.add({ type, { type->getName(), 0, 0, 0 } });
+   return tickprofclasses[last].entry;
+}
+
+//
+// P_TickProfAddThinker
+//
+// Called from Thinker::RunThinkers with the time one Think call took.
+//
+void P_TickProfAddThinker(const Thinker *thinker, int64_t ns)
+{
+   P_tickProfAdd(P_tickProfClass(thinker), ns);
+
+   if(const Mobj *mo = thinker_cast<const Mobj *>(thinker))
+   {
+      if(mo->type >= 0 && mo->type < tickprofnumtypes)
+         P_tickProfAdd(tickproftypes[mo->type], ns);
+   }
+}
+
+void P_TickProfAddSection(tickprofsection_e section, int64_t ns)
+{
+   P_tickProfAdd(tickprofsections[section], ns);
+}
+
+void P_TickProfEndTic()
+{
+   if(p_tickprofiling)
+      ++tickproftics;
+}
+
+static void P_tickProfReset()
+{
+   tickprofclasses.clear();
+   memset(tickprofsections, 0, sizeof(tickprofsections));
+   for(int i = 0; i < NUMTICKPROFSECTIONS; i++)
+      tickprofsections[i].name = tickprofsectionnames[i];
+
+   if(tickproftypes)
+      efree(tickproftypes);
+   tickprofnumtypes = NUMMOBJTYPES;
+   tickproftypes    = ecalloc(tickprofentry_t *, tickprofnumtypes, sizeof(tickprofentry_t));
+   for(int i = 0; i < tickprofnumtypes; i++)
+      tickproftypes[i].name = mobjinfo[i]->name;
+
+   tickproftics = 0;
+}
+
+//=============================================================================
+//
+// Reports
+//
+
+//
+// Everything that has been timed, either the classes and sections or the
+// thing types, heaviest first
+//
+static void P_tickProfSorted(PODCollection<const tickprofentry_t *> &out, bool types)
+{
+   out.clear();
+
+   if(types)
+   {
+      for(int i = 0; i < tickprofnumtypes; i++)
+      {
+         if(tickproftypes[i].calls)
+            out.add(&tickproftypes[i]);
+      }
+   }
+   else
+   {
+      for(const tickprofclass_t &cls : tickprofclasses)
+         out.add(&cls.entry);
+      for(const tickprofentry_t &section : tickprofsections)
+      {
+         if(section.calls)
+            out.add(&section);
+      }
+   }
+
+   std::sort(out.begin(), out.end(), [](const tickprofentry_t *a, const tickprofentry_t *b) {
+      return a->ns > b->ns;
+   });
+}
+
+static int64_t P_tickProfTotal()
+{
+   int64_t total = 0;
+   for(const tickprofclass_t &cls : tickprofclasses)
+      total += cls.entry.ns;
+   for(const tickprofentry_t &section : tickprofsections)
+      total += section.ns;
+   return total;
+}
+
+static void P_tickProfPrintTable(const char *title, bool types, int count)
+{
+   PODCollection<const tickprofentry_t *> sorted;
+   P_tickProfSorted(sorted, types);
+
+   const int64_t total = P_tickProfTotal();
+   const int     tics  = tickproftics ? tickproftics : 1;
+
+   C_Printf(FC_HI "%s\n", title);
+   C_Printf(FC_GRAY "%-20s %8s %8s %8s %8s %6s\n", "name", "calls", "ms/tic", "avg us",
+            "max us", "%");
+
+   for(size_t i = 0; i < sorted.getLength() && int(i) < count; i++)
+   {
+      const tickprofentry_t &entry = *sorted[i];
+      C_Printf("%-20.20s %8llu %8.3f %8.2f %8.1f %6.2f\n", entry.name,
+               static_cast<unsigned long long>(entry.calls), entry.ns / 1000000.0 / tics,
+               entry.ns / 1000.0 / entry.calls, entry.maxns / 1000.0,
+               total ? entry.ns * 100.0 / total : 0.0);
+   }
+}
+
+static void P_tickProfWriteRows(FILE *f, const char *kind, bool types)
+{
+   PODCollection<const tickprofentry_t *> sorted;
+   P_tickProfSorted(sorted, types);
+
+   const int tics = tickproftics ? tickproftics : 1;
+
+   for(const tickprofentry_t *entry : sorted)
+   {
+      fprintf(f, "%s,%s,%llu,%.4f,%.4f,%.3f,%.3f\n", kind, entry->name,
+              static_cast<unsigned long long>(entry->calls), entry->ns / 1000000.0,
+              entry->ns / 1000000.0 / tics, entry->ns / 1000.0 / entry->calls,
+              entry->maxns / 1000.0);
+   }
+}
+
+//
+// Writes everything timed as CSV
+//
+static bool P_tickProfWriteFile(const char *filename)
+{
+   FILE *f;
+   if(!(f = fopen(filename, "w")))
+      return false;
+
+   fprintf(f, "# %d tics, map %s\n", tickproftics, gamemapname);
+   fputs("kind,name,calls,total_ms,ms_per_tic,avg_us,max_us\n", f);
+   P_tickProfWriteRows(f, "class", false);
+   P_tickProfWriteRows(f, "mobjtype", true);
+
+   fclose(f);
+   return true;
+}
+
+//=============================================================================
+//
+// Console Commands
+//
+
+//
+// thinkprof on|off|reset|report [count]|dump <file>
+//
+CONSOLE_COMMAND(thinkprof, 0)
+{
+   const char *arg = Console.argc ? Console.argv[0]->constPtr() : "";
+
+   if(!strcasecmp(arg, "on"))
+   {
+      if(!tickproftypes || tickprofnumtypes != NUMMOBJTYPES)
+         P_tickProfReset();
+      p_tickprofiling = true;
+      C_Printf("Thinker profiling on\n");
+   }
+   else if(!strcasecmp(arg, "off"))
+   {
+      p_tickprofiling = false;
+      C_Printf("Thinker profiling off after %d tics\n", tickproftics);
+   }
+   else if(!strcasecmp(arg, "reset"))
+   {
+      P_tickProfReset();
+      C_Printf("Thinker profile cleared\n");
+   }
+   else if(!strcasecmp(arg, "report"))
+   {
+      const int count = Console.argc >= 2 ? Console.argv[1]->toInt() : 15;
+
+      C_Printf("%d tics profiled\n", tickproftics);
+      P_tickProfPrintTable("By thinker class", false, count);
+      P_tickProfPrintTable("By thing type", true, count);
+   }
+   else if(!strcasecmp(arg, "dump") && Console.argc >= 2)
+   {
+      qstring filename(usergamepath);
+      filename.pathConcatenate(Console.argv[1]->constPtr());
+      filename.addDefaultExtension(".csv");
+
+      if(P_tickProfWriteFile(filename.constPtr()))
+         C_Printf("Wrote thinker profile to %s\n", filename.constPtr());
+      else
+         C_Printf(FC_ERROR "Could not write %s\n", filename.constPtr());
+   }
+   else
+   {
+      C_Printf("Usage: thinkprof on|off|reset|report [count]|dump <file>\n"
+               "Thinker profiling is %s\n", p_tickprofiling ? "on" : "off");
+   }
+}
+
+// EOF
+
@@ -0,0 +1,80 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Tic-time profiler. Times every thinker and the other parts of
+//  P_Ticker, aggregated by thinker class and by thing type.
+//
+// Authors: agent
+//
+
+#ifndef P_TICKPROF_H__
+#define P_TICKPROF_H__
+
+#include "d_bench.h"
+
+class Thinker;
+
+//
+// The parts of P_Ticker that aren't thinkers
+//
+enum tickprofsection_e
+{
+   TICKPROF_PLAYERS,   // P_PlayerThink
+   TICKPROF_PARTICLES, // P_ParticleThinker and P_RunEffects
+   TICKPROF_ACS,       // ACS_Exec
+   TICKPROF_SPECIALS,  // P_UpdateSpecials, P_RespawnSpecials, P_AnimateSurfaces
+   TICKPROF_SOUNDSEQ,  // S_RunSequences
+   NUMTICKPROFSECTIONS
+};
+
+extern bool p_tickprofiling; // thinkprof is on
+
+void P_TickProfAddThinker(const Thinker *thinker, int64_t ns);
+void P_TickProfAddSection(tickprofsection_e section, int64_t ns);
+void P_TickProfEndTic();
+
+//
+// Times the enclosing scope into a section, as BenchScope does for the
+// benchmark phases.
+//
+class TickProfScope
+{
+public:
+   explicit TickProfScope(tickprofsection_e inSection)
+      : section(inSection), start(p_tickprofiling ? D_BenchNow() : 0)
+   {
+   }
+   ~TickProfScope()
+   {
+      if(p_tickprofiling)
+         P_TickProfAddSection(section, D_BenchNow() - start);
+   }
+
+   TickProfScope(const TickProfScope &) = delete;
+   TickProfScope &operator = (const TickProfScope &) = delete;
+
+private:
+   tickprofsection_e section;
+   int64_t           start;
+};
+
+#endif
+
+// EOF
+
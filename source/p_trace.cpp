@@ -809,19 +809,26 @@ void P_UseLines(player_t *player)
 //
 
 // 1/11/98 killough: Intercept limit removed
+// The buffer is kept between traces and only ever grows, together with the
+// sort keys used to visit it in order.
 static intercept_t *intercepts, *intercept_p;
+static uint64_t    *interceptorder;
+static size_t       numintercepts;
 
-// Check for limit and double size if necessary -- killough
-static void check_intercept()
+//
+// Returns the next free intercept, doubling the buffer if it is full
+//
+static intercept_t *P_newIntercept()
 {
-   static size_t num_intercepts;
-   size_t offset = intercept_p - intercepts;
-   if(offset >= num_intercepts)
+   const size_t offset = intercept_p - intercepts;
+   if(offset >= numintercepts)
    {
-      num_intercepts = num_intercepts ? num_intercepts*2 : 128;
-      intercepts = erealloc(intercept_t *, intercepts, sizeof(*intercepts)*num_intercepts);
-      intercept_p = intercepts + offset;
+      numintercepts  = numintercepts ? numintercepts * 2 : 128;
+      intercepts     = erealloc(intercept_t *, intercepts, sizeof(*intercepts) * numintercepts);
+      interceptorder = erealloc(uint64_t *, interceptorder, sizeof(*interceptorder) * numintercepts);
+      intercept_p    = intercepts + offset;
    }
+   return intercept_p++;
 }
 
 //
@@ -866,12 +873,11 @@ static bool PIT_AddLineIntercepts(line_t *ld, polyobj_t *po, void *context)
    if(frac < 0)
       return true;        // behind source
 
-   check_intercept();    // killough
-   
-   intercept_p->frac = frac;
-   intercept_p->isaline = true;
-   intercept_p->d.line = ld;
-   intercept_p++;
+   intercept_t *in = P_newIntercept(); // killough
+
+   in->frac    = frac;
+   in->isaline = true;
+   in->d.line  = ld;
    
    return true;  // continue
 }
@@ -921,12 +927,11 @@ static bool PIT_AddThingIntercepts(Mobj *thing, void *context)
    if(frac < 0)
       return true;                // behind source
    
-   check_intercept();            // killough
-   
-   intercept_p->frac    = frac;
-   intercept_p->isaline = false;
-   intercept_p->d.thing = thing;
-   intercept_p++;
+   intercept_t *in = P_newIntercept(); // killough
+
+   in->frac    = frac;
+   in->isaline = false;
+   in->d.thing = thing;
    
    return true;          // keep going
 }
@@ -941,24 +946,15 @@ static bool PIT_AddThingIntercepts(Mobj *thing, void *context)
 //
 static bool P_TraverseIntercepts(traverser_t func, fixed_t maxfrac, void *context)
 {
-   intercept_t *in = nullptr;
-   int count = static_cast<int>(intercept_p - intercepts);
-   while(count--)
+   // Sort once rather than rescanning for the closest intercept on every
+   // step. The order is the same one the rescan produced, which demos rely
+   // on; anything past maxfrac is where the rescan stopped.
+   const size_t count = P_SortIntercepts(intercepts, intercept_p - intercepts,
+                                         maxfrac, interceptorder);
+   for(size_t i = 0; i < count; i++)
    {
-      fixed_t dist = D_MAXINT;
-      intercept_t *scan;
-      for(scan = intercepts; scan < intercept_p; scan++)
-         if(scan->frac < dist)
-            dist = (in=scan)->frac;
-      if(dist > maxfrac)
-         return true;    // checked everything in range
-
-      if(in) // haleyjd: for safety
-      {
-         if(!func(in, context))
-            return false;           // don't bother going farther
-         in->frac = D_MAXINT;
-      }
+      if(!func(&intercepts[uint32_t(interceptorder[i])], context))
+         return false;           // don't bother going farther
    }
    return true;                  // everything was traversed
 }
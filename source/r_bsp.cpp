@@ -1171,13 +1171,15 @@ static void R_clipSegToLPortal(bspcontext_t &bspcontext, cmapcontext_t &cmapcont
 // When a new seg obtains a sector portal window, make sure to update the render barrier accordingly
 // Needs to be done each time a sector window is detected.
 //
-static void R_updateWindowSectorBarrier(const uint64_t visitid, cb_seg_t &seg, surf_e surf)
+static void R_updateWindowSectorBarrier(portalcontext_t &portalcontext, const uint64_t visitid,
+                                        cb_seg_t &seg, surf_e surf)
 {
-   sectorbox_t &box = pSectorBoxes[seg.line->frontsector - sectors];
-   if(seg.secwindow[surf] && box.visitid[surf] != visitid)
+   const int secnum = int(seg.line->frontsector - sectors);
+   uint64_t &sectorvisitid = portalcontext.sectorvisitids[secnum][surf];
+   if(seg.secwindow[surf] && sectorvisitid != visitid)
    {
-      box.visitid[surf] = visitid;
-      R_CalcRenderBarrier(*seg.secwindow[surf], box);
+      sectorvisitid = visitid;
+      R_CalcRenderBarrier(*seg.secwindow[surf], pSectorBoxes[secnum]);
    }
 }
 
@@ -1339,7 +1341,7 @@ static void R_2S_Sloped(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.ceiling = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_ceil, seg.frontsec->srf.ceiling
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_ceil);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_ceil);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_ceil);
       }
       else if(!heightchange && seg.frontsec->srf.ceiling.portal == seg.backsec->srf.ceiling.portal)
@@ -1347,7 +1349,7 @@ static void R_2S_Sloped(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.ceiling = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_ceil, seg.frontsec->srf.ceiling
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_ceil);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_ceil);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_ceil);
          seg.secwindow.ceiling = nullptr;
       }
@@ -1425,7 +1427,7 @@ static void R_2S_Sloped(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.floor = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_floor, seg.frontsec->srf.floor
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_floor);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_floor);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_floor);
       }
       else if(!heightchange && seg.frontsec->srf.floor.portal == seg.backsec->srf.floor.portal)
@@ -1433,7 +1435,7 @@ static void R_2S_Sloped(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.floor = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_floor, seg.frontsec->srf.floor
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_floor);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_floor);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_floor);
          seg.secwindow.floor = nullptr;
       }
@@ -1660,7 +1662,7 @@ static void R_2S_Normal(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.ceiling = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_ceil, seg.frontsec->srf.ceiling
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_ceil);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_ceil);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_ceil);
       }
       else if(seg.frontsec->srf.ceiling.portal == seg.backsec->srf.ceiling.portal &&
@@ -1670,7 +1672,7 @@ static void R_2S_Normal(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.ceiling = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_ceil, seg.frontsec->srf.ceiling
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_ceil);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_ceil);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_ceil);
          seg.secwindow.ceiling = nullptr;
       }
@@ -1746,7 +1748,7 @@ static void R_2S_Normal(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.floor = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_floor, seg.frontsec->srf.floor
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_floor);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_floor);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_floor);
       }
       else if(seg.frontsec->srf.floor.height == seg.backsec->srf.floor.height &&
@@ -1756,7 +1758,7 @@ static void R_2S_Normal(cmapcontext_t &cmapcontext, planecontext_t &planecontext
          seg.secwindow.floor = R_GetSectorPortalWindow(
             planecontext, portalcontext, viewpoint, bounds, surf_floor, seg.frontsec->srf.floor
          );
-         R_updateWindowSectorBarrier(visitid, seg, surf_floor);
+         R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_floor);
          R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_floor);
          seg.secwindow.floor = nullptr;
       }
@@ -1938,7 +1940,7 @@ static void R_1SidedLine(cmapcontext_t &cmapcontext, planecontext_t &planecontex
       seg.secwindow.ceiling = R_GetSectorPortalWindow(
          planecontext, portalcontext, viewpoint, bounds, surf_ceil, seg.frontsec->srf.ceiling
       );
-      R_updateWindowSectorBarrier(visitid, seg, surf_ceil);
+      R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_ceil);
       R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_ceil);
    }
 
@@ -1949,7 +1951,7 @@ static void R_1SidedLine(cmapcontext_t &cmapcontext, planecontext_t &planecontex
       seg.secwindow.floor = R_GetSectorPortalWindow(
          planecontext, portalcontext, viewpoint, bounds, surf_floor, seg.frontsec->srf.floor
       );
-      R_updateWindowSectorBarrier(visitid, seg, surf_floor);
+      R_updateWindowSectorBarrier(portalcontext, visitid, seg, surf_floor);
       R_MovePortalOverlayToWindow(cmapcontext, planecontext, viewpoint, cb_viewpoint, bounds, seg, surf_floor);
    }
 
@@ -2803,11 +2805,11 @@ static void R_renderPolyNode(bspcontext_t &bspcontext, cmapcontext_t &cmapcontex
 }
 
 //
-// haleyjd: Adds dynamic segs contained in all of the rpolyobj_t fragments
-// contained inside the given subsector into a mini-BSP tree and then 
-// renders the BSP. BSPs are only recomputed when polyobject fragments
-// move into or out of the subsector. This is the ultimate heart of the 
-// polyobject code.
+// haleyjd: Renders the mini-BSP tree built from the dynamic segs contained
+// in all of the rpolyobj_t fragments inside the given subsector. BSPs are
+// only recomputed when polyobject fragments move into or out of the
+// subsector, by R_UpdateDynaBSPs before the frame begins. This is the
+// ultimate heart of the polyobject code.
 //
 // See r_dynseg.cpp to see how dynasegs get attached to a subsector in the
 // first place :)
@@ -2819,16 +2821,8 @@ static void R_addDynaSegs(bspcontext_t &bspcontext, cmapcontext_t &cmapcontext,
                           const viewpoint_t &viewpoint, const cbviewpoint_t &cb_viewpoint,
                           const contextbounds_t &bounds, const uint64_t visitid,
                           cb_seg_t &seg,
-                          subsector_t *sub)
+                          const subsector_t *sub)
 {
-   bool needbsp = (!sub->bsp || sub->bsp->dirty);
-
-   if(needbsp)
-   {
-      if(sub->bsp)
-         R_FreeDynaBSP(sub->bsp);
-      sub->bsp = R_BuildDynaBSP(sub);
-   }
    if(sub->bsp)
    {
       R_renderPolyNode(
@@ -25,35 +25,70 @@
 // Authors: Max Waine
 //
 
-#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 
 #include "c_io.h"
 #include "c_runcmd.h"
 #include "doomstat.h"
+#include "m_compare.h"
 #include "m_misc.h"
-#include "hal/i_timer.h"
 #include "i_video.h"
 #include "r_context.h"
 #include "r_draw.h"
 #include "r_main.h"
 #include "r_state.h"
+#include "r_things.h"
 #include "v_misc.h"
 
 struct renderdata_t
 {
-   rendercontext_t  context;
-   std::thread      thread;
-   std::atomic_bool running;
-   std::atomic_bool shouldquit;
-   std::atomic_bool framewaiting;
-   std::atomic_bool framefinished;
+   rendercontext_t context;
+   std::thread     thread;
+   unsigned int    framenum; // last frame this context has rendered
+   double          frametime;  // time taken for the last frame, in ms
+   double          avgtime;    // moving average of frametime, for display
+   float           nextstart;  // start column for the next frame when balancing
+   unsigned int    jobnum;     // last job batch this context has joined
 };
 
 static renderdata_t *renderdatas      = nullptr;
 static int           prev_numcontexts = 0;
 
-static bool          temp_dgafaboutyourcpu = true; // THREAD_FIXME: DELETE THIS
+bool r_balancecontexts = true;
+
+// The contexts still allocate from the zone heap and fill the lump and
+// texture caches while they render, and none of those are locked. Until
+// they are, only one context may run.
+static constexpr int MAX_CONTEXTS = 1;
+
+// Fraction of the way the boundaries move towards the balanced split each
+// frame. Damps oscillation caused by noisy timings.
+static constexpr float BALANCE_DAMPING = 0.5f;
+
+//
+// Worker pool state. The workers sleep on contextstartcv until the main thread
+// bumps contextframenum, and the main thread sleeps on contextdonecv until
+// every worker has finished the frame. All of it is guarded by contextmutex.
+//
+static std::mutex              contextmutex;
+static std::condition_variable contextstartcv;
+static std::condition_variable contextdonecv;
+static unsigned int            contextframenum      = 0;
+static int                     contextsremaining    = 0;
+static bool                    contextsshouldquit   = false;
+
+//
+// Job batch state, also guarded by contextmutex. Between frames the same
+// workers can be handed a batch of independent jobs by R_RunContextJobs.
+//
+static void                  (*contextjob)(int)   = nullptr;
+static unsigned int            contextjobnum        = 0;
+static int                     contextnumjobs       = 0;
+static int                     contextnextjob       = 0;
+static int                     contextjobsremaining = 0;
 
 //
 // Grabs a given render context
@@ -65,32 +100,121 @@ rendercontext_t &R_GetContext(int index)
 
 //
 // Frees up the dynamically allocated members of a context that aren't tagged PU_VALLOC
-// Also tidies up threads of that context's data
 //
-void R_freeContext(rendercontext_t &context)
+static void R_freeContext(rendercontext_t &context)
 {
-   // THREAD_FIXME: Verify this catches everything
-   if(context.spritecontext.drawsegs_xrange)
-      efree(context.spritecontext.drawsegs_xrange);
-   if(context.spritecontext.vissprites)
-      efree(context.spritecontext.vissprites);
-   if(context.spritecontext.vissprite_ptrs)
-      efree(context.spritecontext.vissprite_ptrs);
-   if(context.spritecontext.sectorvisited)
-      efree(context.spritecontext.sectorvisited);
+   bspcontext_t    &bspcontext    = context.bspcontext;
+   spritecontext_t &spritecontext = context.spritecontext;
+
+   if(bspcontext.drawsegs)
+      efree(bspcontext.drawsegs);
+   if(spritecontext.drawsegs_xrange)
+      efree(spritecontext.drawsegs_xrange);
+   if(spritecontext.vissprites)
+      efree(spritecontext.vissprites);
+   if(spritecontext.vissprite_ptrs)
+      efree(spritecontext.vissprite_ptrs);
+   if(spritecontext.sectorvisited)
+      efree(spritecontext.sectorvisited);
+   if(context.portalcontext.sectorvisitids)
+      efree(context.portalcontext.sectorvisitids);
+
+   // The post-BSP stack and its masked ranges are allocated as needed
+   R_FreePostStack(spritecontext);
+
+   context = {};
 }
 
 //
-// Frees up actual renderdatas, which need waiting on before we can safely free
+// Allocates the per-level arrays of a context
 //
-void R_freeData(renderdata_t &data)
+static void R_allocContextLevelData(rendercontext_t &context)
 {
-   data.shouldquit.store(true);
+   context.spritecontext.sectorvisited =
+      ecalloctag(bool *, numsectors, sizeof(bool), PU_LEVEL, nullptr);
+   context.portalcontext.sectorvisitids =
+      estructalloctag(Surfaces<uint64_t>, numsectors, PU_LEVEL);
+}
 
-   while(data.running.load())
-      i_haltimer.Sleep(1);
+//
+// Takes jobs from the current batch until none are left to start. The lock
+// is held on entry and on return.
+//
+static void R_takeContextJobs(std::unique_lock<std::mutex> &lock)
+{
+   while(contextnextjob < contextnumjobs)
+   {
+      const int index = contextnextjob++;
+
+      lock.unlock();
+      contextjob(index);
+      lock.lock();
 
-   R_freeContext(data.context);
+      if(--contextjobsremaining == 0)
+         contextdonecv.notify_one();
+   }
+}
+
+//
+// This function is always going on in the background so that threads don't
+// need to constantly be spawned. It sleeps until there's a frame to render
+// or a batch of jobs to help with.
+//
+static void R_contextThreadFunc(renderdata_t *data)
+{
+   std::unique_lock<std::mutex> lock(contextmutex);
+
+   while(true)
+   {
+      contextstartcv.wait(lock, [data] {
+         return contextsshouldquit || data->framenum != contextframenum ||
+                data->jobnum != contextjobnum;
+      });
+
+      if(contextsshouldquit)
+         break;
+
+      if(data->jobnum != contextjobnum)
+      {
+         data->jobnum = contextjobnum;
+         R_takeContextJobs(lock);
+         continue;
+      }
+
+      data->framenum = contextframenum;
+
+      lock.unlock();
+      const auto starttime = std::chrono::steady_clock::now();
+      R_RenderViewContext(data->context);
+      const std::chrono::duration<double, std::milli> elapsed =
+         std::chrono::steady_clock::now() - starttime;
+      lock.lock();
+
+      data->frametime = elapsed.count();
+
+      if(--contextsremaining == 0)
+         contextdonecv.notify_one();
+   }
+}
+
+//
+// Tells all the context threads to quit and waits for them to do so
+//
+static void R_stopContextThreads()
+{
+   {
+      std::lock_guard<std::mutex> lock(contextmutex);
+      contextsshouldquit = true;
+   }
+   contextstartcv.notify_all();
+
+   for(int currentcontext = 0; currentcontext < prev_numcontexts; currentcontext++)
+   {
+      if(renderdatas[currentcontext].thread.joinable())
+         renderdatas[currentcontext].thread.join();
+   }
+
+   contextsshouldquit = false;
 }
 
 void R_FreeContexts()
@@ -99,36 +223,94 @@ void R_FreeContexts()
 
    if(renderdatas)
    {
+      R_stopContextThreads();
+
       for(int currentcontext = 0; currentcontext < prev_numcontexts; currentcontext++)
-         R_freeData(renderdatas[currentcontext]);
-      efree(renderdatas);
+         R_freeContext(renderdatas[currentcontext].context);
+
+      delete[] renderdatas;
+      renderdatas = nullptr;
    }
 }
 
 //
-// This function is always going on in the background
-// so that threads don't need to constantly be spawned
+// Sets the column bounds of a context to span [fstart, fend)
 //
-static void R_contextThreadFunc(renderdata_t *data)
+static void R_setContextColumns(contextbounds_t &bounds, const float fstart, const float fend)
+{
+   bounds.fstartcolumn = fstart;
+   bounds.fendcolumn   = fend;
+   bounds.startcolumn  = int(roundf(bounds.fstartcolumn));
+   bounds.endcolumn    = int(roundf(bounds.fendcolumn));
+   bounds.numcolumns   = bounds.endcolumn - bounds.startcolumn;
+}
+
+//
+// Sets the column bounds of a context to an even share of width
+//
+static void R_setContextBounds(contextbounds_t &bounds, const int index, const int width)
+{
+   const float contextwidth = float(width) / float(r_numcontexts);
+
+   R_setContextColumns(bounds, float(index) * contextwidth, float(index + 1) * contextwidth);
+}
+
+//
+// Moves the column boundaries between contexts so that each one gets an equal
+// share of last frame's total render time. The cost of each context is assumed
+// to be spread evenly over its columns, which is good enough once it converges.
+//
+static void R_balanceContexts()
 {
-   data->running.exchange(true);
+   const int   numcontexts = r_numcontexts;
+   const float width       = renderdatas[numcontexts - 1].context.bounds.fendcolumn;
+   const float minwidth    = emax(1.0f, floorf(width / float(numcontexts * 8)));
+
+   double totaltime = 0.0;
+   for(int i = 0; i < numcontexts; i++)
+      totaltime += renderdatas[i].frametime;
 
-   while(!data->shouldquit.load())
+   if(totaltime <= 0.0)
+      return;
+
+   const double targettime = totaltime / double(numcontexts);
+
+   // Walk the cumulative cost curve and find where each new boundary lies
+   double accumtime = 0.0;
+   int    source    = 0;
+
+   renderdatas[0].nextstart = 0.0f;
+   for(int i = 1; i < numcontexts; i++)
    {
-      if(data->framewaiting.exchange(false))
-      {
-         R_RenderViewContext(data->context);
-         data->framefinished.store(true);
-         // THREAD_TODO: Wait here an appropriate amount of time once FPS limiting is in
-      }
+      const double wanttime = targettime * double(i);
+
+      while(source < numcontexts - 1 && accumtime + renderdatas[source].frametime < wanttime)
+         accumtime += renderdatas[source++].frametime;
+
+      const contextbounds_t &bounds = renderdatas[source].context.bounds;
+      const double sourcetime = renderdatas[source].frametime;
+      const double fraction   = sourcetime > 0.0 ? (wanttime - accumtime) / sourcetime : 0.0;
 
-      if(temp_dgafaboutyourcpu)
-         std::this_thread::yield(); // I YIELD MY TIME, FUCK YOU!
-      else
-         i_haltimer.Sleep(1);
+      const float balanced = bounds.fstartcolumn +
+         float(eclamp(fraction, 0.0, 1.0)) * (bounds.fendcolumn - bounds.fstartcolumn);
+      const float current  = renderdatas[i].context.bounds.fstartcolumn;
+
+      renderdatas[i].nextstart = current + (balanced - current) * BALANCE_DAMPING;
+   }
+
+   // Keep every context at least minwidth columns wide
+   for(int i = 1; i < numcontexts; i++)
+   {
+      float &nextstart = renderdatas[i].nextstart;
+      nextstart = emax(nextstart, renderdatas[i - 1].nextstart + minwidth);
+      nextstart = emin(nextstart, width - float(numcontexts - i) * minwidth);
    }
 
-   data->running.exchange(false);
+   for(int i = 0; i < numcontexts; i++)
+   {
+      const float fend = i == numcontexts - 1 ? width : renderdatas[i + 1].nextstart;
+      R_setContextColumns(renderdatas[i].context.bounds, renderdatas[i].nextstart, fend);
+   }
 }
 
 //
@@ -136,6 +318,7 @@ static void R_contextThreadFunc(renderdata_t *data)
 //
 void R_InitContexts(const int width)
 {
+   r_numcontexts    = eclamp(r_numcontexts, 1, MAX_CONTEXTS);
    prev_numcontexts = r_numcontexts;
 
    r_globalcontext = {};
@@ -151,14 +334,15 @@ void R_InitContexts(const int width)
       r_globalcontext.portalcontext.portalrender = { false, MAX_SCREENWIDTH, 0 };
 
       if(numsectors && gamestate == GS_LEVEL)
-         r_globalcontext.spritecontext.sectorvisited = ecalloctag(bool *, numsectors, sizeof(bool), PU_LEVEL, nullptr);
+         R_allocContextLevelData(r_globalcontext);
 
       return;
    }
 
-   renderdatas = estructalloc(renderdata_t, r_numcontexts);
-
-   const float contextwidth = float(width) / float(r_numcontexts);
+   renderdatas       = new renderdata_t[r_numcontexts]();
+   contextframenum   = 0;
+   contextsremaining = 0;
+   contextjobnum     = 0;
 
    for(int currentcontext = 0; currentcontext < r_numcontexts; currentcontext++)
    {
@@ -166,20 +350,13 @@ void R_InitContexts(const int width)
 
       context.bufferindex = currentcontext;
 
-      context.bounds.fstartcolumn = float(currentcontext)     * contextwidth;
-      context.bounds.fendcolumn   = float(currentcontext + 1) * contextwidth;
-      context.bounds.startcolumn  = int(roundf(context.bounds.fstartcolumn));
-      context.bounds.endcolumn    = int(roundf(context.bounds.fendcolumn));
-      context.bounds.numcolumns   = context.bounds.endcolumn - context.bounds.startcolumn;
+      R_setContextBounds(context.bounds, currentcontext, width);
 
       context.portalcontext.portalrender = { false, MAX_SCREENWIDTH, 0 };
 
       if(numsectors && gamestate == GS_LEVEL)
-         context.spritecontext.sectorvisited = ecalloctag(bool *, numsectors, sizeof(bool), PU_LEVEL, nullptr);
+         R_allocContextLevelData(context);
 
-      // Wait until this context's thread is done running before creating a new one
-      while(renderdatas[currentcontext].running.load())
-         i_haltimer.Sleep(1);
       renderdatas[currentcontext].thread = std::thread(&R_contextThreadFunc, &renderdatas[currentcontext]);
    }
 }
@@ -188,16 +365,12 @@ void R_RefreshContexts()
 {
    if(r_numcontexts == 1)
    {
-      r_globalcontext.spritecontext.sectorvisited = ecalloctag(bool *, numsectors, sizeof(bool), PU_LEVEL, nullptr);
+      R_allocContextLevelData(r_globalcontext);
       return;
    }
 
    for(int currentcontext = 0; currentcontext < r_numcontexts; currentcontext++)
-   {
-      rendercontext_t &context = renderdatas[currentcontext].context;
-
-      context.spritecontext.sectorvisited = ecalloctag(bool *, numsectors, sizeof(bool), PU_LEVEL, nullptr);
-   }
+      R_allocContextLevelData(renderdatas[currentcontext].context);
 }
 
 void R_UpdateContextBounds()
@@ -208,66 +381,124 @@ void R_UpdateContextBounds()
       r_globalcontext.bounds.endcolumn     = viewwindow.width;
       r_globalcontext.bounds.fstartcolumn = 0.0f;
       r_globalcontext.bounds.fendcolumn   = float(viewwindow.width);
+      r_globalcontext.bounds.numcolumns   = viewwindow.width;
       return;
    }
 
-   const float contextwidth = float(viewwindow.width) / float(r_numcontexts);
    for(int currentcontext = 0; currentcontext < r_numcontexts; currentcontext++)
-   {
-      rendercontext_t &context = renderdatas[currentcontext].context;
-
-      context.bounds.fstartcolumn = float(currentcontext)     * contextwidth;
-      context.bounds.fendcolumn   = float(currentcontext + 1) * contextwidth;
-      context.bounds.startcolumn  = int(roundf(context.bounds.fstartcolumn));
-      context.bounds.endcolumn    = int(roundf(context.bounds.fendcolumn));
-      context.bounds.numcolumns   = context.bounds.endcolumn - context.bounds.startcolumn;
-   }
+      R_setContextBounds(renderdatas[currentcontext].context.bounds, currentcontext, viewwindow.width);
 }
 
 //
-// Runs all the contexts by setting the waiting-for-frame atomics bool to true,
-// then waits for the frame-finished-rendering atomic bools to be true
-// (setting them to false after)
+// Runs all the contexts by bumping the frame number and waking the workers,
+// then sleeps until the last of them reports that it is done. A frame left
+// pending by pipelined presentation is shown while they work.
 //
 void R_RunContexts()
 {
-   int finishedcontexts = 0;
+   {
+      std::lock_guard<std::mutex> lock(contextmutex);
+      contextsremaining = r_numcontexts;
+      contextframenum++;
+   }
+   contextstartcv.notify_all();
 
-   for(int currentcontext = 0; currentcontext < r_numcontexts; currentcontext++)
-      renderdatas[currentcontext].framewaiting.store(true);
+   I_PresentPendingFrame();
+
+   std::unique_lock<std::mutex> lock(contextmutex);
+   contextdonecv.wait(lock, [] { return contextsremaining == 0; });
 
-   while(finishedcontexts != r_numcontexts)
+   for(int currentcontext = 0; currentcontext < r_numcontexts; currentcontext++)
    {
-      for(int currentcontext = 0; currentcontext < r_numcontexts; currentcontext++)
-      {
-         if(renderdatas[currentcontext].framefinished.exchange(false))
-            finishedcontexts++;
-      }
+      renderdata_t &data = renderdatas[currentcontext];
+      data.avgtime = data.avgtime * 0.9 + data.frametime * 0.1;
    }
+
+   if(r_balancecontexts)
+      R_balanceContexts();
 }
 
-#if 0
-VARIABLE_BOOLEAN(temp_dgafaboutyourcpu, nullptr, yesno);
-CONSOLE_VARIABLE(r_gofast, temp_dgafaboutyourcpu, cf_buffered) {}
+//
+// Calls job once for each index below numjobs, spreading the calls over the
+// context workers and the calling thread, and returns when all are done. Jobs
+// must be independent of each other, and this mustn't be called while the
+// contexts are rendering.
+//
+void R_RunContextJobs(const int numjobs, void (*job)(int))
+{
+   if(r_numcontexts == 1 || numjobs < 2)
+   {
+      for(int i = 0; i < numjobs; i++)
+         job(i);
+      return;
+   }
+
+   std::unique_lock<std::mutex> lock(contextmutex);
+
+   contextjob           = job;
+   contextnumjobs       = numjobs;
+   contextnextjob       = 0;
+   contextjobsremaining = numjobs;
+   contextjobnum++;
+   contextstartcv.notify_all();
+
+   R_takeContextJobs(lock);
+   contextdonecv.wait(lock, [] { return contextjobsremaining == 0; });
+
+   contextjob     = nullptr;
+   contextnumjobs = 0;
+}
 
 VARIABLE_INT(r_numcontexts, nullptr, 0, UL, nullptr);
 CONSOLE_VARIABLE(r_numcontexts, r_numcontexts, cf_buffered)
 {
-   const int maxcontexts = std::thread::hardware_concurrency();
+   const int maxcontexts = emin(emax(int(std::thread::hardware_concurrency()), 1), MAX_CONTEXTS);
 
    if(r_numcontexts == 0)
-      r_numcontexts = maxcontexts - 1; // allow scrolling left from 1 to maxcontexts
+      r_numcontexts = maxcontexts; // allow scrolling left from 1 to maxcontexts
    else if(r_numcontexts == maxcontexts + 1)
       r_numcontexts = 1; // allow scrolling right from maxcontexts to 1
    else if(r_numcontexts > maxcontexts)
    {
-      C_Printf(FC_ERROR "Warning: r_numcontexts's current maximum is %d, resetting to 1", maxcontexts);
+      C_Printf(FC_ERROR "Warning: r_numcontexts's current maximum is %d, resetting to 1\n", maxcontexts);
       r_numcontexts = 1;
    }
 
-   I_SetMode();
+   // Tears down the existing contexts (joining their threads) and builds the
+   // new set between frames.
+   if(r_numcontexts != prev_numcontexts)
+      I_SetMode();
+}
+
+VARIABLE_TOGGLE(r_balancecontexts, nullptr, onoff);
+CONSOLE_VARIABLE(r_balancecontexts, r_balancecontexts, 0)
+{
+   // Go back to an even split when turned off
+   if(!r_balancecontexts && renderdatas)
+      R_UpdateContextBounds();
+}
+
+//
+// Prints the columns each context is rendering and how long they're taking
+//
+CONSOLE_COMMAND(r_contexttimes, 0)
+{
+   if(!renderdatas)
+   {
+      C_Printf(FC_ERROR "Only one render context is running\n");
+      return;
+   }
+
+   C_Printf(FC_HI "Context  Columns      Width  Time (ms)\n");
+   for(int currentcontext = 0; currentcontext < prev_numcontexts; currentcontext++)
+   {
+      const renderdata_t    &data   = renderdatas[currentcontext];
+      const contextbounds_t &bounds = data.context.bounds;
+
+      C_Printf("%7d  %4d - %4d  %5d  %9.3f\n", currentcontext, bounds.startcolumn,
+               bounds.endcolumn - 1, bounds.numcolumns, data.avgtime);
+   }
 }
-#endif
 
 // EOF
 
@@ -105,6 +105,10 @@ struct portalcontext_t
 
    pwindow_t *unusedhead, *windowhead, *windowlast;
 
+   // Per-sector visit IDs used to update sector portal render barriers once per
+   // portal render. Kept per-context so that contexts don't stomp on each other.
+   Surfaces<uint64_t> *sectorvisitids;
+
    // This flag is set when a portal is being rendered. This flag is checked in
    // r_bsp.c when rendering camera portals (skybox, anchored, linked) so that an
    // extra function (R_ClipSegToPortal) is called to prevent certain types of HOM
@@ -166,8 +170,8 @@ struct rendercontext_t
 // It doesn't contribute to r_numcontexts
 inline rendercontext_t r_globalcontext;
 
-inline constexpr int r_numcontexts = 1;
-//inline int r_numcontexts; // RESTORE TO THIS EVENTUALLY
+inline int r_numcontexts = 1;
+extern bool r_balancecontexts;
 
 rendercontext_t &R_GetContext(int context);
 void R_FreeContexts();
@@ -175,6 +179,7 @@ void R_InitContexts(const int width);
 void R_RefreshContexts();
 void R_UpdateContextBounds();
 void R_RunContexts();
+void R_RunContextJobs(const int numjobs, void (*job)(int));
 
 template<typename F>
 void R_ForEachContext(F &&f)
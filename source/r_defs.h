@@ -193,6 +193,7 @@ struct sectoraction_t
 struct sectorinterp_t
 {
    bool    interpolated;       // if true, interpolated
+   bool    moved;              // if true, on the moved sectors list
 
    fixed_t prevfloorheight;    // previous values, stored for interpolation
    fixed_t prevceilingheight;
@@ -212,7 +213,6 @@ struct sectorbox_t
 {
    fixed_t box[4];      // bounding box per sector
    float fbox[4];
-   Surfaces<uint64_t> visitid;   // updated to avoid visiting more than once
 };
 
 //
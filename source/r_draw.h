@@ -86,6 +86,7 @@ struct columndrawer_t
 };
 
 extern columndrawer_t r_normal_drawer;
+extern columndrawer_t r_simd_drawer;
 
 #define TRANSLATIONCOLOURS 14
 
@@ -138,6 +139,7 @@ struct spandrawer_t
 
 extern spandrawer_t r_lpspandrawer;  // low-precision
 extern spandrawer_t r_spandrawer;    // normal
+extern spandrawer_t r_simdspandrawer; // SIMD
 
 void R_InitBuffer(int width, int height);
 
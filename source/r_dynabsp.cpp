@@ -29,51 +29,92 @@
 //
 //-----------------------------------------------------------------------------
 
+#include <algorithm>
+#include <mutex>
+
 #include "z_zone.h"
 
 #include "i_system.h"
+#include "m_collection.h"
 #include "p_setup.h"
+#include "r_context.h"
 #include "r_dynabsp.h"
+#include "r_state.h"
 
 //=============================================================================
 //
-// rpolynode Maintenance
+// rpolynode Pooling
+//
+// Each tree carves its nodes out of a chain of blocks that it owns, so that
+// trees in different subsectors can be built at the same time without a
+// shared freelist, and a tree is freed a block at a time. Blocks come from
+// the system heap, which unlike the zone may be used from any thread.
 //
 
-static rpolynode_t *polyNodeFreeList;
+struct rpolynodeblock_t
+{
+   rpolynodeblock_t *next;
+   int               numnodes; // nodes handed out so far
+   int               maxnodes; // nodes the block has room for
+};
+
+// size of the blocks added once a tree outgrows its first one
+#define POLYNODE_GROWBLOCK 16
+
+//
+// Adds a block of maxnodes zeroed nodes to the front of the tree's chain.
+//
+static rpolynodeblock_t *R_newPolyNodeBlock(rpolybsp_t *bsp, int maxnodes)
+{
+   auto block = static_cast<rpolynodeblock_t *>(
+      Z_SysCalloc(1, sizeof(rpolynodeblock_t) + maxnodes * sizeof(rpolynode_t)));
+
+   block->maxnodes = maxnodes;
+   block->next     = bsp->blocks;
+   bsp->blocks     = block;
+
+   return block;
+}
 
 //
 // R_GetFreePolyNode
 //
-// Gets a node from the free list or allocates a new one.
+// Gets a node from the tree's newest block, adding a block if it is full.
 //
-static rpolynode_t *R_GetFreePolyNode()
+static rpolynode_t *R_GetFreePolyNode(rpolybsp_t *bsp)
 {
-   rpolynode_t *ret = nullptr;
+   rpolynodeblock_t *block = bsp->blocks;
 
-   if(polyNodeFreeList)
-   {
-      ret = polyNodeFreeList;
-      polyNodeFreeList = polyNodeFreeList->children[0];
-      memset(ret, 0, sizeof(*ret));
-   }
-   else
-      ret = estructalloc(rpolynode_t, 1);
+   if(!block || block->numnodes == block->maxnodes)
+      block = R_newPolyNodeBlock(bsp, POLYNODE_GROWBLOCK);
 
-   return ret;
+   return reinterpret_cast<rpolynode_t *>(block + 1) + block->numnodes++;
 }
 
 //
-// R_FreePolyNode
+// Returns all of a tree's node blocks to the system heap.
 //
-// Puts a dynamic node onto the free list.
-//
-static void R_FreePolyNode(rpolynode_t *rpn)
+static void R_freePolyNodeBlocks(rpolybsp_t *bsp)
 {
-   rpn->children[0] = polyNodeFreeList;
-   polyNodeFreeList = rpn;
+   rpolynodeblock_t *block = bsp->blocks;
+
+   while(block)
+   {
+      rpolynodeblock_t *next = block->next;
+      Z_SysFree(block);
+      block = next;
+   }
+
+   bsp->blocks = nullptr;
 }
 
+//
+// Guards the dynaseg and dynavertex pools, the list of dynasegs changed this
+// tic, and the reference counts of vertices that several subsectors share,
+// while trees are being built on more than one thread.
+//
+static std::mutex dynaSegMutex;
+
 //=============================================================================
 //
 // Dynaseg Setup
@@ -435,6 +476,8 @@ static void R_divideSegs(rpolynode_t *rpn, dseglist_t *ts,
          // seg is split by the partition
          R_ComputeIntersection(best, seg, x, y, &fbackup);
 
+         std::lock_guard<std::mutex> lock(dynaSegMutex);
+
          // create a new vertex at the intersection point
          dynavertex_t *nv = R_GetFreeDynaVertex();
          nv->fx = static_cast<float>(x);
@@ -529,7 +572,7 @@ static void R_divideSegs(rpolynode_t *rpn, dseglist_t *ts,
 // A tree of rpolynode instances is returned. nullptr is returned in the terminal
 // case where there are no segs left to classify.
 //
-static rpolynode_t *R_createNode(dseglist_t *ts)
+static rpolynode_t *R_createNode(rpolybsp_t *bsp, dseglist_t *ts)
 {
    dseglist_t rights = nullptr;
    dseglist_t lefts  = nullptr;
@@ -537,16 +580,16 @@ static rpolynode_t *R_createNode(dseglist_t *ts)
    if(!*ts)
       return nullptr; // terminal case: empty list
 
-   rpolynode_t *rpn = R_GetFreePolyNode();
+   rpolynode_t *rpn = R_GetFreePolyNode(bsp);
 
    // divide the segs into two lists
    R_divideSegs(rpn, ts, &rights, &lefts);
 
    // recurse into right space
-   rpn->children[0] = R_createNode(&rights);
+   rpn->children[0] = R_createNode(bsp, &rights);
 
    // recurse into left space
-   rpn->children[1] = R_createNode(&lefts);
+   rpn->children[1] = R_createNode(bsp, &lefts);
 
    return rpn;
 }
@@ -561,7 +604,7 @@ static rpolynode_t *R_createNode(dseglist_t *ts)
 //
 // Take a subsector and turn its list of rpolyobj fragments into a flat list of
 // dynasegs linked by their bsplinks. The dynasegs' BSP-related fields will also
-// be initialized. The result is suitable for input to R_BuildDynaBSP.
+// be initialized. The result is suitable for input to R_createNode.
 //
 static bool R_collapseFragmentsToDSList(const subsector_t *subsec, dseglist_t *list)
 {
@@ -646,47 +689,141 @@ static void R_freeTreeRecursive(rpolynode_t *root)
    R_freeTreeRecursive(root->children[0]);
    R_freeTreeRecursive(root->children[1]);
 
-   // free resources stored in this node
+   // free resources stored in this node; the node itself goes with its block
    R_returnOwnedList(root);
-
-   // return the bsp node
-   R_FreePolyNode(root);
 }
 
 //=============================================================================
 //
-// External Interface
+// Rebuilding
+//
+// Subsectors whose fragments change are queued when they do, and their trees
+// are all rebuilt at once before the next frame is rendered, spread over the
+// render context workers. The renderer only ever reads finished trees.
 //
 
+struct dynabspjob_t
+{
+   subsector_t *subsec;
+   int          numsegs; // dynasegs in its fragments
+};
+
+static PODCollection<subsector_t *> dirtySubsecs;
+static PODCollection<dynabspjob_t>  dynaBSPJobs;
+
 //
-// R_BuildDynaBSP
+// Counts the dynasegs in all of a subsector's polyobject fragments.
 //
-// Call to build a dynamic BSP sub-tree for sorting of dynasegs.
+static int R_countFragmentSegs(const subsector_t *subsec)
+{
+   int count = 0;
+
+   for(const DLListItem<rpolyobj_t> *fragment = subsec->polyList; fragment;
+       fragment = fragment->dllNext)
+   {
+      for(const dynaseg_t *ds = (*fragment)->dynaSegs; ds; ds = ds->subnext)
+         ++count;
+   }
+
+   return count;
+}
+
 //
-rpolybsp_t *R_BuildDynaBSP(const subsector_t *subsec)
+// Frees the tree's nodes and the dynasegs made by its splits, and puts back
+// the polyobject dynasegs it altered. Not safe to run concurrently.
+//
+static void R_clearDynaBSP(rpolybsp_t *bsp)
+{
+   R_freeTreeRecursive(bsp->root);
+   R_freePolyNodeBlocks(bsp);
+   bsp->root = nullptr;
+}
+
+//
+// Builds one queued tree. Run by R_RunContextJobs.
+//
+static void R_buildDynaBSPJob(int index)
+{
+   const dynabspjob_t &job = dynaBSPJobs[index];
+   rpolybsp_t *bsp  = job.subsec->bsp;
+   dseglist_t  segs = nullptr;
+
+   // Every dynaseg, including any made by splits, partitions exactly one node,
+   // so the first block fits the whole tree unless something gets split.
+   R_newPolyNodeBlock(bsp, job.numsegs);
+
+   if(R_collapseFragmentsToDSList(job.subsec, &segs))
+      bsp->root = R_createNode(bsp, &segs);
+}
+
+//
+// Queues a subsector's dynamic BSP to be rebuilt before the next frame,
+// giving it one if it has none yet. Call when its fragments change.
+//
+void R_MarkDynaBSPDirty(subsector_t *subsec)
+{
+   if(!subsec->bsp)
+      subsec->bsp = estructalloctag(rpolybsp_t, 1, PU_LEVEL);
+   else if(subsec->bsp->dirty)
+      return;
+
+   subsec->bsp->dirty = true;
+   dirtySubsecs.add(subsec);
+}
+
+//
+// Rebuilds every queued dynamic BSP. Old trees are freed here, where it is
+// safe to do so; the new ones are built concurrently, largest first.
+//
+void R_UpdateDynaBSPs()
 {
-   rpolybsp_t *bsp = nullptr;
-   dseglist_t segs = nullptr;
+   if(dirtySubsecs.isEmpty())
+      return;
+
+   dynaBSPJobs.makeEmpty();
 
-   if(R_collapseFragmentsToDSList(subsec, &segs))
+   for(subsector_t *subsec : dirtySubsecs)
    {
-      bsp = estructalloctag(rpolybsp_t, 1, PU_LEVEL);
+      rpolybsp_t *bsp = subsec->bsp;
+
+      R_clearDynaBSP(bsp);
       bsp->dirty = false;
-      bsp->root = R_createNode(&segs);
+
+      const int numsegs = R_countFragmentSegs(subsec);
+      if(!numsegs)
+      {
+         efree(bsp);
+         subsec->bsp = nullptr;
+         continue;
+      }
+
+      dynaBSPJobs.add({ subsec, numsegs });
    }
+   dirtySubsecs.makeEmpty();
+
+   std::sort(dynaBSPJobs.begin(), dynaBSPJobs.end(),
+             [](const dynabspjob_t &a, const dynabspjob_t &b) { return a.numsegs > b.numsegs; });
 
-   return bsp;
+   R_RunContextJobs(static_cast<int>(dynaBSPJobs.getLength()), R_buildDynaBSPJob);
 }
 
 //
-// R_FreeDynaBSP
-//
-// Return all resources owned by a dynamic BSP tree.
+// Frees every subsector's dynamic BSP. Call at the end of a level, after the
+// polyobjects have been detached.
 //
-void R_FreeDynaBSP(rpolybsp_t *bsp)
+void R_ClearDynaBSPs()
 {
-   R_freeTreeRecursive(bsp->root);
-   efree(bsp);
+   for(int i = 0; i < numsubsectors; i++)
+   {
+      if(rpolybsp_t *bsp = subsectors[i].bsp)
+      {
+         R_clearDynaBSP(bsp);
+         efree(bsp);
+         subsectors[i].bsp = nullptr;
+      }
+   }
+
+   dirtySubsecs.makeEmpty();
 }
 
 // EOF
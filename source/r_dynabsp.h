@@ -36,14 +36,18 @@ struct rpolynode_t
    dseglink_t  *altered;     // polyobject-owned segs altered by partitions.
 };
 
+struct rpolynodeblock_t;
+
 struct rpolybsp_t
 {
-   bool         dirty; // needs to be rebuilt if true
-   rpolynode_t *root;  // root of tree
+   bool              dirty;  // needs to be rebuilt if true
+   rpolynode_t      *root;   // root of tree
+   rpolynodeblock_t *blocks; // pooled storage of the tree's nodes
 };
 
-rpolybsp_t *R_BuildDynaBSP(const subsector_t *subsec);
-void R_FreeDynaBSP(rpolybsp_t *bsp);
+void R_MarkDynaBSPDirty(subsector_t *subsec);
+void R_UpdateDynaBSPs();
+void R_ClearDynaBSPs();
 
 
 //
@@ -0,0 +1,267 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Dynamic resolution. Renders the 3D view into a smaller buffer
+//  whose size follows recent frame times, then scales it up into the view
+//  window before the HUD is drawn.
+//
+// Authors: agent
+//
+
+#include <math.h>
+
+#include "z_zone.h"
+
+#include "c_io.h"
+#include "c_runcmd.h"
+#include "d_bench.h"
+#include "m_compare.h"
+#include "r_draw.h"
+#include "r_dynres.h"
+#include "r_main.h"
+#include "v_alloc.h"
+#include "v_misc.h"
+
+bool r_dynres;
+int  r_dynresfps = 60;
+int  r_dynresmin = 50;
+int  r_dynresmax = 100;
+
+// Frames to wait after a change before the average is trusted again
+static constexpr int DYNRES_COOLDOWN = 15;
+
+// Samples longer than this are loading or a stall, not rendering
+static constexpr int64_t DYNRES_MAXSAMPLE = 250000000;
+
+static int     dynscale = 100;  // current scale, in percent
+static bool    dynactive;       // the view is rendering into dynbuffer
+static bool    dynviewdrawn;    // a view was drawn this frame
+static double  dynavgns;        // moving average of render time
+static int     dyncooldown;
+static int64_t dynframestart;
+
+static rrect_t shownwindow;     // where the view ends up on screen
+
+static byte *dynbuffer;
+static int   dynpitch;
+static int  *dynxmap;           // screen column -> buffer column
+static int  *dynymap;           // screen row -> buffer row
+static int   dynmaxwidth;
+static int   dynmaxheight;
+
+VALLOCATION(dynbuffer)
+{
+   // allocated on first use, since most sessions never turn this on
+   dynbuffer    = nullptr;
+   dynxmap      = nullptr;
+   dynymap      = nullptr;
+   dynpitch     = h;
+   dynmaxwidth  = w;
+   dynmaxheight = h;
+}
+
+//
+// Picks the view window to render into. Called from R_SetupViewScaling once
+// viewwindow and the render buffer are set up for the real view size; when
+// scaled, both are redirected at dynbuffer.
+//
+void R_DynResSetupView()
+{
+   shownwindow = viewwindow;
+   dynactive   = false;
+
+   if(!r_dynres)
+      dynscale = 100;
+   if(dynscale >= 100)
+      return;
+
+   if(!dynbuffer)
+   {
+      dynbuffer = emalloctag(byte *, dynmaxwidth * dynmaxheight, PU_VALLOC, nullptr);
+      dynxmap   = emalloctag(int *, dynmaxwidth  * sizeof(int), PU_VALLOC, nullptr);
+      dynymap   = emalloctag(int *, dynmaxheight * sizeof(int), PU_VALLOC, nullptr);
+   }
+
+   const int width  = emax(shownwindow.width  * dynscale / 100, 1);
+   const int height = emax(shownwindow.height * dynscale / 100, 1);
+
+   // sample from the middle of each screen pixel
+   for(int x = 0; x < shownwindow.width; x++)
+      dynxmap[x] = (2 * x + 1) * width / (2 * shownwindow.width);
+   for(int y = 0; y < shownwindow.height; y++)
+      dynymap[y] = (2 * y + 1) * height / (2 * shownwindow.height);
+
+   viewwindow.x      = 0;
+   viewwindow.y      = 0;
+   viewwindow.width  = width;
+   viewwindow.height = height;
+
+   renderscreen = dynbuffer;
+   linesize     = dynpitch;
+   dynactive    = true;
+}
+
+//
+// The view window as it appears on screen, whatever size it renders at
+//
+const rrect_t &R_DynResShownWindow()
+{
+   return shownwindow;
+}
+
+//
+// Scales the rendered view up into the screen. Nearest neighbour, since the
+// screen is paletted; columns that repeat the previous source column are
+// copied from the screen rather than resampled.
+//
+void R_DynResBlit()
+{
+   dynviewdrawn = true;
+
+   if(!dynactive)
+      return;
+
+   byte *dest = video.screens[0] + shownwindow.x * video.pitch + shownwindow.y;
+
+   for(int x = 0; x < shownwindow.width; x++, dest += video.pitch)
+   {
+      if(x && dynxmap[x] == dynxmap[x - 1])
+      {
+         memcpy(dest, dest - video.pitch, shownwindow.height);
+         continue;
+      }
+
+      const byte *source = dynbuffer + dynxmap[x] * dynpitch;
+      for(int y = 0; y < shownwindow.height; y++)
+         dest[y] = source[dynymap[y]];
+   }
+}
+
+//
+// Called at the start of D_Display
+//
+void R_DynResBeginFrame()
+{
+   dynviewdrawn  = false;
+   dynframestart = D_BenchNow();
+}
+
+//
+// Called at the end of D_Display, before the frame is handed to the video
+// driver. Folds this frame's time into the average and resizes the view when
+// it drifts away from the target. Presentation is left out, since it waits on
+// vsync and doesn't shrink with the view.
+//
+void R_DynResEndFrame()
+{
+   if(!r_dynres || !dynviewdrawn)
+      return;
+
+   const int64_t ns = D_BenchNow() - dynframestart;
+   if(ns > DYNRES_MAXSAMPLE)
+      return;
+
+   dynavgns = dynavgns ? dynavgns * 0.9 + ns * 0.1 : double(ns);
+
+   if(dyncooldown > 0)
+   {
+      --dyncooldown;
+      return;
+   }
+
+   // time scales with pixel count, so step the sides by the square root
+   const double target = 1000000000.0 / r_dynresfps;
+   double factor;
+
+   if(dynavgns > target)
+      factor = eclamp(sqrt(target * 0.95 / dynavgns), 0.8, 0.98);
+   else if(dynavgns < target * 0.75)
+      factor = eclamp(sqrt(target * 0.9 / dynavgns), 1.02, 1.1);
+   else
+      return;
+
+   const int minscale = emin(r_dynresmin, r_dynresmax);
+   int newscale = int(dynscale * factor + 0.5);
+
+   newscale = eclamp(newscale, minscale, r_dynresmax);
+   if(newscale == dynscale)
+      return;
+
+   dynscale      = newscale;
+   dyncooldown   = DYNRES_COOLDOWN;
+   setsizeneeded = true;
+}
+
+//=============================================================================
+//
+// Console Variables and Commands
+//
+
+VARIABLE_TOGGLE(r_dynres,    nullptr,         onoff);
+VARIABLE_INT(r_dynresfps,    nullptr, 10, 500, nullptr);
+VARIABLE_INT(r_dynresmin,    nullptr, 25, 100, nullptr);
+VARIABLE_INT(r_dynresmax,    nullptr, 25, 100, nullptr);
+
+CONSOLE_VARIABLE(r_dynres, r_dynres, 0)
+{
+   dynscale      = r_dynres ? r_dynresmax : 100;
+   dynavgns      = 0;
+   dyncooldown   = DYNRES_COOLDOWN;
+   setsizeneeded = true;
+}
+
+CONSOLE_VARIABLE(r_dynresfps, r_dynresfps, 0) {}
+
+CONSOLE_VARIABLE(r_dynresmin, r_dynresmin, 0)
+{
+   if(r_dynres && dynscale < r_dynresmin)
+   {
+      dynscale      = emin(r_dynresmin, r_dynresmax);
+      setsizeneeded = true;
+   }
+}
+
+CONSOLE_VARIABLE(r_dynresmax, r_dynresmax, 0)
+{
+   if(r_dynres && dynscale > r_dynresmax)
+   {
+      dynscale      = r_dynresmax;
+      setsizeneeded = true;
+   }
+}
+
+CONSOLE_COMMAND(r_dynresinfo, 0)
+{
+   if(!r_dynres)
+   {
+      C_Printf("Dynamic resolution is off\n");
+      return;
+   }
+
+   C_Printf(FC_HI "Dynamic resolution\n"
+            FC_NORMAL "scale: %d%%\n"
+            "view: %dx%d of %dx%d\n"
+            "frame: %.2f ms, target %.2f ms\n",
+            dynscale, viewwindow.width, viewwindow.height,
+            shownwindow.width, shownwindow.height,
+            dynavgns / 1000000.0, 1000.0 / r_dynresfps);
+}
+
+// EOF
+
@@ -0,0 +1,46 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Dynamic resolution. Renders the 3D view into a smaller buffer
+//  whose size follows recent frame times, then scales it up into the view
+//  window before the HUD is drawn.
+//
+// Authors: agent
+//
+
+#ifndef R_DYNRES_H__
+#define R_DYNRES_H__
+
+struct rrect_t;
+
+extern bool r_dynres;    // scale the view to hold r_dynresfps
+extern int  r_dynresfps; // target frame rate
+extern int  r_dynresmin; // smallest scale, in percent of the view window
+extern int  r_dynresmax; // largest scale, in percent of the view window
+
+void R_DynResSetupView();
+const rrect_t &R_DynResShownWindow();
+void R_DynResBlit();
+void R_DynResBeginFrame();
+void R_DynResEndFrame();
+
+#endif
+
+// EOF
+
@@ -94,9 +94,8 @@ static void R_AddDynaSubsec(subsector_t *ss, polyobj_t *po)
 {
    int i;
 
-   // If the subsector has a BSP tree, it will need to be rebuilt.
-   if(ss->bsp)
-      ss->bsp->dirty = true;
+   // Its BSP tree will need to be rebuilt.
+   R_MarkDynaBSPDirty(ss);
 
    // make sure subsector is not already tracked
    for(i = 0; i < po->numDSS; ++i)
@@ -794,8 +793,7 @@ void R_DetachPolyObject(polyobj_t *poly)
       DLListItem<rpolyobj_t> *next;
 
       // mark BSPs dirty
-      if(ss->bsp)
-         ss->bsp->dirty = true;
+      R_MarkDynaBSPDirty(ss);
       
       // iterate on subsector rpolyobj_t lists
       while(link)
@@ -855,11 +853,7 @@ void R_ClearDynaSegs()
    for(i = 0; i < numPolyObjects; i++)
       R_DetachPolyObject(&PolyObjects[i]);
 
-   for(i = 0; i < numsubsectors; i++)
-   {
-      if(subsectors[i].bsp)
-         R_FreeDynaBSP(subsectors[i].bsp);
-   }
+   R_ClearDynaBSPs();
 }
 
 // EOF
@@ -29,6 +29,7 @@
 
 #include "c_io.h"
 #include "c_runcmd.h"
+#include "d_bench.h"
 #include "d_deh.h"
 #include "d_dehtbl.h"
 #include "d_gi.h"
@@ -48,16 +49,20 @@
 #include "p_partcl.h"
 #include "p_portal.h"
 #include "p_scroll.h"
+#include "p_sector.h"
 #include "p_xenemy.h"
 #include "r_bsp.h"
 #include "r_context.h"
 #include "r_draw.h"
+#include "r_dynabsp.h"
+#include "r_dynres.h"
 #include "r_dynseg.h"
 #include "r_interpolate.h"
 #include "r_main.h"
 #include "r_plane.h"
 #include "r_portal.h"
 #include "r_ripple.h"
+#include "r_simd.h"
 #include "r_things.h"
 #include "r_sky.h"
 #include "r_state.h"
@@ -148,16 +153,21 @@ static columndrawer_t *r_column_engines[NUMCOLUMNENGINES] =
 {
    &r_normal_drawer, // normal engine
    // Here lies Quad Cache Engine: 2006/09/04 - 2020/10/31
+   &r_simd_drawer,   // SIMD engine
 };
 
 //
 // R_SetColumnEngine
 //
 // Sets r_column_engine to the appropriate set of column drawers.
+// The SIMD engine falls back to the normal one if this CPU can't run it.
 //
 void R_SetColumnEngine()
 {
-   r_column_engine = r_column_engines[r_column_engine_num];
+   if(r_column_engine_num == COLUMNENGINE_SIMD && !R_SIMDAvailable())
+      r_column_engine = &r_normal_drawer;
+   else
+      r_column_engine = r_column_engines[r_column_engine_num];
 }
 
 // haleyjd 09/10/06: span drawing engines
@@ -166,17 +176,22 @@ int r_span_engine_num;
 
 static spandrawer_t *r_span_engines[NUMSPANENGINES] =
 {
-   &r_spandrawer,    // normal engine
+   &r_spandrawer,     // normal engine
+   &r_simdspandrawer, // SIMD engine
 };
 
 //
 // R_SetSpanEngine
 //
 // Sets r_span_engine to the appropriate set of span drawers.
+// The SIMD engine falls back to the normal one if this CPU can't run it.
 //
 void R_SetSpanEngine(void)
 {
-   r_span_engine = r_span_engines[r_span_engine_num];
+   if(r_span_engine_num == SPANENGINE_SIMD && !R_SIMDAvailable())
+      r_span_engine = &r_spandrawer;
+   else
+      r_span_engine = r_span_engines[r_span_engine_num];
 }
 
 //
@@ -449,7 +464,9 @@ static void R_InitTextureMapping()
 
    // SoM: Thanks to 'Randi' of Zdoom fame!
    slopet = (float)tan((90.0f + (float)fov / 2.0f) * PI / 180.0f);
-   slopevis = 8.0f * slopet * 16.0f * 320.0f / (float)view.width; // THREAD_FIXME: context.fendcolumn?
+   // This is scaled by the whole view and not a context's columns, as slope
+   // lighting must match across context boundaries.
+   slopevis = 8.0f * slopet * 16.0f * 320.0f / (float)view.width;
 
    // SoM: rewrote old LUT generation code to work with variable FOV
    i = 0;
@@ -625,6 +642,11 @@ void R_SetupViewScaling()
    // haleyjd 05/02/13: set viewwindow properties
    viewwindow.viewFromScaled(setblocks, video.width, video.height, scaledwindow);
 
+   R_InitBuffer(scaledwindow.width, scaledwindow.height);       // killough 11/98
+
+   // may shrink viewwindow and point the render buffer elsewhere
+   R_DynResSetupView();
+
    centerx     = viewwindow.width  / 2;
    centery     = viewwindow.height / 2;
    centerxfrac = centerx << FRACBITS;
@@ -634,7 +656,6 @@ void R_SetupViewScaling()
    view.xcenter = (view.width  = (float)viewwindow.width ) * 0.5f;
    view.ycenter = (view.height = (float)viewwindow.height) * 0.5f;
 
-   R_InitBuffer(scaledwindow.width, scaledwindow.height);       // killough 11/98
    R_UpdateContextBounds();
 }
 
@@ -655,9 +676,11 @@ static void R_calculateVisSpriteScales()
         (video.width == 640 && video.height == 400)))
       realxscale = ((float)video.height * 4 / 3) / SCREENWIDTH;
 
-   // determine subwindow scaling for smaller screen sizes
-   float swxscale = 1.0f;
-   float swyscale = 1.0f;
+   // determine subwindow scaling for smaller screen sizes, and for a view
+   // that is rendering below its on-screen size
+   const rrect_t &shown = R_DynResShownWindow();
+   float swxscale = (float)viewwindow.width  / shown.width;
+   float swyscale = (float)viewwindow.height / shown.height;
    if(setblocks < 10)
    {
       float sbheight = GameModeInfo->StatusBar->height * video.yscalef;
@@ -765,8 +788,10 @@ static void R_incrementFrameid()
       frameid = 1;
 
       // Do as the description says...
-      for(int i = 0; i < numsectors; ++i)
-         pSectorBoxes[i].visitid.floor = pSectorBoxes[i].visitid.ceiling = 0;
+      R_ForEachContext([](rendercontext_t &context) {
+         if(context.portalcontext.sectorvisitids)
+            memset(context.portalcontext.sectorvisitids, 0, sizeof(Surfaces<uint64_t>) * numsectors);
+      });
    }
 }
 
@@ -890,15 +915,14 @@ enum secinterpstate_e
 //
 static void R_setSectorInterpolationState(secinterpstate_e state)
 {
-   int i;
-
+   // Only sectors moved since the last tic began can differ from their
+   // previous heights, so the rest are left alone.
    switch(state)
    {
    case SEC_INTERPOLATE:
-      for(i = 0; i < numsectors; i++)
-      {
-         auto &si  = sectorinterps[i];
-         auto &sec = sectors[i];
+      P_ForEachMovedSector([](sector_t *sector) {
+         auto &si  = sectorinterps[sector - sectors];
+         auto &sec = *sector;
 
          if(si.prevfloorheight   != sec.srf.floor.height ||
             si.prevceilingheight != sec.srf.ceiling.height)
@@ -919,13 +943,12 @@ static void R_setSectorInterpolationState(secinterpstate_e state)
          }
          else
             si.interpolated = false;
-      }
+      });
       break;
    case SEC_NORMAL:
-      for(i = 0; i < numsectors; i++)
-      {
-         auto &si  = sectorinterps[i];
-         auto &sec = sectors[i];
+      P_ForEachMovedSector([](sector_t *sector) {
+         auto &si  = sectorinterps[sector - sectors];
+         auto &sec = *sector;
 
          // restore backed up heights
          if(si.interpolated)
@@ -934,8 +957,9 @@ static void R_setSectorInterpolationState(secinterpstate_e state)
             sec.srf.floor.heightf = si.backfloorheightf;
             sec.srf.ceiling.height = si.backceilingheight;
             sec.srf.ceiling.heightf = si.backceilingheightf;
+            si.interpolated = false;
          }
-      }
+      });
       break;
    }
 }
@@ -1247,30 +1271,38 @@ void R_RenderViewContext(rendercontext_t &context)
    // check for new console commands.
    //NetUpdate();
 
-   // The head node is the last node output.
-   R_RenderBSPNode(context, numnodes - 1);
+   {
+      BenchScope bench(BENCH_BSP);
 
-   // Check for new console commands.
-   //NetUpdate();
+      // The head node is the last node output.
+      R_RenderBSPNode(context, numnodes - 1);
 
-   R_SetMaskedSilhouette(context.bounds, nullptr, nullptr);
+      // Check for new console commands.
+      //NetUpdate();
 
-   // Push the first element on the Post-BSP stack
-   R_PushPost(context.bspcontext, context.spritecontext, context.bounds, true, nullptr);
+      R_SetMaskedSilhouette(context.bounds, nullptr, nullptr);
 
-   // SoM 12/9/03: render the portals.
-   R_RenderPortals(context);
+      // Push the first element on the Post-BSP stack
+      R_PushPost(context.bspcontext, context.spritecontext, context.bounds, true, nullptr);
 
-   R_DrawPlanes(
-      context.cmapcontext, context.planecontext.mainhash,
-      context.planecontext.spanstart, context.view.angle, nullptr
-   );
+      // SoM 12/9/03: render the portals.
+      R_RenderPortals(context);
+   }
+
+   {
+      BenchScope bench(BENCH_PLANES);
+      R_DrawPlanes(
+         context.cmapcontext, context.planecontext.mainhash,
+         context.planecontext.spanstart, context.view.angle, nullptr
+      );
+   }
 
    // Check for new console commands.
    //NetUpdate();
 
    // Draw Post-BSP elements such as sprites, masked textures, and portal
    // overlays
+   BenchScope bench(BENCH_MASKED);
    R_DrawPostBSP(context);
 }
 
@@ -1284,6 +1316,7 @@ extern void R_UntaintPortals();
 //
 void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
 {
+   BenchScope bench(BENCH_RENDER);
    bool quake = false;
    unsigned int savedflags = 0;
 
@@ -1306,9 +1339,16 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
    else
       player->mo->intflags &= ~MIF_HIDDENBYQUAKE;  // zero it otherwise
 
+   // rebuild polyobject BSPs invalidated since the last frame, so that the
+   // contexts only have to read them
+   R_UpdateDynaBSPs();
+
    // We don't need to multithread if we only have one context
    if(r_numcontexts == 1)
+   {
+      I_PresentPendingFrame();
       R_RenderViewContext(r_globalcontext);
+   }
    else
       R_RunContexts();
 
@@ -1321,6 +1361,8 @@ void R_RenderPlayerView(player_t* player, camera_t *camerapoint)
    if(r_column_engine->ResetBuffer)
       r_column_engine->ResetBuffer();
 
+   R_DynResBlit();
+
    if(quake)
       player->mo->flags2 = savedflags;
 
@@ -1348,9 +1390,9 @@ void R_HOMdrawer()
    
    colour = !flashing_hom || (gametic % 20) < 9 ? 0xb0 : 0;
 
-   V_ColorBlock(&vbscreen, (byte)colour, viewwindow.x, viewwindow.y, 
-                viewwindow.width,
-                viewwindow.height);
+   // the view may be rendering somewhere other than vbscreen
+   for(int x = 0; x < viewwindow.width; x++)
+      memset(R_ADDRESS(x, 0), colour, viewwindow.height);
 }
 
 //
@@ -1506,8 +1548,8 @@ void R_DoomTLStyle()
 
 static const char *handedstr[]  = { "right", "left" };
 static const char *ptranstr[]   = { "none", "smooth", "general" };
-static const char *coleng[]     = { "normal" };
-static const char *spaneng[]    = { "highprecision" };
+static const char *coleng[]     = { "normal", "simd" };
+static const char *spaneng[]    = { "highprecision", "simd" };
 static const char *tlstylestr[] = { "opaque", "boom", "additive" };
 
 VARIABLE_BOOLEAN(lefthanded, nullptr,               handedstr);
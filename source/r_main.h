@@ -137,8 +137,20 @@ angle_t R_WadToAngle(int wadangle);
 
 extern int viewdir;
 
-#define NUMCOLUMNENGINES 1
-#define NUMSPANENGINES 1
+enum
+{
+   COLUMNENGINE_NORMAL,
+   COLUMNENGINE_SIMD,
+   NUMCOLUMNENGINES
+};
+
+enum
+{
+   SPANENGINE_NORMAL,
+   SPANENGINE_SIMD,
+   NUMSPANENGINES
+};
+
 extern int r_column_engine_num;
 extern int r_span_engine_num;
 extern columndrawer_t *r_column_engine;
@@ -523,8 +523,10 @@ static void R_calculateTransform(int markerlinenum, int anchorlinenum,
 //
 // See r_main.cpp's R_incrementFrameid to see why this exists
 //
-static void R_incrementRenderDepth(uint16_t &renderdepth)
+static void R_incrementRenderDepth(portalcontext_t &portalcontext)
 {
+   uint16_t &renderdepth = portalcontext.renderdepth;
+
    renderdepth++;
 
    if(!renderdepth)
@@ -538,8 +540,7 @@ static void R_incrementRenderDepth(uint16_t &renderdepth)
       renderdepth = 1;
 
       // Do as the description says...
-      for(int i = 0; i < numsectors; ++i)
-         pSectorBoxes[i].visitid.floor = pSectorBoxes[i].visitid.ceiling = 0;
+      memset(portalcontext.sectorvisitids, 0, sizeof(Surfaces<uint64_t>) * numsectors);
    }
 }
 
@@ -1041,7 +1042,7 @@ static void R_renderSkyboxPortal(rendercontext_t &context, pwindow_t *window)
    cb_viewpoint.sin   = (float)sin(cb_viewpoint.angle);
    cb_viewpoint.cos   = (float)cos(cb_viewpoint.angle);
 
-   R_incrementRenderDepth(portalcontext.renderdepth);
+   R_incrementRenderDepth(portalcontext);
    R_RenderBSPNode(context, numnodes - 1);
 
    // Only push the overlay if this is the head window
@@ -1247,7 +1248,7 @@ static void R_renderAnchoredPortal(rendercontext_t &context, pwindow_t *window)
    cb_viewpoint.sin   = sinf(cb_viewpoint.angle);
    cb_viewpoint.cos   = cosf(cb_viewpoint.angle);
 
-   R_incrementRenderDepth(portalcontext.renderdepth);
+   R_incrementRenderDepth(portalcontext);
    R_RenderBSPNode(context, numnodes - 1);
 
    // Only push the overlay if this is the head window
@@ -1365,7 +1366,7 @@ static void R_renderLinkedPortal(rendercontext_t &context, pwindow_t *window)
       cb_viewpoint.cos = cosf(cb_viewpoint.angle);
    }
 
-   R_incrementRenderDepth(portalcontext.renderdepth);
+   R_incrementRenderDepth(portalcontext);
    R_RenderBSPNode(context, numnodes - 1);
 
    // Only push the overlay if this is the head window
@@ -0,0 +1,124 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Thin wrapper over 4 x 32-bit integer vectors, used by the SIMD
+//  column and span drawers. Only integer ops that give bit-identical results
+//  to the scalar drawers are exposed.
+//
+// Authors: agent
+//
+
+#ifndef R_SIMD_H__
+#define R_SIMD_H__
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define R_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define R_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(R_SIMD_SSE2) || defined(R_SIMD_NEON)
+#define R_SIMD
+
+#include <stdint.h>
+
+#if defined(R_SIMD_SSE2)
+using simd4u_t = __m128i;
+
+inline simd4u_t SIMD_Splat(uint32_t a)  { return _mm_set1_epi32(int(a)); }
+inline simd4u_t SIMD_Set(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+   return _mm_setr_epi32(int(a), int(b), int(c), int(d));
+}
+inline simd4u_t SIMD_Add(simd4u_t a, simd4u_t b) { return _mm_add_epi32(a, b); }
+inline simd4u_t SIMD_Sub(simd4u_t a, simd4u_t b) { return _mm_sub_epi32(a, b); }
+inline simd4u_t SIMD_And(simd4u_t a, simd4u_t b) { return _mm_and_si128(a, b); }
+inline simd4u_t SIMD_Or (simd4u_t a, simd4u_t b) { return _mm_or_si128(a, b);  }
+
+// Logical shifts by a count that's only known at runtime
+inline simd4u_t SIMD_ShiftRight(simd4u_t a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+inline simd4u_t SIMD_ShiftLeft (simd4u_t a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+
+inline void SIMD_Store(uint32_t *dest, simd4u_t a)
+{
+   _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), a);
+}
+#else
+using simd4u_t = uint32x4_t;
+
+inline simd4u_t SIMD_Splat(uint32_t a)  { return vdupq_n_u32(a); }
+inline simd4u_t SIMD_Set(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+   const uint32_t values[4] = { a, b, c, d };
+   return vld1q_u32(values);
+}
+inline simd4u_t SIMD_Add(simd4u_t a, simd4u_t b) { return vaddq_u32(a, b); }
+inline simd4u_t SIMD_Sub(simd4u_t a, simd4u_t b) { return vsubq_u32(a, b); }
+inline simd4u_t SIMD_And(simd4u_t a, simd4u_t b) { return vandq_u32(a, b); }
+inline simd4u_t SIMD_Or (simd4u_t a, simd4u_t b) { return vorrq_u32(a, b); }
+
+// NEON shifts right when given a negative left shift count
+inline simd4u_t SIMD_ShiftRight(simd4u_t a, int n) { return vshlq_u32(a, vdupq_n_s32(-n)); }
+inline simd4u_t SIMD_ShiftLeft (simd4u_t a, int n) { return vshlq_u32(a, vdupq_n_s32(n));  }
+
+inline void SIMD_Store(uint32_t *dest, simd4u_t a) { vst1q_u32(dest, a); }
+#endif
+
+//
+// Vector of start, start + step, start + 2 * step, start + 3 * step,
+// wrapping the same way 32-bit unsigned scalar arithmetic does.
+//
+inline simd4u_t SIMD_Ramp(uint32_t start, uint32_t step)
+{
+   return SIMD_Set(start, start + step, start + step * 2, start + step * 3);
+}
+
+//
+// The saturating RGB32k blend shared by the additive drawers. Returns the
+// RGB32k index for each lane.
+//
+inline simd4u_t SIMD_AddBlend(simd4u_t a)
+{
+   simd4u_t b = SIMD_And(a, SIMD_Splat(0x40100400));
+   a = SIMD_Or(a, SIMD_Splat(0x01f07c1f));
+   a = SIMD_And(a, SIMD_Splat(0x3fffffff));
+   b = SIMD_Sub(b, SIMD_ShiftRight(b, 5));
+   a = SIMD_Or(a, b);
+   return SIMD_And(a, SIMD_ShiftRight(a, 15));
+}
+
+//
+// The RGB32k blend shared by the translucent drawers
+//
+inline simd4u_t SIMD_TLBlend(simd4u_t t)
+{
+   t = SIMD_Or(t, SIMD_Splat(0x01f07c1f));
+   return SIMD_And(t, SIMD_ShiftRight(t, 15));
+}
+
+#endif
+
+// Returns true if the SIMD drawers were built and can run on this CPU
+bool R_SIMDAvailable();
+
+#endif
+
+// EOF
@@ -0,0 +1,456 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: On-disk cache of composited wall textures, so they needn't be
+//  built from their patches again on the next launch.
+//
+//  The cache is keyed by a SHA1 over every texture definition together with
+//  the size and CRC32 of each lump it is built from. Zip lumps have their
+//  CRC32 in the zip directory and mapped wad lumps are checksummed in place,
+//  so validating the cache doesn't load any patches. If anything differs,
+//  the whole cache is rebuilt.
+//
+// Authors: agent
+//
+
+#include "z_zone.h"
+#include "i_system.h"
+
+#include "d_main.h"
+#include "doomstat.h"
+#include "hal/i_filemap.h"
+#include "m_argv.h"
+#include "m_buffer.h"
+#include "m_hash.h"
+#include "m_qstr.h"
+#include "r_data.h"
+#include "r_texcache.h"
+#include "w_wad.h"
+
+#define TEXCACHE_FILENAME "texcache.bin"
+#define TEXCACHE_MAGIC    "EETX"
+#define TEXCACHE_VERSION  2
+
+static uint32_t texcachekey[5];
+static bool     texcachekeyvalid;
+
+//
+// Path of the cache file in the user game directory
+//
+static qstring R_textureCachePath()
+{
+   qstring path(usergamepath);
+   path.pathConcatenate(TEXCACHE_FILENAME);
+   return path;
+}
+
+//
+// Number of bytes in a finished texture's linear buffer, not counting the
+// leading pad. Masked textures have their alpha mask appended to it.
+//
+static size_t R_textureDataSize(const texture_t *tex)
+{
+   const size_t size = size_t(tex->width) * tex->height;
+   return size + 4 + ((tex->flags & TF_MASKED) ? (size + 7) / 8 : 0);
+}
+
+//
+// Only textures built from components are cached. The rest are made up at
+// startup and cost nothing to make again.
+//
+static bool R_isCachedTexture(const texture_t *tex)
+{
+   return tex && tex->ccount > 0;
+}
+
+//
+// Hashes everything a composited texture depends on
+//
+static void R_computeTextureCacheKey(int start, int stop)
+{
+   const int numlumps = wGlobalDir.getNumLumps();
+
+   // patches are shared between many textures; checksum each only once
+   auto lumpcrcs = ecalloc(uint32_t *, numlumps, sizeof(uint32_t));
+   auto havecrcs = ecalloc(bool *,     numlumps, sizeof(bool));
+
+   HashData hash(HashData::SHA1);
+
+   auto addInt = [&hash](int32_t value) {
+      uint8_t bytes[4] = { uint8_t(value), uint8_t(value >> 8), uint8_t(value >> 16),
+                           uint8_t(value >> 24) };
+      hash.addData(bytes, 4);
+   };
+
+   addInt(TEXCACHE_VERSION);
+   addInt(stop - start);
+
+   // PNG patches are matched to the palette as they're loaded, so it goes
+   // into every texture that has one
+   const int playpal = wGlobalDir.checkNumForName("PLAYPAL");
+   if(playpal >= 0)
+   {
+      addInt(wGlobalDir.lumpLength(playpal));
+      addInt(int32_t(W_LumpCheckSum(playpal)));
+   }
+   else
+      addInt(-1);
+
+   for(int i = start; i < stop; i++)
+   {
+      const texture_t *tex = textures[i];
+
+      if(!R_isCachedTexture(tex))
+      {
+         addInt(-1);
+         continue;
+      }
+
+      hash.addData(reinterpret_cast<const uint8_t *>(tex->namebuf), 8);
+      addInt(tex->width);
+      addInt(tex->height);
+      addInt(int32_t(tex->flags));
+      addInt(tex->ccount);
+
+      for(int c = 0; c < tex->ccount; c++)
+      {
+         const tcomponent_t &component = tex->components[c];
+
+         addInt(component.originx);
+         addInt(component.originy);
+         addInt(int32_t(component.width));
+         addInt(int32_t(component.height));
+         addInt(component.type);
+
+         if(component.lump < 0 || component.lump >= numlumps)
+         {
+            addInt(-1);
+            continue;
+         }
+
+         if(!havecrcs[component.lump])
+         {
+            lumpcrcs[component.lump] = W_LumpCheckSum(component.lump);
+            havecrcs[component.lump] = true;
+         }
+         addInt(wGlobalDir.lumpLength(component.lump));
+         addInt(int32_t(lumpcrcs[component.lump]));
+      }
+   }
+
+   hash.wrapUp();
+
+   for(int i = 0; i < 5; i++)
+      texcachekey[i] = hash.getDigestPart(i);
+   texcachekeyvalid = true;
+
+   efree(lumpcrcs);
+   efree(havecrcs);
+}
+
+//=============================================================================
+//
+// Loading
+//
+
+//
+// Bounds-checked little-endian reader over the mapped cache file
+//
+class TexCacheReader
+{
+   const byte *data;
+   size_t      size;
+   size_t      pos;
+
+public:
+   TexCacheReader(const byte *inData, size_t inSize) : data(inData), size(inSize), pos(0) {}
+
+   bool has(size_t len) const { return len <= size - pos; }
+
+   const byte *bytes(size_t len)
+   {
+      if(!has(len))
+         return nullptr;
+      const byte *ret = data + pos;
+      pos += len;
+      return ret;
+   }
+
+   bool readUint32(uint32_t &num)
+   {
+      const byte *b = bytes(4);
+      if(!b)
+         return false;
+      num = uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+      return true;
+   }
+
+   bool readUint16(uint16_t &num)
+   {
+      const byte *b = bytes(2);
+      if(!b)
+         return false;
+      num = uint16_t(b[0] | b[1] << 8);
+      return true;
+   }
+};
+
+//
+// Reads one texture's buffer and columns. Returns false if the record is
+// damaged or doesn't fit the texture.
+//
+static bool R_loadCachedTexture(TexCacheReader &reader, texture_t *tex)
+{
+   const byte *name;
+   uint16_t    width, height, masked;
+   uint32_t    datasize;
+
+   if(!(name = reader.bytes(8)) || !reader.readUint16(width) ||
+      !reader.readUint16(height) || !reader.readUint16(masked) ||
+      !reader.readUint32(datasize))
+      return false;
+
+   if(memcmp(name, tex->namebuf, 8) || width != tex->width || height != tex->height)
+      return false;
+
+   const uint32_t oldflags = tex->flags;
+   if(masked)
+      tex->flags |= TF_MASKED;
+
+   const byte *data;
+   if(datasize != R_textureDataSize(tex) || !(data = reader.bytes(datasize)))
+   {
+      tex->flags = oldflags;
+      return false;
+   }
+
+   // read the columns before allocating anything, so a damaged record can't
+   // leave the texture half-built
+   const size_t pixels = size_t(width) * height;
+   uint32_t     numruns = 0;
+   TexCacheReader runcheck = reader;
+
+   for(int x = 0; x < width; x++)
+   {
+      uint16_t count;
+      if(!runcheck.readUint16(count))
+         return false;
+      for(int r = 0; r < count; r++)
+      {
+         uint16_t yoff, len;
+         uint32_t ptroff;
+         if(!runcheck.readUint16(yoff) || !runcheck.readUint16(len) ||
+            !runcheck.readUint32(ptroff) || yoff + len > height ||
+            ptroff + len > pixels)
+         {
+            tex->flags = oldflags;
+            return false;
+         }
+      }
+      numruns += count;
+   }
+
+   tex->bufferalloc = ecalloctag(byte *, 1, datasize + 8, PU_STATIC, (void **)&tex->bufferalloc);
+   tex->bufferdata  = tex->bufferalloc + 8;
+   memcpy(tex->bufferdata, data, datasize);
+
+   tex->columns = ecalloctag(texcol_t **, sizeof(texcol_t **), width, PU_RENDERER, nullptr);
+
+   for(int x = 0; x < width; x++)
+   {
+      uint16_t count;
+      reader.readUint16(count);
+      if(!count)
+         continue;
+
+      texcol_t *tcol = tex->columns[x] = estructalloctag(texcol_t, count, PU_RENDERER);
+      for(int r = 0; r < count; r++, tcol++)
+      {
+         reader.readUint16(tcol->yoff);
+         reader.readUint16(tcol->len);
+         reader.readUint32(tcol->ptroff);
+         tcol->next = r + 1 < count ? tcol + 1 : nullptr;
+      }
+   }
+
+   Z_ChangeTag(tex->bufferalloc, PU_CACHE);
+   return true;
+}
+
+//
+// R_LoadTextureCache
+//
+// Fills in the buffers and columns of the wall textures in [start, stop) from
+// the cache file, if there is one and it matches the loaded textures. Returns
+// true if every texture was loaded. Textures that weren't are left alone, for
+// R_CacheTexture to build as usual.
+//
+bool R_LoadTextureCache(int start, int stop)
+{
+   texcachekeyvalid = false;
+
+   if(M_CheckParm("-notexcache"))
+      return false;
+
+   R_computeTextureCacheKey(start, stop);
+
+   const qstring path = R_textureCachePath();
+   FILE *f;
+   if(!(f = fopen(path.constPtr(), "rb")))
+      return false;
+
+   hal_filemap_t map;
+   if(!I_MapFile(f, map))
+   {
+      fclose(f);
+      return false;
+   }
+
+   TexCacheReader reader(map.data, map.size);
+   const byte    *magic = reader.bytes(4);
+   uint32_t       version = 0, count = 0;
+   bool           valid = magic && !memcmp(magic, TEXCACHE_MAGIC, 4) &&
+                          reader.readUint32(version) && version == TEXCACHE_VERSION;
+
+   for(int i = 0; valid && i < 5; i++)
+   {
+      uint32_t part;
+      valid = reader.readUint32(part) && part == texcachekey[i];
+   }
+
+   valid = valid && reader.readUint32(count) && count == uint32_t(stop - start);
+
+   int loaded = 0, wanted = 0;
+   for(int i = start; valid && i < stop; i++)
+   {
+      texture_t *tex = textures[i];
+
+      if(!R_isCachedTexture(tex))
+         continue;
+
+      ++wanted;
+      if(tex->bufferalloc || tex->columns || !R_loadCachedTexture(reader, tex))
+         valid = false;
+      else
+         ++loaded;
+   }
+
+   I_UnmapFile(map);
+   fclose(f);
+
+   if(loaded)
+      usermsg("\tloaded %d textures from %s", loaded, TEXCACHE_FILENAME);
+
+   return valid && loaded == wanted;
+}
+
+//=============================================================================
+//
+// Saving
+//
+
+static bool R_saveCachedTexture(OutBuffer &out, const texture_t *tex)
+{
+   const uint32_t datasize = uint32_t(R_textureDataSize(tex));
+
+   if(!out.write(tex->namebuf, 8) || !out.writeUint16(uint16_t(tex->width)) ||
+      !out.writeUint16(uint16_t(tex->height)) ||
+      !out.writeUint16((tex->flags & TF_MASKED) ? 1 : 0) ||
+      !out.writeUint32(datasize) || !out.write(tex->bufferdata, datasize))
+      return false;
+
+   for(int x = 0; x < tex->width; x++)
+   {
+      uint16_t count = 0;
+      for(const texcol_t *col = tex->columns[x]; col; col = col->next)
+         ++count;
+
+      if(!out.writeUint16(count))
+         return false;
+
+      for(const texcol_t *col = tex->columns[x]; col; col = col->next)
+      {
+         if(!out.writeUint16(col->yoff) || !out.writeUint16(col->len) ||
+            !out.writeUint32(col->ptroff))
+            return false;
+      }
+   }
+
+   return true;
+}
+
+//
+// R_SaveTextureCache
+//
+// Writes the composited wall textures in [start, stop) out to the cache file.
+// Must follow R_LoadTextureCache, which works out the key, and every texture
+// must be built. The file is written under a temporary name and renamed into
+// place, so that other instances sharing the user directory never see half
+// of one.
+//
+void R_SaveTextureCache(int start, int stop)
+{
+   if(!texcachekeyvalid)
+      return;
+
+   const qstring path = R_textureCachePath();
+   qstring       temppath(path);
+   temppath += ".tmp";
+
+   OutBuffer out;
+   if(!out.createFile(temppath.constPtr(), 512 * 1024, OutBuffer::LENDIAN))
+      return;
+
+   bool ok = out.write(TEXCACHE_MAGIC, 4) && out.writeUint32(TEXCACHE_VERSION);
+   for(int i = 0; ok && i < 5; i++)
+      ok = out.writeUint32(texcachekey[i]);
+   ok = ok && out.writeUint32(uint32_t(stop - start));
+
+   for(int i = start; ok && i < stop; i++)
+   {
+      const texture_t *tex = textures[i];
+
+      if(!R_isCachedTexture(tex))
+         continue;
+
+      if(!tex->bufferalloc || !tex->columns)
+         ok = false;
+      else
+         ok = R_saveCachedTexture(out, tex);
+   }
+
+   ok = out.flush() && ok;
+   out.close();
+
+   if(ok)
+   {
+      // rename won't replace an existing file everywhere
+      remove(path.constPtr());
+      ok = !rename(temppath.constPtr(), path.constPtr());
+   }
+
+   if(!ok)
+   {
+      remove(temppath.constPtr());
+      usermsg("\tcould not write %s", TEXCACHE_FILENAME);
+   }
+}
+
+// EOF
+
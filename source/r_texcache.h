@@ -0,0 +1,35 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: On-disk cache of composited wall textures, so they needn't be
+//  built from their patches again on the next launch.
+//
+// Authors: agent
+//
+
+#ifndef R_TEXCACHE_H__
+#define R_TEXCACHE_H__
+
+bool R_LoadTextureCache(int start, int stop);
+void R_SaveTextureCache(int start, int stop);
+
+#endif
+
+// EOF
+
@@ -40,6 +40,7 @@
 #include "r_draw.h"
 #include "r_patch.h"
 #include "r_ripple.h"
+#include "r_texcache.h"
 #include "v_misc.h"
 #include "v_patchfmt.h"
 #include "v_video.h"
@@ -1430,6 +1431,10 @@ void R_InitTextures()
 {
    auto &tns = wGlobalDir.getNamespace(lumpinfo_t::ns_textures);
 
+   // start inflating zipped textures and flats while the lists are read
+   wGlobalDir.prefetchNamespace(lumpinfo_t::ns_textures);
+   wGlobalDir.prefetchNamespace(lumpinfo_t::ns_flats);
+
    // load PNAMES
    int nummappatches;
    int *patchlookup = R_LoadPNames(nummappatches);
@@ -1510,11 +1515,15 @@ void R_InitTextures()
 
    // SoM: This REALLY hits us when starting EE with large wads. Caching 
    // textures on map start would probably be preferable 99.9% of the time...
-   // Precache textures
+   // Precache textures, from the texture cache file when it's up to date
    for(int i = wallstart; i < wallstop; i++)
-   {
       R_checkInvalidTexture(i);
-      R_CacheTexture(i);
+
+   if(!R_LoadTextureCache(wallstart, wallstop))
+   {
+      for(int i = wallstart; i < wallstop; i++)
+         R_CacheTexture(i);
+      R_SaveTextureCache(wallstart, wallstop);
    }
    
    if(errors)
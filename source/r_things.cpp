@@ -205,46 +205,53 @@ VALLOCATION(pscreenheightarray)
 // Max number of particles
 static int numParticles;
 
-VALLOCATION(pstack)
+//
+// Frees the post-BSP stack of a sprite context, along with all maskedrange_t
+// objects in use or on the freelist.
+//
+void R_FreePostStack(spritecontext_t &context)
 {
-   R_ForEachContext([](rendercontext_t &basecontext) {
-      spritecontext_t &context = basecontext.spritecontext;
-
-      poststack_t   *&pstack       = context.pstack;
-      int            &pstacksize   = context.pstacksize;
-      int            &pstackmax    = context.pstackmax;
-      maskedrange_t *&unusedmasked = context.unusedmasked;
+   poststack_t   *&pstack       = context.pstack;
+   int            &pstacksize   = context.pstacksize;
+   int            &pstackmax    = context.pstackmax;
+   maskedrange_t *&unusedmasked = context.unusedmasked;
 
-      if(pstack)
+   if(pstack)
+   {
+      // free all maskedrange_t on the pstack
+      for(int i = 0; i < pstacksize; i++)
       {
-         // free all maskedrange_t on the pstack
-         for(int i = 0; i < pstacksize; i++)
+         if(pstack[i].masked)
          {
-            if(pstack[i].masked)
-            {
-               efree(pstack[i].masked->ceilingclip);
-               efree(pstack[i].masked);
-            }
+            efree(pstack[i].masked->ceilingclip);
+            efree(pstack[i].masked);
          }
-
-         // free the pstack
-         efree(pstack);
       }
 
-      // free the maskedrange freelist 
-      maskedrange_t *mr = unusedmasked;
-      while(mr)
-      {
-         maskedrange_t *next = mr->next;
-         efree(mr->ceilingclip);
-         efree(mr);
-         mr = next;
-      }
+      // free the pstack
+      efree(pstack);
+   }
+
+   // free the maskedrange freelist 
+   maskedrange_t *mr = unusedmasked;
+   while(mr)
+   {
+      maskedrange_t *next = mr->next;
+      efree(mr->ceilingclip);
+      efree(mr);
+      mr = next;
+   }
 
-      pstack       = nullptr;
-      pstacksize   = 0;
-      pstackmax    = 0;
-      unusedmasked = nullptr;
+   pstack       = nullptr;
+   pstacksize   = 0;
+   pstackmax    = 0;
+   unusedmasked = nullptr;
+}
+
+VALLOCATION(pstack)
+{
+   R_ForEachContext([](rendercontext_t &basecontext) {
+      R_FreePostStack(basecontext.spritecontext);
    });
 }
 
@@ -572,9 +579,11 @@ void R_PushPost(bspcontext_t &bspcontext, spritecontext_t &spritecontext,
       {
          post->masked = estructalloc(maskedrange_t, 1);
 
-         float *buf = emalloc(float *, 2 * bounds.numcolumns * sizeof(float));
+         // Sized for the whole screen, as a context's bounds can change
+         // between frames while masked ranges sit on the freelist.
+         float *buf = emalloc(float *, 2 * video.width * sizeof(float));
          post->masked->ceilingclip = buf;
-         post->masked->floorclip   = buf + bounds.numcolumns;
+         post->masked->floorclip   = buf + video.width;
       }
 
       for(i = pstacksize - 1; i >= 0; i--)
@@ -2479,7 +2488,7 @@ static void R_drawParticle(const contextbounds_t &bounds, vissprite_t *vis,
          return;
       ++ycount;
 
-      spacing = video.pitch - ycount;
+      spacing = linesize - ycount;
       dest    = R_ADDRESS(x1, yl);
 
       // haleyjd 02/08/05: rewritten to remove inner loop invariants
@@ -0,0 +1,429 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Float DSP building blocks shared by the mixer, the reverb engine
+//  and the sound driver. All buffers are planar: one array per channel.
+//
+// Authors: agent
+//
+
+#include "z_zone.h"
+
+#include "m_compare.h"
+#include "s_dsp.h"
+
+//=============================================================================
+//
+// Denormals
+//
+
+#if defined(R_SIMD_SSE2)
+#define MXCSR_FTZ 0x8000
+#define MXCSR_DAZ 0x0040
+#elif defined(__aarch64__) && (defined(__GNUC__) || defined(__clang__))
+#define FPCR_FZ   (uint64_t(1) << 24)
+#endif
+
+DSPDenormalGuard::DSPDenormalGuard()
+{
+#if defined(R_SIMD_SSE2)
+   saved = _mm_getcsr();
+   _mm_setcsr(static_cast<unsigned int>(saved) | MXCSR_FTZ | MXCSR_DAZ);
+#elif defined(FPCR_FZ)
+   asm volatile("mrs %0, fpcr" : "=r"(saved));
+   asm volatile("msr fpcr, %0" : : "r"(saved | FPCR_FZ));
+#else
+   saved = 0;
+#endif
+}
+
+DSPDenormalGuard::~DSPDenormalGuard()
+{
+#if defined(R_SIMD_SSE2)
+   _mm_setcsr(static_cast<unsigned int>(saved));
+#elif defined(FPCR_FZ)
+   asm volatile("msr fpcr, %0" : : "r"(saved));
+#endif
+}
+
+//=============================================================================
+//
+// Three-Band Equalization
+//
+// EQ.C - Main Source file for 3 band EQ
+// http://www.musicdsp.org/showone.php?id=236
+//
+// (c) Neil C / Etanza Systems / 2K6
+// Shouts / Loves / Moans = etanza at lycos dot co dot uk
+//
+// This work is hereby placed in the public domain for all purposes, including
+// use in commercial applications.
+// The author assumes NO RESPONSIBILITY for any problems caused by the use of
+// this software.
+//
+
+#define SND_PI 3.14159265
+
+//
+// Sets up the gains and cutoff frequencies and flushes out all filter state
+//
+void S_EQInit(eqstate_t &eq, const eqparams_t &params, double samplerate)
+{
+   memset(&eq, 0, sizeof(eq));
+
+   const float lf = static_cast<float>(2 * sin(SND_PI * (params.lowfreq  / samplerate)));
+   const float hf = static_cast<float>(2 * sin(SND_PI * (params.highfreq / samplerate)));
+
+   eq.freq[0] = eq.freq[1] = lf;
+   eq.freq[2] = eq.freq[3] = hf;
+
+   eq.lowgain  = static_cast<float>(params.lowgain);
+   eq.midgain  = static_cast<float>(params.midgain);
+   eq.highgain = static_cast<float>(params.highgain);
+   eq.preamp   = static_cast<float>(params.preamp);
+}
+
+//
+// Forgets the input history, leaving the filters alone
+//
+void S_EQClear(eqstate_t &eq)
+{
+   memset(eq.history, 0, sizeof(eq.history));
+}
+
+//
+// Equalizes a stereo pair in place. The four filter chains are recursive, so
+// they run across lanes one frame at a time; combining the bands has no
+// dependencies between frames and runs across frames.
+//
+void S_EQProcess(eqstate_t &eq, float *left, float *right, int frames)
+{
+   float low[2][DSP_BLOCK], high[2][DSP_BLOCK], delayed[2][DSP_BLOCK];
+   float lanes[4];
+
+   const dsp4f_t freq = DSP_Load(eq.freq);
+   dsp4f_t p0 = DSP_Load(eq.poles[0]);
+   dsp4f_t p1 = DSP_Load(eq.poles[1]);
+   dsp4f_t p2 = DSP_Load(eq.poles[2]);
+   dsp4f_t p3 = DSP_Load(eq.poles[3]);
+
+   const dsp4f_t lowgain  = DSP_Splat(eq.lowgain);
+   const dsp4f_t midgain  = DSP_Splat(eq.midgain);
+   const dsp4f_t highgain = DSP_Splat(eq.highgain);
+
+   for(int base = 0; base < frames; base += DSP_BLOCK)
+   {
+      const int count = emin(frames - base, DSP_BLOCK);
+      float *const out[2] = { left + base, right + base };
+
+      for(int k = 0; k < count; k++)
+      {
+         const float xl = out[0][k] * eq.preamp;
+         const float xr = out[1][k] * eq.preamp;
+         const dsp4f_t x = DSP_Set(xl, xr, xl, xr);
+
+         // lowpass in the first two lanes, highpass in the last two
+         p0 = DSP_MulAdd(freq, DSP_Sub(x,  p0), p0);
+         p1 = DSP_MulAdd(freq, DSP_Sub(p0, p1), p1);
+         p2 = DSP_MulAdd(freq, DSP_Sub(p1, p2), p2);
+         p3 = DSP_MulAdd(freq, DSP_Sub(p2, p3), p3);
+
+         DSP_Store(lanes, p3);
+         low[0][k]  = lanes[0];
+         low[1][k]  = lanes[1];
+         high[0][k] = lanes[2];
+         high[1][k] = lanes[3];
+
+         // shuffle history buffer
+         for(int c = 0; c < 2; c++)
+         {
+            delayed[c][k]    = eq.history[2][c];
+            eq.history[2][c] = eq.history[1][c];
+            eq.history[1][c] = eq.history[0][c];
+         }
+         eq.history[0][0] = xl;
+         eq.history[0][1] = xr;
+      }
+
+      for(int c = 0; c < 2; c++)
+      {
+         int k = 0;
+
+         for(; k + 4 <= count; k += 4)
+         {
+            const dsp4f_t sdm3 = DSP_Load(delayed[c] + k);
+            const dsp4f_t l    = DSP_Load(low[c] + k);
+            const dsp4f_t h    = DSP_Sub(sdm3, DSP_Load(high[c] + k));
+            const dsp4f_t m    = DSP_Sub(sdm3, DSP_Add(h, l)); // haleyjd 07/05/10: which is right?
+
+            DSP_Store(out[c] + k, DSP_MulAdd(l, lowgain,
+                                  DSP_MulAdd(m, midgain, DSP_Mul(h, highgain))));
+         }
+         for(; k < count; k++)
+         {
+            const float l = low[c][k];
+            const float h = delayed[c][k] - high[c][k];
+            const float m = delayed[c][k] - (h + l);
+
+            out[c][k] = l * eq.lowgain + m * eq.midgain + h * eq.highgain;
+         }
+      }
+   }
+
+   DSP_Store(eq.poles[0], p0);
+   DSP_Store(eq.poles[1], p1);
+   DSP_Store(eq.poles[2], p2);
+   DSP_Store(eq.poles[3], p3);
+}
+
+//=============================================================================
+//
+// Device Buffer Conversion
+//
+
+//
+// Splits an interleaved device buffer of stride channels into two planar
+// channels. Only the first two channels of each frame are read; a mono
+// buffer goes to both.
+//
+void S_DSPDeinterleave(const float *src, float *left, float *right, int frames, int stride)
+{
+   int k = 0;
+
+   if(stride != 2)
+   {
+      for(; k < frames; k++)
+      {
+         left[k]  = src[stride * k];
+         right[k] = src[stride * k + (stride > 1)];
+      }
+      return;
+   }
+
+#if defined(R_SIMD_SSE2)
+   for(; k + 4 <= frames; k += 4)
+   {
+      const __m128 a = _mm_loadu_ps(src + 2 * k);
+      const __m128 b = _mm_loadu_ps(src + 2 * k + 4);
+
+      _mm_storeu_ps(left  + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+      _mm_storeu_ps(right + k, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+   }
+#elif defined(R_SIMD_NEON)
+   for(; k + 4 <= frames; k += 4)
+   {
+      const float32x4x2_t s = vld2q_f32(src + 2 * k);
+
+      vst1q_f32(left  + k, s.val[0]);
+      vst1q_f32(right + k, s.val[1]);
+   }
+#endif
+
+   for(; k < frames; k++)
+   {
+      left[k]  = src[2 * k + 0];
+      right[k] = src[2 * k + 1];
+   }
+}
+
+//
+// As above, for 16-bit samples, scaled to -1..1
+//
+void S_DSPDeinterleave(const int16_t *src, float *left, float *right, int frames, int stride)
+{
+   int k = 0;
+
+   if(stride != 2)
+   {
+      for(; k < frames; k++)
+      {
+         left[k]  = static_cast<float>(src[stride * k]) * (1.0f / 32768.0f);
+         right[k] = static_cast<float>(src[stride * k + (stride > 1)]) * (1.0f / 32768.0f);
+      }
+      return;
+   }
+
+#if defined(R_SIMD_SSE2)
+   const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+
+   for(; k + 4 <= frames; k += 4)
+   {
+      const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * k));
+
+      // left samples are the low halves of each 32-bit lane; sign extend both
+      const __m128i l = _mm_srai_epi32(_mm_slli_epi32(s, 16), 16);
+      const __m128i r = _mm_srai_epi32(s, 16);
+
+      _mm_storeu_ps(left  + k, _mm_mul_ps(_mm_cvtepi32_ps(l), scale));
+      _mm_storeu_ps(right + k, _mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+   }
+#elif defined(R_SIMD_NEON)
+   for(; k + 4 <= frames; k += 4)
+   {
+      const int16x4x2_t s = vld2_s16(src + 2 * k);
+
+      vst1q_f32(left  + k, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(s.val[0])), 1.0f / 32768.0f));
+      vst1q_f32(right + k, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(s.val[1])), 1.0f / 32768.0f));
+   }
+#endif
+
+   for(; k < frames; k++)
+   {
+      left[k]  = static_cast<float>(src[2 * k + 0]) * (1.0f / 32768.0f);
+      right[k] = static_cast<float>(src[2 * k + 1]) * (1.0f / 32768.0f);
+   }
+}
+
+//
+// rational_tanh
+//
+// cschueler
+// http://www.musicdsp.org/showone.php?id=238
+//
+// Notes :
+// This is a rational function to approximate a tanh-like soft clipper. It is
+// based on the pade-approximation of the tanh function with tweaked
+// coefficients.
+// The function is in the range x=-3..3 and outputs the range y=-1..1. Beyond
+// this range the output must be clamped to -1..1.
+// The first two derivatives of the function vanish at -3 and 3, so the
+// transition to the hard clipped region is C2-continuous.
+//
+// Clamping the input to -3..3 gives exactly -1 and 1 at the ends, so there
+// is no need to branch.
+//
+static inline float S_rationalTanh(float x)
+{
+   x = x < -3.0f ? -3.0f : (x > 3.0f ? 3.0f : x);
+   return x * (27.0f + x * x) / (27.0f + 9.0f * x * x);
+}
+
+#if defined(S_DSP_SIMD)
+static inline dsp4f_t S_rationalTanh4(dsp4f_t x)
+{
+   x = DSP_Min(DSP_Max(x, DSP_Splat(-3.0f)), DSP_Splat(3.0f));
+
+   const dsp4f_t x2 = DSP_Mul(x, x);
+   return DSP_Div(DSP_Mul(x, DSP_Add(x2, DSP_Splat(27.0f))),
+                  DSP_MulAdd(x2, DSP_Splat(9.0f), DSP_Splat(27.0f)));
+}
+#endif
+
+//
+// Soft clips two planar channels into the first two channels of each frame
+// of an interleaved device buffer of stride channels. A mono buffer gets
+// both mixed down.
+//
+void S_DSPSoftClipInterleave(const float *left, const float *right, float *dest, int frames,
+                             int stride)
+{
+   int k = 0;
+
+   if(stride == 1)
+   {
+      for(; k < frames; k++)
+         dest[k] = S_rationalTanh(0.5f * (left[k] + right[k]));
+      return;
+   }
+   if(stride != 2)
+   {
+      for(; k < frames; k++)
+      {
+         dest[stride * k + 0] = S_rationalTanh(left[k]);
+         dest[stride * k + 1] = S_rationalTanh(right[k]);
+      }
+      return;
+   }
+
+#if defined(S_DSP_SIMD)
+   for(; k + 4 <= frames; k += 4)
+   {
+      const dsp4f_t l = S_rationalTanh4(DSP_Load(left  + k));
+      const dsp4f_t r = S_rationalTanh4(DSP_Load(right + k));
+
+#if defined(R_SIMD_SSE2)
+      _mm_storeu_ps(dest + 2 * k,     _mm_unpacklo_ps(l, r));
+      _mm_storeu_ps(dest + 2 * k + 4, _mm_unpackhi_ps(l, r));
+#else
+      vst2q_f32(dest + 2 * k, float32x4x2_t { { l, r } });
+#endif
+   }
+#endif
+
+   for(; k < frames; k++)
+   {
+      dest[2 * k + 0] = S_rationalTanh(left[k]);
+      dest[2 * k + 1] = S_rationalTanh(right[k]);
+   }
+}
+
+//
+// As above, for 16-bit samples
+//
+void S_DSPSoftClipInterleave(const float *left, const float *right, int16_t *dest, int frames,
+                             int stride)
+{
+   int k = 0;
+
+   if(stride == 1)
+   {
+      for(; k < frames; k++)
+         dest[k] = static_cast<int16_t>(S_rationalTanh(0.5f * (left[k] + right[k])) * 32767.0f);
+      return;
+   }
+   if(stride != 2)
+   {
+      for(; k < frames; k++)
+      {
+         dest[stride * k + 0] = static_cast<int16_t>(S_rationalTanh(left[k])  * 32767.0f);
+         dest[stride * k + 1] = static_cast<int16_t>(S_rationalTanh(right[k]) * 32767.0f);
+      }
+      return;
+   }
+
+#if defined(S_DSP_SIMD)
+   const dsp4f_t scale = DSP_Splat(32767.0f);
+
+   for(; k + 4 <= frames; k += 4)
+   {
+      const dsp4f_t l = DSP_Mul(S_rationalTanh4(DSP_Load(left  + k)), scale);
+      const dsp4f_t r = DSP_Mul(S_rationalTanh4(DSP_Load(right + k)), scale);
+
+#if defined(R_SIMD_SSE2)
+      const __m128i li = _mm_cvttps_epi32(l);
+      const __m128i ri = _mm_cvttps_epi32(r);
+
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + 2 * k),
+                       _mm_packs_epi32(_mm_unpacklo_epi32(li, ri), _mm_unpackhi_epi32(li, ri)));
+#else
+      vst2_s16(dest + 2 * k, int16x4x2_t { { vmovn_s32(vcvtq_s32_f32(l)),
+                                             vmovn_s32(vcvtq_s32_f32(r)) } });
+#endif
+   }
+#endif
+
+   for(; k < frames; k++)
+   {
+      dest[2 * k + 0] = static_cast<int16_t>(S_rationalTanh(left[k])  * 32767.0f);
+      dest[2 * k + 1] = static_cast<int16_t>(S_rationalTanh(right[k]) * 32767.0f);
+   }
+}
+
+// EOF
+
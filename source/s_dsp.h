@@ -0,0 +1,180 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Float DSP building blocks shared by the mixer, the reverb engine
+//  and the sound driver. All buffers are planar: one array per channel.
+//
+// Authors: agent
+//
+
+#ifndef S_DSP_H__
+#define S_DSP_H__
+
+#include <stdint.h>
+
+#include "r_simd.h"
+
+// Frames processed at a time by effects that need scratch space
+#define DSP_BLOCK 256
+
+//
+// 4 x float vectors. NEON only has a vector divide on AArch64, so 32-bit ARM
+// gets the scalar version.
+//
+#if defined(R_SIMD_SSE2)
+#define S_DSP_SIMD
+
+using dsp4f_t = __m128;
+
+inline dsp4f_t DSP_Splat(float a) { return _mm_set1_ps(a); }
+inline dsp4f_t DSP_Set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+inline dsp4f_t DSP_Load(const float *src)     { return _mm_loadu_ps(src); }
+inline void    DSP_Store(float *dest, dsp4f_t a) { _mm_storeu_ps(dest, a); }
+
+inline dsp4f_t DSP_Add(dsp4f_t a, dsp4f_t b) { return _mm_add_ps(a, b); }
+inline dsp4f_t DSP_Sub(dsp4f_t a, dsp4f_t b) { return _mm_sub_ps(a, b); }
+inline dsp4f_t DSP_Mul(dsp4f_t a, dsp4f_t b) { return _mm_mul_ps(a, b); }
+inline dsp4f_t DSP_Div(dsp4f_t a, dsp4f_t b) { return _mm_div_ps(a, b); }
+inline dsp4f_t DSP_Min(dsp4f_t a, dsp4f_t b) { return _mm_min_ps(a, b); }
+inline dsp4f_t DSP_Max(dsp4f_t a, dsp4f_t b) { return _mm_max_ps(a, b); }
+#elif defined(R_SIMD_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#define S_DSP_SIMD
+
+using dsp4f_t = float32x4_t;
+
+inline dsp4f_t DSP_Splat(float a) { return vdupq_n_f32(a); }
+inline dsp4f_t DSP_Set(float a, float b, float c, float d)
+{
+   const float values[4] = { a, b, c, d };
+   return vld1q_f32(values);
+}
+inline dsp4f_t DSP_Load(const float *src)     { return vld1q_f32(src); }
+inline void    DSP_Store(float *dest, dsp4f_t a) { vst1q_f32(dest, a); }
+
+inline dsp4f_t DSP_Add(dsp4f_t a, dsp4f_t b) { return vaddq_f32(a, b); }
+inline dsp4f_t DSP_Sub(dsp4f_t a, dsp4f_t b) { return vsubq_f32(a, b); }
+inline dsp4f_t DSP_Mul(dsp4f_t a, dsp4f_t b) { return vmulq_f32(a, b); }
+inline dsp4f_t DSP_Div(dsp4f_t a, dsp4f_t b) { return vdivq_f32(a, b); }
+inline dsp4f_t DSP_Min(dsp4f_t a, dsp4f_t b) { return vminq_f32(a, b); }
+inline dsp4f_t DSP_Max(dsp4f_t a, dsp4f_t b) { return vmaxq_f32(a, b); }
+#else
+struct dsp4f_t
+{
+   float v[4];
+};
+
+inline dsp4f_t DSP_Splat(float a) { return { { a, a, a, a } }; }
+inline dsp4f_t DSP_Set(float a, float b, float c, float d) { return { { a, b, c, d } }; }
+inline dsp4f_t DSP_Load(const float *src) { return { { src[0], src[1], src[2], src[3] } }; }
+inline void    DSP_Store(float *dest, dsp4f_t a)
+{
+   dest[0] = a.v[0];
+   dest[1] = a.v[1];
+   dest[2] = a.v[2];
+   dest[3] = a.v[3];
+}
+
+#define DSP_LANEWISE(name, expr)                                     \
+   inline dsp4f_t name(dsp4f_t a, dsp4f_t b)                         \
+   {                                                                 \
+      dsp4f_t r;                                                     \
+      for(int i = 0; i < 4; i++)                                     \
+         r.v[i] = expr;                                              \
+      return r;                                                      \
+   }
+
+DSP_LANEWISE(DSP_Add, a.v[i] + b.v[i])
+DSP_LANEWISE(DSP_Sub, a.v[i] - b.v[i])
+DSP_LANEWISE(DSP_Mul, a.v[i] * b.v[i])
+DSP_LANEWISE(DSP_Div, a.v[i] / b.v[i])
+DSP_LANEWISE(DSP_Min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+DSP_LANEWISE(DSP_Max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+
+#undef DSP_LANEWISE
+#endif
+
+// a * b + c
+inline dsp4f_t DSP_MulAdd(dsp4f_t a, dsp4f_t b, dsp4f_t c) { return DSP_Add(DSP_Mul(a, b), c); }
+
+//
+// Flushes denormals to zero on the calling thread for as long as it is in
+// scope, restoring the previous mode afterwards. Recursive filters decay into
+// denormals when the input goes quiet, and those are very slow on most CPUs.
+//
+class DSPDenormalGuard
+{
+public:
+   DSPDenormalGuard();
+   ~DSPDenormalGuard();
+
+   DSPDenormalGuard(const DSPDenormalGuard &) = delete;
+   DSPDenormalGuard &operator = (const DSPDenormalGuard &) = delete;
+
+private:
+   uint64_t saved;
+};
+
+//
+// Three-band equalizer
+//
+
+struct eqparams_t
+{
+   double lowfreq;
+   double highfreq;
+   double lowgain;
+   double midgain;
+   double highgain;
+   double preamp;   // input is scaled by this first
+};
+
+//
+// Equalizer state for a stereo pair. The low and high band filters of both
+// channels run side by side, in lanes of left low, right low, left high and
+// right high.
+//
+struct eqstate_t
+{
+   float freq[4];
+   float poles[4][4];    // [pole][lane]
+   float history[3][2];  // input 1, 2 and 3 frames ago, per channel
+   float lowgain;
+   float midgain;
+   float highgain;
+   float preamp;
+};
+
+void S_EQInit(eqstate_t &eq, const eqparams_t &params, double samplerate);
+void S_EQClear(eqstate_t &eq);
+void S_EQProcess(eqstate_t &eq, float *left, float *right, int frames);
+
+//
+// Conversion to and from interleaved device buffers of stride channels
+//
+void S_DSPDeinterleave(const float   *src, float *left, float *right, int frames, int stride);
+void S_DSPDeinterleave(const int16_t *src, float *left, float *right, int frames, int stride);
+void S_DSPSoftClipInterleave(const float *left, const float *right, float   *dest, int frames,
+                             int stride);
+void S_DSPSoftClipInterleave(const float *left, const float *right, int16_t *dest, int frames,
+                             int stride);
+
+#endif
+
+// EOF
+
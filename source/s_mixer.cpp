@@ -0,0 +1,444 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Software sound effect mixer. The main thread controls voices by
+//  queueing commands on a lock-free ring that the audio thread drains at the
+//  start of each mix, so neither side ever waits on the other.
+//
+// Authors: agent
+//
+
+#include <atomic>
+
+#include "z_zone.h"
+
+#include "c_runcmd.h"
+#include "m_compare.h"
+#include "s_dsp.h"
+#include "s_mixer.h"
+
+int s_interpolation = MIXER_INTERP_LINEAR;
+
+// Commands that can be queued without the audio thread draining them. Far
+// more than a game can issue between two mixes.
+#define MIXER_RINGSIZE 1024
+
+// Frames resampled at a time into the scratch buffer
+#define MIXER_BLOCK 256
+
+static constexpr uint64_t MIXER_UNITSTEP = uint64_t(1) << 32;
+
+//=============================================================================
+//
+// Command Ring
+//
+
+enum mixercmdtype_e
+{
+   MIXCMD_START,
+   MIXCMD_PARAMS,
+   MIXCMD_STOP
+};
+
+struct mixercmd_t
+{
+   mixercmdtype_e type;
+   int            voice;
+   unsigned int   serial; // sound instance the command is meant for
+   const float   *data;
+   unsigned int   length;
+   bool           loop;
+   bool           reverb;
+   mixerparams_t  params;
+};
+
+static mixercmd_t mixerring[MIXER_RINGSIZE];
+
+// Single producer (main thread), single consumer (audio thread)
+static std::atomic<unsigned int> mixerringhead; // next slot to write
+static std::atomic<unsigned int> mixerringtail; // next slot to read
+
+//
+// Queues a command. Returns false if the ring is full.
+//
+static bool S_pushMixerCommand(const mixercmd_t &cmd)
+{
+   const unsigned int head = mixerringhead.load(std::memory_order_relaxed);
+
+   if(head - mixerringtail.load(std::memory_order_acquire) >= MIXER_RINGSIZE)
+      return false;
+
+   mixerring[head & (MIXER_RINGSIZE - 1)] = cmd;
+   mixerringhead.store(head + 1, std::memory_order_release);
+   return true;
+}
+
+//=============================================================================
+//
+// Main Thread Side
+//
+
+// What the main thread last asked each voice to do
+struct mixershadow_t
+{
+   unsigned int serial;
+   bool         active;
+   bool         stopping; // a stop didn't fit in the ring, and is retried
+};
+
+static mixershadow_t mixershadows[MIXER_MAXVOICES];
+static unsigned int  mixerserial;
+
+// Serial of the last sound each voice played to its end, written by the
+// audio thread. A voice is still busy until this catches up with its shadow.
+static std::atomic<unsigned int> mixerfinished[MIXER_MAXVOICES];
+
+//
+// Audio-thread voice state
+//
+struct mixervoice_t
+{
+   unsigned int serial;  // 0 if idle
+   const float *data;
+   uint64_t     endpos;  // 32.32 position at which the sound is over
+   uint64_t     pos;     // 32.32 position of the next output sample
+   uint64_t     step;    // 32.32
+   uint64_t     restartpos;
+   float        leftvol;
+   float        rightvol;
+   bool         loop;
+   bool         reverb;
+   bool         loopcutoff; // looping sound held until sounds may play again
+   bool         hasrestart; // restartpos is where the sound was when paused
+};
+
+static mixervoice_t mixervoices[MIXER_MAXVOICES];
+
+//
+// Resets all voices. Must be called before the audio callback is installed.
+//
+void S_MixerInit()
+{
+   memset(mixervoices,  0, sizeof(mixervoices));
+   memset(mixershadows, 0, sizeof(mixershadows));
+
+   for(std::atomic<unsigned int> &finished : mixerfinished)
+      finished.store(0, std::memory_order_relaxed);
+
+   mixerringhead.store(0, std::memory_order_relaxed);
+   mixerringtail.store(0, std::memory_order_relaxed);
+}
+
+//
+// Starts a sound of length samples on a voice, replacing anything it was
+// playing. Returns false if the sound can't be played.
+//
+bool S_MixerStartVoice(int voice, const float *data, unsigned int length, bool loop,
+                       bool reverb, const mixerparams_t &params)
+{
+   if(!data || length < 2)
+      return false;
+
+   if(!++mixerserial) // 0 means idle
+      ++mixerserial;
+
+   const mixercmd_t cmd = { MIXCMD_START, voice, mixerserial, data, length, loop, reverb, params };
+   if(!S_pushMixerCommand(cmd))
+      return false;
+
+   mixershadows[voice].serial   = mixerserial;
+   mixershadows[voice].active   = true;
+   mixershadows[voice].stopping = false;
+   return true;
+}
+
+//
+// Changes volume and pitch of whatever a voice is playing
+//
+void S_MixerSetParams(int voice, const mixerparams_t &params)
+{
+   const mixershadow_t &shadow = mixershadows[voice];
+
+   if(!shadow.active)
+      return;
+
+   const mixercmd_t cmd = { MIXCMD_PARAMS, voice, shadow.serial, nullptr, 0, false, false, params };
+   S_pushMixerCommand(cmd);
+}
+
+//
+// Stops a voice. It is free for reuse once the stop is queued; the ring keeps
+// the stop ahead of any later start. If the ring is full, the voice stays busy
+// and the stop is tried again whenever the voice is asked about.
+//
+void S_MixerStopVoice(int voice)
+{
+   mixershadow_t &shadow = mixershadows[voice];
+
+   if(!shadow.active)
+      return;
+
+   const mixercmd_t cmd = { MIXCMD_STOP, voice, shadow.serial, nullptr, 0, false, false, {} };
+   shadow.stopping = !S_pushMixerCommand(cmd);
+   shadow.active   = shadow.stopping;
+}
+
+bool S_MixerVoicePlaying(int voice)
+{
+   const mixershadow_t &shadow = mixershadows[voice];
+
+   if(shadow.stopping)
+      S_MixerStopVoice(voice);
+
+   return shadow.active &&
+          mixerfinished[voice].load(std::memory_order_acquire) != shadow.serial;
+}
+
+//=============================================================================
+//
+// Audio Thread Side
+//
+
+static void S_applyParams(mixervoice_t &v, const mixerparams_t &params)
+{
+   v.leftvol  = params.leftvol;
+   v.rightvol = params.rightvol;
+   v.step     = uint64_t(params.step) << 16;
+}
+
+//
+// Applies everything the main thread has queued since the last mix
+//
+static void S_drainMixerCommands()
+{
+   const unsigned int head = mixerringhead.load(std::memory_order_acquire);
+   unsigned int       tail = mixerringtail.load(std::memory_order_relaxed);
+
+   for(; tail != head; ++tail)
+   {
+      const mixercmd_t &cmd = mixerring[tail & (MIXER_RINGSIZE - 1)];
+      mixervoice_t     &v   = mixervoices[cmd.voice];
+
+      switch(cmd.type)
+      {
+      case MIXCMD_START:
+         v = {};
+         v.serial = cmd.serial;
+         v.data   = cmd.data;
+         v.endpos = uint64_t(cmd.length - 1) << 32;
+         v.loop   = cmd.loop;
+         v.reverb = cmd.reverb;
+         S_applyParams(v, cmd.params);
+         break;
+      case MIXCMD_PARAMS:
+         if(v.serial == cmd.serial)
+            S_applyParams(v, cmd.params);
+         break;
+      case MIXCMD_STOP:
+         if(v.serial == cmd.serial)
+            v.serial = 0;
+         break;
+      }
+   }
+
+   mixerringtail.store(tail, std::memory_order_release);
+}
+
+//
+// Produces count samples of a voice from its current position and advances
+// it. Returns the samples, which are read straight from the sound when it
+// is playing at its own rate.
+//
+static const float *S_resampleVoice(mixervoice_t &v, float *block, int count, int interp)
+{
+   const float *data = v.data;
+   uint64_t     pos  = v.pos;
+   const uint64_t step = v.step;
+
+   v.pos += step * count;
+
+   if(step == MIXER_UNITSTEP && !(pos & 0xffffffff))
+      return data + (pos >> 32);
+
+   switch(interp)
+   {
+   case MIXER_INTERP_LINEAR:
+      for(int k = 0; k < count; k++, pos += step)
+      {
+         const float *p    = data + (pos >> 32);
+         const float  frac = float(pos & 0xffffffff) * (1.0f / 4294967296.0f);
+
+         block[k] = p[0] + (p[1] - p[0]) * frac;
+      }
+      break;
+   case MIXER_INTERP_CUBIC:
+   {
+      // the sample after the last one played is always in range; the ones
+      // either side of that pair are clamped to the sound
+      const uint64_t last = v.endpos >> 32; // the last sample
+
+      for(int k = 0; k < count; k++, pos += step)
+      {
+         const uint64_t i    = pos >> 32;
+         const float    frac = float(pos & 0xffffffff) * (1.0f / 4294967296.0f);
+         const float    p0   = data[i ? i - 1 : 0];
+         const float    p1   = data[i];
+         const float    p2   = data[i + 1];
+         const float    p3   = data[emin(i + 2, last)];
+
+         block[k] = p1 + 0.5f * frac * (p2 - p0 + frac * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3 +
+                                        frac * (3.0f * (p1 - p2) + p3 - p0)));
+      }
+      break;
+   }
+   default:
+      for(int k = 0; k < count; k++, pos += step)
+         block[k] = data[pos >> 32];
+      break;
+   }
+
+   return block;
+}
+
+//
+// Adds count mono samples into a planar stereo pair at two volumes
+//
+static void S_addStereo(float *left, float *right, const float *src, int count,
+                        float leftvol, float rightvol)
+{
+   const dsp4f_t lv = DSP_Splat(leftvol);
+   const dsp4f_t rv = DSP_Splat(rightvol);
+   int k = 0;
+
+   for(; k + 4 <= count; k += 4)
+   {
+      const dsp4f_t s = DSP_Load(src + k);
+
+      DSP_Store(left  + k, DSP_MulAdd(s, lv, DSP_Load(left  + k)));
+      DSP_Store(right + k, DSP_MulAdd(s, rv, DSP_Load(right + k)));
+   }
+
+   for(; k < count; k++)
+   {
+      left[k]  += src[k] * leftvol;
+      right[k] += src[k] * rightvol;
+   }
+}
+
+//
+// Adds src into dest
+//
+void S_MixerSum(float *dest, const float *src, int count)
+{
+   int i = 0;
+
+   for(; i + 4 <= count; i += 4)
+      DSP_Store(dest + i, DSP_Add(DSP_Load(dest + i), DSP_Load(src + i)));
+
+   for(; i < count; i++)
+      dest[i] += src[i];
+}
+
+//
+// Mixes every playing voice into dry, or into wet if it is affected by
+// reverb. Both are planar stereo pairs. Looping sounds
+// are held at their end while loopsounds is false, then resumed from where
+// they were when it turned false.
+//
+void S_MixerMix(float *const dry[2], float *const wet[2], int frames, bool loopsounds)
+{
+   float block[MIXER_BLOCK];
+
+   S_drainMixerCommands();
+
+   const int interp = s_interpolation;
+
+   for(int i = 0; i < MIXER_MAXVOICES; i++)
+   {
+      mixervoice_t &v = mixervoices[i];
+
+      if(!v.serial)
+         continue;
+
+      if(v.loopcutoff)
+      {
+         if(!loopsounds)
+            continue;
+
+         v.pos        = v.restartpos;
+         v.loopcutoff = false;
+         v.hasrestart = false;
+      }
+
+      // Save position of sound if we just paused
+      if(!loopsounds && !v.hasrestart && v.loop)
+      {
+         v.restartpos = v.pos;
+         v.hasrestart = true;
+      }
+
+      float *const *out = v.reverb ? wet : dry;
+
+      for(int done = 0; done < frames; )
+      {
+         // frames left before the sound is over
+         const uint64_t avail = (v.endpos - v.pos + v.step - 1) / v.step;
+         const bool     ends  = avail <= uint64_t(emin(frames - done, MIXER_BLOCK));
+         const int      count = ends ? int(avail) : emin(frames - done, MIXER_BLOCK);
+
+         S_addStereo(out[0] + done, out[1] + done, S_resampleVoice(v, block, count, interp),
+                     count, v.leftvol, v.rightvol);
+         done += count;
+
+         if(!ends)
+            continue;
+
+         if(v.loop && loopsounds)
+         {
+            // restart a looping sample if not paused
+            v.pos        = 0;
+            v.hasrestart = false;
+         }
+         else
+         {
+            if(v.loop)
+               v.loopcutoff = true; // start again once sounds can play
+            else
+            {
+               mixerfinished[i].store(v.serial, std::memory_order_release);
+               v.serial = 0;
+            }
+            break;
+         }
+      }
+   }
+}
+
+//=============================================================================
+//
+// Console Variables
+//
+
+static const char *interpstr[MIXER_NUMINTERP] = { "none", "linear", "cubic" };
+
+VARIABLE_INT(s_interpolation, nullptr, MIXER_INTERP_NONE, MIXER_NUMINTERP - 1, interpstr);
+CONSOLE_VARIABLE(snd_interpolation, s_interpolation, 0) {}
+
+// EOF
+
@@ -0,0 +1,69 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Software sound effect mixer. The main thread controls voices by
+//  queueing commands on a lock-free ring that the audio thread drains at the
+//  start of each mix, so neither side ever waits on the other.
+//
+// Authors: agent
+//
+
+#ifndef S_MIXER_H__
+#define S_MIXER_H__
+
+// Most voices that can play at once; snd_channels is capped to this
+#define MIXER_MAXVOICES 256
+
+// Resampling used for pitched sounds
+enum mixerinterp_e
+{
+   MIXER_INTERP_NONE,   // nearest sample, as the old mixer did
+   MIXER_INTERP_LINEAR,
+   MIXER_INTERP_CUBIC,  // 4-point Catmull-Rom
+   MIXER_NUMINTERP
+};
+
+extern int s_interpolation;
+
+//
+// Voice parameters. step is the 16.16 playback rate.
+//
+struct mixerparams_t
+{
+   float        leftvol;
+   float        rightvol;
+   unsigned int step;
+};
+
+// Main thread
+void S_MixerInit();
+bool S_MixerStartVoice(int voice, const float *data, unsigned int length, bool loop,
+                       bool reverb, const mixerparams_t &params);
+void S_MixerSetParams(int voice, const mixerparams_t &params);
+void S_MixerStopVoice(int voice);
+bool S_MixerVoicePlaying(int voice);
+
+// Audio thread
+void S_MixerMix(float *const dry[2], float *const wet[2], int frames, bool loopsounds);
+void S_MixerSum(float *dest, const float *src, int count);
+
+#endif
+
+// EOF
+
@@ -22,11 +22,26 @@
 // Authors: James Haley, Max Waine
 //
 
+#include <chrono>
+
 #include "z_zone.h"
 
+#include "c_io.h"
+#include "c_runcmd.h"
 #include "e_reverbs.h"
 #include "i_sound.h"
+#include "m_compare.h"
+#include "s_dsp.h"
 #include "s_reverb.h"
+#include "v_misc.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define S_HAVE_RDTSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define S_HAVE_RDTSC
+#endif
 
 //
 // Defines and constants
@@ -51,197 +66,38 @@
 #define FREEZEMODE   0.5
 #define STEREOSPREAD 23
 
-#define COMBTUNINGL1 1116
-#define COMBTUNINGR1 1116+STEREOSPREAD
-#define COMBTUNINGL2 1188
-#define COMBTUNINGR2 1188+STEREOSPREAD
-#define COMBTUNINGL3 1277
-#define COMBTUNINGR3 1277+STEREOSPREAD
-#define COMBTUNINGL4 1356
-#define COMBTUNINGR4 1356+STEREOSPREAD
-#define COMBTUNINGL5 1422
-#define COMBTUNINGR5 1422+STEREOSPREAD
-#define COMBTUNINGL6 1491
-#define COMBTUNINGR6 1491+STEREOSPREAD
-#define COMBTUNINGL7 1557
-#define COMBTUNINGR7 1557+STEREOSPREAD
-#define COMBTUNINGL8 1617
-#define COMBTUNINGR8 1617+STEREOSPREAD
-
-#define ALLPASSTUNINGL1 556
-#define ALLPASSTUNINGR1 556+STEREOSPREAD
-#define ALLPASSTUNINGL2 441
-#define ALLPASSTUNINGR2 441+STEREOSPREAD
-#define ALLPASSTUNINGL3 341
-#define ALLPASSTUNINGR3 341+STEREOSPREAD
-#define ALLPASSTUNINGL4 225
-#define ALLPASSTUNINGR4 225+STEREOSPREAD
-
-//=============================================================================
-//
-// denorms
-//
-
-static inline void undenormalize(double &d)
-{
-   static const double anti_denormal = 1e-18;
-   d += anti_denormal;
-   d -= anti_denormal;
-}
-
-//=============================================================================
-//
-// delay
-//
-
-#define MAXDELAY 250u
-#define MAXSR    44100u
-
-static double delayBuffer[MAXDELAY*MAXSR/1000];
-
-static size_t delaySize;
-static size_t readPos;
-static size_t writePos;
-
-static void delay_clearBuffer()
-{
-   for(size_t i = 0; i < delaySize; i++)
-      delayBuffer[i] = 0.0;
-}
-
-static void delay_set(size_t delayms, size_t sr = MAXSR)
-{
-   if(delayms > MAXDELAY)
-      delayms = MAXDELAY;
-   if(sr > MAXSR)
-      sr = MAXSR;
-   size_t curDelaySize = delaySize;
-   delaySize = delayms * sr / 1000;
-
-   if(delaySize != curDelaySize)
-   {
-      readPos  = 0;
-      writePos = delaySize - 1;
-      delay_clearBuffer();
-   }
-}
+#define ALLPASSFEEDBACK 0.5f
 
-static void delay_writeSample(double sample)
+// Left channel tunings; the right channel's are STEREOSPREAD longer
+static constexpr int combtuning[NUMCOMBS] =
 {
-   delayBuffer[writePos] = sample;
-   if(++writePos >= delaySize)
-      writePos = 0;
-}
-
-static double delay_readSample()
-{
-   double ret = delayBuffer[readPos];
-   if(++readPos >= delaySize)
-      readPos = 0;
-   return ret;
-}
-
-//=============================================================================
-//
-// comb
-//
+   1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617
+};
 
-class comb
+static constexpr int allpasstuning[NUMALLPASSES] =
 {
-public:
-   double  feedback;
-   double  filterstore;
-   double  damp1;
-   double  damp2;
-   double *buffer;
-   int     bufsize;
-   int     bufidx;
-
-   void setbuffer(double *buf, int size)
-   {
-      buffer  = buf;
-      bufsize = size;
-   }
-
-   double process(double input)
-   {
-      double output;
-      
-      output = buffer[bufidx];
-      undenormalize(output);
-
-      filterstore = (output * damp2) + (filterstore * damp1);
-      undenormalize(filterstore);
-
-      buffer[bufidx] = input + (filterstore * feedback);
-
-      if(++bufidx >= bufsize)
-         bufidx = 0;
-
-      return output;
-   }
-
-   void mute()
-   {
-      for(int i = 0; i < bufsize; i++)
-         buffer[i] = 0;
-   }
-
-   void setdamp(double val)
-   {
-      damp1 = val;
-      damp2 = 1 - val;
-   }
+   556, 441, 341, 225
 };
 
-//=============================================================================
-//
-// allpass
-//
-
-class allpass
+static constexpr int S_sumTunings(const int *tunings, int count)
 {
-public:
-   double  feedback;
-   double *buffer;
-   int     bufsize;
-   int     bufidx;
-
-   void setbuffer(double *buf, int size)
-   {
-      buffer  = buf;
-      bufsize = size;
-   }
-
-   double process(double input)
-   {
-      double output, bufout;
-
-      bufout = buffer[bufidx];
-      undenormalize(bufout);
-
-      output = -input + bufout;
-      buffer[bufidx] = input + (bufout * feedback);
+   int total = 0;
+   for(int i = 0; i < count; i++)
+      total += 2 * tunings[i] + STEREOSPREAD;
+   return total;
+}
 
-      if(++bufidx >= bufsize)
-         bufidx = 0;
+static constexpr int COMBSTORAGE    = S_sumTunings(combtuning, NUMCOMBS);
+static constexpr int ALLPASSSTORAGE = S_sumTunings(allpasstuning, NUMALLPASSES);
 
-      return output;
-   }
-
-   void mute()
-   {
-      for(int i = 0; i < bufsize; i++)
-         buffer[i] = 0;
-   }
-};
+#define MAXDELAY 250u
+#define MAXSR    44100u
 
 //=============================================================================
 //
 // Equalizer
 //
 
-#define SND_PI       3.14159265
 #define INITIALEQ    false
 #define INITIALLG    1.0
 #define INITIALMG    1.0
@@ -249,110 +105,20 @@ public:
 #define INITIALLF    250.0
 #define INITIALHF    4000.0
 
-struct EQSTATE
-{
-  // Filter #1 (Low band)
-
-  double  lf;       // Frequency
-  double  f1p0;     // Poles ...
-  double  f1p1;    
-  double  f1p2;
-  double  f1p3;
-
-  // Filter #2 (High band)
-
-  double  hf;       // Frequency
-  double  f2p0;     // Poles ...
-  double  f2p1;
-  double  f2p2;
-  double  f2p3;
-
-  // Sample history buffer
-
-  double  sdm1;     // Sample data minus 1
-  double  sdm2;     //                   2
-  double  sdm3;     //                   3
-
-  // Gain Controls
-
-  double  lg;       // low  gain
-  double  mg;       // mid  gain
-  double  hg;       // high gain
-};
-
-struct eqparams_t
-{
-   double lowfreq;
-   double highfreq;
-   double lowgain;
-   double midgain;
-   double highgain;
-};
-
-static double do_3band(EQSTATE &es, double sample)
-{
-   static double vsa = (1.0 / 4294967295.0);
-   
-   // Locals
-   double l, m, h;    // Low / Mid / High - Sample Values
-
-   // Filter #1 (lowpass)
-   es.f1p0  += (es.lf * (sample  - es.f1p0)) + vsa;
-   es.f1p1  += (es.lf * (es.f1p0 - es.f1p1));
-   es.f1p2  += (es.lf * (es.f1p1 - es.f1p2));
-   es.f1p3  += (es.lf * (es.f1p2 - es.f1p3));
-
-   l         = es.f1p3;
-
-   // Filter #2 (highpass)
-   es.f2p0  += (es.hf * (sample  - es.f2p0)) + vsa;
-   es.f2p1  += (es.hf * (es.f2p0 - es.f2p1));
-   es.f2p2  += (es.hf * (es.f2p1 - es.f2p2));
-   es.f2p3  += (es.hf * (es.f2p2 - es.f2p3));
-
-   h         = es.sdm3 - es.f2p3;
-
-   // Calculate midrange (signal - (low + high))
-   m         = es.sdm3 - (h + l); // haleyjd 07/05/10: which is right?
-
-   // Scale, Combine and store
-   l        *= es.lg;
-   m        *= es.mg;
-   h        *= es.hg;
-
-   // Shuffle history buffer
-   es.sdm3   = es.sdm2;
-   es.sdm2   = es.sdm1;
-   es.sdm1   = sample;                
-
-   return (l + m + h);
-}
-
-static void init_3band(const eqparams_t &params, EQSTATE &eql, EQSTATE &eqr)
-{
-   // flush out state of equalizers
-   memset(&eql, 0, sizeof(eql));
-   memset(&eqr, 0, sizeof(eqr));
-
-   // Set Low/Mid/High gains 
-   eql.lg = eqr.lg = params.lowgain;
-   eql.mg = eqr.mg = params.midgain;
-   eql.hg = eqr.hg = params.highgain;
-
-   // Calculate filter cutoff frequencies
-   eql.lf = eqr.lf = 2 * sin(SND_PI * (params.lowfreq  / (double)MAXSR));
-   eql.hf = eqr.hf = 2 * sin(SND_PI * (params.highfreq / (double)MAXSR));
-}
-
-static void clear_3band(EQSTATE &eq)
-{
-   eq.sdm1 = eq.sdm2 = eq.sdm3 = 0.0;
-}
-
 //=============================================================================
 //
 // revmodel
 //
+// Everything runs in single precision on planar buffers. Denormals are left
+// to the caller's DSPDenormalGuard.
+//
+// The comb filters all take the same input but are each recursive, so the
+// eight combs of each channel run across SIMD lanes a frame at a time. The
+// allpasses are in series, so each one runs across frames a block at a time
+// before the next. A frame reads only what was written size frames before
+// it, so any run of frames that stops at the end of the delay buffer reads
+// every slot before writing it; the blocks are split into such runs.
+//
 
 class revmodel
 {
@@ -368,82 +134,61 @@ public:
    bool   doEQ;
 
    // equalizer
-   EQSTATE eql, eqr;
+   eqstate_t  eq;
    eqparams_t eqparams;
 
-   // comb filters
-   comb combL[NUMCOMBS];
-   comb combR[NUMCOMBS];
-
-   // allpass filters
-   allpass allpassL[NUMALLPASSES];
-   allpass allpassR[NUMALLPASSES];
-
-   // Buffers for the combs
-   double bufcombL1[COMBTUNINGL1];
-   double bufcombR1[COMBTUNINGR1];
-   double bufcombL2[COMBTUNINGL2];
-   double bufcombR2[COMBTUNINGR2];
-   double bufcombL3[COMBTUNINGL3];
-   double bufcombR3[COMBTUNINGR3];
-   double bufcombL4[COMBTUNINGL4];
-   double bufcombR4[COMBTUNINGR4];
-   double bufcombL5[COMBTUNINGL5];
-   double bufcombR5[COMBTUNINGR5];
-   double bufcombL6[COMBTUNINGL6];
-   double bufcombR6[COMBTUNINGR6];
-   double bufcombL7[COMBTUNINGL7];
-   double bufcombR7[COMBTUNINGR7];
-   double bufcombL8[COMBTUNINGL8];
-   double bufcombR8[COMBTUNINGR8];
-
-   // Buffers for the allpasses
-   double bufallpassL1[ALLPASSTUNINGL1];
-   double bufallpassR1[ALLPASSTUNINGR1];
-   double bufallpassL2[ALLPASSTUNINGL2];
-   double bufallpassR2[ALLPASSTUNINGR2];
-   double bufallpassL3[ALLPASSTUNINGL3];
-   double bufallpassR3[ALLPASSTUNINGR3];
-   double bufallpassL4[ALLPASSTUNINGL4];
-   double bufallpassR4[ALLPASSTUNINGR4];
+   // comb filters; the left channel's come first
+   float *combbuf[2 * NUMCOMBS];
+   int    combsize[2 * NUMCOMBS];
+   int    combidx[2 * NUMCOMBS];
+   float  combstore[2 * NUMCOMBS];
+   float  combfeedback;
+   float  combdamp1;
+   float  combdamp2;
+
+   // allpass filters, by channel
+   float *allpassbuf[2][NUMALLPASSES];
+   int    allpasssize[2][NUMALLPASSES];
+   int    allpassidx[2][NUMALLPASSES];
+
+   // pre-delay line
+   float  delaybuf[MAXDELAY * MAXSR / 1000];
+   size_t delaySize;
+   size_t readPos;
+   size_t writePos;
+
+   float combstorage[COMBSTORAGE];
+   float allpassstorage[ALLPASSSTORAGE];
 
    revmodel()
    {
-      combL[0].setbuffer(bufcombL1, COMBTUNINGL1);
-      combR[0].setbuffer(bufcombR1, COMBTUNINGR1);
-      combL[1].setbuffer(bufcombL2, COMBTUNINGL2);
-      combR[1].setbuffer(bufcombR2, COMBTUNINGR2);
-      combL[2].setbuffer(bufcombL3, COMBTUNINGL3);
-      combR[2].setbuffer(bufcombR3, COMBTUNINGR3);
-      combL[3].setbuffer(bufcombL4, COMBTUNINGL4);
-      combR[3].setbuffer(bufcombR4, COMBTUNINGR4);
-      combL[4].setbuffer(bufcombL5, COMBTUNINGL5);
-      combR[4].setbuffer(bufcombR5, COMBTUNINGR5);
-      combL[5].setbuffer(bufcombL6, COMBTUNINGL6);
-      combR[5].setbuffer(bufcombR6, COMBTUNINGR6);
-      combL[6].setbuffer(bufcombL7, COMBTUNINGL7);
-      combR[6].setbuffer(bufcombR7, COMBTUNINGR7);
-      combL[7].setbuffer(bufcombL8, COMBTUNINGL8);
-      combR[7].setbuffer(bufcombR8, COMBTUNINGR8);
-      allpassL[0].setbuffer(bufallpassL1, ALLPASSTUNINGL1);
-      allpassR[0].setbuffer(bufallpassR1, ALLPASSTUNINGR1);
-      allpassL[1].setbuffer(bufallpassL2, ALLPASSTUNINGL2);
-      allpassR[1].setbuffer(bufallpassR2, ALLPASSTUNINGR2);
-      allpassL[2].setbuffer(bufallpassL3, ALLPASSTUNINGL3);
-      allpassR[2].setbuffer(bufallpassR3, ALLPASSTUNINGR3);
-      allpassL[3].setbuffer(bufallpassL4, ALLPASSTUNINGL4);
-      allpassR[3].setbuffer(bufallpassR4, ALLPASSTUNINGR4);
-
-      // Set default values
-      allpassL[0].feedback = 0.5;
-      allpassR[0].feedback = 0.5;
-      allpassL[1].feedback = 0.5;
-      allpassR[1].feedback = 0.5;
-      allpassL[2].feedback = 0.5;
-      allpassR[2].feedback = 0.5;
-      allpassL[3].feedback = 0.5;
-      allpassR[3].feedback = 0.5;
-      
+      float *buf = combstorage;
+      for(int c = 0; c < 2; c++)
+      {
+         for(int i = 0; i < NUMCOMBS; i++)
+         {
+            const int n = c * NUMCOMBS + i;
+            combbuf[n]  = buf;
+            combsize[n] = combtuning[i] + c * STEREOSPREAD;
+            combidx[n]  = 0;
+            buf += combsize[n];
+         }
+      }
+
+      buf = allpassstorage;
+      for(int c = 0; c < 2; c++)
+      {
+         for(int i = 0; i < NUMALLPASSES; i++)
+         {
+            allpassbuf[c][i]  = buf;
+            allpasssize[c][i] = allpasstuning[i] + c * STEREOSPREAD;
+            allpassidx[c][i]  = 0;
+            buf += allpasssize[c][i];
+         }
+      }
+
+      delaySize = 0;
+
       // set initial parameters
       wet      = INITIALWET * SCALEWET;
       roomsize = (INITIALROOM * SCALEROOM) + OFFSETROOM;
@@ -459,6 +204,7 @@ public:
       eqparams.highgain = INITIALHG;
       eqparams.lowfreq  = INITIALLF;
       eqparams.highfreq = INITIALHF;
+      eqparams.preamp   = 1.0;
       update();
 
       // Buffer will be full of rubbish - so we MUST mute them
@@ -475,121 +221,232 @@ public:
       if(getMode() >= FREEZEMODE)
          return;
 
-      for(int i = 0; i < NUMCOMBS; i++)
+      memset(combstorage, 0, sizeof(combstorage));
+      memset(combstore, 0, sizeof(combstore));
+      memset(allpassstorage, 0, sizeof(allpassstorage));
+
+      delay_clearBuffer();
+      S_EQClear(eq);
+   }
+
+   //
+   // delay
+   //
+
+   void delay_clearBuffer()
+   {
+      for(size_t i = 0; i < delaySize; i++)
+         delaybuf[i] = 0.0f;
+   }
+
+   void delay_set(size_t delayms, size_t sr = MAXSR)
+   {
+      if(delayms > MAXDELAY)
+         delayms = MAXDELAY;
+      if(sr > MAXSR)
+         sr = MAXSR;
+      size_t curDelaySize = delaySize;
+      delaySize = delayms * sr / 1000;
+
+      if(delaySize != curDelaySize)
       {
-         combL[i].mute();
-         combR[i].mute();
+         readPos  = 0;
+         writePos = delaySize - 1;
+         delay_clearBuffer();
       }
-      for(int i = 0; i < NUMALLPASSES; i++)
+   }
+
+   void delay_process(float *input, int count)
+   {
+      for(int k = 0; k < count; k++)
       {
-         allpassL[i].mute();
-         allpassR[i].mute();
-      }
+         delaybuf[writePos] = input[k];
+         if(++writePos >= delaySize)
+            writePos = 0;
 
-      delay_clearBuffer();
-      clear_3band(eql);
-      clear_3band(eqr);
+         input[k] = delaybuf[readPos];
+         if(++readPos >= delaySize)
+            readPos = 0;
+      }
    }
 
-   void processReplace(float *inputL, float *inputR, 
-                       float *outputL, float *outputR,
-                       int numsamples, int skip)
+   //
+   // Runs the combs over count frames of mono input, writing the sum of each
+   // channel's combs to outL and outR.
+   //
+   void processCombs(const float *input, float *outL, float *outR, int count)
    {
-      double outL, outR, input;
+      const dsp4f_t feedback = DSP_Splat(combfeedback);
+      const dsp4f_t damp1v   = DSP_Splat(combdamp1);
+      const dsp4f_t damp2v   = DSP_Splat(combdamp2);
 
-      while(numsamples-- > 0)
-      {
-         outL = outR = 0;
-         input = (*inputL + *inputR) * gain;
+      dsp4f_t store[4];
+      for(int g = 0; g < 4; g++)
+         store[g] = DSP_Load(combstore + 4 * g);
 
-         // pre-delay
-         if(delay)
-         {
-            delay_writeSample(input);
-            input = delay_readSample();
-         }
+      float *p[2 * NUMCOMBS];
+      float  lanes[4];
 
-         // accumulate comb filters in parallel
-         for(int i = 0; i < NUMCOMBS; i++)
+      for(int done = 0; done < count; )
+      {
+         // run up to the next point where any of the buffers wraps
+         int run = count - done;
+         for(int n = 0; n < 2 * NUMCOMBS; n++)
          {
-            outL += combL[i].process(input);
-            outR += combR[i].process(input);
+            run  = emin(run, combsize[n] - combidx[n]);
+            p[n] = combbuf[n] + combidx[n];
          }
 
-         // feed through allpasses in series
-         for(int i = 0; i < NUMALLPASSES; i++)
+         for(int k = 0; k < run; k++)
          {
-            outL = allpassL[i].process(outL);
-            outR = allpassR[i].process(outR);
+            const dsp4f_t in = DSP_Splat(input[done + k]);
+            dsp4f_t sum[2];
+
+            for(int g = 0; g < 4; g++)
+            {
+               float *const *q = p + 4 * g;
+               const dsp4f_t output = DSP_Set(q[0][k], q[1][k], q[2][k], q[3][k]);
+
+               store[g] = DSP_MulAdd(output, damp2v, DSP_Mul(store[g], damp1v));
+
+               DSP_Store(lanes, DSP_MulAdd(store[g], feedback, in));
+               q[0][k] = lanes[0];
+               q[1][k] = lanes[1];
+               q[2][k] = lanes[2];
+               q[3][k] = lanes[3];
+
+               sum[g >> 1] = (g & 1) ? DSP_Add(sum[g >> 1], output) : output;
+            }
+
+            DSP_Store(lanes, sum[0]);
+            outL[done + k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            DSP_Store(lanes, sum[1]);
+            outR[done + k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
          }
 
-         // equalization pass
-         if(doEQ)
+         for(int n = 0; n < 2 * NUMCOMBS; n++)
          {
-            outL = do_3band(eql, outL);
-            outR = do_3band(eqr, outR);
+            if((combidx[n] += run) >= combsize[n])
+               combidx[n] = 0;
          }
+         done += run;
+      }
 
-         // calculate output replacing anything already there
-         *outputL = (float)(outL * wet1 + outR * wet2 + *inputL * dry);
-         *outputR = (float)(outR * wet1 + outL * wet2 + *inputR * dry);
+      for(int g = 0; g < 4; g++)
+         DSP_Store(combstore + 4 * g, store[g]);
+   }
+
+   //
+   // Feeds count frames of one channel through its allpasses in place
+   //
+   void processAllpasses(float *io, int channel, int count)
+   {
+      const dsp4f_t feedback = DSP_Splat(ALLPASSFEEDBACK);
+
+      for(int i = 0; i < NUMALLPASSES; i++)
+      {
+         float *const buffer = allpassbuf[channel][i];
+         const int    size   = allpasssize[channel][i];
+         int         &idx    = allpassidx[channel][i];
 
-         // increment sample pointers
-         inputL  += skip;
-         inputR  += skip;
-         outputL += skip;
-         outputR += skip;
+         for(int done = 0; done < count; )
+         {
+            // every slot in the run is read before it is rewritten
+            const int run = emin(count - done, size - idx);
+            float *b = buffer + idx;
+            float *x = io + done;
+            int    k = 0;
+
+            for(; k + 4 <= run; k += 4)
+            {
+               const dsp4f_t bufout = DSP_Load(b + k);
+               const dsp4f_t input  = DSP_Load(x + k);
+
+               DSP_Store(x + k, DSP_Sub(bufout, input));
+               DSP_Store(b + k, DSP_MulAdd(bufout, feedback, input));
+            }
+            for(; k < run; k++)
+            {
+               const float bufout = b[k];
+               const float input  = x[k];
+
+               x[k] = bufout - input;
+               b[k] = input + bufout * ALLPASSFEEDBACK;
+            }
+
+            if((idx += run) >= size)
+               idx = 0;
+            done += run;
+         }
       }
    }
 
-   void processMix(float *inputL, float *inputR, 
-                   float *outputL, float *outputR,
-                   int numsamples, int skip)
+   //
+   // Processes frames of planar stereo. The output either replaces what is
+   // in outputL and outputR or is mixed into it; input and output may be the
+   // same buffers.
+   //
+   void process(const float *inputL, const float *inputR, float *outputL, float *outputR,
+                int frames, bool mix)
    {
-      double outL, outR, input;
+      float input[DSP_BLOCK], wetL[DSP_BLOCK], wetR[DSP_BLOCK];
 
-      while(numsamples-- > 0)
+      const float   fgain = static_cast<float>(gain);
+      const dsp4f_t vwet1 = DSP_Splat(static_cast<float>(wet1));
+      const dsp4f_t vwet2 = DSP_Splat(static_cast<float>(wet2));
+      const dsp4f_t vdry  = DSP_Splat(static_cast<float>(dry));
+
+      for(int base = 0; base < frames; base += DSP_BLOCK)
       {
-         outL = outR = 0;
-         input = (*inputL + *inputR) * gain;
+         const int    count = emin(frames - base, DSP_BLOCK);
+         const float *inL   = inputL + base;
+         const float *inR   = inputR + base;
+         float       *outL  = outputL + base;
+         float       *outR  = outputR + base;
+
+         for(int k = 0; k < count; k++)
+            input[k] = (inL[k] + inR[k]) * fgain;
 
          // pre-delay
          if(delay)
-         {
-            delay_writeSample(input);
-            input = delay_readSample();
-         }
+            delay_process(input, count);
 
          // accumulate comb filters in parallel
-         for(int i = 0; i < NUMCOMBS; i++)
-         {
-            outL += combL[i].process(input);
-            outR += combR[i].process(input);
-         }
+         processCombs(input, wetL, wetR, count);
 
          // feed through allpasses in series
-         for(int i = 0; i < NUMALLPASSES; i++)
-         {
-            outL = allpassL[i].process(outL);
-            outR = allpassR[i].process(outR);
-         }
+         processAllpasses(wetL, 0, count);
+         processAllpasses(wetR, 1, count);
 
          // equalization pass
          if(doEQ)
+            S_EQProcess(eq, wetL, wetR, count);
+
+         // calculate output, replacing or mixing with anything already there
+         int k = 0;
+         for(; k + 4 <= count; k += 4)
          {
-            outL = do_3band(eql, outL);
-            outR = do_3band(eqr, outR);
+            const dsp4f_t l = DSP_Load(wetL + k);
+            const dsp4f_t r = DSP_Load(wetR + k);
+            dsp4f_t       mixL = DSP_MulAdd(l, vwet1, DSP_MulAdd(r, vwet2, DSP_Mul(DSP_Load(inL + k), vdry)));
+            dsp4f_t       mixR = DSP_MulAdd(r, vwet1, DSP_MulAdd(l, vwet2, DSP_Mul(DSP_Load(inR + k), vdry)));
+
+            if(mix)
+            {
+               mixL = DSP_Add(mixL, DSP_Load(outL + k));
+               mixR = DSP_Add(mixR, DSP_Load(outR + k));
+            }
+            DSP_Store(outL + k, mixL);
+            DSP_Store(outR + k, mixR);
          }
+         for(; k < count; k++)
+         {
+            const float mixL = static_cast<float>(wetL[k] * wet1 + wetR[k] * wet2 + inL[k] * dry);
+            const float mixR = static_cast<float>(wetR[k] * wet1 + wetL[k] * wet2 + inR[k] * dry);
 
-         // calculate output mixing with anything already there
-         *outputL += (float)(outL * wet1 + outR * wet2 + *inputL * dry);
-         *outputR += (float)(outR * wet1 + outL * wet2 + *inputR * dry);
-
-         // increment sample pointers
-         inputL  += skip;
-         inputR  += skip;
-         outputL += skip;
-         outputR += skip;
+            outL[k] = mix ? outL[k] + mixL : mixL;
+            outR[k] = mix ? outR[k] + mixR : mixR;
+         }
       }
    }
 
@@ -611,15 +468,11 @@ public:
          gain      = FIXEDGAIN;
       }
 
-      for(int i = 0; i < NUMCOMBS; i++)
-      {
-         combL[i].feedback = roomsize1;
-         combL[i].setdamp(damp1);
-         combR[i].feedback = roomsize1;
-         combR[i].setdamp(damp1);
-      }
+      combfeedback = static_cast<float>(roomsize1);
+      combdamp1    = static_cast<float>(damp1);
+      combdamp2    = static_cast<float>(1 - damp1);
 
-      init_3band(eqparams, eql, eqr);
+      S_EQInit(eq, eqparams, MAXSR);
    }
 
    void setRoomSize(double value)
@@ -723,22 +576,115 @@ void S_ReverbSetState(ereverb_t *ereverb)
 }
 
 //
-// Mix the reverb engine's output into the input sound stream.
+// Mix the reverb engine's output into a planar stereo stream.
 //
-void S_ProcessReverb(float *stream, const int samples, const int skip)
+void S_ProcessReverb(float *left, float *right, int frames)
 {
-   reverb.processMix(stream, stream+1, stream, stream+1, samples, skip);
+   reverb.process(left, right, left, right, frames, true);
 }
 
 //
 // S_ProcessReverbReplace
 //
-// Replace the input sound stream with the reverb engine's output.
+// Replace a planar stereo stream with the reverb engine's output.
 //
-void S_ProcessReverbReplace(float *stream, int samples)
+void S_ProcessReverbReplace(float *left, float *right, int frames)
 {
-   reverb.processReplace(stream, stream+1, stream, stream+1, samples, 2);
+   reverb.process(left, right, left, right, frames, false);
 }
 
-// EOF
+//=============================================================================
+//
+// Benchmark
+//
+
+#define BENCHFRAMES  (MAXSR * 10) // ten seconds of audio
+#define BENCHBUFFER  1024         // a typical callback
+
+static uint64_t S_benchCycles()
+{
+#ifdef S_HAVE_RDTSC
+   return __rdtsc();
+#else
+   return 0;
+#endif
+}
 
+static int64_t S_benchNanoseconds()
+{
+   using namespace std::chrono;
+   return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//
+// Fills a planar stereo buffer with repeatable noise
+//
+static void S_benchNoise(float *left, float *right, int frames, uint32_t &seed)
+{
+   for(int k = 0; k < frames; k++)
+   {
+      seed = seed * 1664525 + 1013904223;
+      left[k]  = static_cast<float>(int32_t(seed)) * (0.25f / 2147483648.0f);
+      seed = seed * 1664525 + 1013904223;
+      right[k] = static_cast<float>(int32_t(seed)) * (0.25f / 2147483648.0f);
+   }
+}
+
+//
+// Times fn over BENCHFRAMES frames of noise and prints the cost per frame.
+// Cycles are TSC ticks, so they only match core clocks at base frequency.
+//
+template<typename F>
+static void S_benchRun(const char *name, F &&fn)
+{
+   float    left[BENCHBUFFER], right[BENCHBUFFER];
+   uint32_t seed    = 1;
+   int64_t  ns      = 0;
+   uint64_t cycles  = 0;
+
+   for(unsigned int done = 0; done < BENCHFRAMES; done += BENCHBUFFER)
+   {
+      S_benchNoise(left, right, BENCHBUFFER, seed);
+
+      const int64_t  startns     = S_benchNanoseconds();
+      const uint64_t startcycles = S_benchCycles();
+      fn(left, right, BENCHBUFFER);
+      cycles += S_benchCycles() - startcycles;
+      ns     += S_benchNanoseconds() - startns;
+   }
+
+   const double frames = double(BENCHFRAMES / BENCHBUFFER * BENCHBUFFER);
+   C_Printf("%-8s %7.2f ns  %7.1f cycles  %6.0fx realtime\n", name, ns / frames,
+            cycles / frames, ns ? frames / MAXSR * 1.0e9 / ns : 0.0);
+}
+
+//
+// Runs the effect chain on a private reverb model and equalizer, so it is
+// safe to use while sound is playing.
+//
+CONSOLE_COMMAND(s_dspbench, 0)
+{
+   DSPDenormalGuard denormals;
+
+   revmodel *model = new revmodel;
+   model->setRoomSize(0.9);
+   model->setDelay(50);
+   model->doEQ = true;
+   model->update();
+
+   eqstate_t        eq;
+   const eqparams_t eqparams = { 250.0, 4000.0, 1.2, 1.0, 0.8, 0.93896 };
+   S_EQInit(eq, eqparams, MAXSR);
+
+   C_Printf(FC_HI "DSP cost per stereo frame:\n");
+   S_benchRun("reverb", [model](float *l, float *r, int n) {
+      model->process(l, r, l, r, n, true);
+   });
+   S_benchRun("eq", [&eq](float *l, float *r, int n) {
+      S_EQProcess(eq, l, r, n);
+   });
+
+   delete model;
+}
+
+// EOF
@@ -36,8 +36,8 @@ struct ereverb_t;
 void S_SuspendReverb();
 void S_ResumeReverb();
 void S_ReverbSetState(ereverb_t *ereverb);
-void S_ProcessReverb(float *stream, const int samples, const int skip);
-void S_ProcessReverbReplace(float *stream, int samples);
+void S_ProcessReverb(float *left, float *right, int frames);
+void S_ProcessReverbReplace(float *left, float *right, int frames);
 
 #endif
 
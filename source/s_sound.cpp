@@ -51,6 +51,7 @@
 #include "r_defs.h"
 #include "r_main.h"
 #include "r_state.h"
+#include "s_mixer.h"
 #include "s_reverb.h"
 #include "s_sound.h"
 #include "v_misc.h"
@@ -1492,6 +1493,7 @@ void S_Init(int sfxVolume, int musicVolume)
 
    if(s_precache)        // sf: option to precache sounds
    {
+      wGlobalDir.prefetchNamespace(lumpinfo_t::ns_sounds);
       E_PreCacheSounds();
       usermsg("\tprecached all sounds.");
    }
@@ -1610,7 +1612,7 @@ musicinfo_t *S_MusicForName(const char *name)
 
 VARIABLE_BOOLEAN(s_precache,      nullptr, onoff);
 VARIABLE_BOOLEAN(pitched_sounds,  nullptr, onoff);
-VARIABLE_INT(default_numChannels, nullptr, 1, 32,  nullptr);
+VARIABLE_INT(default_numChannels, nullptr, 1, MIXER_MAXVOICES, nullptr);
 VARIABLE_INT(snd_SfxVolume,       nullptr, 0, 15,  nullptr);
 VARIABLE_INT(snd_MusicVolume,     nullptr, 0, 15,  nullptr);
 VARIABLE_BOOLEAN(forceFlipPan,    nullptr, onoff);
@@ -93,9 +93,13 @@ int main(int argc, char **argv)
    // haleyjd 04/15/02: added check for failure
    // ioanch: avoid loading SDL_VIDEO if -nodraw and -nosound are combined.
    // FIXME: code duplication; the global booleans aren't assigned yet.
-   Uint32 initflags = (M_CheckParm("-nodraw") &&
-                       (M_CheckParm("-nosound") || (M_CheckParm("-nosfx") &&
-                                                    M_CheckParm("-nomusic")))) ?
+   // -benchmark implies -nosound, and is headless unless -benchwindow is given.
+   // -demobatch only runs workers, which are given -nodraw -nosound themselves.
+   Uint32 initflags = ((M_CheckParm("-nodraw") &&
+                        (M_CheckParm("-nosound") || (M_CheckParm("-nosfx") &&
+                                                     M_CheckParm("-nomusic")))) ||
+                       (M_CheckParm("-benchmark") && !M_CheckParm("-benchwindow")) ||
+                       M_CheckParm("-demobatch")) ?
    SDL_INIT_JOYSTICK : SDL_INIT_VIDEO | SDL_INIT_JOYSTICK;
    if(SDL_Init(initflags) == -1)
    {
@@ -25,7 +25,8 @@
 #include "SDL.h"
 #include "SDL_opengl.h"
 
-// HAL header
+// HAL headers
+#include "../hal/i_palexpand.h"
 #include "../hal/i_platform.h"
 
 // DOOM headers
@@ -85,12 +86,21 @@ static GLuint textureid;
 // Framebuffer texture data
 static Uint32 *framebuffer;
 
+// Copy of the screen taken by StageFrame when pipelined
+static byte *stagedscreen;
+
+// Source, destination and destination height of the next ConvertFrame
+static const byte  *convertsource;
+static void        *convertdest;
+static unsigned int convertheight;
+
 // Bump amount used to avoid cache misses on power-of-two-sized screens
 static int bump;
 
 // Options
 static bool   use_arb_pbo; // If true, use ARB pixel buffer object extension
 static GLuint pboIDs[2];   // IDs of pixel buffer objects
+static int    pboindex;    // the one uploaded from this frame
 
 // PBO extension function pointers
 static PFNGLGENBUFFERSARBPROC    pglGenBuffersARB    = nullptr;
@@ -153,44 +163,21 @@ static void GL2D_setupVertexArray(
 //
 // Protected method.
 //
-void SDLGL2DVideoDriver::DrawPixels(void *buffer, unsigned int destheight)
+void SDLGL2DVideoDriver::DrawPixels(const byte *source, void *buffer,
+                                    unsigned int destheight)
 {
-   Uint32   *fb            = static_cast<Uint32 *>(buffer);
-   const int d_end         = screen->w & ~7;
-   const int d_remainder   = screen->w & 7;
-   const int render_height = screen->h - bump;
-
-   for(int y = 0; y < render_height; y++)
-   {
-      byte   *src  = static_cast<byte *>(screen->pixels) + y * screen->pitch;
-      Uint32 *dest = fb + y * destheight;
-
-      for(int x = d_end; x; x -= 8)
-      {
-         *dest   = RGB8to32[*src];
-         dest[1] = RGB8to32[src[1]];
-         dest[2] = RGB8to32[src[2]];
-         dest[3] = RGB8to32[src[3]];
-         dest[4] = RGB8to32[src[4]];
-         dest[5] = RGB8to32[src[5]];
-         dest[6] = RGB8to32[src[6]];
-         dest[7] = RGB8to32[src[7]];
-         src  += 8;
-         dest += 8;
-      }
-      for(int i = d_remainder; i; i--)
-      {
-         *dest = RGB8to32[*src];
-         ++src;
-         ++dest;
-      }
-   }
+   I_ExpandPalette(source, screen->pitch, static_cast<Uint32 *>(buffer), int(destheight),
+                   screen->w, screen->h - bump, RGB8to32);
 }
 
 //
-// SDLGL2DVideoDriver::FinishUpdate
+// SDLGL2DVideoDriver::BeginUpdate
 //
-void SDLGL2DVideoDriver::FinishUpdate()
+// Protected method. Picks the source and destination of the next conversion,
+// first copying the screen aside if staged is set so that the game can draw
+// over it meanwhile. Returns false if the frame shouldn't be shown.
+//
+bool SDLGL2DVideoDriver::BeginUpdate(bool staged)
 {
    // haleyjd 10/08/05: from Chocolate DOOM:
    UpdateGrab(window);
@@ -199,30 +186,30 @@ void SDLGL2DVideoDriver::FinishUpdate()
    // Not doing this breaks under Windows when we alt-tab away 
    // while fullscreen.   
    if(!(SDL_GetWindowFlags(window) & SDL_WINDOW_SHOWN))
-      return;
+      return false;
 
-   if(!use_arb_pbo)
+   convertsource = static_cast<byte *>(screen->pixels);
+
+   if(staged)
    {
-      // Convert the game's 8-bit output to the 32-bit texture buffer
-      DrawPixels(framebuffer, static_cast<unsigned int>(video.height));
+      const size_t size = size_t(screen->pitch) * screen->h;
 
-      // bind the framebuffer texture if necessary
-      GL_BindTextureIfNeeded(textureid);
+      if(!stagedscreen)
+         stagedscreen = emalloc(byte *, size);
+      memcpy(stagedscreen, screen->pixels, size);
+      convertsource = stagedscreen;
+   }
 
-      // update the texture data
-      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 
-                      static_cast<GLsizei>(video.height), static_cast<GLsizei>(video.width),
-                      GL_BGRA, GL_UNSIGNED_BYTE, static_cast<GLvoid *>(framebuffer));
+   if(!use_arb_pbo)
+   {
+      // Convert the game's 8-bit output to the 32-bit texture buffer
+      convertdest   = framebuffer;
+      convertheight = static_cast<unsigned int>(video.height);
    }
    else
    {
-      static int pboindex  = 0;
-      int        nextindex = 0;
-      GLvoid    *ptr       = nullptr;
-
       // use the two pixel buffers in a rotation
-      pboindex  = (pboindex + 1) % 2;
-      nextindex = (pboindex + 1) % 2;
+      pboindex = (pboindex + 1) % 2;
 
       // bind the framebuffer texture if necessary
       GL_BindTextureIfNeeded(textureid);
@@ -236,23 +223,58 @@ void SDLGL2DVideoDriver::FinishUpdate()
                    nullptr);
 
       // bind the secondary PBO
-      pglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, pboIDs[nextindex]);
+      pglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, pboIDs[(pboindex + 1) % 2]);
 
-      // map the PBO into client memory in such a way as to avoid stalls
+      // map the PBO into client memory in such a way as to avoid stalls;
+      // the frame is drawn directly into video memory
       pglBufferDataARB(GL_PIXEL_UNPACK_BUFFER_ARB, texturesize, nullptr, GL_STREAM_DRAW_ARB);
+      convertdest   = pglMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB);
+      convertheight = framebuffer_vmax;
 
-      if((ptr = pglMapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, GL_WRITE_ONLY_ARB)))
-      {
-         // draw directly into video memory
-         DrawPixels(ptr, framebuffer_vmax);
+      // Unbind all PBOs
+      pglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
+   }
 
-         // release pointer
-         pglUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
-      }
+   return true;
+}
 
-      // Unbind all PBOs
+//
+// SDLGL2DVideoDriver::ConvertFrame
+//
+// Expands the frame picked by BeginUpdate to 32-bit. Makes no GL calls, so it
+// can run on the present thread.
+//
+void SDLGL2DVideoDriver::ConvertFrame()
+{
+   if(convertdest)
+      DrawPixels(convertsource, convertdest, convertheight);
+}
+
+//
+// SDLGL2DVideoDriver::PresentFrame
+//
+// Hands the converted frame to GL and shows it.
+//
+void SDLGL2DVideoDriver::PresentFrame()
+{
+   if(!use_arb_pbo)
+   {
+      // bind the framebuffer texture if necessary
+      GL_BindTextureIfNeeded(textureid);
+
+      // update the texture data
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 
+                      static_cast<GLsizei>(video.height), static_cast<GLsizei>(video.width),
+                      GL_BGRA, GL_UNSIGNED_BYTE, static_cast<GLvoid *>(framebuffer));
+   }
+   else if(convertdest)
+   {
+      // release pointer
+      pglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, pboIDs[(pboindex + 1) % 2]);
+      pglUnmapBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB);
       pglBindBufferARB(GL_PIXEL_UNPACK_BUFFER_ARB, 0);
    }
+   convertdest = nullptr;
 
    // draw vertex array
    glDrawElements(GL_TRIANGLES, 3*2, GL_UNSIGNED_BYTE, screenVtxOrder);
@@ -261,6 +283,28 @@ void SDLGL2DVideoDriver::FinishUpdate()
    SDL_GL_SwapWindow(window);
 }
 
+//
+// SDLGL2DVideoDriver::FinishUpdate
+//
+void SDLGL2DVideoDriver::FinishUpdate()
+{
+   if(BeginUpdate(false))
+   {
+      ConvertFrame();
+      PresentFrame();
+   }
+}
+
+//
+// SDLGL2DVideoDriver::StageFrame
+//
+// Pipelined counterpart of FinishUpdate; see HALVideoDriver.
+//
+bool SDLGL2DVideoDriver::StageFrame()
+{
+   return BeginUpdate(true);
+}
+
 //
 // SDLGL2DVideoDriver::ReadScreen
 //
@@ -337,6 +381,11 @@ void SDLGL2DVideoDriver::SetPrimaryBuffer()
 //
 void SDLGL2DVideoDriver::UnsetPrimaryBuffer()
 {
+   if(stagedscreen)
+   {
+      efree(stagedscreen);
+      stagedscreen = nullptr;
+   }
    if(screen)
    {
       SDL_FreeSurface(screen);
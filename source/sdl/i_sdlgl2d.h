@@ -41,8 +41,9 @@ class SDLGL2DVideoDriver : public HALVideoDriver
 protected:
    int colordepth;
 
-   void DrawPixels(void *buffer, unsigned int destheight);
+   void DrawPixels(const byte *source, void *buffer, unsigned int destheight);
    void LoadPBOExtension();
+   bool BeginUpdate(bool staged);
 
    virtual void SetPrimaryBuffer();
    virtual void UnsetPrimaryBuffer();
@@ -56,6 +57,11 @@ public:
    virtual void ShutdownGraphicsPartway();
    virtual bool InitGraphicsMode();
 
+   virtual bool CanPipeline() const { return true; }
+   virtual bool StageFrame();
+   virtual void ConvertFrame();
+   virtual void PresentFrame();
+
    // Accessors
    void SetColorDepth(int cd) { colordepth = cd; }
 };
@@ -26,7 +26,12 @@
 // haleyjd 11/22/08: I don't understand why this is needed here...
 #define USE_RWOPS
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <optional>
+#include <thread>
 
 #ifdef __APPLE__
 #include "SDL2/SDL.h"
@@ -77,6 +82,156 @@ extern SDL_AudioSpec audio_spec;
 #define STEP 2
 #define STEPSHIFT 1
 
+//=============================================================================
+//
+// Synthesis Thread
+//
+// SPC and ADLMIDI music is rendered ahead on a thread of its own, into a
+// single-producer, single-consumer ring of output-format samples. The
+// SDL_mixer music hook only copies out of the ring, so emulating more chips
+// can't make the audio thread miss its deadline.
+//
+
+// Depth of the ring, in audio callback buffers
+int snd_musicbuffers = 4;
+
+#if defined(HAVE_SPCLIB) || defined(HAVE_ADLMIDILIB)
+
+// Renders len bytes of output into a zeroed buffer
+using musicrender_t = void (*)(void *udata, Uint8 *stream, int len);
+
+static Uint8       *musicring;
+static unsigned int musicringsize;  // bytes; a multiple of musicchunk
+static unsigned int musicchunk;     // bytes rendered at a time
+static unsigned int musicringwrite; // synthesis thread only
+static unsigned int musicringread;  // audio thread only
+
+// Bytes rendered but not yet played
+static std::atomic<unsigned int> musicringfill;
+
+static musicrender_t musicrender;
+static bool          musicpausable;  // stop output while Mix_PausedMusic
+static bool          musichookvolume; // apply snd_MusicVolume while copying
+
+static std::thread             musicthread;
+static std::atomic<bool>       musicthreadquit;
+static std::mutex              musicwakemutex;
+static std::condition_variable musicwake; // the hook has made room
+
+//
+// Synthesis thread loop. Renders a chunk whenever there's room for one, and
+// otherwise sleeps until the music hook takes some. The timeout covers a
+// wakeup that lands between the check and the wait.
+//
+static void I_musicThreadFunc()
+{
+   while(!musicthreadquit.load(std::memory_order_acquire))
+   {
+      if(musicringsize - musicringfill.load(std::memory_order_acquire) < musicchunk)
+      {
+         std::unique_lock<std::mutex> lock(musicwakemutex);
+         musicwake.wait_for(lock, std::chrono::milliseconds(2));
+         continue;
+      }
+
+      // chunks never straddle the end, since the size is a multiple of them
+      Uint8 *dest = musicring + musicringwrite;
+      memset(dest, 0, musicchunk);
+      musicrender(nullptr, dest, int(musicchunk));
+
+      musicringwrite = (musicringwrite + musicchunk) % musicringsize;
+      musicringfill.fetch_add(musicchunk, std::memory_order_release);
+   }
+}
+
+//
+// SDL_mixer music hook. Copies out whatever has been rendered; an underrun
+// only leaves the rest of this buffer silent.
+//
+static void I_musicStreamHook(void *udata, Uint8 *stream, int len)
+{
+   // TODO: Remove the exiting check once all atexit calls are erradicated
+   if(musicpausable && Mix_PausedMusic()) //if(exiting || Mix_PausedMusic())
+      return;
+
+   const int    volume = musichookvolume ? (snd_MusicVolume * 128) / 15 : SDL_MIX_MAXVOLUME;
+   unsigned int count  = emin(unsigned(len), musicringfill.load(std::memory_order_acquire));
+   unsigned int copied = 0;
+
+   while(copied < count)
+   {
+      const unsigned int seg = emin(count - copied, musicringsize - musicringread);
+
+      if(volume == SDL_MIX_MAXVOLUME)
+         memcpy(stream + copied, musicring + musicringread, seg);
+      else
+      {
+         SDL_MixAudioFormat(stream + copied, musicring + musicringread, audio_spec.format,
+                            seg, volume);
+      }
+
+      musicringread = (musicringread + seg) % musicringsize;
+      copied += seg;
+   }
+
+   musicringfill.fetch_sub(copied, std::memory_order_release);
+   musicwake.notify_one();
+}
+
+//
+// Unhooks the music and stops the synthesis thread. The player objects may
+// be touched freely once this returns.
+//
+static void I_stopMusicStream()
+{
+   Mix_HookMusic(nullptr, nullptr);
+
+   if(musicthread.joinable())
+   {
+      musicthreadquit.store(true, std::memory_order_release);
+      musicwake.notify_one();
+      musicthread.join();
+   }
+}
+
+//
+// Starts rendering music with render and hooks it into SDL_mixer
+//
+static void I_startMusicStream(musicrender_t render, bool pausable, bool hookvolume)
+{
+   I_stopMusicStream();
+
+   musicchunk = static_cast<unsigned int>(audio_spec.size);
+
+   const unsigned int size = musicchunk * static_cast<unsigned int>(snd_musicbuffers);
+   if(size != musicringsize)
+   {
+      if(musicring)
+         efree(musicring);
+      musicring     = emalloc(Uint8 *, size);
+      musicringsize = size;
+   }
+
+   // have a chunk ready for the first callback
+   memset(musicring, 0, musicchunk);
+   render(nullptr, musicring, int(musicchunk));
+
+   musicringwrite = musicchunk % musicringsize;
+   musicringread  = 0;
+   musicringfill.store(musicchunk, std::memory_order_relaxed);
+
+   musicrender     = render;
+   musicpausable   = pausable;
+   musichookvolume = hookvolume;
+
+   musicthreadquit.store(false, std::memory_order_relaxed);
+   musicthread = std::thread(I_musicThreadFunc);
+
+   Mix_HookMusic(I_musicStreamHook, nullptr);
+}
+
+#endif
+
 #ifdef HAVE_SPCLIB
 // haleyjd 05/02/08: SPC support
 static SNES_SPC   *snes_spc   = nullptr;
@@ -91,7 +246,7 @@ void I_SDLMusicSetSPCBass(void)
       spc_filter_set_bass(spc_filter, spc_bass_boost);
 }
 //
-// SDL_mixer effect processor; mixes SPC data into the postmix stream.
+// Renders SPC data for the synthesis thread.
 //
 template<typename T>
 static void I_effectSPC(void *udata, Uint8 *stream, int len)
@@ -179,7 +334,6 @@ static void I_effectSPC(void *udata, Uint8 *stream, int len)
 
 #ifdef HAVE_ADLMIDILIB
 static ADL_MIDIPlayer *adlmidi_player = nullptr;
-volatile bool adlplaying = false;
 
 int midi_device      = 0;
 int adlmidi_numchips = 2;
@@ -187,22 +341,13 @@ int adlmidi_bank     = 72;
 int adlmidi_emulator = 0;
 
 //
-// Play a MIDI via libADLMIDI
+// Play a MIDI via libADLMIDI. Renders for the synthesis thread; volume is
+// applied by the music hook.
 //
 template<typename T>
 static void I_effectADLMIDI(void *udata, Uint8 *stream, int len)
 {
    static constexpr unsigned int ADLMIDISTEP = sizeof(T);
-   static T   *adlmidi_buffer     = nullptr;
-   static int  lastadlmidisamples = 0;
-
-   adlplaying = true;
-   // TODO: Remove the exiting check once all atexit calls are erradicated
-   if(Mix_PausedMusic()) //if(exiting || Mix_PausedMusic())
-   {
-      adlplaying = false;
-      return;
-   }
 
    ADLMIDI_AudioFormat fmt = { ADLMIDI_SampleType_S16, ADLMIDISTEP, ADLMIDISTEP * audio_spec.channels };
    if constexpr(std::is_same_v<T, Sint16>)
@@ -214,26 +359,9 @@ static void I_effectADLMIDI(void *udata, Uint8 *stream, int len)
 
    const int numsamples = (len * 2) / fmt.sampleOffset;
 
-   // realloc ADLMIDI buffer?
-   if(numsamples != lastadlmidisamples)
-   {
-      // add extra buffer samples at end for filtering safety; stereo channels
-      adlmidi_buffer = static_cast<T *>(Z_SysRealloc(adlmidi_buffer, len));
-      lastadlmidisamples = numsamples;
-   }
-
-   ADL_UInt8 *const l_out = reinterpret_cast<ADL_UInt8 *>(adlmidi_buffer);
-   ADL_UInt8 *const r_out = reinterpret_cast<ADL_UInt8 *>(adlmidi_buffer + 1);
-   const int gotlen = adl_playFormat(adlmidi_player, numsamples, l_out, r_out, &fmt) *
-                      fmt.sampleOffset / 2;
-   if(snd_MusicVolume == 15)
-      memcpy(stream, reinterpret_cast<Uint8 *>(adlmidi_buffer), size_t(gotlen));
-   else
-   {
-      SDL_MixAudioFormat(stream, reinterpret_cast<Uint8 *>(adlmidi_buffer), audio_spec.format,
-                         gotlen, (snd_MusicVolume * 128) / 15);
-   }
-   adlplaying = false;
+   ADL_UInt8 *const l_out = reinterpret_cast<ADL_UInt8 *>(stream);
+   ADL_UInt8 *const r_out = reinterpret_cast<ADL_UInt8 *>(stream) + ADLMIDISTEP;
+   adl_playFormat(adlmidi_player, numsamples, l_out, r_out, &fmt);
 }
 
 #endif
@@ -372,14 +500,15 @@ static void I_SDLPlaySong(int handle, int looping)
 #ifdef HAVE_SPCLIB
    // if a SPC is set up, play it.
    if(snes_spc)
-      Mix_HookMusic(float_samples ? I_effectSPC<float> : I_effectSPC<Sint16>, nullptr);
+      I_startMusicStream(float_samples ? I_effectSPC<float> : I_effectSPC<Sint16>, false, false);
    else
 #endif
 #ifdef HAVE_ADLMIDILIB
       if(adlmidi_player)
       {
-         Mix_HookMusic(float_samples ? I_effectADLMIDI<float> : I_effectADLMIDI<Sint16>, nullptr);
          adl_setLoopEnabled(adlmidi_player, looping);
+         I_startMusicStream(float_samples ? I_effectADLMIDI<float> : I_effectADLMIDI<Sint16>,
+                            true, true);
       }
       else
 #endif
@@ -493,14 +622,8 @@ static void I_SDLStopSong(int handle)
    if(CHECK_MUSIC(handle))
       Mix_HaltMusic();
 
-#ifdef HAVE_SPCLIB
-   if(snes_spc)
-      Mix_HookMusic(nullptr, nullptr);
-#endif
-
-#ifdef HAVE_ADLMIDILIB
-   if(adlmidi_player)
-      Mix_HookMusic(nullptr, nullptr);
+#if defined(HAVE_SPCLIB) || defined(HAVE_ADLMIDILIB)
+   I_stopMusicStream();
 #endif
 }
 
@@ -520,7 +643,7 @@ static void I_SDLUnRegisterSong(int handle)
 #ifdef HAVE_ADLMIDILIB
    if(adlmidi_player)
    {
-      Mix_HookMusic(nullptr, nullptr);
+      I_stopMusicStream();
       adl_close(adlmidi_player);
       adlmidi_player = nullptr;
    }
@@ -548,7 +671,7 @@ static void I_SDLUnRegisterSong(int handle)
    if(snes_spc)
    {
       // be certain the callback is unregistered first
-      Mix_HookMusic(nullptr, nullptr);
+      I_stopMusicStream();
 
       // free the spc and filter objects
       spc_delete(snes_spc);
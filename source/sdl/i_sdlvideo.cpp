@@ -25,6 +25,7 @@
 #include "SDL.h"
 #endif
 
+#include "../hal/i_palexpand.h"
 #include "../hal/i_platform.h"
 
 #include "../z_zone.h"  /* memory allocation wrappers -- killough */
@@ -62,7 +63,9 @@ void UpdateFocus(SDL_Window *window);
 //
 
 static SDL_Surface  *primary_surface;
-static SDL_Surface  *rgba_surface;
+static SDL_Surface  *staging_surface; // copy of primary_surface when pipelined
+static SDL_Surface  *convert_surface; // the one ConvertFrame reads from
+static SDL_Surface  *rgba_surface;    // only used if the texture isn't 32-bit
 static SDL_Texture  *sdltexture; // the texture to use for rendering
 static SDL_Renderer *renderer;
 static SDL_Rect     *destrect;
@@ -76,6 +79,13 @@ extern bool noblit;
 static SDL_Color basepal[256], colors[256];
 static bool setpalette = false;
 
+// When the texture is 32-bit, frames are expanded straight into it through
+// RGB8to32 instead of being blitted to rgba_surface and uploaded.
+static SDL_PixelFormat *textureformat;
+static Uint32           RGB8to32[256];
+static Uint32          *texturepixels; // locked texture, between Begin and Present
+static int              texturepitch;  // in pixels
+
 extern char *i_resolution;
 extern char *i_videomode;
 
@@ -83,11 +93,27 @@ extern char *i_videomode;
 int displaynum = 0;
 
 //
-// SDLVideoDriver::FinishUpdate
+// I_SDLBuildTextureTable
 //
-// Push the newest frame to the display.
+// Maps the current colours to the texture's pixel format.
 //
-void SDLVideoDriver::FinishUpdate()
+static void I_SDLBuildTextureTable()
+{
+   if(!textureformat)
+      return;
+
+   for(int i = 0; i < 256; i++)
+      RGB8to32[i] = SDL_MapRGB(textureformat, colors[i].r, colors[i].g, colors[i].b);
+}
+
+//
+// SDLVideoDriver::BeginUpdate
+//
+// Protected method. Gets the newest frame ready for conversion, first copying
+// it aside if staged is set so that the game can draw over the primary
+// surface meanwhile. Returns false if the frame shouldn't be shown.
+//
+bool SDLVideoDriver::BeginUpdate(bool staged)
 {
    // haleyjd 10/08/05: from Chocolate DOOM:
    UpdateGrab(window);
@@ -96,22 +122,102 @@ void SDLVideoDriver::FinishUpdate()
    // Not doing this breaks under Windows when we alt-tab away 
    // while fullscreen.   
    if(!(SDL_GetWindowFlags(window) & SDL_WINDOW_SHOWN))
-      return;
+      return false;
 
    if(setpalette)
    {
       if(primary_surface)
          SDL_SetPaletteColors(primary_surface->format->palette, colors, 0, 256);
+      I_SDLBuildTextureTable();
 
       setpalette = false;
    }
 
-   // haleyjd 11/12/09: blit *after* palette set improves behavior.
-   if(primary_surface)
+   convert_surface = primary_surface;
+
+   if(staged && primary_surface)
+   {
+      if(!staging_surface)
+      {
+         staging_surface = SDL_CreateRGBSurfaceWithFormat(0, primary_surface->w,
+                                                          primary_surface->h,
+                                                          0, SDL_PIXELFORMAT_INDEX8);
+         if(!staging_surface)
+         {
+            I_Error("SDLVideoDriver::BeginUpdate: failed to create staging buffer: %s\n",
+                    SDL_GetError());
+         }
+
+         // shares the palette, so it follows SDL_SetPaletteColors above
+         SDL_SetSurfacePalette(staging_surface, primary_surface->format->palette);
+      }
+
+      memcpy(staging_surface->pixels, primary_surface->pixels,
+             size_t(primary_surface->pitch) * primary_surface->h);
+      convert_surface = staging_surface;
+   }
+
+   if(textureformat && primary_surface)
+   {
+      void *pixels;
+      int   pitch;
+
+      // on failure the frame just isn't converted
+      if(!SDL_LockTexture(sdltexture, nullptr, &pixels, &pitch))
+      {
+         texturepixels = static_cast<Uint32 *>(pixels);
+         texturepitch  = pitch / int(sizeof(Uint32));
+      }
+   }
+
+   return true;
+}
+
+//
+// SDLVideoDriver::ConvertFrame
+//
+// Expands the frame picked by BeginUpdate into the locked texture, or the
+// true-colour surface. Makes no renderer calls, so it can run on the present
+// thread.
+//
+void SDLVideoDriver::ConvertFrame()
+{
+   if(!convert_surface)
+      return;
+
+   if(textureformat)
+   {
+      if(texturepixels)
+      {
+         I_ExpandPalette(static_cast<byte *>(convert_surface->pixels), convert_surface->pitch,
+                         texturepixels, texturepitch, convert_surface->w, convert_surface->h,
+                         RGB8to32);
+      }
+   }
+   else
    {
       // Don't bother checking for errors. It should just cancel itself in that case.
-      SDL_BlitSurface(primary_surface, nullptr, rgba_surface, nullptr);
-      SDL_UpdateTexture(sdltexture, nullptr, rgba_surface->pixels, rgba_surface->pitch);
+      // haleyjd 11/12/09: blit *after* palette set improves behavior.
+      SDL_BlitSurface(convert_surface, nullptr, rgba_surface, nullptr);
+   }
+}
+
+//
+// SDLVideoDriver::PresentFrame
+//
+// Uploads the converted frame and shows it.
+//
+void SDLVideoDriver::PresentFrame()
+{
+   if(primary_surface)
+   {
+      if(!textureformat)
+         SDL_UpdateTexture(sdltexture, nullptr, rgba_surface->pixels, rgba_surface->pitch);
+      else if(texturepixels)
+      {
+         SDL_UnlockTexture(sdltexture);
+         texturepixels = nullptr;
+      }
       SDL_RenderCopyEx(renderer, sdltexture, nullptr, destrect, 90.0, nullptr, SDL_FLIP_VERTICAL);
    }
 
@@ -120,6 +226,30 @@ void SDLVideoDriver::FinishUpdate()
    SDL_RenderPresent(renderer);
 }
 
+//
+// SDLVideoDriver::FinishUpdate
+//
+// Push the newest frame to the display.
+//
+void SDLVideoDriver::FinishUpdate()
+{
+   if(BeginUpdate(false))
+   {
+      ConvertFrame();
+      PresentFrame();
+   }
+}
+
+//
+// SDLVideoDriver::StageFrame
+//
+// Pipelined counterpart of FinishUpdate; see HALVideoDriver.
+//
+bool SDLVideoDriver::StageFrame()
+{
+   return BeginUpdate(true);
+}
+
 //
 // SDLVideoDriver::ReadScreen
 //
@@ -151,6 +281,7 @@ static void I_SDLSetPaletteDirect(byte *palette)
 
    if(primary_surface)
       SDL_SetPaletteColors(primary_surface->format->palette, colors, 0, 256);
+   I_SDLBuildTextureTable();
 }
 
 //
@@ -201,11 +332,23 @@ void SDLVideoDriver::UnsetPrimaryBuffer()
       SDL_FreeSurface(rgba_surface);
       rgba_surface = nullptr;
    }
+   if(textureformat)
+   {
+      SDL_FreeFormat(textureformat);
+      textureformat = nullptr;
+   }
+   texturepixels = nullptr;
+   if(staging_surface)
+   {
+      SDL_FreeSurface(staging_surface);
+      staging_surface = nullptr;
+   }
    if(primary_surface)
    {
       SDL_FreeSurface(primary_surface);
       primary_surface = nullptr;
    }
+   convert_surface = nullptr;
    video.screens[0] = nullptr;
 }
 
@@ -231,13 +374,22 @@ void SDLVideoDriver::SetPrimaryBuffer()
       if(pixelformat == SDL_PIXELFORMAT_UNKNOWN)
          pixelformat = SDL_PIXELFORMAT_RGBA32;
 
-      rgba_surface = SDL_CreateRGBSurfaceWithFormat(0, video.height, video.width + bump,
-                                                    0, pixelformat);
-      if(!rgba_surface)
+      // 32-bit textures are written directly; anything else goes through SDL
+      if(SDL_BYTESPERPIXEL(pixelformat) == 4 && !SDL_ISPIXELFORMAT_FOURCC(pixelformat) &&
+         !SDL_ISPIXELFORMAT_INDEXED(pixelformat))
+         textureformat = SDL_AllocFormat(pixelformat);
+
+      if(!textureformat)
       {
-         I_Error("SDLVideoDriver::SetPrimaryBuffer: failed to create true-colour buffer: %s\n",
-                 SDL_GetError());
+         rgba_surface = SDL_CreateRGBSurfaceWithFormat(0, video.height, video.width + bump,
+                                                       0, pixelformat);
+         if(!rgba_surface)
+         {
+            I_Error("SDLVideoDriver::SetPrimaryBuffer: failed to create true-colour buffer: %s\n",
+                    SDL_GetError());
+         }
       }
+      I_SDLBuildTextureTable();
       sdltexture = SDL_CreateTexture(renderer, pixelformat,
                                      SDL_TEXTUREACCESS_STREAMING,
                                      video.height, video.width + bump);
@@ -39,6 +39,8 @@
 class SDLVideoDriver : public HALVideoDriver
 {
 protected:
+   bool BeginUpdate(bool staged);
+
    virtual void SetPrimaryBuffer();
    virtual void UnsetPrimaryBuffer();
 
@@ -49,6 +51,11 @@ public:
    virtual void ShutdownGraphics();
    virtual void ShutdownGraphicsPartway();
    virtual bool InitGraphicsMode();
+
+   virtual bool CanPipeline() const { return window != nullptr; }
+   virtual bool StageFrame();
+   virtual void ConvertFrame();
+   virtual void PresentFrame();
 };
 
 // Global singleton instance
@@ -396,6 +396,9 @@ VARIABLE_INT(snd_card,       nullptr,   -1,  1, sndcardstr);
 VARIABLE_INT(mus_card,       nullptr,   -1,  0, muscardstr);
 VARIABLE_INT(detect_voices,  nullptr,    0,  1, yesno);
 
+extern int snd_musicbuffers;
+VARIABLE_INT(snd_musicbuffers, nullptr,  2, 32, nullptr);
+
 #ifdef HAVE_SPCLIB
 extern int spc_preamp;
 extern int spc_bass_boost;
@@ -415,7 +418,7 @@ extern int adlmidi_bank;
 extern int adlmidi_emulator;
 
 VARIABLE_INT(midi_device, nullptr, -1, 0, mididevicestr);
-VARIABLE_INT(adlmidi_numchips, nullptr, 1, 8, nullptr);
+VARIABLE_INT(adlmidi_numchips, nullptr, 1, 16, nullptr);
 VARIABLE_INT(adlmidi_bank, nullptr, 0, BANKS_MAX, adlbankstr);
 VARIABLE_INT(adlmidi_emulator, nullptr, 0, ADLMIDI_EMU_end - 1, adlemustr);
 #endif
@@ -443,6 +446,9 @@ CONSOLE_VARIABLE(mus_card, mus_card, 0)
 
 CONSOLE_VARIABLE(detect_voices, detect_voices, 0) {}
 
+// takes effect when the next song starts
+CONSOLE_VARIABLE(snd_musicbuffers, snd_musicbuffers, 0) {}
+
 #ifdef _SDL_VER
 #ifdef HAVE_SPCLIB
 CONSOLE_VARIABLE(snd_spcpreamp, spc_preamp, 0) 
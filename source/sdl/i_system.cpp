@@ -38,6 +38,7 @@
 #include "../z_zone.h"
 #include "../c_io.h"
 #include "../c_runcmd.h"
+#include "../d_demobatch.h"
 #include "../d_event.h"
 #include "../d_gi.h"
 #include "../i_system.h"
@@ -161,9 +162,14 @@ void I_Quit(void)
    //         06/06/10: check each call, as an I_FatalError called from any of this
    //                   code could escalate the error status.
 
-   IFNOTFATAL(M_SaveDefaults());
-   IFNOTFATAL(M_SaveSysConfig());
-   IFNOTFATAL(G_SaveDefaults()); // haleyjd
+   // a worker of a demo batch leaves the config alone, as the others are
+   // all writing it at once
+   if(!d_batchworker)
+   {
+      IFNOTFATAL(M_SaveDefaults());
+      IFNOTFATAL(M_SaveSysConfig());
+      IFNOTFATAL(G_SaveDefaults()); // haleyjd
+   }
    
 #ifdef _MSC_VER
    // Under Visual C++, the console window likes to rudely slam
@@ -69,6 +69,9 @@ result_e T_MoveFloorDown(sector_t *sector, fixed_t speed, fixed_t dest, int crus
    move3dsides  = (sector->srf.floor.attached && demo_version >= 331);
    moveattached = (sector->srf.floor.asurfaces && demo_version >= 331);
 
+   // its interpolation backup will need refreshing
+   P_AddMovedSector(sector);
+
    // Moving a floor down
    if(sector->srf.floor.height - speed < dest)
    {
@@ -178,6 +181,9 @@ result_e T_MoveFloorUp(sector_t *sector, fixed_t speed, fixed_t dest, int crush,
    move3dsides  = (sector->srf.floor.attached && demo_version >= 331);
    moveattached = (sector->srf.floor.asurfaces && demo_version >= 331);
 
+   // its interpolation backup will need refreshing
+   P_AddMovedSector(sector);
+
    // Moving a floor up
    // jff 02/04/98 keep floor from moving thru ceilings
    // jff 2/22/98 weaken check to demo_compatibility
@@ -294,6 +300,9 @@ result_e T_MoveCeilingDown(sector_t *sector, fixed_t speed, fixed_t dest,
    move3dsides  = (sector->srf.ceiling.attached && demo_version >= 331);
    moveattached = (sector->srf.ceiling.asurfaces && demo_version >= 331);
 
+   // its interpolation backup will need refreshing
+   P_AddMovedSector(sector);
+
    // moving a ceiling down
    // jff 02/04/98 keep ceiling from moving thru floors
    // jff 2/22/98 weaken check to demo_compatibility
@@ -411,6 +420,9 @@ result_e T_MoveCeilingUp(sector_t *sector, fixed_t speed, fixed_t dest, int crus
    move3dsides  = (sector->srf.ceiling.attached && demo_version >= 331);
    moveattached = (sector->srf.ceiling.asurfaces && demo_version >= 331);
 
+   // its interpolation backup will need refreshing
+   P_AddMovedSector(sector);
+
    // moving a ceiling up
    if(sector->srf.ceiling.height + speed > dest)
    {
@@ -46,6 +46,7 @@ namespace fs = std::experimental::filesystem;
 #include "d_files.h"
 #include "e_hash.h"
 #include "hal/i_directory.h"
+#include "hal/i_filemap.h"
 #include "m_argv.h"
 #include "m_collection.h"
 #include "m_dllist.h"
@@ -60,6 +61,7 @@ namespace fs = std::experimental::filesystem;
 #include "w_hacks.h"
 #include "w_wad.h"
 #include "w_zip.h"
+#include "w_zipcache.h"
 #include "z_auto.h"
 
 //
@@ -154,11 +156,19 @@ public:
       return SourceFileNames[source].constPtr();
    }
 
+   // A mapped file. Subfiles share the mapping of the file they're in.
+   struct wadmapping_t
+   {
+      FILE         *file;
+      hal_filemap_t map;
+   };
+
    PODCollection<lumpinfo_t *>  infoptrs; // lumpinfo_t allocations
    DLListItem<ZipFile>         *zipFiles; // zip files attached to this waddir
+   PODCollection<wadmapping_t>  mappings; // mapped wad files
 
    WadDirectoryPimpl()
-      : ZoneObject(), infoptrs(), zipFiles(nullptr)
+      : ZoneObject(), infoptrs(), zipFiles(nullptr), mappings()
    {
    }
 };
@@ -338,6 +348,8 @@ bool WadDirectory::addSingleFile(openwad_t &openData, const wfileadd_t &addInfo,
 
    strncpy(lump_p->name, singleinfo.name, 8);
 
+   mapDirectLumps(openData.handle, startlump);
+
    incrementSource(openData);
 
    return true;
@@ -559,6 +571,8 @@ bool WadDirectory::addWadFile(openwad_t &openData, const wfileadd_t &addInfo,
       strncpy(lump_p->name, fileinfo->name, 8);
    }
 
+   mapDirectLumps(openData.handle, startlump);
+
    if(ispublic)
       D_NewWadLumps(source);
 
@@ -567,6 +581,49 @@ bool WadDirectory::addWadFile(openwad_t &openData, const wfileadd_t &addInfo,
    return true;
 }
 
+//
+// WadDirectory::mapDirectLumps
+//
+// Maps the file just added so its lumps can be read, or used in place,
+// without going through stdio. Lumps that lie outside of the file keep using
+// stdio, so they still fail the same way when read. A file that is already
+// mapped, as the container of several subfiles is, is only mapped once.
+//
+void WadDirectory::mapDirectLumps(FILE *f, int startlump)
+{
+   const hal_filemap_t *mapping = nullptr;
+
+   for(const WadDirectoryPimpl::wadmapping_t &wm : pImpl->mappings)
+   {
+      if(wm.file == f)
+      {
+         mapping = &wm.map;
+         break;
+      }
+   }
+
+   if(!mapping)
+   {
+      WadDirectoryPimpl::wadmapping_t wm = { f, {} };
+
+      if(!I_MapFile(f, wm.map))
+         return;
+
+      pImpl->mappings.add(wm);
+      mapping = &pImpl->mappings.back().map;
+   }
+
+   const hal_filemap_t &map = *mapping;
+
+   for(int i = startlump; i < numlumps; i++)
+   {
+      directlump_t &direct = lumpinfo[i]->direct;
+
+      if(direct.position <= map.size && lumpinfo[i]->size <= map.size - direct.position)
+         direct.mapped = map.data;
+   }
+}
+
 //
 // WadDirectory::addZipFile
 //
@@ -1686,6 +1743,84 @@ void *WadDirectory::cacheLumpNum(int lump, int tag,
    return lumpinfo[lump]->cache[fmt];
 }
 
+//
+// WadDirectory::mapLumpNum
+//
+// Returns the raw lump data for read-only use. Lumps in mapped files, memory
+// lumps and stored zip entries are returned in place without allocating or
+// copying; anything else is cached at PU_CACHE. Either way the caller must
+// not write to, free or re-tag the result, and should not hold onto it across
+// other allocations. Callers that modify lump data must use cacheLumpNum,
+// which always hands out a private copy.
+//
+const void *WadDirectory::mapLumpNum(int lump) const
+{
+   if(lump < 0 || lump >= numlumps)
+      I_Error("WadDirectory::mapLumpNum: %i >= numlumps\n", lump);
+
+   lumpinfo_t *lptr = lumpinfo[lump];
+
+   if(!lptr->size)
+      return nullptr;
+
+   switch(lptr->type)
+   {
+   case lumpinfo_t::lump_direct:
+      if(lptr->direct.mapped)
+         return lptr->direct.mapped + lptr->direct.position;
+      break;
+   case lumpinfo_t::lump_memory:
+      return static_cast<const byte *>(lptr->memory.data) + lptr->memory.position;
+   case lumpinfo_t::lump_zip:
+      if(const void *data = lptr->zip.zipLump->getMappedData())
+         return data;
+      break;
+   default:
+      break;
+   }
+
+   return cacheLumpNum(lump, PU_CACHE);
+}
+
+//
+// WadDirectory::mapLumpName
+//
+const void *WadDirectory::mapLumpName(const char *name) const
+{
+   return mapLumpNum(getNumForName(name));
+}
+
+//
+// WadDirectory::prefetchLump
+//
+// Starts inflating a deflated zip lump in the background, if it isn't
+// cached already, so a later readLump or cacheLumpNum just copies it. Does
+// nothing for any other kind of lump.
+//
+void WadDirectory::prefetchLump(int lump) const
+{
+   if(lump < 0 || lump >= numlumps)
+      return;
+
+   lumpinfo_t *lptr = lumpinfo[lump];
+
+   if(lptr->type == lumpinfo_t::lump_zip && !lptr->cache[lumpinfo_t::fmt_default])
+      ZIP_PrefetchLump(*lptr->zip.zipLump);
+}
+
+//
+// WadDirectory::prefetchNamespace
+//
+// Prefetches every lump in a namespace, ahead of loading all of them.
+//
+void WadDirectory::prefetchNamespace(int li_namespace) const
+{
+   const namespace_t &ns = m_namespaces[li_namespace];
+
+   for(int i = ns.firstLump; i < ns.firstLump + ns.numLumps; i++)
+      prefetchLump(i);
+}
+
 //
 // W_CacheLumpName
 //
@@ -1752,10 +1887,16 @@ bool WadDirectory::writeLump(const char *lumpname, const char *destpath) const
 //
 // sf
 // haleyjd 08/27/11: Rewritten to use CRC32 hash algorithm
+// Zip lumps already carry the CRC32 of their data in the zip directory, so
+// they don't have to be read at all.
 //
 uint32_t W_LumpCheckSum(int lumpnum)
 {
-   uint8_t  *lump    = (uint8_t *)(wGlobalDir.cacheLumpNum(lumpnum, PU_CACHE));
+   const lumpinfo_t *lptr = wGlobalDir.getLumpInfo()[lumpnum];
+   if(lptr->type == lumpinfo_t::lump_zip)
+      return lptr->zip.zipLump->crc;
+
+   auto      lump    = static_cast<const uint8_t *>(wGlobalDir.mapLumpNum(lumpnum));
    uint32_t  lumplen = (uint32_t )(wGlobalDir.lumpLength(lumpnum));
 
    return HashData(HashData::CRC32, lump, lumplen).getDigestPart(0);
@@ -1826,6 +1967,10 @@ void WadDirectory::close()
       // free all resources loaded from the wad
       freeDirectoryLumps();
 
+      for(WadDirectoryPimpl::wadmapping_t &wm : pImpl->mappings)
+         I_UnmapFile(wm.map);
+      pImpl->mappings.clear();
+
       if(lumpinfo[0]->type == lumpinfo_t::lump_direct && lumpinfo[0]->direct.file)
          fclose(lumpinfo[0]->direct.file);
 
@@ -1856,6 +2001,12 @@ static size_t W_DirectReadLump(lumpinfo_t *l, void *dest)
    size_t ret;
    directlump_t &direct = l->direct;
 
+   if(direct.mapped)
+   {
+      memcpy(dest, direct.mapped + direct.position, size);
+      return size;
+   }
+
    // killough 10/98: Add flashing disk indicator
    fseek(direct.file, static_cast<long>(direct.position), SEEK_SET);
    ret = fread(dest, 1, size, direct.file);
@@ -54,6 +54,7 @@ struct directlump_t
 {
    FILE *file;       // for a direct lump, a pointer to the file it is in
    size_t position;  // for direct and memory lumps, offset into file/buffer
+   const byte *mapped; // read-only mapping of the whole file, if any
 };
 
 // A memory lump is loaded in a buffer in RAM and just needs to be memcpy'd.
@@ -291,6 +292,7 @@ protected:
    bool addDirectoryAsArchive(openwad_t &openData, const wfileadd_t &addInfo,
                               int startlump);
    bool addFile(wfileadd_t &addInfo);
+   void mapDirectLumps(FILE *f, int startlump);
    void freeDirectoryLumps();  // haleyjd 06/27/09
    void freeDirectoryAllocs(); // haleyjd 06/06/10
 
@@ -325,6 +327,10 @@ public:
                       const WadLumpLoader *lfmt = nullptr) const;
    void *cacheLumpName(const char *name, int tag,
                        const WadLumpLoader *lfmt = nullptr) const;
+   const void *mapLumpNum(int lump) const;
+   const void *mapLumpName(const char *name) const;
+   void  prefetchLump(int lump) const;
+   void  prefetchNamespace(int li_namespace) const;
    void  cacheLumpAuto(int lumpnum, ZAutoBuffer &buffer) const;
    void  cacheLumpAuto(const char *name, ZAutoBuffer &buffer) const;
    bool  writeLump(const char *lumpname, const char *destpath) const;
@@ -36,6 +36,7 @@
 #include "m_swap.h"
 #include "w_wad.h"
 #include "w_zip.h"
+#include "w_zipcache.h"
 
 #include "../zlib/zlib.h"
 
@@ -288,6 +289,10 @@ ZipFile::~ZipFile()
       wads = nullptr;
    }
 
+   // nothing may be left inflating out of the mapping
+   ZIP_PurgePrefetched(this);
+   I_UnmapFile(map);
+
    // close the disk file if it is open
    if(file)
    {
@@ -399,6 +404,7 @@ bool ZipFile::readCentralDirEntry(InBuffer &fin, ZipLump &lump, bool &skip)
    lump.method     = entry.method;
    lump.compressed = entry.compressed;
    lump.size       = entry.uncompressed;
+   lump.crc        = entry.crc32;
    lump.offset     = entry.localOffset;
 
    // Lump will need true offset to file data calculated the first time it is
@@ -491,6 +497,9 @@ bool ZipFile::readFromFile(FILE *f)
    if(numLumps > 1)
       qsort(lumps, numLumps, sizeof(ZipLump), ZIP_LumpSortCB);
 
+   // map the file if possible so lumps can be read straight out of memory
+   I_MapFile(f, map);
+
    return true;
 }
 
@@ -677,6 +686,33 @@ static void ZIP_ReadDeflated(InBuffer &fin, void *buffer, size_t len)
    reader.read(buffer, len);
 }
 
+//
+// ZIP_InflateMemory
+//
+// Inflate a deflated file that is entirely in memory in one call. Doesn't
+// error out, so that it's safe to call from any thread; returns false if the
+// stream is bad or short.
+//
+bool ZIP_InflateMemory(const byte *src, uint32_t srclen, void *buffer, size_t len)
+{
+   z_stream zlStream = {};
+   int      code;
+
+   if(inflateInit2(&zlStream, -MAX_WBITS) != Z_OK)
+      return false;
+
+   zlStream.next_in   = const_cast<Bytef *>(src);
+   zlStream.avail_in  = static_cast<uInt>(srclen);
+   zlStream.next_out  = static_cast<Bytef *>(buffer);
+   zlStream.avail_out = static_cast<uInt>(len);
+
+   code = inflate(&zlStream, Z_FINISH);
+   inflateEnd(&zlStream);
+
+   return (code == Z_OK || code == Z_STREAM_END || code == Z_BUF_ERROR) &&
+          !zlStream.avail_out;
+}
+
 //
 // ZipLump::setAddress
 //
@@ -723,6 +759,20 @@ void ZipLump::read(void *buffer)
 {
    InBuffer reader;
 
+   // Already inflated in the background?
+   if(method == ZipFile::METHOD_DEFLATE && ZIP_ReadPrefetched(*this, buffer))
+      return;
+
+   // Read straight out of the file mapping when there is one
+   if(const byte *data = getMappedBytes())
+   {
+      if(method == ZipFile::METHOD_STORED)
+         memcpy(buffer, data, size);
+      else if(!ZIP_InflateMemory(data, compressed, buffer, size))
+         I_Error("ZipLump::read: invalid deflate stream in '%s'\n", name);
+      return;
+   }
+
    reader.openExisting(file->getFile(), InBuffer::LENDIAN);
 
    // Calculate an offset beyond the lump's local file header, if such hasn't
@@ -753,6 +803,48 @@ void ZipLump::read(void *buffer)
    }
 }
 
+//
+// ZipLump::getMappedBytes
+//
+// Returns where the lump's data, compressed or not, lies in the mapping of its
+// zip file, or nullptr if the file isn't mapped.
+//
+const byte *ZipLump::getMappedBytes()
+{
+   const hal_filemap_t &map = file->getMapping();
+
+   if(!map.data)
+      return nullptr;
+
+   if(flags & ZipFile::LF_CALCOFFSET)
+   {
+      InBuffer reader;
+
+      reader.openExisting(file->getFile(), InBuffer::LENDIAN);
+      setAddress(reader);
+   }
+
+   const size_t length = method == ZipFile::METHOD_STORED ? size : compressed;
+   if(offset < 0 || size_t(offset) > map.size || length > map.size - size_t(offset))
+      return nullptr;
+
+   return map.data + offset;
+}
+
+//
+// ZipLump::getMappedData
+//
+// Returns the lump's data in place for stored lumps in mapped zip files, or
+// nullptr if it has to be read. See WadDirectory::mapLumpNum.
+//
+const void *ZipLump::getMappedData()
+{
+   if(method != ZipFile::METHOD_STORED)
+      return nullptr;
+
+   return getMappedBytes();
+}
+
 //
 // ZipLump::read(ZAutoBuffer &, bool)
 //
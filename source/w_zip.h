@@ -30,6 +30,7 @@
 #define W_ZIP_H__
 
 #include "z_zone.h"
+#include "hal/i_filemap.h"
 #include "m_dllist.h"
 
 class  InBuffer;
@@ -45,6 +46,7 @@ struct ZipLump
    int       method;     // compression method
    uint32_t  compressed; // compressed size
    uint32_t  size;       // uncompressed size
+   uint32_t  crc;        // CRC32 of uncompressed data
    long      offset;     // file offset
    char     *name;       // full name 
    ZipFile  *file;       // parent zipfile
@@ -52,6 +54,8 @@ struct ZipLump
    void setAddress(InBuffer &fin);
    void read(void *buffer);
    void read(ZAutoBuffer &buf, bool asString);
+   const byte *getMappedBytes();
+   const void *getMappedData();
 };
 
 struct ZipWad
@@ -88,6 +92,7 @@ protected:
    ZipLump *lumps;    // directory
    int      numLumps; // directory size
    FILE    *file;     // physical disk file
+   hal_filemap_t map; // read-only mapping of file, if any
 
    DLListItem<ZipFile> links; // links for use by WadDirectory
 
@@ -99,7 +104,8 @@ protected:
 
 public:
    ZipFile() 
-      : ZoneObject(), lumps(nullptr), numLumps(0), file(nullptr), links(), wads(nullptr) 
+      : ZoneObject(), lumps(nullptr), numLumps(0), file(nullptr), map(), links(),
+        wads(nullptr)
    {
    }
    
@@ -114,8 +120,12 @@ public:
    int      findLump(const char *name) const;
    int      getNumLumps() const { return numLumps; }   
    FILE    *getFile()     const { return file;     }
+
+   const hal_filemap_t &getMapping() const { return map; }
 };
 
+bool ZIP_InflateMemory(const byte *src, uint32_t srclen, void *buffer, size_t len);
+
 #endif
 
 // EOF
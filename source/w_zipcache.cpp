@@ -0,0 +1,311 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Background inflation of deflated zip lumps, into a bounded cache.
+//
+//  Lumps are only prefetched out of mapped zip files, so the workers never
+//  touch a FILE or the zone heap; they inflate from the mapping into memory
+//  of their own. ZipLump::read takes finished lumps from the cache, waits
+//  for ones being inflated, and inflates anything still queued itself.
+//  A lump leaves the cache once it has been read, since the caller holds its
+//  own copy from then on, and nothing is evicted before it has been read;
+//  prefetching just stops while the cache is full.
+//
+// Authors: agent
+//
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "z_zone.h"
+
+#include "w_zip.h"
+#include "w_zipcache.h"
+
+// most bytes of inflated lumps kept or being inflated at once
+#define ZIPCACHE_MAXBYTES (64 * 1024 * 1024)
+
+// most worker threads
+#define ZIPCACHE_MAXTHREADS 8
+
+struct zipcacheentry_t
+{
+   enum state_e
+   {
+      QUEUED,    // waiting for a worker
+      INFLATING, // a worker has it
+      READY,     // data is valid
+      FAILED,    // bad stream; the main thread will read it and error out
+      CANCELLED, // taken back while queued; the worker that pops it erases it
+   };
+
+   const ZipLump *lump;
+   const ZipFile *file;
+   const byte    *src;
+   uint32_t       srclen;
+   size_t         size;
+   state_e        state;
+
+   std::unique_ptr<byte[]> data;
+};
+
+using zipcacheentryptr_t = std::unique_ptr<zipcacheentry_t>;
+
+static std::mutex              zipcachemutex;
+static std::condition_variable zipcachework;  // workers wait for the queue
+static std::condition_variable zipcachedone;  // main thread waits for inflation
+
+static std::unordered_map<const ZipLump *, zipcacheentryptr_t> zipcache;
+static std::deque<zipcacheentry_t *> zipcachequeue;
+static size_t                        zipcachebytes; // all but CANCELLED
+
+static std::thread *zipcachethreads;
+static unsigned     zipcachenumthreads;
+static bool         zipcachequit;
+
+//
+// Drop a READY or FAILED entry. Lock must be held.
+//
+static void ZIP_eraseEntry(zipcacheentry_t *entry)
+{
+   zipcachebytes -= entry->size;
+   zipcache.erase(entry->lump);
+}
+
+//
+// Worker thread loop
+//
+static void ZIP_workerThread()
+{
+   std::unique_lock<std::mutex> lock(zipcachemutex);
+
+   while(true)
+   {
+      zipcachework.wait(lock, [] { return zipcachequit || !zipcachequeue.empty(); });
+      if(zipcachequit)
+         return;
+
+      zipcacheentry_t *entry = zipcachequeue.front();
+      zipcachequeue.pop_front();
+
+      if(entry->state == zipcacheentry_t::CANCELLED)
+      {
+         zipcache.erase(entry->lump);
+         continue;
+      }
+
+      entry->state = zipcacheentry_t::INFLATING;
+      lock.unlock();
+
+      std::unique_ptr<byte[]> data(new (std::nothrow) byte[entry->size]);
+      bool ok = data && ZIP_InflateMemory(entry->src, entry->srclen, data.get(), entry->size);
+
+      lock.lock();
+      if(ok)
+      {
+         entry->data  = std::move(data);
+         entry->state = zipcacheentry_t::READY;
+      }
+      else
+         entry->state = zipcacheentry_t::FAILED;
+
+      zipcachedone.notify_all();
+   }
+}
+
+static void ZIP_stopWorkers()
+{
+   {
+      std::lock_guard<std::mutex> lock(zipcachemutex);
+      zipcachequit = true;
+   }
+   zipcachework.notify_all();
+
+   for(unsigned i = 0; i < zipcachenumthreads; i++)
+      zipcachethreads[i].join();
+
+   delete[] zipcachethreads;
+   zipcachethreads    = nullptr;
+   zipcachenumthreads = 0;
+}
+
+//
+// Workers are only started the first time something is prefetched.
+//
+static void ZIP_startWorkers()
+{
+   if(zipcachethreads)
+      return;
+
+   unsigned numthreads = std::thread::hardware_concurrency();
+   numthreads = numthreads > 1 ? numthreads - 1 : 1;
+   if(numthreads > ZIPCACHE_MAXTHREADS)
+      numthreads = ZIPCACHE_MAXTHREADS;
+
+   zipcachethreads    = new std::thread[numthreads];
+   zipcachenumthreads = numthreads;
+   for(unsigned i = 0; i < numthreads; i++)
+      zipcachethreads[i] = std::thread(ZIP_workerThread);
+
+   atexit(ZIP_stopWorkers);
+}
+
+//
+// ZIP_PrefetchLump
+//
+// Queue a deflated lump for inflation in the background. Does nothing for
+// lumps that aren't deflated or aren't in a mapped zip, or if the cache is
+// full of lumps that haven't been used yet.
+//
+void ZIP_PrefetchLump(ZipLump &lump)
+{
+   if(lump.method != ZipFile::METHOD_DEFLATE || !lump.size)
+      return;
+
+   const byte *src = lump.getMappedBytes();
+   if(!src)
+      return;
+
+   ZIP_startWorkers();
+
+   std::lock_guard<std::mutex> lock(zipcachemutex);
+
+   auto itr = zipcache.find(&lump);
+   zipcacheentry_t *entry = itr != zipcache.end() ? itr->second.get() : nullptr;
+
+   // already here, or on its way
+   if(entry && entry->state != zipcacheentry_t::CANCELLED)
+      return;
+
+   if(zipcachebytes + lump.size > ZIPCACHE_MAXBYTES)
+      return;
+
+   if(entry)
+   {
+      // still in the queue, so just bring it back
+      entry->file   = lump.file;
+      entry->src    = src;
+      entry->srclen = lump.compressed;
+      entry->size   = lump.size;
+      entry->state  = zipcacheentry_t::QUEUED;
+   }
+   else
+   {
+      entry = new zipcacheentry_t { &lump, lump.file, src, lump.compressed, lump.size,
+                                    zipcacheentry_t::QUEUED, nullptr };
+      zipcache.emplace(&lump, zipcacheentryptr_t(entry));
+      zipcachequeue.push_back(entry);
+   }
+
+   zipcachebytes += entry->size;
+   zipcachework.notify_one();
+}
+
+//
+// ZIP_ReadPrefetched
+//
+// Copies a prefetched lump into buffer, drops it from the cache and returns
+// true, waiting for it if a worker is inflating it right now. Returns false if the lump wasn't
+// prefetched, or is still queued, in which case the caller reads it normally.
+//
+bool ZIP_ReadPrefetched(const ZipLump &lump, void *buffer)
+{
+   std::unique_lock<std::mutex> lock(zipcachemutex);
+
+   auto itr = zipcache.find(&lump);
+   if(itr == zipcache.end())
+      return false;
+
+   zipcacheentry_t *entry = itr->second.get();
+
+   switch(entry->state)
+   {
+   case zipcacheentry_t::QUEUED:
+      // inflating it here beats waiting behind the rest of the queue
+      entry->state = zipcacheentry_t::CANCELLED;
+      zipcachebytes -= entry->size;
+      return false;
+   case zipcacheentry_t::INFLATING:
+      zipcachedone.wait(lock, [entry] { return entry->state != zipcacheentry_t::INFLATING; });
+      break;
+   default:
+      break;
+   }
+
+   if(entry->state != zipcacheentry_t::READY)
+   {
+      if(entry->state == zipcacheentry_t::FAILED)
+         ZIP_eraseEntry(entry);
+      return false;
+   }
+
+   memcpy(buffer, entry->data.get(), entry->size);
+   ZIP_eraseEntry(entry);
+   return true;
+}
+
+//
+// ZIP_PurgePrefetched
+//
+// Drop everything prefetched from a zip file that's being closed, once no
+// worker is still reading its mapping.
+//
+void ZIP_PurgePrefetched(const ZipFile *file)
+{
+   std::unique_lock<std::mutex> lock(zipcachemutex);
+
+   zipcachedone.wait(lock, [file] {
+      for(const auto &pair : zipcache)
+      {
+         if(pair.second->file == file && pair.second->state == zipcacheentry_t::INFLATING)
+            return false;
+      }
+      return true;
+   });
+
+   for(auto itr = zipcache.begin(); itr != zipcache.end(); )
+   {
+      zipcacheentry_t *entry = itr->second.get();
+
+      if(entry->file != file || entry->state == zipcacheentry_t::CANCELLED)
+      {
+         ++itr;
+         continue;
+      }
+
+      if(entry->state == zipcacheentry_t::QUEUED)
+      {
+         // the worker that pops it will erase it
+         entry->state = zipcacheentry_t::CANCELLED;
+         zipcachebytes -= entry->size;
+         ++itr;
+         continue;
+      }
+
+      zipcachebytes -= entry->size;
+      itr = zipcache.erase(itr);
+   }
+}
+
+// EOF
+
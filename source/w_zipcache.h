@@ -0,0 +1,40 @@
+//
+// The Eternity Engine
+// Copyright(C) 2026 agent
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//----------------------------------------------------------------------------
+//
+// Purpose: Background inflation of deflated zip lumps, into a bounded cache
+//  with LRU eviction.
+//
+// Authors: agent
+//
+
+#ifndef W_ZIPCACHE_H__
+#define W_ZIPCACHE_H__
+
+class  ZipFile;
+struct ZipLump;
+
+// All of these must be called from the main thread.
+void ZIP_PrefetchLump(ZipLump &lump);
+bool ZIP_ReadPrefetched(const ZipLump &lump, void *buffer);
+void ZIP_PurgePrefetched(const ZipFile *file);
+
+#endif
+
+// EOF
+
@@ -29,6 +29,13 @@
 // When running with this heap, there is no limitation to the amount of memory
 // allocated except what the system will provide.
 //
+// Blocks without an owner that are tagged PU_LEVEL or PU_RENDERER are carved
+// out of large arena chunks instead of being malloc'd one at a time, since
+// those tags are nearly always freed all at once. Z_FreeTags then releases
+// them by resetting the arena rather than walking thousands of blocks. Blocks
+// that are reallocated move out to the system heap; blocks that are re-tagged
+// keep their chunk alive until they are freed.
+//
 // Limitations:
 // * Purgables are never currently dumped unless the machine runs out of RAM.
 // * Instrumentation cannot track the amount of free memory.
@@ -80,6 +87,18 @@
 // signature for block header
 #define ZONEID  0x931d4a11
 
+// usable size of each arena chunk
+#define ARENA_CHUNKSIZE   (1024*1024)
+
+// larger arena-tagged allocations go straight to the system heap
+#define ARENA_MAXBLOCK    (ARENA_CHUNKSIZE / 8)
+
+// arena blocks up to this size are recycled when freed early
+#define ARENA_RECYCLESIZE 1024
+
+#define ARENA_ALIGN       16
+#define ARENA_NUMCLASSES  (ARENA_RECYCLESIZE / ARENA_ALIGN + 1)
+
 // End Tunables
 
 //=============================================================================
@@ -94,6 +113,7 @@ struct memblock_t
 #endif
 
   struct memblock_t *next,**prev;
+  struct arenachunk_t *chunk; // arena chunk the block lives in, if any
   size_t size;
   void **user;
   unsigned char tag;
@@ -117,6 +137,31 @@ static const size_t header_size = (sizeof(memblock_t) + 15) & ~15;
 
 static memblock_t *blockbytag[PU_MAX];   // used for tracking all zone blocks
 
+//=============================================================================
+//
+// Arena Structures
+//
+
+struct arenachunk_t
+{
+   arenachunk_t *next;
+   size_t used; // bump pointer, in bytes from the start of the data
+   int    pins; // blocks re-tagged out of the arena
+   bool   dead; // reset while pinned; freed with its last pinned block
+};
+
+static const size_t chunk_header_size = (sizeof(arenachunk_t) + 15) & ~15;
+
+struct zonearena_t
+{
+   arenachunk_t *chunks;                       // current chunk is first
+   memblock_t   *freeblocks[ARENA_NUMCLASSES]; // freed blocks by size
+   size_t        residentbytes;                // size of live arena blocks
+};
+
+static zonearena_t   arenas[PU_MAX];
+static arenachunk_t *deadchunks; // reset chunks still holding pinned blocks
+
 // ZoneObject class statics
 ZoneObject *ZoneObject::objectbytag[PU_MAX]; // like blockbytag but for objects
 void       *ZoneObject::newalloc;            // most recent ZoneObject alloc
@@ -298,19 +343,225 @@ void Z_Init(void)
    Z_LogPrintf("Initialized zone heap (using native implementation)\n");
 }
 
+//=============================================================================
+//
+// Level Arenas
+//
+
+//
+// Only these tags are freed wholesale often enough to be worth an arena.
+//
+static bool Z_isArenaTag(int tag)
+{
+   return tag == PU_LEVEL || tag == PU_RENDERER;
+}
+
+//
+// True if the block is still owned by its arena, as opposed to malloc'd or
+// pinned. Arena blocks are never on a tag list until they are pinned.
+//
+static bool Z_isResident(const memblock_t *block)
+{
+   return block->chunk && !block->prev;
+}
+
+static size_t Z_arenaRound(size_t size)
+{
+   return (size + ARENA_ALIGN - 1) & ~size_t(ARENA_ALIGN - 1);
+}
+
+static byte *Z_arenaData(arenachunk_t *chunk)
+{
+   return (byte *)chunk + chunk_header_size;
+}
+
+//
+// Z_arenaAlloc
+//
+// Returns a block from a freed block of the same size class, or carves a new
+// one off the current chunk. Returns nullptr if the system is out of memory,
+// in which case the caller falls back to the normal path.
+//
+static memblock_t *Z_arenaAlloc(int tag, size_t size)
+{
+   zonearena_t  &arena   = arenas[tag];
+   const size_t  rounded = Z_arenaRound(size);
+   memblock_t   *block;
+
+   if(rounded <= ARENA_RECYCLESIZE && (block = arena.freeblocks[rounded / ARENA_ALIGN]))
+   {
+      arena.freeblocks[rounded / ARENA_ALIGN] = block->next;
+   }
+   else
+   {
+      arenachunk_t *chunk = arena.chunks;
+
+      if(!chunk || ARENA_CHUNKSIZE - chunk->used < header_size + rounded)
+      {
+         if(!(chunk = (arenachunk_t *)(malloc(chunk_header_size + ARENA_CHUNKSIZE))))
+            return nullptr;
+
+         chunk->used  = 0;
+         chunk->pins  = 0;
+         chunk->dead  = false;
+         chunk->next  = arena.chunks;
+         arena.chunks = chunk;
+      }
+
+      block = (memblock_t *)(Z_arenaData(chunk) + chunk->used);
+      block->chunk = chunk;
+      chunk->used += header_size + rounded;
+   }
+
+   block->next = nullptr;
+   block->prev = nullptr;
+   arena.residentbytes += size;
+
+   return block;
+}
+
+//
+// Z_arenaFree
+//
+// A block freed before its arena is reset. The most recent block in the
+// current chunk is simply popped; small blocks are kept for reuse, and
+// anything else waits for the reset.
+//
+static void Z_arenaFree(memblock_t *block, int tag)
+{
+   zonearena_t  &arena   = arenas[tag];
+   arenachunk_t *chunk   = block->chunk;
+   const size_t  rounded = Z_arenaRound(block->size);
+
+   arena.residentbytes -= block->size;
+
+   if(chunk == arena.chunks &&
+      (byte *)block + header_size + rounded == Z_arenaData(chunk) + chunk->used)
+   {
+      chunk->used -= header_size + rounded;
+   }
+   else if(rounded <= ARENA_RECYCLESIZE)
+   {
+      block->next = arena.freeblocks[rounded / ARENA_ALIGN];
+      arena.freeblocks[rounded / ARENA_ALIGN] = block;
+   }
+}
+
+//
+// Z_arenaPin
+//
+// A resident block is being re-tagged, so it has to outlive the arena. Its
+// chunk is kept until the block is freed.
+//
+static void Z_arenaPin(memblock_t *block)
+{
+   arenas[block->tag].residentbytes -= block->size;
+   ++block->chunk->pins;
+}
+
+//
+// Z_arenaUnpin
+//
+// Frees a chunk that was reset while pinned, once its last pinned block goes.
+//
+static void Z_arenaUnpin(arenachunk_t *chunk)
+{
+   if(--chunk->pins || !chunk->dead)
+      return;
+
+   for(arenachunk_t **link = &deadchunks; *link; link = &(*link)->next)
+   {
+      if(*link == chunk)
+      {
+         *link = chunk->next;
+         free(chunk);
+         return;
+      }
+   }
+}
+
+//
+// Z_arenaReset
+//
+// Releases every resident block of an arena tag at once. One empty chunk is
+// kept for the next level; pinned chunks are set aside until they empty.
+//
+static void Z_arenaReset(int tag)
+{
+   zonearena_t  &arena = arenas[tag];
+   arenachunk_t *chunk = arena.chunks;
+   arenachunk_t *kept  = nullptr;
+
+   while(chunk)
+   {
+      arenachunk_t *next = chunk->next;
+
+      if(chunk->pins)
+      {
+         chunk->dead = true;
+         chunk->next = deadchunks;
+         deadchunks  = chunk;
+      }
+      else if(!kept)
+      {
+         SCRAMBLER(Z_arenaData(chunk), chunk->used);
+         chunk->used = 0;
+         chunk->next = nullptr;
+         kept = chunk;
+      }
+      else
+         free(chunk);
+
+      chunk = next;
+   }
+
+   INSTRUMENT(memorybytag[tag] -= arena.residentbytes);
+
+   arena.chunks        = kept;
+   arena.residentbytes = 0;
+   memset(arena.freeblocks, 0, sizeof(arena.freeblocks));
+}
+
+//
+// Z_forEachBlock
+//
+// Calls func on every live block of a tag, on the tag list or in the arena.
+//
+template<typename F>
+static void Z_forEachBlock(int tag, F &&func)
+{
+   for(memblock_t *block = blockbytag[tag]; block; block = block->next)
+      func(block);
+
+   for(arenachunk_t *chunk = arenas[tag].chunks; chunk; chunk = chunk->next)
+   {
+      for(size_t offs = 0; offs < chunk->used; )
+      {
+         memblock_t *block = (memblock_t *)(Z_arenaData(chunk) + offs);
+
+         if(Z_isResident(block) && block->tag == tag)
+            func(block);
+
+         offs += header_size + Z_arenaRound(block->size);
+      }
+   }
+}
+
 //=============================================================================
 //
 // Core Memory Management Routines
 //
 
 //
-// Z_Malloc
+// Z_allocate
 //
-// You can pass a nullptr user if the tag is < PU_PURGELEVEL.
+// Z_Malloc proper. Arena blocks are only handed out when allowed, and never
+// to blocks with an owner, which would have to be cleared on reset.
 //
-void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
+static void *Z_allocate(size_t size, int tag, void **user, bool allowarena,
+                        const char *file, int line)
 {
-   memblock_t *block;
+   memblock_t *block = nullptr;
    byte *ret;
 
    DEBUG_CHECKHEAP();
@@ -321,28 +572,36 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
 
    if(!size)
       return user ? *user = nullptr : nullptr;          // malloc(0) returns nullptr
-   
-   if(!(block = (memblock_t *)(malloc(size + header_size))))
+
+   if(allowarena && !user && Z_isArenaTag(tag) && size <= ARENA_MAXBLOCK)
+      block = Z_arenaAlloc(tag, size);
+
+   if(!block)
    {
-      if(blockbytag[PU_CACHE])
+      if(!(block = (memblock_t *)(malloc(size + header_size))))
       {
-         Z_FreeTags(PU_CACHE, PU_CACHE);
-         block = (memblock_t *)(malloc(size + header_size));
+         if(blockbytag[PU_CACHE])
+         {
+            Z_FreeTags(PU_CACHE, PU_CACHE);
+            block = (memblock_t *)(malloc(size + header_size));
+         }
       }
-   }
 
-   if(!block)
-   {
-      I_FatalError(I_ERR_KILL, "Z_Malloc: Failure trying to allocate %u bytes\n"
-                               "Source: %s:%d\n", (unsigned int)size, file, line);
+      if(!block)
+      {
+         I_FatalError(I_ERR_KILL, "Z_Malloc: Failure trying to allocate %u bytes\n"
+                                  "Source: %s:%d\n", (unsigned int)size, file, line);
+      }
+
+      block->chunk = nullptr;
+
+      if((block->next = blockbytag[tag]))
+         block->next->prev = &block->next;
+      blockbytag[tag] = block;
+      block->prev = &blockbytag[tag];
    }
    
    block->size = size;
-   
-   if((block->next = blockbytag[tag]))
-      block->next->prev = &block->next;
-   blockbytag[tag] = block;
-   block->prev = &blockbytag[tag];
            
    INSTRUMENT(memorybytag[tag] += block->size);
    INSTRUMENT(block->file = file);
@@ -366,6 +625,16 @@ void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
    return ret;
 }
 
+//
+// Z_Malloc
+//
+// You can pass a nullptr user if the tag is < PU_PURGELEVEL.
+//
+void *(Z_Malloc)(size_t size, int tag, void **user, const char *file, int line)
+{
+   return Z_allocate(size, tag, user, true, file, line);
+}
+
 //
 // Z_Free
 //
@@ -402,6 +671,7 @@ void (Z_Free)(void *p, const char *file, int line)
                      );
       }
       INSTRUMENT(memorybytag[block->tag] -= block->size);
+      const int tag = block->tag;
       block->tag = PU_FREE;       // Mark block freed
 
       // scramble memory -- weed out any bugs
@@ -410,10 +680,18 @@ void (Z_Free)(void *p, const char *file, int line)
       if(block->user)            // Nullify user if one exists
          *block->user = nullptr;
 
-      if((*block->prev = block->next))
-         block->next->prev = block->prev;
-         
-      free(block);
+      if(Z_isResident(block))
+         Z_arenaFree(block, tag);
+      else
+      {
+         if((*block->prev = block->next))
+            block->next->prev = block->prev;
+
+         if(block->chunk)
+            Z_arenaUnpin(block->chunk);
+         else
+            free(block);
+      }
          
       Z_LogPrintf("* Z_Free(p=%p, file=%s:%d)\n", p, file, line);
    }
@@ -448,6 +726,9 @@ void (Z_FreeTags)(int lowtag, int hightag, const char *file, int line)
          (Z_Free)((byte *)block + header_size, file, line);
          block = next;               // Advance to next block
       }
+
+      if(Z_isArenaTag(lowtag))
+         Z_arenaReset(lowtag);
    }
 
    Z_LogPrintf("* Z_FreeTags(lowtag=%d, hightag=%d, file=%s:%d)\n",
@@ -483,7 +764,13 @@ void (Z_ChangeTag)(void *ptr, int tag, const char *file, int line)
              "Z_ChangeTag: an owner is required for purgable blocks",
              block, file, line);
 
-   if((*block->prev = block->next))
+   if(Z_isResident(block))
+   {
+      if(tag == block->tag)
+         return;
+      Z_arenaPin(block);
+   }
+   else if((*block->prev = block->next))
       block->next->prev = block->prev;
    if((block->next = blockbytag[tag]))
       block->next->prev = &block->next;
@@ -534,6 +821,20 @@ void *(Z_Realloc)(void *ptr, size_t n, int tag, void **user,
    if(block->tag == PU_PERMANENT)
       tag = PU_PERMANENT;
 
+   // Arena blocks can't be resized in place. Move them to the system heap,
+   // so a block that keeps growing doesn't leave a trail of copies behind.
+   if(block->chunk)
+   {
+      p = Z_allocate(n, tag, user, false, file, line);
+      memcpy(p, ptr, n < block->size ? n : block->size);
+      block->user = nullptr;
+      (Z_Free)(ptr, file, line);
+
+      Z_LogPrintf("* %p = Z_Realloc(ptr=%p, n=%lu, tag=%d, user=%p, source=%s:%d)\n", 
+                  p, ptr, n, tag, user, file, line);
+      return p;
+   }
+
    // nullify current user, if any
    if(block->user)
       *(block->user) = nullptr;
@@ -627,17 +928,13 @@ char *(Z_Strdup)(const char *s, int tag, void **user,
 void (Z_CheckHeap)(const char *file, int line)
 {
 #ifdef ZONEIDCHECK
-   memblock_t *block;
-   int lowtag;
-
-   for(lowtag = PU_FREE+1; lowtag < PU_MAX; ++lowtag)
+   for(int lowtag = PU_FREE+1; lowtag < PU_MAX; ++lowtag)
    {
-      for(block = blockbytag[lowtag]; block; block = block->next)
-      {
+      Z_forEachBlock(lowtag, [file, line](memblock_t *block) {
          Z_IDCheck(IDBOOL(block->id != ZONEID),
                    "Z_CheckHeap: Block found without ZONEID", 
                    block, file, line);
-      }
+      });
    }
 #endif
 
@@ -671,7 +968,6 @@ int (Z_CheckTag)(void *ptr, const char *file, int line)
 //
 void Z_PrintZoneHeap(void)
 {
-   memblock_t *block;
    int lowtag;
    FILE *outfile;
 
@@ -693,8 +989,7 @@ void Z_PrintZoneHeap(void)
 
    for(lowtag = PU_FREE; lowtag < PU_MAX; ++lowtag)
    {
-      for(block = blockbytag[lowtag]; block; block = block->next)
-      {
+      Z_forEachBlock(lowtag, [outfile, fmtstr](memblock_t *block) {
          fprintf(outfile, fmtstr, block,
 #if defined(ZONEIDCHECK)
                  block->id, 
@@ -720,7 +1015,7 @@ void Z_PrintZoneHeap(void)
             fputs("\tWARNING: invalid cache level\n", outfile);
          
          fflush(outfile);
-      }
+      });
    }
 
    fclose(outfile);
@@ -748,16 +1043,12 @@ void Z_DumpCore()
    };
 
    int tag;
-   memblock_t *block;
    uint32_t dirofs = 12;
    uint32_t dirlen;
    uint32_t numentries = 0;
 
    for(tag = PU_FREE+1; tag < PU_MAX; tag++)
-   {
-      for(block = blockbytag[tag]; block; block = block->next)
-         ++numentries;
-   }
+      Z_forEachBlock(tag, [&numentries](memblock_t *) { ++numentries; });
 
    dirlen = numentries * 64; // crazy PAK format...
 
@@ -771,8 +1062,7 @@ void Z_DumpCore()
    uint32_t offs = 12 + 64 * numentries;
    for(tag = PU_FREE+1; tag < PU_MAX; tag++)
    {
-      for(block = blockbytag[tag]; block; block = block->next)
-      {
+      Z_forEachBlock(tag, [f, &offs](memblock_t *block) {
          char     name[56];
          uint32_t filepos = offs;
          uint32_t filelen = (uint32_t)(block->size);
@@ -786,13 +1076,14 @@ void Z_DumpCore()
          fwrite(&filelen, sizeof(filelen), 1, f);
 
          offs += filelen;
-      }
+      });
    }
 
    for(tag = PU_FREE+1; tag < PU_MAX; tag++)
    {
-      for(block = blockbytag[tag]; block; block = block->next)
+      Z_forEachBlock(tag, [f](memblock_t *block) {
          fwrite(((byte *)block + header_size), block->size, 1, f);
+      });
    }
 
    fclose(f);